@@ -92,6 +92,17 @@ typedef struct
      * finalize the interface
      */
     void (*finalize)();
+
+    /**
+     * get the frequency a core/uncore is actually running at
+     * Other than get_frequency, which returns the configured frequency (range), this is the
+     * frequency observed by the hardware, e.g., the uncore frequency selected within a range.
+     * Callers must check whether this function exists (get_current_frequency == NULL) before using
+     * it.
+     * @param fp from init_device
+     * @return frequency in Hz or an error (<0)
+     */
+    long long int (*get_current_frequency)(freq_gen_single_device_t fp);
 } freq_gen_interface_t;
 
 /**
@@ -106,6 +117,46 @@ typedef struct
  */
 freq_gen_interface_t* freq_gen_init(freq_gen_dev_type type);
 
+/**
+ * An initialized interface and its measured costs, see freq_gen_init_ranked()
+ */
+typedef struct
+{
+    freq_gen_interface_t* interface;
+    int device;    /**< the device that has been used for measuring */
+    double get_ns; /**< average time of a get_frequency call in ns */
+    double set_ns; /**< average time of a set_frequency call in ns */
+} freq_gen_ranked_interface_t;
+
+/**
+ * Will initialize all suitable interfaces for a device type, measure a few get_frequency and
+ * set_frequency calls on the first device that can be opened, and sort them by the sum of both
+ * costs, fastest first. The current frequency is written back, so settings do not change.
+ * LIBFREQGEN_CORE_INTERFACE and LIBFREQGEN_UNCORE_INTERFACE are respected, i.e., only the selected
+ * interface is measured.
+ * All returned interfaces are initialized. Use freq_gen_select_ranked() to pick one and finalize
+ * the others.
+ * @param ranked array with max_interfaces entries
+ * @return the number of interfaces in ranked or -ERRNO
+ */
+int freq_gen_init_ranked(freq_gen_dev_type type, freq_gen_ranked_interface_t* ranked,
+                         int max_interfaces);
+
+/**
+ * Will finalize all interfaces of a ranked list except the one at index
+ * @return the selected interface, ready to use like the result of freq_gen_init()
+ */
+freq_gen_interface_t* freq_gen_select_ranked(freq_gen_dev_type type,
+                                             freq_gen_ranked_interface_t* ranked,
+                                             int nr_interfaces, int index);
+
+/**
+ * Will return the interface with the lowest measured get and set costs, see
+ * freq_gen_init_ranked()
+ * @return NULL if there is no suitable interface
+ */
+freq_gen_interface_t* freq_gen_init_fastest(freq_gen_dev_type type);
+
 /**
  * Returns the current error string, which tells you what went wrong
  */
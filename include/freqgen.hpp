@@ -0,0 +1,634 @@
+/*
+ * freqgen.hpp
+ *
+ * Header-only C++17 API. Devices and sessions are RAII objects, settings are values, and the
+ * backend is a template policy:
+ *  - runtime_backend dispatches through freq_gen_interface_t like the C API
+ *  - msr_backend<type> accesses /dev/cpu/(cpu)/msr[-safe] directly, so setting a frequency is an
+ *    inlined pwrite with a precomputed register value
+ * default_backend<type> is msr_backend if FREQGEN_CXX_BACKEND_MSR is defined (CMake option
+ * FREQGEN_CXX_BACKEND=msr) and runtime_backend otherwise.
+ * With C++20 coroutines, co_await transition(device, setting) resumes once the new frequency is
+ * observed.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_HPP_
+#define SRC_FREQGEN_HPP_
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cpuid.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <thread>
+#define FREQGEN_HAS_COROUTINES 1
+#endif
+
+extern "C" {
+#include "freqgen.h"
+}
+
+namespace freqgen
+{
+
+enum class device_type
+{
+    core = FREQ_GEN_DEVICE_CORE_FREQ,
+    uncore = FREQ_GEN_DEVICE_UNCORE_FREQ
+};
+
+/** thrown on failures, what() contains freq_gen_error_string() if the C library set an error */
+class error : public std::runtime_error
+{
+public:
+    error(const std::string& message, int code)
+    : std::runtime_error(message + "\n" + library_error()), code_(code)
+    {
+    }
+
+    /** error defined in errno.h */
+    int code() const noexcept
+    {
+        return code_;
+    }
+
+private:
+    static std::string library_error()
+    {
+        const char* string = freq_gen_error_string();
+        return string != nullptr ? string : "";
+    }
+
+    int code_;
+};
+
+/** dispatches through the interface returned by freq_gen_init() */
+class runtime_backend
+{
+public:
+    using handle_type = freq_gen_single_device_t;
+
+    /** a prepared setting, owns the setting of the interface */
+    class setting
+    {
+    public:
+        setting() = default;
+        setting(freq_gen_interface_t* interface, long long int frequency)
+        : interface_(interface), setting_(interface->prepare_set_frequency(frequency, 0)),
+          frequency_(frequency)
+        {
+            if (setting_ == nullptr)
+                throw error("could not prepare frequency " + std::to_string(frequency), EINVAL);
+        }
+        setting(const setting&) = delete;
+        setting& operator=(const setting&) = delete;
+        setting(setting&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+        setting& operator=(setting&& other) noexcept
+        {
+            std::swap(interface_, other.interface_);
+            std::swap(setting_, other.setting_);
+            std::swap(frequency_, other.frequency_);
+            return *this;
+        }
+        ~setting()
+        {
+            if (setting_ != nullptr)
+                interface_->unprepare_set_frequency(setting_);
+        }
+
+        long long int frequency() const noexcept
+        {
+            return frequency_;
+        }
+        freq_gen_setting_t get() const noexcept
+        {
+            return setting_;
+        }
+
+    private:
+        freq_gen_interface_t* interface_ = nullptr;
+        freq_gen_setting_t setting_ = nullptr;
+        long long int frequency_ = 0;
+    };
+
+    explicit runtime_backend(device_type type)
+    : interface_(freq_gen_init(static_cast<freq_gen_dev_type>(type)))
+    {
+        if (interface_ == nullptr)
+            throw error("could not initialize interface", ENODEV);
+    }
+
+    /** takes ownership of an interface, e.g., from freq_gen_init_fastest() */
+    explicit runtime_backend(freq_gen_interface_t* interface) : interface_(interface)
+    {
+        if (interface_ == nullptr)
+            throw error("no interface given", EINVAL);
+    }
+
+    runtime_backend(const runtime_backend&) = delete;
+    runtime_backend& operator=(const runtime_backend&) = delete;
+    runtime_backend(runtime_backend&& other) noexcept : interface_(other.interface_)
+    {
+        other.interface_ = nullptr;
+    }
+    runtime_backend& operator=(runtime_backend&& other) noexcept
+    {
+        std::swap(interface_, other.interface_);
+        return *this;
+    }
+    ~runtime_backend()
+    {
+        if (interface_ != nullptr)
+            interface_->finalize();
+    }
+
+    const char* name() const noexcept
+    {
+        return interface_->name;
+    }
+    freq_gen_interface_t* interface() const noexcept
+    {
+        return interface_;
+    }
+
+    int num_devices() const
+    {
+        int nr = interface_->get_num_devices();
+        if (nr < 0)
+            throw error("could not get the number of devices", -nr);
+        return nr;
+    }
+
+    /** @return a handle or -ERRNO */
+    handle_type open(int device) const noexcept
+    {
+        return interface_->init_device(device);
+    }
+    void close(int device, handle_type handle) const noexcept
+    {
+        interface_->close_device(device, handle);
+    }
+
+    setting prepare(long long int frequency) const
+    {
+        return setting(interface_, frequency);
+    }
+
+    /** @return frequency in Hz or -ERRNO */
+    long long int get_frequency(handle_type handle) const noexcept
+    {
+        return interface_->get_frequency(handle);
+    }
+    long long int get_min_frequency(handle_type handle) const noexcept
+    {
+        return interface_->get_min_frequency != nullptr ? interface_->get_min_frequency(handle)
+                                                        : -ENOTSUP;
+    }
+    long long int get_current_frequency(handle_type handle) const noexcept
+    {
+        return interface_->get_current_frequency != nullptr
+                   ? interface_->get_current_frequency(handle)
+                   : -ENOTSUP;
+    }
+
+    /** @return 0 or an error */
+    int set_frequency(handle_type handle, const setting& setting) const noexcept
+    {
+        return interface_->set_frequency(handle, setting.get());
+    }
+    int set_min_frequency(handle_type handle, const setting& setting) const noexcept
+    {
+        return interface_->set_min_frequency != nullptr
+                   ? interface_->set_min_frequency(handle, setting.get())
+                   : ENOTSUP;
+    }
+
+private:
+    freq_gen_interface_t* interface_;
+};
+
+namespace detail
+{
+constexpr off_t ia32_perf_status = 0x198;
+constexpr off_t ia32_perf_ctl = 0x199;
+constexpr off_t uncore_ratio_limit = 0x620;
+constexpr off_t uncore_perf_status = 0x621;
+constexpr long long int ratio_hz = 100000000LL;
+
+/* Sandy and Ivy Bridge use the lower byte of IA32_PERF_CTL for the ratio, see msr-safe.c */
+inline bool core_ratio_in_low_byte()
+{
+    static const bool low_byte = [] {
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+            return false;
+        unsigned int model = (((eax >> 16) & 0xF) << 4) + ((eax >> 4) & 0xF);
+        return ((eax >> 8) & 0xF) == 6 &&
+               (model == 0x2a || model == 0x2d || model == 0x3a || model == 0x3e);
+    }();
+    return low_byte;
+}
+
+/* first cpu of /sys/devices/system/node/node(uncore)/cpulist */
+inline int uncore_leader_cpu(int uncore)
+{
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(uncore) + "/cpulist");
+    int cpu = -1;
+    if (!(file >> cpu))
+        return -ENODEV;
+    return cpu;
+}
+
+/* counts entries that are a prefix followed by a number in a directory */
+inline int count_numbered(const char* path, const char* prefix)
+{
+    DIR* dir = opendir(path);
+    if (dir == nullptr)
+        return -errno;
+    int max = -1;
+    std::size_t length = std::strlen(prefix);
+    while (struct dirent* entry = readdir(dir))
+    {
+        if (std::strncmp(entry->d_name, prefix, length) != 0)
+            continue;
+        char* end;
+        long number = std::strtol(entry->d_name + length, &end, 10);
+        if (end != entry->d_name + length && *end == '\0' && number > max)
+            max = number;
+    }
+    closedir(dir);
+    return max + 1;
+}
+} // namespace detail
+
+/**
+ * Direct access to the msr files, there is no indirect call on the set path.
+ * Cores are CPU numbers, uncores are NUMA nodes that are accessed through their first CPU, like
+ * the msr interface of the C library.
+ */
+template <device_type Type>
+class msr_backend
+{
+public:
+    using handle_type = int;
+
+    /** the precomputed register value, trivially copyable */
+    struct setting
+    {
+        std::uint64_t value;
+        long long int hz;
+
+        long long int frequency() const noexcept
+        {
+            return hz;
+        }
+    };
+
+    msr_backend() = default;
+    explicit msr_backend(device_type type)
+    {
+        if (type != Type)
+            throw error("msr_backend is specialized for another device type", EINVAL);
+    }
+
+    static const char* name() noexcept
+    {
+        return "msr";
+    }
+
+    static int num_devices()
+    {
+        int nr = Type == device_type::core ? detail::count_numbered("/dev/cpu", "")
+                                           : detail::count_numbered("/sys/devices/system/node",
+                                                                    "node");
+        if (nr <= 0)
+            throw error("could not get the number of devices", nr < 0 ? -nr : ENODEV);
+        return nr;
+    }
+
+    /** @return a file descriptor or -ERRNO */
+    static handle_type open(int device) noexcept
+    {
+        int cpu = Type == device_type::core ? device : detail::uncore_leader_cpu(device);
+        if (cpu < 0)
+            return cpu;
+        std::string path = "/dev/cpu/" + std::to_string(cpu) + "/msr";
+        int fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0)
+            fd = ::open((path + "_safe").c_str(), O_RDWR);
+        return fd < 0 ? -errno : fd;
+    }
+    static void close(int, handle_type handle) noexcept
+    {
+        ::close(handle);
+    }
+
+    static setting prepare(long long int frequency) noexcept
+    {
+        std::uint64_t ratio = frequency / detail::ratio_hz;
+        if (Type == device_type::uncore)
+            return { ratio | (ratio << 8), frequency };
+        return { detail::core_ratio_in_low_byte() ? ratio : ratio << 8, frequency };
+    }
+
+    static long long int get_frequency(handle_type handle) noexcept
+    {
+        std::uint64_t value;
+        if (Type == device_type::core)
+        {
+            if (::pread(handle, &value, 8, detail::ia32_perf_ctl) != 8)
+                return -EIO;
+            return (detail::core_ratio_in_low_byte() ? value & 0xFF : (value >> 8) & 0xFF) *
+                   detail::ratio_hz;
+        }
+        if (::pread(handle, &value, 8, detail::uncore_ratio_limit) != 8)
+            return -EIO;
+        return (value & 0x7F) * detail::ratio_hz;
+    }
+    static long long int get_min_frequency(handle_type handle) noexcept
+    {
+        std::uint64_t value;
+        if (Type == device_type::core)
+            return -ENOTSUP;
+        if (::pread(handle, &value, 8, detail::uncore_ratio_limit) != 8)
+            return -EIO;
+        return ((value >> 8) & 0x7F) * detail::ratio_hz;
+    }
+    static long long int get_current_frequency(handle_type handle) noexcept
+    {
+        std::uint64_t value;
+        if (Type == device_type::core)
+        {
+            if (::pread(handle, &value, 8, detail::ia32_perf_status) != 8)
+                return -EIO;
+            return (detail::core_ratio_in_low_byte() ? value & 0xFF : (value >> 8) & 0xFF) *
+                   detail::ratio_hz;
+        }
+        if (::pread(handle, &value, 8, detail::uncore_perf_status) != 8)
+            return -EIO;
+        return (value & 0x7F) * detail::ratio_hz;
+    }
+
+    static int set_frequency(handle_type handle, const setting& setting) noexcept
+    {
+        off_t offset = Type == device_type::core ? detail::ia32_perf_ctl : detail::uncore_ratio_limit;
+        return ::pwrite(handle, &setting.value, 8, offset) == 8 ? 0 : EIO;
+    }
+    static int set_min_frequency(handle_type handle, const setting& setting) noexcept
+    {
+        if (Type == device_type::core)
+            return ENOTSUP;
+        std::uint64_t value;
+        if (::pread(handle, &value, 8, detail::uncore_ratio_limit) != 8)
+            return EIO;
+        value = (value & ~std::uint64_t(0xFF00)) | (setting.value & 0xFF00);
+        return ::pwrite(handle, &value, 8, detail::uncore_ratio_limit) == 8 ? 0 : EIO;
+    }
+};
+
+#ifdef FREQGEN_CXX_BACKEND_MSR
+template <device_type Type>
+using default_backend = msr_backend<Type>;
+#else
+template <device_type Type>
+using default_backend = runtime_backend;
+#endif
+
+/** an opened device, closed on destruction */
+template <class Backend>
+class device
+{
+public:
+    using setting = typename Backend::setting;
+
+    device(const Backend& backend, int number)
+    : backend_(&backend), number_(number), handle_(backend.open(number))
+    {
+        if (handle_ < 0)
+            throw error("could not open device " + std::to_string(number), -handle_);
+    }
+    /** takes ownership of a handle returned by backend.open(number) */
+    device(const Backend& backend, int number, typename Backend::handle_type handle)
+    : backend_(&backend), number_(number), handle_(handle)
+    {
+    }
+    device(const device&) = delete;
+    device& operator=(const device&) = delete;
+    device(device&& other) noexcept
+    : backend_(other.backend_), number_(other.number_), handle_(other.handle_)
+    {
+        other.handle_ = -1;
+    }
+    device& operator=(device&& other) noexcept
+    {
+        std::swap(backend_, other.backend_);
+        std::swap(number_, other.number_);
+        std::swap(handle_, other.handle_);
+        return *this;
+    }
+    ~device()
+    {
+        if (handle_ >= 0)
+            backend_->close(number_, handle_);
+    }
+
+    int number() const noexcept
+    {
+        return number_;
+    }
+    typename Backend::handle_type handle() const noexcept
+    {
+        return handle_;
+    }
+    const Backend& backend() const noexcept
+    {
+        return *backend_;
+    }
+
+    long long int frequency() const
+    {
+        return check(backend_->get_frequency(handle_), "read the frequency");
+    }
+    long long int min_frequency() const
+    {
+        return check(backend_->get_min_frequency(handle_), "read the minimal frequency");
+    }
+    long long int current_frequency() const
+    {
+        return check(backend_->get_current_frequency(handle_), "read the current frequency");
+    }
+
+    /** @return 0 or an error, does not throw for use in hot paths */
+    int set(const setting& setting) const noexcept
+    {
+        return backend_->set_frequency(handle_, setting);
+    }
+    int set_min(const setting& setting) const noexcept
+    {
+        return backend_->set_min_frequency(handle_, setting);
+    }
+
+private:
+    long long int check(long long int value, const char* what) const
+    {
+        if (value < 0)
+            throw error("could not " + std::string(what) + " of device " + std::to_string(number_),
+                        static_cast<int>(-value));
+        return value;
+    }
+
+    const Backend* backend_;
+    int number_;
+    typename Backend::handle_type handle_;
+};
+
+/** a set of opened devices */
+template <class Backend>
+class session
+{
+public:
+    using setting = typename Backend::setting;
+
+    /** opens all devices that can be opened */
+    explicit session(const Backend& backend)
+    {
+        int nr = backend.num_devices();
+        for (int number = 0; number < nr; number++)
+        {
+            auto handle = backend.open(number);
+            if (handle < 0)
+                continue;
+            devices_.emplace_back(backend, number, handle);
+        }
+        if (devices_.empty())
+            throw error("could not open any device", ENODEV);
+    }
+    session(const Backend& backend, const std::vector<int>& numbers)
+    {
+        devices_.reserve(numbers.size());
+        for (int number : numbers)
+            devices_.emplace_back(backend, number);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return devices_.size();
+    }
+    const device<Backend>& operator[](std::size_t index) const noexcept
+    {
+        return devices_[index];
+    }
+    auto begin() const noexcept
+    {
+        return devices_.begin();
+    }
+    auto end() const noexcept
+    {
+        return devices_.end();
+    }
+
+    /** @return 0 or the first error, all devices are tried */
+    int set(const setting& setting) const noexcept
+    {
+        int ret = 0;
+        for (const auto& device : devices_)
+        {
+            int result = device.set(setting);
+            if (ret == 0)
+                ret = result;
+        }
+        return ret;
+    }
+    int set_min(const setting& setting) const noexcept
+    {
+        int ret = 0;
+        for (const auto& device : devices_)
+        {
+            int result = device.set_min(setting);
+            if (ret == 0)
+                ret = result;
+        }
+        return ret;
+    }
+
+private:
+    std::vector<device<Backend>> devices_;
+};
+
+#ifdef FREQGEN_HAS_COROUTINES
+/**
+ * co_await transition(device, setting) sets the frequency and resumes the coroutine on a helper
+ * thread once get_current_frequency reports the new frequency (within half a 100 MHz step) or the
+ * timeout expired. device and setting must outlive the co_await expression. The result is 0, ETIMEDOUT or the error of the set call.
+ * Without get_current_frequency, the coroutine resumes right after the set call.
+ */
+template <class Backend>
+class transition
+{
+public:
+    transition(const device<Backend>& device, const typename Backend::setting& setting,
+               std::chrono::nanoseconds timeout = std::chrono::milliseconds(10))
+    : device_(device), setting_(setting), timeout_(timeout)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        std::thread([this, handle] {
+            result_ = device_.set(setting_);
+            auto deadline = std::chrono::steady_clock::now() + timeout_;
+            while (result_ == 0)
+            {
+                long long int current = device_.backend().get_current_frequency(device_.handle());
+                if (current < 0 || std::llabs(current - setting_.frequency()) <= detail::ratio_hz / 2)
+                    break;
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    result_ = ETIMEDOUT;
+                    break;
+                }
+            }
+            handle.resume();
+        }).detach();
+    }
+
+    int await_resume() const noexcept
+    {
+        return result_;
+    }
+
+private:
+    const device<Backend>& device_;
+    const typename Backend::setting& setting_;
+    std::chrono::nanoseconds timeout_;
+    int result_ = 0;
+};
+#endif
+
+} // namespace freqgen
+
+#endif /* SRC_FREQGEN_HPP_ */
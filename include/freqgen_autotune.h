@@ -0,0 +1,147 @@
+/*
+ * freqgen_autotune.h
+ *
+ * Offline autotuning of the core and uncore frequency of a kernel. The tuner applies (core, uncore)
+ * pairs through sessions, runs a user kernel with warm-up and repetitions at every pair and
+ * measures its runtime and package and DRAM energy (RAPL via powercap or a user-supplied measure
+ * function). The result holds all measured points, their Pareto front over runtime and energy and
+ * the points with the lowest energy, EDP (energy * time) and ED2P (energy * time^2). The best
+ * point can be added to a tuning model (see freqgen_model.h).
+ *
+ * Sweeping all pairs can take hours, so two pruning strategies are available:
+ * - coarse to fine: measure every coarse_stride-th frequency, then halve the stride around the
+ *   best points of all objectives until all neighbours of the best points have been measured.
+ * - early stop: after min_repetitions, the repetitions of a point stop when its objective is
+ *   worse than the best point by more than early_stop. Core frequencies are swept from high to
+ *   low, and a sweep stops after two consecutive points that have been stopped early.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_AUTOTUNE_H_
+#define SRC_FREQGEN_AUTOTUNE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "freqgen.h"
+#include "freqgen_model.h"
+#include "freqgen_session.h"
+
+/**
+ * Run the kernel once
+ * @return 0 or an error defined in errno.h (or its negation), which aborts the sweep
+ */
+typedef int (*freq_gen_autotune_kernel_t)(void* data);
+
+/**
+ * Measure the energy of the node, replaces the powercap RAPL counters
+ * @param package_joules cumulative energy of all packages
+ * @param dram_joules cumulative energy of all DRAM domains, 0 if not available
+ * @return 0 or an error defined in errno.h
+ */
+typedef int (*freq_gen_autotune_measure_t)(double* package_joules, double* dram_joules,
+                                           void* data);
+
+/** the objectives a point can be optimal for */
+typedef enum {
+    FREQ_GEN_AUTOTUNE_ENERGY, /**< package + DRAM energy */
+    FREQ_GEN_AUTOTUNE_EDP,    /**< energy * time */
+    FREQ_GEN_AUTOTUNE_ED2P,   /**< energy * time^2 */
+    FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES
+} freq_gen_autotune_objective;
+
+typedef struct
+{
+    /** cores to tune, NULL to keep the core frequency */
+    freq_gen_session_t* core;
+    /** uncores to tune, NULL to keep the uncore frequency */
+    freq_gen_session_t* uncore;
+
+    /** core frequencies to sweep in Hz and their distance, 0 for 100 MHz */
+    long long int core_min_frequency;
+    long long int core_max_frequency;
+    long long int core_step;
+    /** uncore frequencies to sweep in Hz and their distance, 0 for 100 MHz */
+    long long int uncore_min_frequency;
+    long long int uncore_max_frequency;
+    long long int uncore_step;
+
+    /** runs of the kernel per point that are not measured, 0 for 1, -1 for none */
+    int warmup;
+    /** measured runs of the kernel per point, 0 for 5 */
+    int repetitions;
+    /** time to wait after changing frequencies in ns, 0 for 10 ms */
+    uint64_t settle_ns;
+
+    /** measure every coarse_stride-th frequency first, 0 or 1 for a full sweep */
+    int coarse_stride;
+    /** objective for pruning, the refinement of coarse to fine covers all objectives */
+    freq_gen_autotune_objective objective;
+    /** stop a point that is worse than the best point by this fraction, 0 to disable */
+    double early_stop;
+    /** repetitions before a point can be stopped, 0 for 2 */
+    int min_repetitions;
+
+    /** function that measures energy, NULL for /sys/class/powercap/intel-rapl:* */
+    freq_gen_autotune_measure_t measure;
+    void* measure_data;
+
+    /** called after every point, can be NULL */
+    void (*progress)(int measured, int total, void* data);
+    void* progress_data;
+} freq_gen_autotune_config_t;
+
+/** a measured (core, uncore) pair */
+typedef struct
+{
+    long long int core_frequency;   /**< in Hz, FREQ_GEN_MODEL_KEEP if not tuned */
+    long long int uncore_frequency; /**< in Hz, FREQ_GEN_MODEL_KEEP if not tuned */
+    double time;                    /**< mean runtime of the kernel in s */
+    double package_energy;          /**< mean package energy per run in J */
+    double dram_energy;             /**< mean DRAM energy per run in J */
+    double objectives[FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES];
+    int repetitions; /**< measured runs */
+    int stopped;     /**< stopped early, time and energy are less accurate */
+    int pareto;      /**< on the Pareto front over time and energy */
+} freq_gen_autotune_point_t;
+
+typedef struct
+{
+    freq_gen_autotune_point_t* points;
+    int nr_points;
+    /** number of pairs of the full sweep */
+    int nr_candidates;
+    /** index of the best point for every objective */
+    int best[FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES];
+} freq_gen_autotune_result_t;
+
+/**
+ * Sweep frequencies and measure the kernel. The frequencies of the sessions are restored
+ * afterwards.
+ * @param result is allocated and must be freed with freq_gen_autotune_result_free()
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_autotune_run(const freq_gen_autotune_config_t* config,
+                          freq_gen_autotune_kernel_t kernel, void* data,
+                          freq_gen_autotune_result_t** result);
+
+/**
+ * Add the best point for an objective as a region to a model
+ * @param id region id, 0 to use freq_gen_region_hash(name)
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_autotune_add_to_model(const freq_gen_autotune_result_t* result,
+                                   freq_gen_autotune_objective objective,
+                                   freq_gen_model_builder_t* builder, uint64_t id,
+                                   const char* name);
+
+/**
+ * Write all points as CSV, the Pareto front and the best points are marked
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_autotune_write_csv(const freq_gen_autotune_result_t* result, FILE* file);
+
+void freq_gen_autotune_result_free(freq_gen_autotune_result_t* result);
+
+#endif /* SRC_FREQGEN_AUTOTUNE_H_ */
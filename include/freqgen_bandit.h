@@ -0,0 +1,173 @@
+/*
+ * freqgen_bandit.h
+ *
+ * Online frequency selection per region. Every region runs a multi-armed bandit over a small set
+ * of (core, uncore) pairs, the arms. freq_gen_bandit_enter_region() picks an arm and applies it,
+ * freq_gen_bandit_exit_region() measures the cost of the invocation (time, energy or EDP) and
+ * updates the statistics of the arm. Arms are picked with UCB1 or Thompson sampling on the mean
+ * cost of every arm.
+ *
+ * Every arm is played twice first. Afterwards, exploration is bounded: a region converges to its
+ * best arm when it is better than all other arms with confidence (two standard errors), or after
+ * budget invocations that did not play the best arm. A converged region always plays its arm and
+ * is no longer measured, so entering it costs the same as entering a region of a tuning model.
+ * Converged regions can be stored in a tuning model and loaded on the next run, so they do not
+ * explore again.
+ *
+ * As with tuning models, all arms are prepared when the bandit is created, and a decision is a
+ * lookup in an open addressing hash table, a pass over the arms and the writes of the prepared
+ * settings to devices whose setting changes. Energy is read from the package zones of RAPL in
+ * /sys/class/powercap or a user-supplied measure function. RAPL is updated about every
+ * millisecond, so energy costs are only meaningful for longer regions.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_BANDIT_H_
+#define SRC_FREQGEN_BANDIT_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+#include "freqgen_model.h"
+#include "freqgen_session.h"
+
+/** the maximal number of arms */
+#define FREQ_GEN_BANDIT_MAX_ARMS 64
+
+/**
+ * Measure the energy of the node, replaces the perf RAPL counters
+ * @param joules cumulative energy so far
+ * @return 0 or an error defined in errno.h
+ */
+typedef int (*freq_gen_bandit_measure_t)(double* joules, void* data);
+
+typedef enum {
+    FREQ_GEN_BANDIT_THOMPSON, /**< play the arm with the lowest sample of a normal posterior */
+    FREQ_GEN_BANDIT_UCB       /**< UCB1, play the arm with the lowest confidence bound */
+} freq_gen_bandit_policy;
+
+/** the cost of an invocation that is minimized */
+typedef enum {
+    FREQ_GEN_BANDIT_TIME,   /**< runtime */
+    FREQ_GEN_BANDIT_ENERGY, /**< energy */
+    FREQ_GEN_BANDIT_EDP     /**< energy * runtime */
+} freq_gen_bandit_cost;
+
+/** a (core, uncore) pair */
+typedef struct
+{
+    long long int core_frequency;   /**< in Hz or FREQ_GEN_MODEL_KEEP */
+    long long int uncore_frequency; /**< in Hz or FREQ_GEN_MODEL_KEEP */
+} freq_gen_bandit_arm_t;
+
+typedef struct
+{
+    /** cores to change, NULL to not change cores */
+    freq_gen_session_t* core;
+    /** uncores to change, NULL to not change uncores */
+    freq_gen_session_t* uncore;
+
+    /** the pairs to choose from, at most FREQ_GEN_BANDIT_MAX_ARMS */
+    const freq_gen_bandit_arm_t* arms;
+    int nr_arms;
+
+    freq_gen_bandit_policy policy;
+    freq_gen_bandit_cost cost;
+    /** weight of exploration, 0 for 1: the confidence bound of UCB1 or the width of the
+     * posterior of Thompson sampling */
+    double exploration;
+    /** invocations of a region after the first two of every arm that do not play its best arm
+     * before it converges, 0 for 10 * nr_arms */
+    int budget;
+    /** number of regions that are tuned, others keep the settings of the enclosing region, 0 for
+     * 1024 */
+    int max_regions;
+    /** seed of Thompson sampling, 0 for a seed from the clock */
+    uint64_t seed;
+
+    /** function that measures energy, NULL for RAPL via powercap, only used for energy costs */
+    freq_gen_bandit_measure_t measure;
+    void* measure_data;
+} freq_gen_bandit_config_t;
+
+typedef struct
+{
+    uint64_t invocations;  /**< number of times the region was entered */
+    uint64_t explorations; /**< invocations that did not play the best arm */
+    int best_arm;          /**< arm with the lowest mean cost, -1 if none has been measured */
+    double best_cost;      /**< mean cost of best_arm in s, J or J*s */
+    int converged;         /**< best_arm is played from now on */
+} freq_gen_bandit_region_t;
+
+typedef struct
+{
+    uint64_t decisions; /**< number of entered regions */
+    uint64_t untracked; /**< entered regions that did not fit into max_regions */
+    int regions;        /**< number of tracked regions */
+    int converged;      /**< number of converged regions */
+    uint64_t errors;    /**< failed measurements */
+} freq_gen_bandit_stats_t;
+
+typedef struct freq_gen_bandit_s freq_gen_bandit_t;
+
+/**
+ * Create a bandit and prepare the settings of all arms for the interfaces of the sessions. The
+ * current frequency of every device of the sessions is read and restored when the outermost
+ * region is left, creating fails if it can not be read. A bandit must only be used by a single
+ * thread.
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_bandit_t* freq_gen_bandit_create(const freq_gen_bandit_config_t* config);
+
+/**
+ * Pick an arm for a region and apply it. Regions can be nested up to a depth of 64, the cost of a
+ * region includes the cost of nested regions.
+ * @param id region id, e.g., freq_gen_region_hash(name)
+ * @return 0 or the error of the first failed device
+ */
+int freq_gen_bandit_enter_region(freq_gen_bandit_t* bandit, uint64_t id);
+
+/**
+ * Leave the innermost region, update the statistics of its arm and restore the settings of the
+ * enclosing region
+ * @param id must be the id of the innermost region
+ * @return 0, EINVAL if id is not the innermost region, or the error of the first failed device
+ */
+int freq_gen_bandit_exit_region(freq_gen_bandit_t* bandit, uint64_t id);
+
+/**
+ * Get the state of a region
+ * @return 0 or ENOENT if the region has not been entered or loaded
+ */
+int freq_gen_bandit_get_region(freq_gen_bandit_t* bandit, uint64_t id,
+                               freq_gen_bandit_region_t* region);
+
+/**
+ * Forget the statistics of a region, e.g., when its input changed, so it explores again
+ * @return 0 or ENOENT if the region has not been entered or loaded
+ */
+int freq_gen_bandit_forget_region(freq_gen_bandit_t* bandit, uint64_t id);
+
+/**
+ * Mark regions of a model as converged to the arm with the same frequencies. Regions whose
+ * frequencies are not an arm are ignored.
+ * @return the number of loaded regions or -ERRNO, e.g., -ENOSPC if max_regions was exceeded
+ */
+int freq_gen_bandit_load(freq_gen_bandit_t* bandit, const freq_gen_model_t* model);
+
+/**
+ * Add all converged regions to a model
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_bandit_save(freq_gen_bandit_t* bandit, freq_gen_model_builder_t* builder);
+
+void freq_gen_bandit_get_stats(freq_gen_bandit_t* bandit, freq_gen_bandit_stats_t* stats);
+
+/**
+ * Free all prepared settings and close the energy counters. The sessions are not closed, but
+ * invalidated, since they do not know the frequencies applied by the bandit.
+ */
+void freq_gen_bandit_destroy(freq_gen_bandit_t* bandit);
+
+#endif /* SRC_FREQGEN_BANDIT_H_ */
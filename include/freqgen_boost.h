@@ -0,0 +1,106 @@
+/*
+ * freqgen_boost.h
+ *
+ * Scoped boosts for latency-critical sections. freq_gen_boost_acquire() raises the frequency of a
+ * device and returns a token. Releasing the token restores the previous frequency. A token that
+ * is not released within its maximal duration, e.g., because the thread is stuck, is released by
+ * a timer thread, so a boost is never left on.
+ *
+ * Tokens of a device are reference counted per frequency, the highest frequency with an active
+ * token is applied. The frequency of a device is read when it gets its first active token, this
+ * baseline is restored when the last token of the device is released or expires. Changes made by
+ * others (e.g., a governor) while the device has no tokens are therefore kept. A boost never
+ * lowers a device: tokens for frequencies at or below the baseline are counted, but not applied.
+ * For interfaces with a frequency range, the minimal frequency is restored as well.
+ *
+ * All boost frequencies are prepared when the boost context is created, baselines when they are
+ * captured (and only again if the frequency changed). The first token of a device reads its
+ * frequency. Other acquires and releases that do not change the highest active frequency of their
+ * device only take two uncontended locks and do not call the interface.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_BOOST_H_
+#define SRC_FREQGEN_BOOST_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+typedef struct
+{
+    /** interface that frequencies are applied through */
+    freq_gen_interface_t* interface;
+    /** devices that can be boosted, NULL for all devices of the interface */
+    const int* devices;
+    int nr_devices;
+
+    /** lowest and highest boost frequency in Hz, requests are rounded up to this grid */
+    long long int min_frequency;
+    long long int max_frequency;
+    /** distance of the boost frequencies in Hz, 0 for 100 MHz */
+    long long int step;
+
+    /** number of tokens that can be active at the same time, 0 for 1024 */
+    int max_tokens;
+    /** maximal duration if 0 is passed to freq_gen_boost_acquire(), 0 for 100 ms */
+    uint64_t default_duration_ns;
+    /** granularity of deadlines in ns, 0 for 1 ms */
+    uint64_t tick_ns;
+    /** cpu the timer thread is pinned to, -1 to not pin it */
+    int cpu;
+} freq_gen_boost_config_t;
+
+typedef struct
+{
+    uint64_t acquired; /**< number of acquired tokens */
+    uint64_t released; /**< number of tokens released by their owner */
+    uint64_t expired;  /**< number of tokens released by the timer thread */
+    uint64_t switches; /**< number of frequency changes, including restores */
+    uint64_t errors;   /**< failed set_frequency calls */
+} freq_gen_boost_stats_t;
+
+/** a token of an active boost, > 0 */
+typedef int64_t freq_gen_boost_token_t;
+
+typedef struct freq_gen_boost_s freq_gen_boost_t;
+
+/**
+ * Create a boost context, open all devices, prepare all boost frequencies and start the timer
+ * thread
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_boost_t* freq_gen_boost_create(const freq_gen_boost_config_t* config);
+
+/**
+ * Boost a device until the token is released or max_duration_ns has passed. Can be called from
+ * any thread.
+ * @param device device number as passed to init_device
+ * @param frequency requested frequency in Hz, rounded up to the grid of the context
+ * @param max_duration_ns time after which the boost is released automatically, 0 for the default
+ * @return a token or -ERRNO, e.g., -EBUSY if all tokens are in use or the error of get_frequency
+ * if the first token of the device could not read its baseline
+ */
+freq_gen_boost_token_t freq_gen_boost_acquire(freq_gen_boost_t* boost, int device,
+                                              long long int frequency, uint64_t max_duration_ns);
+
+/**
+ * Release a token. If no other token of the device requests this frequency, the next lower
+ * requested frequency above the baseline or the baseline is applied.
+ * @return 0, ETIMEDOUT if the token has already expired, EINVAL if it is not valid (anymore), or
+ * the error of set_frequency
+ */
+int freq_gen_boost_release(freq_gen_boost_t* boost, freq_gen_boost_token_t token);
+
+/**
+ * Get the number of tokens and frequency changes so far
+ */
+void freq_gen_boost_get_stats(freq_gen_boost_t* boost, freq_gen_boost_stats_t* stats);
+
+/**
+ * Stop the timer thread, release all tokens, close all devices and free the boost context
+ */
+void freq_gen_boost_destroy(freq_gen_boost_t* boost);
+
+#endif /* SRC_FREQGEN_BOOST_H_ */
@@ -0,0 +1,63 @@
+/*
+ * freqgen_broker.h
+ *
+ * The freqgen-broker daemon runs with the privileges to open /dev/cpu/(cpu)/msr_safe and
+ * /sys/devices/system/cpu/cpu(cpu)/cpufreq/scaling_setspeed. It opens these files once at start
+ * and passes duplicates of the file descriptors to unprivileged processes over a Unix socket
+ * (SCM_RIGHTS), if its policy allows the user, cgroup, cpu and register of the request. The cpu
+ * must also be in the affinity of the requesting process, for UNCORE_RATIO_LIMIT a cpu of the same
+ * package is sufficient.
+ * Afterwards, the process reads and writes the files directly, without a round trip to the
+ * daemon.
+ *
+ * The msr and sysfs backends request file descriptors from the broker when opening the files
+ * fails with EACCES or EPERM. The socket is LIBFREQGEN_BROKER or FREQ_GEN_BROKER_DEFAULT_SOCKET,
+ * an empty LIBFREQGEN_BROKER disables the broker.
+ *
+ * A request is a single freq_gen_broker_request_t. The broker answers with a
+ * freq_gen_broker_response_t, which carries the file descriptor as ancillary data if error is 0,
+ * and closes the connection.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_BROKER_H_
+#define SRC_FREQGEN_BROKER_H_
+
+#include <stdint.h>
+
+#define FREQ_GEN_BROKER_DEFAULT_SOCKET "/run/freqgen-broker.sock"
+
+/** "FGBR", first field of requests and responses */
+#define FREQ_GEN_BROKER_MAGIC 0x46474252U
+
+/** the files that can be requested */
+typedef enum {
+    FREQ_GEN_BROKER_MSR = 1,             /**< /dev/cpu/(cpu)/msr_safe */
+    FREQ_GEN_BROKER_SCALING_SETSPEED = 2 /**< cpufreq/scaling_setspeed of the cpu */
+} freq_gen_broker_file_t;
+
+typedef struct
+{
+    uint32_t magic;        /**< FREQ_GEN_BROKER_MAGIC */
+    uint32_t file;         /**< freq_gen_broker_file_t */
+    int32_t cpu;           /**< cpu of the file */
+    uint32_t msr_register; /**< for FREQ_GEN_BROKER_MSR, the register that will be written */
+} freq_gen_broker_request_t;
+
+typedef struct
+{
+    uint32_t magic; /**< FREQ_GEN_BROKER_MAGIC */
+    int32_t error;  /**< 0 or an error defined in errno.h, e.g., EACCES if the policy denies it */
+} freq_gen_broker_response_t;
+
+/**
+ * Request a file descriptor from the broker
+ * @param file the file to open
+ * @param cpu the cpu of the file
+ * @param msr_register for FREQ_GEN_BROKER_MSR, the register that will be written, otherwise 0
+ * @return a file descriptor opened for reading and writing or -ERRNO
+ */
+int freq_gen_broker_open(freq_gen_broker_file_t file, int cpu, uint32_t msr_register);
+
+#endif /* SRC_FREQGEN_BROKER_H_ */
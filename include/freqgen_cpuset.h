@@ -0,0 +1,39 @@
+/*
+ * freqgen_cpuset.h
+ *
+ * Restrict enumeration and control to the CPUs the process may run on, i.e., the intersection of
+ * its affinity mask and the cgroup v2 cpuset.cpus.effective. Uncore devices are allowed if they
+ * belong to a package of one of these CPUs.
+ *
+ * The scope can be enabled by setting LIBFREQGEN_CPUSET=1 or by calling
+ * freq_gen_cpuset_set_scope() before freq_gen_init().
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_CPUSET_H_
+#define SRC_FREQGEN_CPUSET_H_
+
+#include "freqgen.h"
+
+/**
+ * Enable or disable the cpuset scope. This overrides LIBFREQGEN_CPUSET.
+ * The allowed CPUs are read again on the next use.
+ * Call this before freq_gen_init(), the number of devices is cached by the interfaces.
+ */
+void freq_gen_cpuset_set_scope(int enable);
+
+/**
+ * @return 1 if the cpuset scope is enabled, 0 otherwise
+ */
+int freq_gen_cpuset_get_scope(void);
+
+/**
+ * Check whether a device can be used in the current scope
+ * @param type core or uncore
+ * @param device cpu or uncore number as passed to init_device
+ * @return 1 if the device is allowed or the scope is disabled, 0 otherwise
+ */
+int freq_gen_device_allowed(freq_gen_dev_type type, int device);
+
+#endif /* SRC_FREQGEN_CPUSET_H_ */
@@ -0,0 +1,142 @@
+/*
+ * freqgen_dither.h
+ *
+ * Frequency dithering emulates operating points between the discrete frequencies of the hardware,
+ * e.g., 2.35 GHz on a 100 MHz grid. A device alternates between the two neighbouring frequencies
+ * (2.3 and 2.4 GHz) with a duty cycle that yields the target on average: in every period, it runs
+ * at the upper frequency for duty * period and at the lower one for the rest.
+ *
+ * Every period contains two transitions. The period is chosen so that the transitions take at
+ * most max_overhead of it, based on the latency of the transition between both frequencies from a
+ * latency table (see freqgen_latency.h and freqgen-characterize) or a default latency.
+ *
+ * A dithering thread switches all devices at the boundaries of their duty cycles. All settings
+ * are prepared when the ditherer is created, so the thread only calls set_frequency. For cores,
+ * the achieved effective frequency is measured with APERF/MPERF (perf msr PMU) where available.
+ * For all devices, the time-weighted mean of the applied frequencies is reported.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_DITHER_H_
+#define SRC_FREQGEN_DITHER_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+#include "freqgen_latency.h"
+
+typedef struct
+{
+    /** interface that frequencies are applied through */
+    freq_gen_interface_t* interface;
+    /** device type of the interface, for latencies and APERF/MPERF */
+    freq_gen_dev_type type;
+    /** devices to dither, NULL for all devices of the interface */
+    const int* devices;
+    int nr_devices;
+
+    /** lowest and highest frequency in Hz, targets are clamped to this range */
+    long long int min_frequency;
+    long long int max_frequency;
+    /** distance of the hardware frequencies in Hz, 0 for 100 MHz */
+    long long int step;
+
+    /** measured transition latencies, NULL to use default_latency_ns */
+    const freq_gen_latency_table_t* latencies;
+    /** latency of a transition if it is not in latencies, 0 for 50 us */
+    uint64_t default_latency_ns;
+    /** fraction of a period that may be spent in transitions, 0 for 0.05 */
+    double max_overhead;
+    /** fixed period in ns instead of a period derived from the latency, 0 to derive it */
+    uint64_t period_ns;
+
+    /** cpu the dithering thread is pinned to, -1 to not pin it */
+    int cpu;
+    /** measure the effective frequency of cores with APERF/MPERF */
+    int measure_effective;
+} freq_gen_dither_config_t;
+
+/** the dithering of a device */
+typedef struct
+{
+    long long int target; /**< requested frequency, 0 if the device is not dithered */
+    long long int lower;  /**< lower frequency of the duty cycle */
+    long long int upper;  /**< upper frequency of the duty cycle */
+    double duty;          /**< fraction of a period at the upper frequency */
+    uint64_t period_ns;
+    uint64_t switches; /**< number of set_frequency calls for the device */
+    /** time-weighted mean of the applied frequencies since the last call, 0 if unknown */
+    long long int applied_frequency;
+    /** APERF/MPERF frequency since the last call, 0 if unknown, -ENOENT if not measured */
+    long long int effective_frequency;
+} freq_gen_dither_state_t;
+
+typedef struct
+{
+    uint64_t rounds;   /**< calls of freq_gen_dither_step() */
+    uint64_t switches; /**< number of set_frequency calls */
+    uint64_t errors;   /**< failed set_frequency calls */
+    double ns_per_round;
+    uint64_t max_ns_per_round;
+} freq_gen_dither_stats_t;
+
+typedef struct freq_gen_dither_s freq_gen_dither_t;
+
+/**
+ * Create a ditherer, open all devices and prepare all frequencies between min_frequency and
+ * max_frequency. No device is dithered until a target is set.
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_dither_t* freq_gen_dither_create(const freq_gen_dither_config_t* config);
+
+/**
+ * Set the target frequency of a device. Targets on the grid are applied without dithering.
+ * Can be called while the thread is running.
+ * @param device device number as passed to init_device, -1 for all devices
+ * @param frequency target in Hz, 0 to stop dithering the device (its frequency stays)
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_dither_set_target(freq_gen_dither_t* dither, int device, long long int frequency);
+
+/**
+ * Start the dithering thread, which calls freq_gen_dither_step() at every switch
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_dither_start(freq_gen_dither_t* dither);
+
+/**
+ * Stop the dithering thread, the last applied frequencies stay
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_dither_stop(freq_gen_dither_t* dither);
+
+/**
+ * Apply the frequencies all devices should run at now. Use this instead of the thread, e.g., with
+ * a virtual clock.
+ * @param now current time in ns
+ * @param next time of the next switch in ns, can be NULL
+ * @return the number of frequency changes or -ERRNO
+ */
+int freq_gen_dither_step(freq_gen_dither_t* dither, uint64_t now, uint64_t* next);
+
+/**
+ * Get the dithering of a device and the frequencies achieved since the last call for it. Must
+ * only be called by a single thread.
+ * @param device device number as passed to init_device
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_dither_get_state(freq_gen_dither_t* dither, int device,
+                              freq_gen_dither_state_t* state);
+
+/**
+ * Get the overhead and number of switches so far
+ */
+void freq_gen_dither_get_stats(freq_gen_dither_t* dither, freq_gen_dither_stats_t* stats);
+
+/**
+ * Stop the thread if running, close all devices and counters and free the ditherer
+ */
+void freq_gen_dither_destroy(freq_gen_dither_t* dither);
+
+#endif /* SRC_FREQGEN_DITHER_H_ */
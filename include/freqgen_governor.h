@@ -0,0 +1,157 @@
+/*
+ * freqgen_governor.h
+ *
+ * A core frequency governor. A background thread samples instructions, cycles, backend stall
+ * cycles and APERF/MPERF of every core through perf_event, classifies the workload of each core as
+ * idle, compute-bound or memory-bound and applies a frequency through any core interface.
+ *
+ * The decision logic is available separately (freq_gen_governor_update()), so counter traces that
+ * have been recorded with the governor can be replayed offline against the sim interface
+ * (freqgen_sim.h).
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_GOVERNOR_H_
+#define SRC_FREQGEN_GOVERNOR_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/** the workload class of a core */
+typedef enum {
+    FREQ_GEN_GOVERNOR_UNKNOWN, /**< no sample yet */
+    FREQ_GEN_GOVERNOR_IDLE,    /**< the core was mostly halted */
+    FREQ_GEN_GOVERNOR_COMPUTE, /**< few stalls, performance scales with the frequency */
+    FREQ_GEN_GOVERNOR_MEMORY   /**< many stalls, performance is limited by memory */
+} freq_gen_governor_class;
+
+/** flags of a sample */
+typedef enum {
+    FREQ_GEN_GOVERNOR_HAS_STALLS = 1 << 0, /**< stall_cycles has been counted */
+    FREQ_GEN_GOVERNOR_HAS_APERF = 1 << 1   /**< aperf, mperf and tsc have been counted */
+} freq_gen_governor_sample_flags;
+
+/** counter deltas of a core over one interval, 64 bytes */
+typedef struct
+{
+    uint64_t timestamp; /**< CLOCK_MONOTONIC in ns at the end of the interval */
+    uint32_t cpu;
+    uint32_t flags; /**< freq_gen_governor_sample_flags */
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t stall_cycles;
+    uint64_t aperf;
+    uint64_t mperf;
+    uint64_t tsc;
+} freq_gen_governor_sample_t;
+
+typedef struct
+{
+    /** core interface that frequencies are applied through */
+    freq_gen_interface_t* interface;
+    /** cpus to govern, NULL for all devices of the interface */
+    const int* cpus;
+    int nr_cpus;
+
+    /** lowest and highest frequency that is applied in Hz */
+    long long int min_frequency;
+    long long int max_frequency;
+    /** granularity of applied frequencies in Hz, 0 for 100 MHz */
+    long long int step;
+
+    /** 0 always runs at max_frequency, 1 lowers memory-bound cores down to min_frequency */
+    double energy_bias;
+    /** fraction of stalled cycles above which a core is memory-bound, 0 for 0.5 */
+    double memory_stall_ratio;
+    /** instructions per cycle below which a core is memory-bound if stalls cannot be counted, 0
+     * for 1.0 */
+    double memory_ipc;
+    /** fraction of unhalted cycles (MPERF/TSC) below which a core is idle, 0 for 0.05 */
+    double idle_ratio;
+    /** changes smaller than this are not applied, in Hz */
+    long long int hysteresis;
+    /** minimal time between two changes of a core in ns */
+    uint64_t min_change_interval_ns;
+
+    /** time between two samples of the governor thread in ns */
+    uint64_t interval_ns;
+    /** cpu the governor thread is pinned to, -1 to not pin it */
+    int cpu;
+    /** file that the samples of the governor thread are recorded to, NULL to not record them */
+    const char* record_path;
+} freq_gen_governor_config_t;
+
+/** the last decision for a core */
+typedef struct
+{
+    freq_gen_governor_class workload;
+    double ipc;              /**< instructions per cycle */
+    double stall_ratio;      /**< stalled cycles per cycle, <0 if unknown */
+    double busy_ratio;       /**< unhalted fraction of the interval, <0 if unknown */
+    long long int frequency; /**< the frequency that has been applied last, <0 if none */
+} freq_gen_governor_state_t;
+
+typedef struct
+{
+    uint64_t samples;      /**< number of processed samples */
+    uint64_t changes;      /**< number of applied frequency changes */
+    uint64_t hysteresis;   /**< changes that have been suppressed by the hysteresis */
+    uint64_t rate_limited; /**< changes that have been suppressed by min_change_interval_ns */
+    uint64_t errors;       /**< failed set_frequency calls and counter reads */
+} freq_gen_governor_stats_t;
+
+typedef struct freq_gen_governor_s freq_gen_governor_t;
+
+/**
+ * Create a governor and open all devices listed in config. Counters are opened by
+ * freq_gen_governor_start(), so governors for replays work without perf_event access.
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_governor_t* freq_gen_governor_create(const freq_gen_governor_config_t* config);
+
+/**
+ * Open the counters and start the governor thread
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_governor_start(freq_gen_governor_t* governor);
+
+/**
+ * Stop the governor thread, the last applied frequencies stay
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_governor_stop(freq_gen_governor_t* governor);
+
+/**
+ * Classify cores and apply frequencies for a number of samples. This is what the governor thread
+ * does for every interval, samples of cpus that are not governed are ignored.
+ * @return the number of applied changes or -ERRNO
+ */
+int freq_gen_governor_update(freq_gen_governor_t* governor,
+                             const freq_gen_governor_sample_t* samples, int nr_samples);
+
+/**
+ * Feed all samples of a file recorded with record_path to freq_gen_governor_update()
+ * @return the number of applied changes or -ERRNO
+ */
+long long int freq_gen_governor_replay(freq_gen_governor_t* governor, const char* path);
+
+/**
+ * Get the last decision for a cpu
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_governor_get_state(freq_gen_governor_t* governor, int cpu,
+                                freq_gen_governor_state_t* state);
+
+/**
+ * Get the number of samples and changes so far
+ */
+void freq_gen_governor_get_stats(freq_gen_governor_t* governor, freq_gen_governor_stats_t* stats);
+
+/**
+ * Stop the governor if running, close all devices and free it
+ */
+void freq_gen_governor_destroy(freq_gen_governor_t* governor);
+
+#endif /* SRC_FREQGEN_GOVERNOR_H_ */
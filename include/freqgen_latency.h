@@ -0,0 +1,96 @@
+/*
+ * freqgen_latency.h
+ *
+ * Frequency transition latency tables as written by freqgen-characterize. A table holds one matrix
+ * per device type with percentiles of the time from calling set_frequency(from -> to) until the
+ * new frequency is observed. Use it to decide whether a region is long enough to be worth a
+ * switch.
+ *
+ * File format (host byte order): the magic "FGLATNCY", uint32_t version, uint32_t number of
+ * matrices. Each matrix has a uint32_t device type, a uint32_t number of frequencies n, a 24 byte
+ * interface name, n int64_t frequencies in Hz and n*n*FREQ_GEN_LATENCY_NUM uint32_t latencies in
+ * ns, indexed [from][to][statistic].
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_LATENCY_H_
+#define SRC_FREQGEN_LATENCY_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/** statistics stored per transition */
+typedef enum {
+    FREQ_GEN_LATENCY_P50 = 0,
+    FREQ_GEN_LATENCY_P90,
+    FREQ_GEN_LATENCY_P99,
+    FREQ_GEN_LATENCY_MAX,
+    FREQ_GEN_LATENCY_NUM
+} freq_gen_latency_stat;
+
+/** stored for transitions that have not been measured or never completed */
+#define FREQ_GEN_LATENCY_UNKNOWN UINT32_MAX
+
+typedef struct freq_gen_latency_table_s freq_gen_latency_table_t;
+
+/**
+ * Create an empty table
+ * @return NULL on failure
+ */
+freq_gen_latency_table_t* freq_gen_latency_create(void);
+
+/**
+ * Add a matrix for a device type, replacing an existing one. All latencies are
+ * FREQ_GEN_LATENCY_UNKNOWN.
+ * @param frequencies the frequencies in Hz that have been swept
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_latency_add_matrix(freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                const char* interface_name, int nr_frequencies,
+                                const long long int* frequencies);
+
+/**
+ * Compute and store the statistics of a transition from measured samples
+ * @param samples latencies in ns, will be sorted
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_latency_set_samples(freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                 int from_index, int to_index, uint32_t* samples, int nr_samples);
+
+/**
+ * Write a table to a file
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_latency_save(const freq_gen_latency_table_t* table, const char* path);
+
+/**
+ * Read a table from a file
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_latency_table_t* freq_gen_latency_load(const char* path);
+
+/**
+ * Get the expected latency of a transition. from and to are mapped to the closest frequencies
+ * in the matrix, so this is O(number of frequencies).
+ * @return the latency in ns, -ENOENT if the device type is not in the table or the transition has
+ * not been measured
+ */
+long long int freq_gen_latency_get(const freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                   long long int from, long long int to,
+                                   freq_gen_latency_stat stat);
+
+/**
+ * Get the frequencies of the matrix of a device type
+ * @return the number of frequencies or -ENOENT
+ */
+int freq_gen_latency_get_frequencies(const freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                     const long long int** frequencies);
+
+/**
+ * Free a table
+ */
+void freq_gen_latency_free(freq_gen_latency_table_t* table);
+
+#endif /* SRC_FREQGEN_LATENCY_H_ */
@@ -0,0 +1,126 @@
+/*
+ * freqgen_model.h
+ *
+ * A tuning model maps code regions to a core and an uncore frequency. Models are built offline
+ * and stored in a compact file that is mapped into memory at runtime. Regions are identified by a
+ * 64 bit id, e.g., the hash of their name (freq_gen_region_hash()), and found in O(1) in an open
+ * addressing hash table.
+ *
+ * A model is bound to a core and/or an uncore session. Binding prepares every frequency of the
+ * model once, so freq_gen_model_enter_region() and freq_gen_model_exit_region() only look up the
+ * region and write the prepared settings, without string handling, allocations or re-encoding.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_MODEL_H_
+#define SRC_FREQGEN_MODEL_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+#include "freqgen_session.h"
+
+/** pass this as frequency to leave a device type unchanged in a region */
+#define FREQ_GEN_MODEL_KEEP (-1LL)
+
+typedef struct freq_gen_model_builder_s freq_gen_model_builder_t;
+typedef struct freq_gen_model_s freq_gen_model_t;
+typedef struct freq_gen_model_runtime_s freq_gen_model_runtime_t;
+
+/**
+ * @return the region id for a name (64 bit FNV-1a, never 0)
+ */
+uint64_t freq_gen_region_hash(const char* name);
+
+/**
+ * Create an empty model
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_model_builder_t* freq_gen_model_builder_create(void);
+
+/**
+ * Add a region or replace the frequencies of a region
+ * @param id region id, 0 to use freq_gen_region_hash(name)
+ * @param name name of the region, stored for tools, can be NULL
+ * @param core_frequency in Hz or FREQ_GEN_MODEL_KEEP
+ * @param uncore_frequency in Hz or FREQ_GEN_MODEL_KEEP
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_model_builder_add(freq_gen_model_builder_t* builder, uint64_t id, const char* name,
+                               long long int core_frequency, long long int uncore_frequency);
+
+/**
+ * Write the model to a file
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_model_builder_save(freq_gen_model_builder_t* builder, const char* path);
+
+void freq_gen_model_builder_free(freq_gen_model_builder_t* builder);
+
+/**
+ * Map a model file
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_model_t* freq_gen_model_open(const char* path);
+
+/**
+ * @return the number of regions in a model
+ */
+int freq_gen_model_get_num_regions(const freq_gen_model_t* model);
+
+/**
+ * Get a region by index, e.g., to list all regions
+ * @param name is set to the name of the region or NULL, can be NULL
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_model_get_region(const freq_gen_model_t* model, int index, uint64_t* id,
+                              const char** name, long long int* core_frequency,
+                              long long int* uncore_frequency);
+
+/**
+ * Find the frequencies of a region
+ * @return 0 or ENOENT if the region is not in the model
+ */
+int freq_gen_model_lookup(const freq_gen_model_t* model, uint64_t id, long long int* core_frequency,
+                          long long int* uncore_frequency);
+
+/**
+ * Unmap a model, all runtimes must have been freed before
+ */
+void freq_gen_model_close(freq_gen_model_t* model);
+
+/**
+ * Prepare the settings of all regions for the interfaces of the sessions. The current frequency of
+ * every device of the sessions is read and restored when the outermost region is left, binding
+ * fails if it can not be read.
+ * A runtime must only be used by a single thread.
+ * @param core session with the cores to change, NULL to not change cores
+ * @param uncore session with the uncores to change, NULL to not change uncores
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_model_runtime_t* freq_gen_model_bind(const freq_gen_model_t* model,
+                                              freq_gen_session_t* core,
+                                              freq_gen_session_t* uncore);
+
+/**
+ * Apply the settings of a region. Regions that are not in the model keep the settings of the
+ * enclosing region. Regions can be nested up to a depth of 64.
+ * @return 0 or the error of the first failed device
+ */
+int freq_gen_model_enter_region(freq_gen_model_runtime_t* runtime, uint64_t id);
+
+/**
+ * Leave the innermost region and restore the settings of the enclosing region
+ * @param id must be the id of the innermost region
+ * @return 0, EINVAL if id is not the innermost region, or the error of the first failed device
+ */
+int freq_gen_model_exit_region(freq_gen_model_runtime_t* runtime, uint64_t id);
+
+/**
+ * Free all prepared settings. The sessions are not closed, but invalidated, since they do not
+ * know the frequencies applied by the runtime.
+ */
+void freq_gen_model_runtime_free(freq_gen_model_runtime_t* runtime);
+
+#endif /* SRC_FREQGEN_MODEL_H_ */
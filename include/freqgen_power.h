@@ -0,0 +1,186 @@
+/*
+ * freqgen_power.h
+ *
+ * A power budget allocator that distributes a node power budget over the frequencies of cores and
+ * uncores. Every device has a utility, the benefit of one GHz. Utilities are set by the user or,
+ * for cores, derived from the fraction of time in C0 (MPERF/TSC). Devices with a utility of 0 stay
+ * at their minimal frequency.
+ *
+ * The power model of a package is static_power + core_coefficient * sum(f_core^3) +
+ * uncore_coefficient * sum(f_uncore^3), with frequencies in GHz. Allocations assume fully active
+ * cores, so the budget holds if an idle core becomes busy. With calibrate, the coefficients are
+ * fitted with recursive least squares to the package energy (RAPL via powercap or a user-supplied
+ * measure function), weighting cores by their C0 residency where it can be measured.
+ *
+ * Frequencies are raised greedily by the best ratio of utility gain to power cost, lowered by the
+ * worst ratio when the budget is exceeded, and exchanged while a raise pays more than a lowering.
+ * The ratios are kept in two heaps. Only devices whose utility changed are re-sorted, so a round
+ * with few changes takes a few heap operations. Frequencies are applied with the bulk operations
+ * of freqgen_session.h, which skip devices whose frequency does not change.
+ *
+ * Uncore devices are numbered by package, as in the msr and sim interfaces.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_POWER_H_
+#define SRC_FREQGEN_POWER_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/**
+ * Measure the energy of a package, replaces the powercap RAPL counters
+ * @param package the package number
+ * @param joules the cumulative energy of the package so far
+ * @return 0 or an error defined in errno.h
+ */
+typedef int (*freq_gen_power_measure_t)(int package, double* joules, void* data);
+
+typedef struct
+{
+    /** core interface that frequencies are applied through */
+    freq_gen_interface_t* core_interface;
+    /** cores to allocate, NULL for all devices of the interface */
+    const int* cores;
+    int nr_cores;
+    /** package of each entry of cores (of each cpu if cores is NULL), NULL to read
+     * topology/physical_package_id */
+    const int* core_packages;
+    /** uncore interface, NULL to only allocate core frequencies */
+    freq_gen_interface_t* uncore_interface;
+    /** uncores to allocate, NULL for all devices of the interface */
+    const int* uncores;
+    int nr_uncores;
+
+    /** core frequency range in Hz and the distance of the frequencies, 0 for 100 MHz */
+    long long int core_min_frequency;
+    long long int core_max_frequency;
+    long long int core_step;
+    /** uncore frequency range in Hz and the distance of the frequencies, 0 for 100 MHz */
+    long long int uncore_min_frequency;
+    long long int uncore_max_frequency;
+    long long int uncore_step;
+
+    /** node power budget in W */
+    double budget;
+
+    /** initial power model: W per package, 0 for 10 W */
+    double static_power;
+    /** initial power model: W per core at 1 GHz, 0 for 0.5 W */
+    double core_coefficient;
+    /** initial power model: W per uncore at 1 GHz, 0 for 2 W */
+    double uncore_coefficient;
+
+    /** fit the power model to measured package energy */
+    int calibrate;
+    /** time between two calibration samples in ns, 0 for 100 ms */
+    uint64_t calibration_interval_ns;
+    /** weight of older calibration samples, 0 for 0.98 */
+    double forgetting;
+    /** function that measures package energy, NULL for the RAPL zone package-(package) */
+    freq_gen_power_measure_t measure;
+    void* measure_data;
+
+    /** derive the utility of cores from their C0 residency instead of freq_gen_power_set_utility */
+    int counter_utilities;
+    /** utility changes up to this are ignored, 0 for 0.01 */
+    double utility_hysteresis;
+
+    /** time between two rounds of the allocator thread in ns, 0 for 1 ms */
+    uint64_t interval_ns;
+    /** cpu the allocator thread is pinned to, -1 to not pin it */
+    int cpu;
+} freq_gen_power_config_t;
+
+/** the power model and the last allocation */
+typedef struct
+{
+    double budget;             /**< in W */
+    double estimated_power;    /**< power of the allocated frequencies in W, all cores active */
+    double measured_power;     /**< power of all packages in the last calibration, 0 if none */
+    double static_power;       /**< current model: W per package */
+    double core_coefficient;   /**< current model: W per core at 1 GHz */
+    double uncore_coefficient; /**< current model: W per uncore at 1 GHz */
+    int over_budget;           /**< the budget is below the power at minimal frequencies */
+} freq_gen_power_state_t;
+
+typedef struct
+{
+    uint64_t rounds;       /**< calls of freq_gen_power_step() */
+    uint64_t updates;      /**< devices re-sorted because their utility changed */
+    uint64_t moves;        /**< frequency steps taken by the allocation */
+    uint64_t changes;      /**< devices whose frequency changed */
+    uint64_t calibrations; /**< calibration samples */
+    uint64_t errors;       /**< failed energy measurements and set_frequency calls */
+    double ns_per_round;
+    uint64_t max_ns_per_round;
+} freq_gen_power_stats_t;
+
+typedef struct freq_gen_power_s freq_gen_power_t;
+
+/**
+ * Create an allocator, open all devices in sessions and open the energy counters
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_power_t* freq_gen_power_create(const freq_gen_power_config_t* config);
+
+/**
+ * Change the node power budget, applied in the next round. Can be called from any thread.
+ */
+void freq_gen_power_set_budget(freq_gen_power_t* power, double watts);
+
+/**
+ * Set the utility of a device, applied in the next round. Can be called from any thread.
+ * @param device device number as passed to init_device
+ * @param utility benefit of one GHz, >= 0
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_power_set_utility(freq_gen_power_t* power, freq_gen_dev_type type, int device,
+                               double utility);
+
+/**
+ * Start the allocator thread, which calls freq_gen_power_step() every interval
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_power_start(freq_gen_power_t* power);
+
+/**
+ * Stop the allocator thread, the last applied frequencies stay
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_power_stop(freq_gen_power_t* power);
+
+/**
+ * Run a single round: read counters, calibrate if due, re-solve and apply the frequencies. Use
+ * this instead of the thread, e.g., with a virtual clock.
+ * @param now current time in ns
+ * @return the number of devices whose frequency changed or -ERRNO
+ */
+int freq_gen_power_step(freq_gen_power_t* power, uint64_t now);
+
+/**
+ * Get the allocated frequency of a device
+ * @param device device number as passed to init_device
+ * @return frequency in Hz or -ERRNO
+ */
+long long int freq_gen_power_get_frequency(freq_gen_power_t* power, freq_gen_dev_type type,
+                                           int device);
+
+/**
+ * Get the power model and the result of the last round
+ */
+void freq_gen_power_get_state(freq_gen_power_t* power, freq_gen_power_state_t* state);
+
+/**
+ * Get the overhead and number of changes so far
+ */
+void freq_gen_power_get_stats(freq_gen_power_t* power, freq_gen_power_stats_t* stats);
+
+/**
+ * Stop the allocator thread if running, close all devices and counters and free the allocator
+ */
+void freq_gen_power_destroy(freq_gen_power_t* power);
+
+#endif /* SRC_FREQGEN_POWER_H_ */
@@ -0,0 +1,140 @@
+/*
+ * freqgen_sampler.h
+ *
+ * A background thread that periodically samples core and uncore frequencies of all devices and
+ * stores fixed-size records in a lock-free ring buffer
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_SAMPLER_H_
+#define SRC_FREQGEN_SAMPLER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/** quantities that can be sampled, can be combined */
+typedef enum {
+    FREQ_GEN_SAMPLE_REQUESTED = 1 << 0, /**< configured frequency, from get_frequency */
+    FREQ_GEN_SAMPLE_EFFECTIVE = 1 << 1, /**< effective frequency from APERF/MPERF (core only) */
+    FREQ_GEN_SAMPLE_CURRENT = 1 << 2    /**< observed frequency, from get_current_frequency */
+} freq_gen_sample_quantity;
+
+/** a single sampled value, 24 bytes */
+typedef struct
+{
+    uint64_t timestamp; /**< CLOCK_MONOTONIC in ns */
+    uint32_t device;    /**< the cpu or uncore number */
+    uint8_t type;       /**< freq_gen_dev_type */
+    uint8_t quantity;   /**< a single freq_gen_sample_quantity */
+    uint16_t reserved;
+    int64_t value; /**< frequency in Hz or an error (<0) */
+} freq_gen_sample_t;
+
+typedef struct
+{
+    /** interface for core frequencies, NULL if not sampled */
+    freq_gen_interface_t* core;
+    /** cpus to sample, NULL for all devices of the core interface */
+    const int* core_devices;
+    int nr_core_devices;
+    /** freq_gen_sample_quantity flags for cores */
+    int core_quantities;
+
+    /** interface for uncore frequencies, NULL if not sampled */
+    freq_gen_interface_t* uncore;
+    /** uncores to sample, NULL for all devices of the uncore interface */
+    const int* uncore_devices;
+    int nr_uncore_devices;
+    /** freq_gen_sample_quantity flags for uncores */
+    int uncore_quantities;
+
+    /** time between two samples in ns */
+    uint64_t interval_ns;
+    /** cpu the sampling thread is pinned to, -1 to not pin it */
+    int cpu;
+    /** number of records the ring buffer can hold, 0 for a default */
+    size_t ring_size;
+} freq_gen_sampler_config_t;
+
+/** overhead of the sampler */
+typedef struct
+{
+    uint64_t samples;          /**< number of sampling periods so far */
+    uint64_t records;          /**< number of records pushed to the ring */
+    uint64_t dropped;          /**< number of records lost because the ring was full */
+    double ns_per_sample;      /**< average time for reading all devices once */
+    double ns_per_device;      /**< average time for reading a single device */
+    uint64_t max_ns_per_sample; /**< maximal time for reading all devices once */
+} freq_gen_sampler_stats_t;
+
+typedef struct freq_gen_sampler_s freq_gen_sampler_t;
+
+/**
+ * Create a sampler and open all devices that are listed in config. Sampling
+ * FREQ_GEN_SAMPLE_CURRENT of msr uncores without MSR_UNCORE_PERF_STATUS measures each uncore with
+ * perf for 10 ms. Creating the sampler fails if these windows add up to interval_ns or more.
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_sampler_t* freq_gen_sampler_create(const freq_gen_sampler_config_t* config);
+
+/**
+ * Start the sampling thread
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_sampler_start(freq_gen_sampler_t* sampler);
+
+/**
+ * Stop the sampling thread, records that are still in the ring can be drained afterwards
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_sampler_stop(freq_gen_sampler_t* sampler);
+
+/**
+ * Copy up to max records from the ring. Must only be called by a single consumer thread.
+ * @return the number of records copied
+ */
+size_t freq_gen_sampler_drain(freq_gen_sampler_t* sampler, freq_gen_sample_t* records, size_t max);
+
+/**
+ * Get the overhead of the sampler so far
+ */
+void freq_gen_sampler_get_stats(freq_gen_sampler_t* sampler, freq_gen_sampler_stats_t* stats);
+
+/**
+ * Stop the sampler if running, close all devices and free it
+ */
+void freq_gen_sampler_destroy(freq_gen_sampler_t* sampler);
+
+typedef struct freq_gen_sample_writer_s freq_gen_sample_writer_t;
+
+/**
+ * Create a binary file for records. The file starts with a header (magic "FGSAMPLE", version,
+ * record size and sampling interval) that is followed by freq_gen_sample_t records.
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_sample_writer_t* freq_gen_sample_writer_open(const char* path, uint64_t interval_ns);
+
+/**
+ * Append records to the file
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_sample_writer_write(freq_gen_sample_writer_t* writer, const freq_gen_sample_t* records,
+                                 size_t nr_records);
+
+/**
+ * Drain all records that are currently in the ring of a sampler to the file
+ * @return the number of written records or an error (<0)
+ */
+long long int freq_gen_sample_writer_drain(freq_gen_sample_writer_t* writer,
+                                           freq_gen_sampler_t* sampler);
+
+/**
+ * Flush and close the file
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_sample_writer_close(freq_gen_sample_writer_t* writer);
+
+#endif /* SRC_FREQGEN_SAMPLER_H_ */
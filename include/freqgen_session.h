@@ -0,0 +1,100 @@
+/*
+ * freqgen_session.h
+ *
+ * A session keeps a set of devices of an interface open and applies frequencies to all of them
+ * in a single call. Prepared settings are cached per frequency and devices that already have the
+ * requested frequency are skipped.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_SESSION_H_
+#define SRC_FREQGEN_SESSION_H_
+
+#include "freqgen.h"
+
+/** pass this as frequency to leave a device unchanged in bulk operations */
+#define FREQ_GEN_SESSION_KEEP (-1LL)
+
+typedef struct freq_gen_session_s freq_gen_session_t;
+
+/**
+ * Open devices of an interface
+ * @param interface from freq_gen_init()
+ * @param devices cpu or uncore numbers. If NULL, all devices of the interface that can be opened
+ * are used, devices that can not be opened are skipped.
+ * @param nr_devices length of devices
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_session_t* freq_gen_session_open(freq_gen_interface_t* interface, const int* devices,
+                                          int nr_devices);
+
+/**
+ * @return the interface of the session
+ */
+freq_gen_interface_t* freq_gen_session_get_interface(freq_gen_session_t* session);
+
+/**
+ * @return the number of opened devices
+ */
+int freq_gen_session_get_num_devices(freq_gen_session_t* session);
+
+/**
+ * @return the cpu or uncore numbers of the opened devices. All arrays passed to the bulk
+ * operations of a session are indexed like this array.
+ */
+const int* freq_gen_session_get_devices(freq_gen_session_t* session);
+
+/**
+ * @return the index of a cpu or uncore number within the session or -1
+ */
+int freq_gen_session_find_device(freq_gen_session_t* session, int device);
+
+/**
+ * @return the file descriptor/handle returned by init_device for the device at index
+ */
+freq_gen_single_device_t freq_gen_session_get_handle(freq_gen_session_t* session, int index);
+
+/**
+ * Read the frequency of all devices (see get_frequency)
+ * @param frequencies one entry per device, frequency in Hz or an error (<0)
+ * @return 0 or the error of the first failed device
+ */
+int freq_gen_session_get_frequency(freq_gen_session_t* session, long long int* frequencies);
+
+/**
+ * Read the minimal frequency of all devices (see get_min_frequency)
+ * @return 0 or the error of the first failed device, ENOTSUP if the interface has no
+ * get_min_frequency
+ */
+int freq_gen_session_get_min_frequency(freq_gen_session_t* session, long long int* frequencies);
+
+/**
+ * Set the frequency of all devices (see set_frequency)
+ * Devices with FREQ_GEN_SESSION_KEEP or the frequency that has already been set by this session
+ * are skipped.
+ * @param frequencies one entry per device in Hz
+ * @return 0 or the error of the first failed device
+ */
+int freq_gen_session_set_frequency(freq_gen_session_t* session, const long long int* frequencies);
+
+/**
+ * Set the minimal frequency of all devices (see set_min_frequency)
+ * @return 0 or the error of the first failed device, ENOTSUP if the interface has no
+ * set_min_frequency
+ */
+int freq_gen_session_set_min_frequency(freq_gen_session_t* session,
+                                       const long long int* frequencies);
+
+/**
+ * Forget which frequencies have been set, e.g., after they have been changed by someone else.
+ * The next bulk set will write all devices.
+ */
+void freq_gen_session_invalidate(freq_gen_session_t* session);
+
+/**
+ * Close all devices and free all prepared settings. The interface is not finalized.
+ */
+void freq_gen_session_close(freq_gen_session_t* session);
+
+#endif /* SRC_FREQGEN_SESSION_H_ */
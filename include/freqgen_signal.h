@@ -0,0 +1,73 @@
+/*
+ * freqgen_signal.h
+ *
+ * An async-signal-safe subset for switching frequencies from signal handlers, e.g., a SIGPROF
+ * timer for sampling-driven DVFS. The regular set path is not safe in a handler: preparing
+ * allocates memory, errors are formatted into a global string, instrumentation allocates trace
+ * buffers, and some backends (likwid, sim) take locks.
+ *
+ * A signal setting is created outside of the handler from an opened device and a prepared
+ * setting. It contains the raw write that the backend would do, so that
+ * freq_gen_signal_apply() only calls pread/pwrite on the file descriptor of the device.
+ * freq_gen_signal_apply() and freq_gen_signal_get_stats() are async-signal-safe, everything else
+ * is not. Errors are not written to freq_gen_error_string() but counted in a slot of the calling
+ * thread, which is lock-free and lives in static TLS, so that the first access in a handler does
+ * not allocate.
+ *
+ * Supported are the msr backend (core set_frequency, uncore set_frequency and
+ * set_min_frequency) and the sysfs backend. Signal settings are applied to the backend directly,
+ * they are neither traced nor published to the status page.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_SIGNAL_H_
+#define SRC_FREQGEN_SIGNAL_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+typedef struct freq_gen_signal_setting_s freq_gen_signal_setting_t;
+
+/** counters of the signal-safe calls of a thread */
+typedef struct
+{
+    uint64_t applied; /**< successful calls of freq_gen_signal_apply() */
+    uint64_t failed;  /**< failed calls of freq_gen_signal_apply() */
+    int last_error;   /**< error defined in errno.h of the last failed call, 0 if none */
+    int last_fd;      /**< file descriptor of the last failed call, -1 if none */
+} freq_gen_signal_stats_t;
+
+/**
+ * Create a signal setting. Not async-signal-safe.
+ * @param interface an interface returned by freq_gen_init()
+ * @param fp a device opened with interface->init_device(), it must stay open while the signal
+ * setting is used
+ * @param setting a setting returned by interface->prepare_set_frequency(), it can be unprepared
+ * afterwards
+ * @param min 0 to apply the setting like set_frequency, 1 like set_min_frequency
+ * @return NULL on failure, see freq_gen_error_string(), e.g., if the backend is not supported
+ */
+freq_gen_signal_setting_t* freq_gen_signal_setting_create(freq_gen_interface_t* interface,
+                                                          freq_gen_single_device_t fp,
+                                                          freq_gen_setting_t setting, int min);
+
+/**
+ * Apply a signal setting. Async-signal-safe, errno is preserved.
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_signal_apply(const freq_gen_signal_setting_t* setting);
+
+/**
+ * Read the counters of the calling thread. Async-signal-safe.
+ * @param reset whether to reset the counters
+ */
+void freq_gen_signal_get_stats(freq_gen_signal_stats_t* stats, int reset);
+
+/**
+ * Free a signal setting. Not async-signal-safe, the setting must not be in use by a handler.
+ */
+void freq_gen_signal_setting_free(freq_gen_signal_setting_t* setting);
+
+#endif /* SRC_FREQGEN_SIGNAL_H_ */
@@ -0,0 +1,114 @@
+/*
+ * freqgen_sim.h
+ *
+ * The sim interface simulates core and uncore frequencies of a configurable machine: packages with
+ * cores and hardware threads, discrete frequency grids, frequency domains that are shared by
+ * several cpus, a transition latency, and a power model. It is available through freq_gen_init()
+ * as "sim" when LIBFREQGEN_CORE_INTERFACE or LIBFREQGEN_UNCORE_INTERFACE select it,
+ * LIBFREQGEN_SIM_CONFIG is set, or freq_gen_sim_configure() has been called.
+ *
+ * Core devices are cpus, numbered package by package, core by core, hardware thread by hardware
+ * thread. Consecutive cpus form a core frequency domain, which runs at the highest frequency
+ * requested by its cpus. Uncore devices are packages. A requested frequency is rounded to the grid
+ * and clamped to its range. The domain keeps its current frequency for latency_ns after a new
+ * target has been requested, then switches.
+ *
+ * Power of a domain is static_power + dynamic_power * (f / max_frequency)^3 and is integrated
+ * over time to the consumed energy. Time is the wall clock (CLOCK_MONOTONIC since configuration)
+ * or, with virtual_clock, only advances with freq_gen_sim_set_time().
+ *
+ * LIBFREQGEN_SIM_CONFIG holds comma-separated key=value pairs that change the defaults, e.g.,
+ * "packages=2,cores=8,threads=2,core_domain=2,core_latency=30000,virtual=1". Keys are packages,
+ * cores, threads, core_domain, virtual and <core|uncore>_<min|max|step|latency|static_power|
+ * dynamic_power|initial>. Frequencies are in Hz, latencies in ns and power in W.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_SIM_H_
+#define SRC_FREQGEN_SIM_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/** the frequencies and power of a device type */
+typedef struct
+{
+    long long int min_frequency;     /**< lowest frequency of the grid in Hz */
+    long long int max_frequency;     /**< highest frequency of the grid in Hz */
+    long long int step;              /**< distance of two frequencies of the grid in Hz */
+    long long int initial_frequency; /**< frequency after configuration, 0 for max_frequency */
+    uint64_t latency_ns;             /**< time until a new target frequency is reached */
+    double static_power;             /**< power of a domain independent of its frequency in W */
+    double dynamic_power;            /**< additional power of a domain at max_frequency in W */
+} freq_gen_sim_domain_config_t;
+
+typedef struct
+{
+    int packages;
+    int cores_per_package;
+    int threads_per_core;
+    /** number of consecutive cpus that share a core frequency, must divide the cpus per package */
+    int core_domain_size;
+    /** indexed by freq_gen_dev_type */
+    freq_gen_sim_domain_config_t domains[FREQ_GEN_DEVICE_NUM];
+    /** time only advances with freq_gen_sim_set_time() */
+    int virtual_clock;
+} freq_gen_sim_config_t;
+
+/** the simulated state of a device */
+typedef struct
+{
+    long long int requested;     /**< frequency requested for this device */
+    long long int min_requested; /**< minimal frequency requested for this device (uncore) */
+    long long int target;        /**< frequency the domain is switching to or running at */
+    long long int current;       /**< frequency the domain is running at */
+    uint64_t transitions;        /**< number of target changes of the domain */
+    double energy;               /**< energy consumed by the domain in J */
+} freq_gen_sim_state_t;
+
+/**
+ * Fill a configuration with the defaults: 1 package with 4 cores and 1 thread per core,
+ * core domains of 1 cpu, cores from 0.8 to 3.0 GHz and uncores from 1.2 to 2.4 GHz in steps of
+ * 100 MHz, latencies of 30 and 20 us, and the wall clock.
+ */
+void freq_gen_sim_default_config(freq_gen_sim_config_t* config);
+
+/**
+ * Reset the simulator to a configuration and make the sim interface available to freq_gen_init().
+ * Interfaces returned before stay valid, but their devices should be opened again.
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_sim_configure(const freq_gen_sim_config_t* config);
+
+/**
+ * @return the simulated time in ns since the configuration
+ */
+uint64_t freq_gen_sim_get_time(void);
+
+/**
+ * Advance the virtual clock
+ * @param ns the new time, must not be earlier than the current time
+ * @return 0, EINVAL if the time would go back or ENOTSUP if the simulator uses the wall clock
+ */
+int freq_gen_sim_set_time(uint64_t ns);
+
+/**
+ * Get the simulated state of a device at the current time
+ * @param device cpu for FREQ_GEN_DEVICE_CORE_FREQ, package for FREQ_GEN_DEVICE_UNCORE_FREQ
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_sim_get_state(freq_gen_dev_type type, int device, freq_gen_sim_state_t* state);
+
+/**
+ * @return the energy consumed by all domains of a device type in J
+ */
+double freq_gen_sim_get_energy(freq_gen_dev_type type);
+
+/**
+ * @return the number of target changes of all domains of a device type
+ */
+uint64_t freq_gen_sim_get_transitions(freq_gen_dev_type type);
+
+#endif /* SRC_FREQGEN_SIM_H_ */
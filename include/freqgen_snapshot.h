@@ -0,0 +1,59 @@
+/*
+ * freqgen_snapshot.h
+ *
+ * Save the frequency settings of all devices of a session into a compact blob and restore them
+ * later, e.g., in a job prolog and epilog.
+ *
+ * A snapshot starts with a header (magic "FGSNAP", version, number of entries, backend name) that
+ * is followed by one 32 byte entry per device (device number, flags, frequency and minimal
+ * frequency in Hz, raw register). It can be written to a file as is. Settings are stored in Hz,
+ * so a snapshot can be restored with any interface for the same kind of device (core or uncore).
+ *
+ * Hz alone is lossy for the msr backend: IA32_PERF_CTL and UNCORE_RATIO_LIMIT hold more than the
+ * frequency (e.g., the turbo disengage bit or reserved bits), and frequencies are rounded to
+ * 100 MHz ratios. Snapshots taken with the msr backend therefore also store the whole 64 bit
+ * register, which is written back unchanged when the snapshot is restored with the msr backend.
+ * Other interfaces restore the frequencies in Hz. Raw writes are traced and published to the
+ * status page like set_frequency calls with the frequencies stored in the snapshot.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_SNAPSHOT_H_
+#define SRC_FREQGEN_SNAPSHOT_H_
+
+#include <stddef.h>
+
+#include "freqgen.h"
+#include "freqgen_session.h"
+
+/**
+ * Capture the current settings of all devices of a session
+ * @param blob will be set to a buffer allocated with malloc, free it with free()
+ * @param size will be set to the size of blob
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_snapshot(freq_gen_session_t* session, void** blob, size_t* size);
+
+/**
+ * Restore settings captured with freq_gen_snapshot() in a single bulk pass. The current settings
+ * are read first and only devices with differing values are written.
+ * Devices in the snapshot that are not part of the session are skipped.
+ * @return 0, ENODEV if devices were skipped, or another error defined in errno.h
+ */
+int freq_gen_restore(freq_gen_session_t* session, const void* blob, size_t size);
+
+/**
+ * Write a snapshot to a file
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_snapshot_save(const char* path, const void* blob, size_t size);
+
+/**
+ * Read a snapshot from a file
+ * @param blob will be set to a buffer allocated with malloc, free it with free()
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_snapshot_load(const char* path, void** blob, size_t* size);
+
+#endif /* SRC_FREQGEN_SNAPSHOT_H_ */
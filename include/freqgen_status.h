@@ -0,0 +1,66 @@
+/*
+ * freqgen_status.h
+ *
+ * A node-wide status page in shared memory (/dev/shm/freqgen.<hostname>) that holds the last
+ * applied frequency, minimal frequency, timestamp and pid for every core and uncore. Processes
+ * using libfreqgen publish to it after every successful set_frequency/set_min_frequency if
+ * LIBFREQGEN_STATUS=1 is set or freq_gen_status_enable() has been called before freq_gen_init().
+ * Monitors read it through the reader functions (library freqgen-status, which does not depend on
+ * libfreqgen) without any syscalls after opening.
+ * The page is protected by a sequence lock, so readers always get a consistent node-wide view.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_STATUS_H_
+#define SRC_FREQGEN_STATUS_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/** state of a single device as read from the status page */
+typedef struct
+{
+    int64_t frequency;     /**< last frequency in Hz applied with set_frequency, <0 if unknown */
+    int64_t min_frequency; /**< last minimal frequency in Hz, <0 if unknown */
+    uint64_t timestamp;    /**< CLOCK_REALTIME in ns of the last change, 0 if never changed */
+    uint32_t pid;          /**< process that applied the last change */
+    uint32_t reserved;
+} freq_gen_status_entry_t;
+
+/**
+ * Publish changes of this process to the status page. Call before freq_gen_init().
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_status_enable(void);
+
+typedef struct freq_gen_status_reader_s freq_gen_status_reader_t;
+
+/**
+ * Open the status page of a node for reading (provided by the freqgen-status library)
+ * @param node hostname of the node, NULL for this node
+ * @return NULL on failure, errno is set
+ */
+freq_gen_status_reader_t* freq_gen_status_open(const char* node);
+
+/**
+ * @return the number of devices of a type in the status page
+ */
+int freq_gen_status_get_num_devices(freq_gen_status_reader_t* reader, freq_gen_dev_type type);
+
+/**
+ * Read a consistent copy of all entries
+ * @param cores entries for freq_gen_status_get_num_devices(core) cores, can be NULL
+ * @param uncores entries for freq_gen_status_get_num_devices(uncore) uncores, can be NULL
+ * @return 0, or EAGAIN if writers kept changing the page
+ */
+int freq_gen_status_read(freq_gen_status_reader_t* reader, freq_gen_status_entry_t* cores,
+                         freq_gen_status_entry_t* uncores);
+
+/**
+ * Unmap the status page
+ */
+void freq_gen_status_close(freq_gen_status_reader_t* reader);
+
+#endif /* SRC_FREQGEN_STATUS_H_ */
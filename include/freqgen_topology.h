@@ -0,0 +1,56 @@
+/*
+ * freqgen_topology.h
+ *
+ * Track CPU hotplug and NUMA node changes at runtime. A watcher thread listens for kernel uevents
+ * on a netlink socket (or polls /sys/devices/system/{cpu,node}/online if netlink is not
+ * available), keeps a table of online CPUs and nodes up to date and notifies the user.
+ * Interfaces refresh their cached number of devices and the cpuset scope its allowed CPUs when the
+ * topology generation changes, so long-running processes stay correct without rescanning sysfs.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_TOPOLOGY_H_
+#define SRC_FREQGEN_TOPOLOGY_H_
+
+#include "freqgen.h"
+
+/**
+ * Called from the watcher thread for every change
+ * @param type FREQ_GEN_DEVICE_CORE_FREQ for CPUs, FREQ_GEN_DEVICE_UNCORE_FREQ for nodes
+ * @param device the cpu or node number
+ * @param online 1 if the device came online, 0 if it went offline
+ */
+typedef void (*freq_gen_topology_callback_t)(freq_gen_dev_type type, int device, int online,
+                                             void* data);
+
+/**
+ * Start the watcher thread. Only one watcher can be active.
+ * @param callback can be NULL
+ * @param data passed to callback
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_topology_watch(freq_gen_topology_callback_t callback, void* data);
+
+/**
+ * @return an eventfd that becomes readable when the topology changed (read it to reset it), -1 if
+ * no watcher is active. It can be used with poll/epoll instead of a callback.
+ */
+int freq_gen_topology_get_eventfd(void);
+
+/**
+ * @return a counter that is incremented on every change, 0 if no watcher has been started
+ */
+unsigned long long freq_gen_topology_get_generation(void);
+
+/**
+ * @return 1 if the CPU is online or no watcher is active, 0 otherwise
+ */
+int freq_gen_topology_cpu_online(int cpu);
+
+/**
+ * Stop the watcher thread and close the eventfd
+ */
+void freq_gen_topology_unwatch(void);
+
+#endif /* SRC_FREQGEN_TOPOLOGY_H_ */
@@ -0,0 +1,118 @@
+/*
+ * freqgen_trace.h
+ *
+ * Opt-in binary event trace of frequency operations and a reader for the resulting files
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_TRACE_H_
+#define SRC_FREQGEN_TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "freqgen.h"
+
+/**
+ * the traced operation. Operations other than set_frequency and set_min_frequency are only
+ * recorded by freq_gen_record_enable()
+ */
+typedef enum {
+    FREQ_GEN_TRACE_SET_FREQUENCY = 1,
+    FREQ_GEN_TRACE_SET_MIN_FREQUENCY = 2,
+    FREQ_GEN_TRACE_INIT = 3,                   /**< value is the number of devices */
+    FREQ_GEN_TRACE_INIT_DEVICE = 4,            /**< result is the handle or -ERRNO */
+    FREQ_GEN_TRACE_CLOSE_DEVICE = 5,
+    FREQ_GEN_TRACE_PREPARE = 6,                /**< device is turbo, result is -1 if it failed */
+    FREQ_GEN_TRACE_UNPREPARE = 7,
+    FREQ_GEN_TRACE_GET_FREQUENCY = 8,          /**< value is the returned frequency */
+    FREQ_GEN_TRACE_GET_MIN_FREQUENCY = 9,      /**< value is the returned frequency */
+    FREQ_GEN_TRACE_GET_CURRENT_FREQUENCY = 10, /**< value is the returned frequency */
+    FREQ_GEN_TRACE_FINALIZE = 11
+} freq_gen_trace_op;
+
+/** a single traced call, 48 bytes */
+typedef struct
+{
+    uint64_t tsc_begin; /**< TSC when the call was issued */
+    uint64_t tsc_end;   /**< TSC when the call completed */
+    int64_t value;      /**< the frequency passed to prepare_set_frequency in Hz */
+    uint32_t tid;       /**< the calling thread */
+    int32_t device;     /**< cpu or uncore number passed to init_device */
+    int32_t result;     /**< return value of the call */
+    uint8_t type;       /**< freq_gen_dev_type */
+    uint8_t op;         /**< freq_gen_trace_op */
+    uint8_t backend;    /**< index of the backend, see freq_gen_trace_reader_backend */
+    uint8_t reserved;
+    uint32_t setting;   /**< id of the setting for prepare, unprepare and set, 0 if not recorded */
+    uint32_t reserved2;
+} freq_gen_trace_event_t;
+
+/**
+ * Enable tracing to a file. Tracing can also be enabled by setting LIBFREQGEN_TRACE=(file).
+ * Only interfaces returned by freq_gen_init() after this call are traced. Events are stored in
+ * per-thread buffers that are written to the file asynchronously.
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_trace_enable(const char* path);
+
+/**
+ * Record every call of the interfaces to a file, e.g., for freqgen-replay. Recording can also be
+ * enabled by setting LIBFREQGEN_RECORD=(file). Only interfaces returned by freq_gen_init() after
+ * this call are recorded. Stop recording with freq_gen_trace_disable().
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_record_enable(const char* path);
+
+/**
+ * Stop tracing, write all buffered events and close the file.
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_trace_disable(void);
+
+typedef struct freq_gen_trace_reader_s freq_gen_trace_reader_t;
+
+/**
+ * Open a trace file
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_trace_reader_t* freq_gen_trace_reader_open(const char* path);
+
+/**
+ * Read the next event
+ * @return 1 if an event was read, 0 at the end of the file or an error (<0)
+ */
+int freq_gen_trace_reader_next(freq_gen_trace_reader_t* reader, freq_gen_trace_event_t* event);
+
+/**
+ * TSC frequency in Hz that was measured when the trace was started
+ */
+double freq_gen_trace_reader_tsc_hz(freq_gen_trace_reader_t* reader);
+
+/**
+ * Name of the backend (e.g., "msr") with the index used in freq_gen_trace_event_t.backend
+ * @return NULL if the index is unknown
+ */
+const char* freq_gen_trace_reader_backend(freq_gen_trace_reader_t* reader, int backend);
+
+/**
+ * Number of events that could not be stored because a per-thread buffer was full
+ */
+uint64_t freq_gen_trace_reader_dropped(freq_gen_trace_reader_t* reader);
+
+void freq_gen_trace_reader_close(freq_gen_trace_reader_t* reader);
+
+/**
+ * Convert a trace file to CSV
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_trace_convert_csv(const char* path, FILE* out);
+
+/**
+ * Convert a trace file to the Chrome trace event JSON format (chrome://tracing, Perfetto)
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_trace_convert_chrome(const char* path, FILE* out);
+
+#endif /* SRC_FREQGEN_TRACE_H_ */
@@ -0,0 +1,152 @@
+/*
+ * freqgen_uncore_controller.h
+ *
+ * An uncore frequency controller that measures the memory bandwidth (and optionally the LLC miss
+ * rate) of every uncore and selects the lowest uncore frequency that keeps the bandwidth within a
+ * tolerance of the bandwidth at the maximal frequency.
+ *
+ * For each uncore, the controller starts at max_frequency and stores the bandwidth as reference.
+ * It then lowers the frequency by one step per interval while the bandwidth stays within
+ * tolerance of the reference. When the bandwidth drops below, it goes back up by one step and
+ * holds this frequency. A change of the bandwidth or LLC miss rate by more than phase_change
+ * starts the search again at max_frequency.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_UNCORE_CONTROLLER_H_
+#define SRC_FREQGEN_UNCORE_CONTROLLER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/** cumulative memory traffic of an uncore */
+typedef struct
+{
+    uint64_t bytes;      /**< bytes read and written from/to memory */
+    uint64_t llc_misses; /**< LLC misses, 0 if not counted */
+} freq_gen_uncore_traffic_t;
+
+/**
+ * Measure the traffic of an uncore, replaces the perf_event IMC counters
+ * @param uncore the uncore number
+ * @param traffic the cumulative traffic so far
+ * @return 0 or an error defined in errno.h
+ */
+typedef int (*freq_gen_uncore_measure_t)(int uncore, freq_gen_uncore_traffic_t* traffic,
+                                         void* data);
+
+/** why the frequency of an uncore has been changed */
+typedef enum {
+    FREQ_GEN_UNCORE_DECISION_PROBE, /**< set to max_frequency to measure a new reference */
+    FREQ_GEN_UNCORE_DECISION_LOWER, /**< bandwidth is within tolerance, try a lower frequency */
+    FREQ_GEN_UNCORE_DECISION_RAISE  /**< bandwidth dropped, go back to the previous frequency */
+} freq_gen_uncore_decision_reason;
+
+/** a logged decision, 48 bytes */
+typedef struct
+{
+    uint64_t timestamp; /**< CLOCK_MONOTONIC in ns, or the time passed to step() */
+    uint32_t uncore;
+    uint32_t reason;      /**< freq_gen_uncore_decision_reason */
+    int64_t frequency;    /**< the new frequency in Hz */
+    double bandwidth;     /**< measured bandwidth in bytes/s */
+    double reference;     /**< bandwidth at max_frequency in bytes/s */
+    double llc_miss_rate; /**< LLC misses/s, 0 if not counted */
+} freq_gen_uncore_decision_t;
+
+typedef struct
+{
+    /** uncore interface that frequencies are applied through */
+    freq_gen_interface_t* interface;
+    /** uncores to control, NULL for all devices of the interface */
+    const int* uncores;
+    int nr_uncores;
+
+    /** lowest and highest frequency in Hz */
+    long long int min_frequency;
+    long long int max_frequency;
+    /** granularity of applied frequencies in Hz, 0 for 100 MHz */
+    long long int step;
+
+    /** fraction of the reference bandwidth that may be lost, 0 for 0.05 */
+    double tolerance;
+    /** relative change of bandwidth or LLC miss rate that restarts the search, 0 for 0.3 */
+    double phase_change;
+
+    /** time between two control rounds in ns, 0 for 1 ms */
+    uint64_t interval_ns;
+    /** cpu the controller thread is pinned to, -1 to not pin it */
+    int cpu;
+
+    /** function that measures the traffic, NULL for the perf_event IMC counters */
+    freq_gen_uncore_measure_t measure;
+    void* measure_data;
+    /** also count LLC misses on all cpus of each uncore with perf_event */
+    int count_llc_misses;
+
+    /** number of decisions the log can hold, 0 for a default */
+    size_t log_size;
+} freq_gen_uncore_controller_config_t;
+
+typedef struct
+{
+    uint64_t rounds;     /**< number of control rounds */
+    uint64_t changes;    /**< number of frequency changes */
+    uint64_t phases;     /**< number of restarts due to phase changes */
+    uint64_t errors;     /**< failed measurements and set_frequency calls */
+    uint64_t dropped;    /**< decisions lost because the log was full */
+    double ns_per_round; /**< average time of a control round */
+    uint64_t max_ns_per_round;
+} freq_gen_uncore_controller_stats_t;
+
+typedef struct freq_gen_uncore_controller_s freq_gen_uncore_controller_t;
+
+/**
+ * Create a controller, open all uncores listed in config and their counters
+ * @return NULL on failure, see freq_gen_error_string()
+ */
+freq_gen_uncore_controller_t* freq_gen_uncore_controller_create(
+    const freq_gen_uncore_controller_config_t* config);
+
+/**
+ * Start the controller thread, which calls freq_gen_uncore_controller_step() every interval
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_uncore_controller_start(freq_gen_uncore_controller_t* controller);
+
+/**
+ * Stop the controller thread, the last applied frequencies stay
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_uncore_controller_stop(freq_gen_uncore_controller_t* controller);
+
+/**
+ * Run a single control round for all uncores. Use this instead of a thread, e.g., to drive the
+ * controller with a virtual clock.
+ * @param now current time in ns
+ * @return the number of frequency changes or -ERRNO
+ */
+int freq_gen_uncore_controller_step(freq_gen_uncore_controller_t* controller, uint64_t now);
+
+/**
+ * Copy up to max decisions from the log. Must only be called by a single consumer thread.
+ * @return the number of decisions copied
+ */
+size_t freq_gen_uncore_controller_drain(freq_gen_uncore_controller_t* controller,
+                                        freq_gen_uncore_decision_t* decisions, size_t max);
+
+/**
+ * Get the overhead and number of decisions so far
+ */
+void freq_gen_uncore_controller_get_stats(freq_gen_uncore_controller_t* controller,
+                                          freq_gen_uncore_controller_stats_t* stats);
+
+/**
+ * Stop the controller if running, close all devices and counters and free it
+ */
+void freq_gen_uncore_controller_destroy(freq_gen_uncore_controller_t* controller);
+
+#endif /* SRC_FREQGEN_UNCORE_CONTROLLER_H_ */
@@ -0,0 +1,45 @@
+/*
+ * freqgen_util.h
+ *
+ * Helpers for programs that are built on libfreqgen, as used by the freqgen tools: parsing of
+ * frequencies and cpu lists, a monotonic clock, and the cost of reading the current frequency.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQGEN_UTIL_H_
+#define SRC_FREQGEN_UTIL_H_
+
+#include <stdint.h>
+
+#include "freqgen.h"
+
+/**
+ * Parse a frequency with an optional suffix GHz, MHz, kHz or Hz (default), e.g., "2.4GHz"
+ * @param frequency the frequency in Hz
+ * @return 0 or EINVAL
+ */
+int freq_gen_parse_frequency(const char* string, long long int* frequency);
+
+/**
+ * Parse a cpu list like "0-3,8,10-11" into an ascending array of cpus without duplicates
+ * @param cpus is allocated with malloc and has to be freed by the caller
+ * @return 0 or an error defined in errno.h
+ */
+int freq_gen_cpulist_parse_array(const char* string, int** cpus, int* nr_cpus);
+
+/**
+ * @return the time of CLOCK_MONOTONIC in ns
+ */
+uint64_t freq_gen_now_ns(void);
+
+/**
+ * Get how long get_current_frequency blocks for a device
+ * @param interface an interface returned by freq_gen_init()
+ * @return 0 if the current frequency is read from a register or file, or the measurement window
+ * in ns, e.g., if uncore clockticks are counted with perf
+ */
+long long int freq_gen_current_frequency_window(freq_gen_interface_t* interface,
+                                                freq_gen_single_device_t device);
+
+#endif /* SRC_FREQGEN_UTIL_H_ */
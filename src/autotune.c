@@ -0,0 +1,483 @@
+/*
+ * autotune.c
+ *
+ * Implements the offline frequency autotuner, see freqgen_autotune.h. Points are kept in the order
+ * they have been measured, a table over the grid of core and uncore frequencies maps every pair
+ * to its point, so refinement never measures a pair twice.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_autotune.h"
+#include "../include/freqgen_snapshot.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_energy.h"
+#include "freq_gen_internal_perf.h"
+
+#define AUTOTUNE_DEFAULT_STEP 100000000LL
+#define AUTOTUNE_DEFAULT_WARMUP 1
+#define AUTOTUNE_DEFAULT_REPETITIONS 5
+#define AUTOTUNE_DEFAULT_SETTLE 10000000ULL
+#define AUTOTUNE_DEFAULT_MIN_REPETITIONS 2
+/* a sweep over core frequencies stops after this many consecutive points were stopped early */
+#define AUTOTUNE_LINE_PATIENCE 2
+
+static const char* objective_names[FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES] = { "energy", "edp", "ed2p" };
+
+/* the frequencies of a device type, a single FREQ_GEN_MODEL_KEEP if it is not tuned */
+struct autotune_grid
+{
+    freq_gen_session_t* session;
+    long long int min_frequency;
+    long long int max_frequency;
+    long long int step;
+    int nr_levels;
+    long long int* targets; /**< per session device, for bulk writes */
+};
+
+struct autotuner
+{
+    freq_gen_autotune_config_t config;
+    freq_gen_autotune_kernel_t kernel;
+    void* data;
+    struct autotune_grid grids[FREQ_GEN_DEVICE_NUM];
+    int* table; /**< index in points for every (core, uncore) level pair or -1 */
+    freq_gen_autotune_result_t* result;
+    int* levels; /**< core and uncore level of every point */
+    int capacity;
+    double best[FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES]; /**< best objectives so far */
+
+    freq_gen_energy_t energy; /**< package and DRAM zones, if measure is not set */
+};
+
+static long long int frequency_of(const struct autotune_grid* grid, int level)
+{
+    if (grid->session == NULL)
+        return FREQ_GEN_MODEL_KEEP;
+    long long int frequency = grid->min_frequency + level * grid->step;
+    return frequency > grid->max_frequency ? grid->max_frequency : frequency;
+}
+
+static int init_grid(struct autotune_grid* grid, freq_gen_session_t* session,
+                     long long int min_frequency, long long int max_frequency, long long int step)
+{
+    grid->session = session;
+    grid->nr_levels = 1;
+    if (session == NULL)
+        return 0;
+    if (min_frequency <= 0 || max_frequency < min_frequency)
+    {
+        LIBFREQGEN_SET_ERROR("invalid frequency range %lld - %lld Hz", min_frequency,
+                             max_frequency);
+        return EINVAL;
+    }
+    grid->min_frequency = min_frequency;
+    grid->max_frequency = max_frequency;
+    grid->step = step > 0 ? step : AUTOTUNE_DEFAULT_STEP;
+    /* the last level is max_frequency, even if it is not on the grid */
+    grid->nr_levels = (max_frequency - min_frequency + grid->step - 1) / grid->step + 1;
+    grid->targets = malloc(freq_gen_session_get_num_devices(session) * sizeof(long long int));
+    if (grid->targets == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for targets");
+        return ENOMEM;
+    }
+    return 0;
+}
+
+/* reads the cumulative package and DRAM energy */
+static int read_energy(struct autotuner* tuner, double* package, double* dram)
+{
+    if (tuner->config.measure != NULL)
+    {
+        *dram = 0;
+        return tuner->config.measure(package, dram, tuner->config.measure_data);
+    }
+    return freq_gen_energy_read(&tuner->energy, package, dram);
+}
+
+static double objective_of(freq_gen_autotune_objective objective, double time, double energy)
+{
+    switch (objective)
+    {
+    case FREQ_GEN_AUTOTUNE_EDP:
+        return energy * time;
+    case FREQ_GEN_AUTOTUNE_ED2P:
+        return energy * time * time;
+    default:
+        return energy;
+    }
+}
+
+static int apply_frequencies(struct autotuner* tuner, int core_level, int uncore_level)
+{
+    int levels[FREQ_GEN_DEVICE_NUM] = { core_level, uncore_level };
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        struct autotune_grid* grid = &tuner->grids[type];
+        if (grid->session == NULL)
+            continue;
+        int nr = freq_gen_session_get_num_devices(grid->session);
+        for (int i = 0; i < nr; i++)
+            grid->targets[i] = frequency_of(grid, levels[type]);
+        int ret = freq_gen_session_set_frequency(grid->session, grid->targets);
+        if (ret)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not set %lld Hz", frequency_of(grid, levels[type]));
+            return ret;
+        }
+    }
+    if (tuner->config.settle_ns)
+    {
+        struct timespec settle = { .tv_sec = tuner->config.settle_ns / 1000000000ULL,
+                                   .tv_nsec = tuner->config.settle_ns % 1000000000ULL };
+        while (nanosleep(&settle, &settle) == -1 && errno == EINTR)
+            ;
+    }
+    return 0;
+}
+
+/* runs the kernel once, kernels that return -ERRNO are accepted as well */
+static int run_kernel(struct autotuner* tuner)
+{
+    int ret = tuner->kernel(tuner->data);
+    return ret < 0 ? -ret : ret;
+}
+
+/* measures a pair if it has not been measured yet
+ * index is set to the index of its point, returns 0 or an error defined in errno.h */
+static int measure_point(struct autotuner* tuner, int core_level, int uncore_level, int* index)
+{
+    int* entry = &tuner->table[core_level * tuner->grids[FREQ_GEN_DEVICE_UNCORE_FREQ].nr_levels +
+                               uncore_level];
+    if (*entry >= 0)
+    {
+        *index = *entry;
+        return 0;
+    }
+    const freq_gen_autotune_config_t* config = &tuner->config;
+    int ret = apply_frequencies(tuner, core_level, uncore_level);
+    for (int i = 0; ret == 0 && i < config->warmup; i++)
+        ret = run_kernel(tuner);
+    if (ret)
+        return ret;
+
+    freq_gen_autotune_point_t point = {
+        .core_frequency = frequency_of(&tuner->grids[FREQ_GEN_DEVICE_CORE_FREQ], core_level),
+        .uncore_frequency = frequency_of(&tuner->grids[FREQ_GEN_DEVICE_UNCORE_FREQ], uncore_level)
+    };
+    double best = tuner->best[config->objective];
+    while (point.repetitions < config->repetitions)
+    {
+        double package_before, dram_before, package_after, dram_after;
+        ret = read_energy(tuner, &package_before, &dram_before);
+        if (ret)
+            return ret;
+        uint64_t start = freq_gen_now_ns();
+        ret = run_kernel(tuner);
+        uint64_t end = freq_gen_now_ns();
+        if (ret == 0)
+            ret = read_energy(tuner, &package_after, &dram_after);
+        if (ret)
+            return ret;
+        point.time += (end - start) / 1e9;
+        point.package_energy += package_after - package_before;
+        point.dram_energy += dram_after - dram_before;
+        point.repetitions++;
+        if (config->early_stop > 0 && point.repetitions >= config->min_repetitions &&
+            point.repetitions < config->repetitions && isfinite(best))
+        {
+            double time = point.time / point.repetitions;
+            double energy = (point.package_energy + point.dram_energy) / point.repetitions;
+            if (objective_of(config->objective, time, energy) > (1 + config->early_stop) * best)
+            {
+                point.stopped = 1;
+                break;
+            }
+        }
+    }
+    point.time /= point.repetitions;
+    point.package_energy /= point.repetitions;
+    point.dram_energy /= point.repetitions;
+    double energy = point.package_energy + point.dram_energy;
+    freq_gen_autotune_result_t* result = tuner->result;
+    for (int i = 0; i < FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES; i++)
+    {
+        point.objectives[i] = objective_of(i, point.time, energy);
+        if (point.objectives[i] < tuner->best[i])
+        {
+            tuner->best[i] = point.objectives[i];
+            result->best[i] = result->nr_points;
+        }
+    }
+
+    if (result->nr_points == tuner->capacity)
+    {
+        int capacity = tuner->capacity ? 2 * tuner->capacity : 64;
+        freq_gen_autotune_point_t* points =
+            realloc(result->points, capacity * sizeof(freq_gen_autotune_point_t));
+        if (points != NULL)
+            result->points = points;
+        int* levels = realloc(tuner->levels, 2 * capacity * sizeof(int));
+        if (levels != NULL)
+            tuner->levels = levels;
+        if (points == NULL || levels == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for %d points", capacity);
+            return ENOMEM;
+        }
+        tuner->capacity = capacity;
+    }
+    result->points[result->nr_points] = point;
+    tuner->levels[2 * result->nr_points] = core_level;
+    tuner->levels[2 * result->nr_points + 1] = uncore_level;
+    *entry = result->nr_points++;
+    if (config->progress != NULL)
+        config->progress(result->nr_points, result->nr_candidates, config->progress_data);
+    *index = *entry;
+    return 0;
+}
+
+/* measures the given core levels from high to low at an uncore level */
+static int sweep_line(struct autotuner* tuner, int uncore_level, int stride)
+{
+    int nr_levels = tuner->grids[FREQ_GEN_DEVICE_CORE_FREQ].nr_levels;
+    int stopped = 0;
+    for (int level = nr_levels - 1; level >= 0; level = level == 0 ? -1 : level - stride)
+    {
+        /* the lowest frequency is always part of a sweep */
+        if (level < stride && level > 0)
+            level = 0;
+        int index;
+        int ret = measure_point(tuner, level, uncore_level, &index);
+        if (ret)
+            return ret;
+        stopped = tuner->result->points[index].stopped ? stopped + 1 : 0;
+        if (tuner->config.early_stop > 0 && stopped == AUTOTUNE_LINE_PATIENCE)
+            break;
+    }
+    return 0;
+}
+
+/* measures the neighbours of the best points within a distance of stride, using steps of half
+ * the stride, until the best points do not change anymore */
+static int refine(struct autotuner* tuner, int stride)
+{
+    int nr_core = tuner->grids[FREQ_GEN_DEVICE_CORE_FREQ].nr_levels;
+    int nr_uncore = tuner->grids[FREQ_GEN_DEVICE_UNCORE_FREQ].nr_levels;
+    int half = stride / 2 > 0 ? stride / 2 : 1;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        int before = tuner->result->nr_points;
+        for (int objective = 0; objective < FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES; objective++)
+        {
+            int core = tuner->levels[2 * tuner->result->best[objective]];
+            int uncore = tuner->levels[2 * tuner->result->best[objective] + 1];
+            for (int c = core - stride + half; c < core + stride; c += half)
+                for (int u = uncore - stride + half; u < uncore + stride; u += half)
+                {
+                    if (c < 0 || c >= nr_core || u < 0 || u >= nr_uncore)
+                        continue;
+                    int index;
+                    int ret = measure_point(tuner, c, u, &index);
+                    if (ret)
+                        return ret;
+                }
+        }
+        changed = tuner->result->nr_points != before;
+    }
+    return 0;
+}
+
+/* marks the points that are not dominated in time and energy */
+static void mark_pareto(freq_gen_autotune_result_t* result)
+{
+    for (int i = 0; i < result->nr_points; i++)
+    {
+        freq_gen_autotune_point_t* point = &result->points[i];
+        point->pareto = 1;
+        for (int j = 0; j < result->nr_points && point->pareto; j++)
+        {
+            const freq_gen_autotune_point_t* other = &result->points[j];
+            if (other->time <= point->time &&
+                other->objectives[FREQ_GEN_AUTOTUNE_ENERGY] <=
+                    point->objectives[FREQ_GEN_AUTOTUNE_ENERGY] &&
+                (other->time < point->time || other->objectives[FREQ_GEN_AUTOTUNE_ENERGY] <
+                                                  point->objectives[FREQ_GEN_AUTOTUNE_ENERGY]))
+                point->pareto = 0;
+        }
+    }
+}
+
+static int sweep(struct autotuner* tuner)
+{
+    int stride = tuner->config.coarse_stride > 1 ? tuner->config.coarse_stride : 1;
+    int nr_uncore = tuner->grids[FREQ_GEN_DEVICE_UNCORE_FREQ].nr_levels;
+    for (int level = nr_uncore - 1; level >= 0; level = level == 0 ? -1 : level - stride)
+    {
+        if (level < stride && level > 0)
+            level = 0;
+        int ret = sweep_line(tuner, level, stride);
+        if (ret)
+            return ret;
+    }
+    for (; stride > 1; stride /= 2)
+    {
+        int ret = refine(tuner, stride);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+int freq_gen_autotune_run(const freq_gen_autotune_config_t* config,
+                          freq_gen_autotune_kernel_t kernel, void* data,
+                          freq_gen_autotune_result_t** result)
+{
+    if (config == NULL || kernel == NULL || result == NULL || config->repetitions < 0 ||
+        config->early_stop < 0 || config->objective >= FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES)
+    {
+        LIBFREQGEN_SET_ERROR("invalid autotuning configuration");
+        return EINVAL;
+    }
+    struct autotuner tuner = { .config = *config, .kernel = kernel, .data = data };
+    if (tuner.config.warmup == 0)
+        tuner.config.warmup = AUTOTUNE_DEFAULT_WARMUP;
+    else if (tuner.config.warmup < 0)
+        tuner.config.warmup = 0;
+    if (tuner.config.repetitions == 0)
+        tuner.config.repetitions = AUTOTUNE_DEFAULT_REPETITIONS;
+    if (tuner.config.settle_ns == 0)
+        tuner.config.settle_ns = AUTOTUNE_DEFAULT_SETTLE;
+    if (tuner.config.min_repetitions <= 0)
+        tuner.config.min_repetitions = AUTOTUNE_DEFAULT_MIN_REPETITIONS;
+    for (int i = 0; i < FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES; i++)
+        tuner.best[i] = INFINITY;
+
+    int ret = init_grid(&tuner.grids[FREQ_GEN_DEVICE_CORE_FREQ], config->core,
+                        config->core_min_frequency, config->core_max_frequency, config->core_step);
+    if (ret == 0)
+        ret = init_grid(&tuner.grids[FREQ_GEN_DEVICE_UNCORE_FREQ], config->uncore,
+                        config->uncore_min_frequency, config->uncore_max_frequency,
+                        config->uncore_step);
+    if (ret == 0 && config->measure == NULL)
+        ret = freq_gen_energy_open(&tuner.energy, -1, true);
+    int nr_candidates = tuner.grids[FREQ_GEN_DEVICE_CORE_FREQ].nr_levels *
+                        tuner.grids[FREQ_GEN_DEVICE_UNCORE_FREQ].nr_levels;
+    if (ret == 0)
+    {
+        tuner.table = malloc(nr_candidates * sizeof(int));
+        tuner.result = calloc(1, sizeof(freq_gen_autotune_result_t));
+        if (tuner.table == NULL || tuner.result == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for %d points", nr_candidates);
+            ret = ENOMEM;
+        }
+    }
+
+    /* the frequencies are restored at the end */
+    void* snapshots[FREQ_GEN_DEVICE_NUM] = { NULL };
+    size_t sizes[FREQ_GEN_DEVICE_NUM];
+    for (int type = 0; ret == 0 && type < FREQ_GEN_DEVICE_NUM; type++)
+        if (tuner.grids[type].session != NULL)
+            ret = freq_gen_snapshot(tuner.grids[type].session, &snapshots[type], &sizes[type]);
+
+    if (ret == 0)
+    {
+        for (int i = 0; i < nr_candidates; i++)
+            tuner.table[i] = -1;
+        tuner.result->nr_candidates = nr_candidates;
+        ret = sweep(&tuner);
+    }
+
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        if (snapshots[type] != NULL)
+        {
+            int restored = freq_gen_restore(tuner.grids[type].session, snapshots[type],
+                                            sizes[type]);
+            if (ret == 0)
+                ret = restored;
+        }
+        free(snapshots[type]);
+        free(tuner.grids[type].targets);
+    }
+    freq_gen_energy_close(&tuner.energy);
+    free(tuner.table);
+    free(tuner.levels);
+    if (ret == 0 && tuner.result->nr_points == 0)
+    {
+        LIBFREQGEN_SET_ERROR("no point has been measured");
+        ret = ENODATA;
+    }
+    if (ret)
+    {
+        freq_gen_autotune_result_free(tuner.result);
+        return ret;
+    }
+    mark_pareto(tuner.result);
+    *result = tuner.result;
+    return 0;
+}
+
+int freq_gen_autotune_add_to_model(const freq_gen_autotune_result_t* result,
+                                   freq_gen_autotune_objective objective,
+                                   freq_gen_model_builder_t* builder, uint64_t id,
+                                   const char* name)
+{
+    if (objective >= FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES || result->nr_points == 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid objective or empty result");
+        return EINVAL;
+    }
+    const freq_gen_autotune_point_t* point = &result->points[result->best[objective]];
+    return freq_gen_model_builder_add(builder, id, name, point->core_frequency,
+                                      point->uncore_frequency);
+}
+
+int freq_gen_autotune_write_csv(const freq_gen_autotune_result_t* result, FILE* file)
+{
+    fprintf(file, "core_frequency,uncore_frequency,time_s,package_energy_j,dram_energy_j,edp,"
+                  "ed2p,repetitions,stopped,pareto,best\n");
+    for (int i = 0; i < result->nr_points; i++)
+    {
+        const freq_gen_autotune_point_t* point = &result->points[i];
+        char best[64] = "";
+        for (int objective = 0; objective < FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES; objective++)
+            if (result->best[objective] == i)
+                snprintf(best + strlen(best), sizeof(best) - strlen(best), "%s%s",
+                         best[0] ? "|" : "", objective_names[objective]);
+        fprintf(file, "%lld,%lld,%.9f,%.6f,%.6f,%.9g,%.9g,%d,%d,%d,%s\n", point->core_frequency,
+                point->uncore_frequency, point->time, point->package_energy, point->dram_energy,
+                point->objectives[FREQ_GEN_AUTOTUNE_EDP], point->objectives[FREQ_GEN_AUTOTUNE_ED2P],
+                point->repetitions, point->stopped, point->pareto, best);
+    }
+    if (fflush(file))
+    {
+        LIBFREQGEN_SET_ERROR("could not write results");
+        return EIO;
+    }
+    return 0;
+}
+
+void freq_gen_autotune_result_free(freq_gen_autotune_result_t* result)
+{
+    if (result == NULL)
+        return;
+    free(result->points);
+    free(result);
+}
@@ -0,0 +1,486 @@
+/*
+ * bandit.c
+ *
+ * Implements online frequency selection per region, see freqgen_bandit.h
+ *
+ * Regions are found like in model.c: buckets hold the index of a region + 1 or 0 and collisions
+ * are resolved by linear probing. Regions and their arm statistics are allocated when the bandit
+ * is created, so entering a new region does not allocate memory.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_bandit.h"
+#include "freq_gen_internal_energy.h"
+#include "freq_gen_internal_perf.h"
+#include "freq_gen_internal_settings.h"
+
+#define BANDIT_MAX_DEPTH 64
+#define BANDIT_DEFAULT_EXPLORATION 1.0
+#define BANDIT_DEFAULT_BUDGET_PER_ARM 10
+#define BANDIT_DEFAULT_MAX_REGIONS 1024
+/* invocations of every arm before the policy is used, two are needed for a variance */
+#define BANDIT_INITIAL_PULLS 2
+/* standard errors that separate the best arm from all others before a region converges */
+#define BANDIT_CONFIDENCE 2.0
+
+struct arm_stats
+{
+    uint64_t pulls;
+    double mean;
+    double m2; /**< sum of squared differences from the mean (Welford) */
+};
+
+struct bandit_region
+{
+    uint64_t id;
+    uint64_t invocations;
+    uint64_t explorations;
+    int best;      /**< arm with the lowest mean or -1 */
+    int converged; /**< arm that is always played or -1 */
+    int initial;   /**< number of arms with BANDIT_INITIAL_PULLS pulls */
+    struct arm_stats* arms;
+};
+
+struct bandit_frame
+{
+    uint64_t id;
+    struct bandit_region* region; /**< NULL if the invocation is not measured */
+    int arm;
+    uint64_t start_ns;
+    double start_joules;
+};
+
+struct freq_gen_bandit_s
+{
+    freq_gen_bandit_config_t config;
+    freq_gen_bandit_arm_t arms[FREQ_GEN_BANDIT_MAX_ARMS];
+    freq_gen_settings_t types[FREQ_GEN_DEVICE_NUM];
+    /* index of the setting of each arm and type, -1 to keep */
+    int arm_settings[FREQ_GEN_BANDIT_MAX_ARMS][FREQ_GEN_DEVICE_NUM];
+
+    uint32_t* buckets;
+    uint32_t nr_buckets; /**< a power of 2 */
+    struct bandit_region* regions;
+    struct arm_stats* arm_stats;
+    int nr_regions;
+    int nr_converged;
+
+    struct bandit_frame frames[BANDIT_MAX_DEPTH];
+    /* settings at each depth, [0] is FREQ_GEN_SETTING_BASELINE or -1 without devices */
+    int effective[BANDIT_MAX_DEPTH + 1][FREQ_GEN_DEVICE_NUM];
+    int depth;
+
+    freq_gen_energy_t energy; /**< package zones of RAPL, if measure is not set */
+
+    uint64_t random;
+    uint64_t decisions;
+    uint64_t untracked;
+    uint64_t errors;
+};
+
+static inline int read_energy(freq_gen_bandit_t* bandit, double* joules)
+{
+    if (bandit->config.measure != NULL)
+        return bandit->config.measure(joules, bandit->config.measure_data);
+    return freq_gen_energy_read(&bandit->energy, joules, NULL);
+}
+
+/* xorshift64* */
+static inline uint64_t next_random(freq_gen_bandit_t* bandit)
+{
+    bandit->random ^= bandit->random >> 12;
+    bandit->random ^= bandit->random << 25;
+    bandit->random ^= bandit->random >> 27;
+    return bandit->random * 0x2545f4914f6cdd1dULL;
+}
+
+/* approximately standard normal: the number of set bits of 64 random bits is binomial with mean
+ * 32 and standard deviation 4, which is cheaper than Box-Muller */
+static inline double next_normal(freq_gen_bandit_t* bandit)
+{
+    return (__builtin_popcountll(next_random(bandit)) - 32) * 0.25;
+}
+
+/* returns the region of an id, adds it if it is new, or NULL if all regions are used */
+static struct bandit_region* find_region(freq_gen_bandit_t* bandit, uint64_t id, bool add)
+{
+    uint32_t mask = bandit->nr_buckets - 1;
+    uint32_t bucket = id & mask;
+    for (;; bucket = (bucket + 1) & mask)
+    {
+        uint32_t index = bandit->buckets[bucket];
+        if (index == 0)
+            break;
+        if (bandit->regions[index - 1].id == id)
+            return &bandit->regions[index - 1];
+    }
+    if (!add || bandit->nr_regions >= bandit->config.max_regions)
+        return NULL;
+    struct bandit_region* region = &bandit->regions[bandit->nr_regions];
+    region->id = id;
+    region->best = -1;
+    region->converged = -1;
+    region->arms = &bandit->arm_stats[(size_t)bandit->nr_regions * bandit->config.nr_arms];
+    bandit->buckets[bucket] = ++bandit->nr_regions;
+    return region;
+}
+
+static inline double standard_error(const struct arm_stats* arm)
+{
+    return sqrt(arm->m2 / (arm->pulls - 1) / arm->pulls);
+}
+
+static int choose_arm(freq_gen_bandit_t* bandit, struct bandit_region* region)
+{
+    region->invocations++;
+    if (region->converged >= 0)
+        return region->converged;
+    int nr_arms = bandit->config.nr_arms;
+    if (region->initial < nr_arms)
+    {
+        for (int arm = 0; arm < nr_arms; arm++)
+            if (region->arms[arm].pulls < BANDIT_INITIAL_PULLS)
+                return arm;
+    }
+
+    double exploration = bandit->config.exploration;
+    int chosen = region->best;
+    double lowest = INFINITY;
+    if (bandit->config.policy == FREQ_GEN_BANDIT_UCB)
+    {
+        /* UCB1 expects costs in [0, 1], so mean costs are scaled from the best to the worst arm */
+        double best = region->arms[region->best].mean;
+        double worst = best;
+        for (int arm = 0; arm < nr_arms; arm++)
+            if (region->arms[arm].mean > worst)
+                worst = region->arms[arm].mean;
+        double scale = worst > best ? 1.0 / (worst - best) : 0;
+        double log_pulls = 2 * log((double)(region->invocations - 1));
+        for (int arm = 0; arm < nr_arms; arm++)
+        {
+            const struct arm_stats* stats = &region->arms[arm];
+            double bound = (stats->mean - best) * scale -
+                           exploration * sqrt(log_pulls / (double)stats->pulls);
+            if (bound < lowest)
+            {
+                lowest = bound;
+                chosen = arm;
+            }
+        }
+    }
+    else
+    {
+        for (int arm = 0; arm < nr_arms; arm++)
+        {
+            const struct arm_stats* stats = &region->arms[arm];
+            double sample = stats->mean + exploration * standard_error(stats) * next_normal(bandit);
+            if (sample < lowest)
+            {
+                lowest = sample;
+                chosen = arm;
+            }
+        }
+    }
+    if (chosen != region->best)
+        region->explorations++;
+    return chosen;
+}
+
+static void update_arm(freq_gen_bandit_t* bandit, struct bandit_region* region, int arm,
+                       double cost)
+{
+    struct arm_stats* stats = &region->arms[arm];
+    stats->pulls++;
+    double delta = cost - stats->mean;
+    stats->mean += delta / stats->pulls;
+    stats->m2 += delta * (cost - stats->mean);
+    if (stats->pulls == BANDIT_INITIAL_PULLS)
+        region->initial++;
+
+    int nr_arms = bandit->config.nr_arms;
+    const struct arm_stats* arms = region->arms;
+    int best = -1;
+    for (int i = 0; i < nr_arms; i++)
+        if (arms[i].pulls > 0 && (best < 0 || arms[i].mean < arms[best].mean))
+            best = i;
+    region->best = best;
+    if (region->initial < nr_arms || region->converged >= 0)
+        return;
+
+    bool converged = region->explorations >= (uint64_t)bandit->config.budget;
+    if (!converged)
+    {
+        /* the best arm is better than all others with confidence */
+        double upper = arms[best].mean + BANDIT_CONFIDENCE * standard_error(&arms[best]);
+        converged = true;
+        for (int i = 0; i < nr_arms && converged; i++)
+            if (i != best && arms[i].mean - BANDIT_CONFIDENCE * standard_error(&arms[i]) <= upper)
+                converged = false;
+    }
+    if (converged)
+    {
+        region->converged = best;
+        bandit->nr_converged++;
+    }
+}
+
+freq_gen_bandit_t* freq_gen_bandit_create(const freq_gen_bandit_config_t* config)
+{
+    if (config->arms == NULL || config->nr_arms < 1 ||
+        config->nr_arms > FREQ_GEN_BANDIT_MAX_ARMS || config->max_regions < 0 ||
+        config->budget < 0 || config->exploration < 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid bandit configuration, 1 to %d arms are supported",
+                             FREQ_GEN_BANDIT_MAX_ARMS);
+        return NULL;
+    }
+    freq_gen_bandit_t* bandit = calloc(1, sizeof(freq_gen_bandit_t));
+    if (bandit == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate bandit");
+        return NULL;
+    }
+    bandit->config = *config;
+    memcpy(bandit->arms, config->arms, config->nr_arms * sizeof(freq_gen_bandit_arm_t));
+    bandit->config.arms = bandit->arms;
+    if (bandit->config.exploration == 0)
+        bandit->config.exploration = BANDIT_DEFAULT_EXPLORATION;
+    if (bandit->config.budget == 0)
+        bandit->config.budget = BANDIT_DEFAULT_BUDGET_PER_ARM * config->nr_arms;
+    if (bandit->config.max_regions == 0)
+        bandit->config.max_regions = BANDIT_DEFAULT_MAX_REGIONS;
+    bandit->random = config->seed != 0 ? config->seed : freq_gen_now_ns() | 1;
+
+    bandit->nr_buckets = 2;
+    while (bandit->nr_buckets < 2 * (uint32_t)bandit->config.max_regions)
+        bandit->nr_buckets <<= 1;
+    bandit->buckets = calloc(bandit->nr_buckets, sizeof(uint32_t));
+    bandit->regions = calloc(bandit->config.max_regions, sizeof(struct bandit_region));
+    bandit->arm_stats =
+        calloc((size_t)bandit->config.max_regions * config->nr_arms, sizeof(struct arm_stats));
+    if (bandit->buckets == NULL || bandit->regions == NULL || bandit->arm_stats == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d regions",
+                             bandit->config.max_regions);
+        freq_gen_bandit_destroy(bandit);
+        return NULL;
+    }
+
+    freq_gen_session_t* sessions[FREQ_GEN_DEVICE_NUM] = { config->core, config->uncore };
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+    {
+        freq_gen_settings_t* type = &bandit->types[t];
+        if (freq_gen_settings_bind(type, sessions[t]))
+        {
+            freq_gen_bandit_destroy(bandit);
+            return NULL;
+        }
+        /* the settings outside of all regions */
+        bandit->effective[0][t] = type->current;
+        for (int arm = 0; arm < config->nr_arms; arm++)
+        {
+            long long int frequency = t == FREQ_GEN_DEVICE_CORE_FREQ
+                                          ? config->arms[arm].core_frequency
+                                          : config->arms[arm].uncore_frequency;
+            int index = type->session != NULL ? freq_gen_settings_add(type, frequency) : -1;
+            if (index < -1)
+            {
+                freq_gen_bandit_destroy(bandit);
+                return NULL;
+            }
+            bandit->arm_settings[arm][t] = index;
+        }
+    }
+
+    if (config->cost != FREQ_GEN_BANDIT_TIME && config->measure == NULL)
+    {
+        int ret = freq_gen_energy_open(&bandit->energy, -1, false);
+        if (ret)
+        {
+            LIBFREQGEN_APPEND_ERROR("energy costs need RAPL or a measure function");
+            freq_gen_bandit_destroy(bandit);
+            return NULL;
+        }
+    }
+    return bandit;
+}
+
+int freq_gen_bandit_enter_region(freq_gen_bandit_t* bandit, uint64_t id)
+{
+    if (bandit->depth >= BANDIT_MAX_DEPTH)
+    {
+        LIBFREQGEN_SET_ERROR("regions are nested deeper than %d", BANDIT_MAX_DEPTH);
+        return EOVERFLOW;
+    }
+    bandit->decisions++;
+    int depth = bandit->depth;
+    struct bandit_frame* frame = &bandit->frames[depth];
+    struct bandit_region* region = find_region(bandit, id, true);
+    int arm = -1;
+    if (region != NULL)
+        arm = choose_arm(bandit, region);
+    else
+        bandit->untracked++;
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+    {
+        int index = arm >= 0 ? bandit->arm_settings[arm][t] : -1;
+        bandit->effective[depth + 1][t] = index >= 0 ? index : bandit->effective[depth][t];
+    }
+    frame->id = id;
+    frame->arm = arm;
+    frame->region = region != NULL && region->converged < 0 ? region : NULL;
+    bandit->depth = depth + 1;
+    int ret = freq_gen_settings_apply_all(bandit->types, bandit->effective[depth + 1]);
+
+    /* measure after the new settings have been written */
+    if (frame->region != NULL)
+    {
+        if (bandit->config.cost != FREQ_GEN_BANDIT_TIME &&
+            read_energy(bandit, &frame->start_joules))
+        {
+            bandit->errors++;
+            frame->region = NULL;
+        }
+        frame->start_ns = freq_gen_now_ns();
+    }
+    return ret;
+}
+
+int freq_gen_bandit_exit_region(freq_gen_bandit_t* bandit, uint64_t id)
+{
+    if (bandit->depth == 0 || bandit->frames[bandit->depth - 1].id != id)
+    {
+        LIBFREQGEN_SET_ERROR("region %llx is not the innermost region", (unsigned long long)id);
+        return EINVAL;
+    }
+    struct bandit_frame* frame = &bandit->frames[--bandit->depth];
+    if (frame->region != NULL)
+    {
+        double time = (freq_gen_now_ns() - frame->start_ns) * 1e-9;
+        double joules = 0;
+        if (bandit->config.cost != FREQ_GEN_BANDIT_TIME && read_energy(bandit, &joules))
+            bandit->errors++;
+        else
+        {
+            double energy = joules - frame->start_joules;
+            double cost = bandit->config.cost == FREQ_GEN_BANDIT_TIME     ? time
+                          : bandit->config.cost == FREQ_GEN_BANDIT_ENERGY ? energy
+                                                                          : energy * time;
+            update_arm(bandit, frame->region, frame->arm, cost);
+        }
+    }
+    return freq_gen_settings_apply_all(bandit->types, bandit->effective[bandit->depth]);
+}
+
+int freq_gen_bandit_get_region(freq_gen_bandit_t* bandit, uint64_t id,
+                               freq_gen_bandit_region_t* region)
+{
+    const struct bandit_region* found = find_region(bandit, id, false);
+    if (found == NULL)
+        return ENOENT;
+    region->invocations = found->invocations;
+    region->explorations = found->explorations;
+    region->best_arm = found->converged >= 0 ? found->converged : found->best;
+    region->best_cost = region->best_arm >= 0 ? found->arms[region->best_arm].mean : 0;
+    region->converged = found->converged >= 0;
+    return 0;
+}
+
+int freq_gen_bandit_forget_region(freq_gen_bandit_t* bandit, uint64_t id)
+{
+    struct bandit_region* region = find_region(bandit, id, false);
+    if (region == NULL)
+        return ENOENT;
+    if (region->converged >= 0)
+        bandit->nr_converged--;
+    memset(region->arms, 0, bandit->config.nr_arms * sizeof(struct arm_stats));
+    region->invocations = 0;
+    region->explorations = 0;
+    region->best = -1;
+    region->converged = -1;
+    region->initial = 0;
+    /* invocations that are still active must not update the cleared statistics */
+    for (int depth = 0; depth < bandit->depth; depth++)
+        if (bandit->frames[depth].region == region)
+            bandit->frames[depth].region = NULL;
+    return 0;
+}
+
+int freq_gen_bandit_load(freq_gen_bandit_t* bandit, const freq_gen_model_t* model)
+{
+    int loaded = 0;
+    for (int i = 0; i < freq_gen_model_get_num_regions(model); i++)
+    {
+        uint64_t id;
+        long long int core, uncore;
+        freq_gen_model_get_region(model, i, &id, NULL, &core, &uncore);
+        int arm = 0;
+        while (arm < bandit->config.nr_arms && (bandit->arms[arm].core_frequency != core ||
+                                                bandit->arms[arm].uncore_frequency != uncore))
+            arm++;
+        if (arm == bandit->config.nr_arms)
+            continue;
+        struct bandit_region* region = find_region(bandit, id, true);
+        if (region == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not load more than %d regions",
+                                 bandit->config.max_regions);
+            return -ENOSPC;
+        }
+        freq_gen_bandit_forget_region(bandit, id);
+        region->best = arm;
+        region->converged = arm;
+        bandit->nr_converged++;
+        loaded++;
+    }
+    return loaded;
+}
+
+int freq_gen_bandit_save(freq_gen_bandit_t* bandit, freq_gen_model_builder_t* builder)
+{
+    for (int i = 0; i < bandit->nr_regions; i++)
+    {
+        const struct bandit_region* region = &bandit->regions[i];
+        if (region->converged < 0)
+            continue;
+        const freq_gen_bandit_arm_t* arm = &bandit->arms[region->converged];
+        int ret = freq_gen_model_builder_add(builder, region->id, NULL, arm->core_frequency,
+                                             arm->uncore_frequency);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+void freq_gen_bandit_get_stats(freq_gen_bandit_t* bandit, freq_gen_bandit_stats_t* stats)
+{
+    stats->decisions = bandit->decisions;
+    stats->untracked = bandit->untracked;
+    stats->regions = bandit->nr_regions;
+    stats->converged = bandit->nr_converged;
+    stats->errors = bandit->errors;
+}
+
+void freq_gen_bandit_destroy(freq_gen_bandit_t* bandit)
+{
+    if (bandit == NULL)
+        return;
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+        freq_gen_settings_free(&bandit->types[t]);
+    freq_gen_energy_close(&bandit->energy);
+    free(bandit->buckets);
+    free(bandit->regions);
+    free(bandit->arm_stats);
+    free(bandit);
+}
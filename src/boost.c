@@ -0,0 +1,577 @@
+/*
+ * boost.c
+ *
+ * Implements scoped boosts, see freqgen_boost.h. Tokens are entries of a fixed pool, a token
+ * handle combines the index of the entry with a generation, so stale handles are detected. Active
+ * tokens are linked into a hashed timer wheel by their deadline. The timer thread advances the
+ * wheel every tick and releases the tokens whose deadline has passed.
+ *
+ * Two locks are used: the wheel lock protects the token pool and the wheel, a lock per device
+ * protects its reference counts. They are never held at the same time, so a slow set_frequency
+ * of one device does not delay tokens of other devices.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_boost.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_perf.h"
+
+#define BOOST_DEFAULT_STEP 100000000LL
+#define BOOST_DEFAULT_MAX_TOKENS 1024
+#define BOOST_DEFAULT_DURATION 100000000ULL
+#define BOOST_DEFAULT_TICK 1000000ULL
+#define BOOST_WHEEL_SLOTS 256
+
+struct boost_token
+{
+    uint32_t generation; /**< incremented whenever the entry is allocated */
+    bool active;
+    bool expired; /**< released by the timer thread, kept until the entry is reused */
+    int device;   /**< index in devices */
+    int level;    /**< index in settings */
+    uint64_t deadline;
+    int next; /**< next entry in the wheel slot or the free list, -1 for none */
+    int prev; /**< previous entry in the wheel slot, -1 for the head */
+};
+
+struct boosted_device
+{
+    int nr;                      /**< device number */
+    freq_gen_single_device_t fp; /**< from init_device */
+    pthread_mutex_t lock;
+    unsigned int* counts; /**< active tokens per setting */
+    unsigned int tokens;  /**< all active tokens */
+    int active;           /**< applied setting, -1 if not boosted */
+    /* frequency before the first active token, boosts never go below it */
+    long long int baseline_frequency;
+    long long int baseline_min_frequency;
+    /* prepared when captured, reused while the device returns to the same frequency */
+    freq_gen_setting_t baseline;
+    freq_gen_setting_t baseline_min; /**< NULL if the interface has no range */
+};
+
+/* an expired token, collected by the timer thread and released outside of the wheel lock */
+struct expired_token
+{
+    int device;
+    int level;
+};
+
+struct freq_gen_boost_s
+{
+    freq_gen_boost_config_t config;
+    struct boosted_device* devices;
+    int nr_devices;
+    freq_gen_setting_t* settings; /**< one per step between min_frequency and max_frequency */
+    int nr_settings;
+
+    pthread_mutex_t wheel_lock;
+    struct boost_token* tokens;
+    int free_tokens; /**< head of the free list */
+    int slots[BOOST_WHEEL_SLOTS];
+    uint64_t processed_tick; /**< last tick the timer thread has processed */
+    struct expired_token* expired;
+
+    pthread_t thread;
+    bool running;
+    atomic_bool stop;
+
+    atomic_uint_fast64_t acquired;
+    atomic_uint_fast64_t released;
+    atomic_uint_fast64_t expirations;
+    atomic_uint_fast64_t switches;
+    atomic_uint_fast64_t errors;
+};
+
+static long long int frequency_of(freq_gen_boost_t* boost, int index)
+{
+    long long int frequency = boost->config.min_frequency + index * boost->config.step;
+    return frequency > boost->config.max_frequency ? boost->config.max_frequency : frequency;
+}
+
+static struct boosted_device* find_device(freq_gen_boost_t* boost, int nr, int* index)
+{
+    for (int i = 0; i < boost->nr_devices; i++)
+        if (boost->devices[i].nr == nr)
+        {
+            *index = i;
+            return &boost->devices[i];
+        }
+    return NULL;
+}
+
+static void free_baseline(freq_gen_boost_t* boost, struct boosted_device* device)
+{
+    if (device->baseline != NULL)
+        boost->config.interface->unprepare_set_frequency(device->baseline);
+    if (device->baseline_min != NULL)
+        boost->config.interface->unprepare_set_frequency(device->baseline_min);
+    device->baseline = device->baseline_min = NULL;
+}
+
+/*
+ * reads the frequency (range) of a device when it gets its first active token, must hold the
+ * device lock. Settings are only prepared again if the frequency differs from the last baseline
+ */
+static int capture_baseline(freq_gen_boost_t* boost, struct boosted_device* device)
+{
+    freq_gen_interface_t* interface = boost->config.interface;
+    long long int frequency = interface->get_frequency(device->fp);
+    if (frequency <= 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not read the frequency of device %d", device->nr);
+        return frequency < 0 ? -frequency : EIO;
+    }
+    if (device->baseline == NULL || frequency != device->baseline_frequency)
+    {
+        freq_gen_setting_t baseline = interface->prepare_set_frequency(frequency, 0);
+        if (baseline == NULL)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not prepare %lld Hz for restoring device %d",
+                                    frequency, device->nr);
+            return EINVAL;
+        }
+        if (device->baseline != NULL)
+            interface->unprepare_set_frequency(device->baseline);
+        device->baseline = baseline;
+        device->baseline_frequency = frequency;
+    }
+    if (interface->get_min_frequency == NULL || interface->set_min_frequency == NULL)
+        return 0;
+    long long int min_frequency = interface->get_min_frequency(device->fp);
+    if (min_frequency <= 0 || min_frequency == frequency)
+    {
+        if (device->baseline_min != NULL)
+            interface->unprepare_set_frequency(device->baseline_min);
+        device->baseline_min = NULL;
+    }
+    else if (device->baseline_min == NULL || min_frequency != device->baseline_min_frequency)
+    {
+        freq_gen_setting_t baseline_min = interface->prepare_set_frequency(min_frequency, 0);
+        if (baseline_min == NULL)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not prepare %lld Hz for restoring device %d",
+                                    min_frequency, device->nr);
+            return EINVAL;
+        }
+        if (device->baseline_min != NULL)
+            interface->unprepare_set_frequency(device->baseline_min);
+        device->baseline_min = baseline_min;
+        device->baseline_min_frequency = min_frequency;
+    }
+    return 0;
+}
+
+/*
+ * applies the highest requested setting below level, or the baseline if no such setting is above
+ * it, must hold the device lock
+ */
+static int lower_device(freq_gen_boost_t* boost, struct boosted_device* device, int level)
+{
+    freq_gen_interface_t* interface = boost->config.interface;
+    int next = level - 1;
+    while (next >= 0 && device->counts[next] == 0)
+        next--;
+    if (next >= 0 && frequency_of(boost, next) <= device->baseline_frequency)
+        next = -1;
+    int ret;
+    if (next >= 0)
+        ret = interface->set_frequency(device->fp, boost->settings[next]);
+    else
+    {
+        ret = interface->set_frequency(device->fp, device->baseline);
+        if (ret == 0 && device->baseline_min != NULL)
+            ret = interface->set_min_frequency(device->fp, device->baseline_min);
+    }
+    device->active = next;
+    atomic_fetch_add_explicit(&boost->switches, 1, memory_order_relaxed);
+    if (ret)
+    {
+        atomic_fetch_add_explicit(&boost->errors, 1, memory_order_relaxed);
+        LIBFREQGEN_SET_ERROR("could not restore the frequency of device %d", device->nr);
+    }
+    return ret;
+}
+
+/* drops a reference of a released or expired token */
+static int put_level(freq_gen_boost_t* boost, struct boosted_device* device, int level)
+{
+    int ret = 0;
+    pthread_mutex_lock(&device->lock);
+    device->counts[level]--;
+    device->tokens--;
+    if (level == device->active && device->counts[level] == 0)
+        ret = lower_device(boost, device, level);
+    pthread_mutex_unlock(&device->lock);
+    return ret;
+}
+
+/*
+ * adds a reference and raises the frequency if level is higher than the applied one, levels at or
+ * below the baseline are only counted. The first reference of a device captures its baseline
+ */
+static int get_level(freq_gen_boost_t* boost, struct boosted_device* device, int level)
+{
+    pthread_mutex_lock(&device->lock);
+    /* the setting to restore is the one before the device is boosted, not at create time */
+    int ret = device->tokens == 0 ? capture_baseline(boost, device) : 0;
+    if (ret == 0 && level > device->active &&
+        frequency_of(boost, level) > device->baseline_frequency)
+    {
+        ret = boost->config.interface->set_frequency(device->fp, boost->settings[level]);
+        atomic_fetch_add_explicit(&boost->switches, 1, memory_order_relaxed);
+        if (ret)
+        {
+            atomic_fetch_add_explicit(&boost->errors, 1, memory_order_relaxed);
+            LIBFREQGEN_SET_ERROR("could not boost device %d to %lld Hz", device->nr,
+                                 frequency_of(boost, level));
+        }
+        else
+            device->active = level;
+    }
+    if (ret == 0)
+    {
+        device->counts[level]++;
+        device->tokens++;
+    }
+    pthread_mutex_unlock(&device->lock);
+    return ret;
+}
+
+/* removes an entry from its wheel slot and adds it to the free list, must hold the wheel lock */
+static void unlink_token(freq_gen_boost_t* boost, int index)
+{
+    struct boost_token* token = &boost->tokens[index];
+    if (token->prev >= 0)
+        boost->tokens[token->prev].next = token->next;
+    else
+        boost->slots[(token->deadline / boost->config.tick_ns) % BOOST_WHEEL_SLOTS] = token->next;
+    if (token->next >= 0)
+        boost->tokens[token->next].prev = token->prev;
+    token->active = false;
+    token->next = boost->free_tokens;
+    boost->free_tokens = index;
+}
+
+/* expires all tokens with a deadline up to now, returns the number of expired tokens */
+static int advance_wheel(freq_gen_boost_t* boost, uint64_t now)
+{
+    int nr_expired = 0;
+    uint64_t now_tick = now / boost->config.tick_ns;
+    pthread_mutex_lock(&boost->wheel_lock);
+    uint64_t tick = boost->processed_tick + 1;
+    /* a full revolution visits every slot */
+    if (now_tick >= tick + BOOST_WHEEL_SLOTS)
+        tick = now_tick - BOOST_WHEEL_SLOTS + 1;
+    for (; tick <= now_tick; tick++)
+    {
+        int index = boost->slots[tick % BOOST_WHEEL_SLOTS];
+        while (index >= 0)
+        {
+            struct boost_token* token = &boost->tokens[index];
+            int next = token->next;
+            if (token->deadline <= now)
+            {
+                boost->expired[nr_expired++] =
+                    (struct expired_token){ .device = token->device, .level = token->level };
+                unlink_token(boost, index);
+                token->expired = true;
+            }
+            index = next;
+        }
+    }
+    if (now_tick > boost->processed_tick)
+        boost->processed_tick = now_tick;
+    pthread_mutex_unlock(&boost->wheel_lock);
+
+    for (int i = 0; i < nr_expired; i++)
+        put_level(boost, &boost->devices[boost->expired[i].device], boost->expired[i].level);
+    atomic_fetch_add_explicit(&boost->expirations, nr_expired, memory_order_relaxed);
+    return nr_expired;
+}
+
+static void* boost_thread(void* arg)
+{
+    freq_gen_boost_t* boost = arg;
+    while (!atomic_load_explicit(&boost->stop, memory_order_relaxed))
+    {
+        uint64_t now = freq_gen_now_ns();
+        advance_wheel(boost, now);
+        uint64_t next = (now / boost->config.tick_ns + 1) * boost->config.tick_ns;
+        struct timespec wakeup = { .tv_sec = next / 1000000000ULL,
+                                   .tv_nsec = next % 1000000000ULL };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+freq_gen_boost_token_t freq_gen_boost_acquire(freq_gen_boost_t* boost, int device,
+                                              long long int frequency, uint64_t max_duration_ns)
+{
+    int device_index;
+    struct boosted_device* boosted = find_device(boost, device, &device_index);
+    if (boosted == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("device %d can not be boosted", device);
+        return -ENODEV;
+    }
+    if (frequency <= 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid boost frequency %lld", frequency);
+        return -EINVAL;
+    }
+    int level = 0;
+    if (frequency > boost->config.min_frequency)
+        level = (frequency - boost->config.min_frequency + boost->config.step - 1) /
+                boost->config.step;
+    if (level >= boost->nr_settings)
+        level = boost->nr_settings - 1;
+    if (max_duration_ns == 0)
+        max_duration_ns = boost->config.default_duration_ns;
+
+    int ret = get_level(boost, boosted, level);
+    if (ret)
+        return -ret;
+
+    uint64_t deadline = freq_gen_now_ns() + max_duration_ns;
+    pthread_mutex_lock(&boost->wheel_lock);
+    int index = boost->free_tokens;
+    if (index < 0)
+    {
+        pthread_mutex_unlock(&boost->wheel_lock);
+        put_level(boost, boosted, level);
+        LIBFREQGEN_SET_ERROR("all %d boost tokens are in use", boost->config.max_tokens);
+        return -EBUSY;
+    }
+    struct boost_token* token = &boost->tokens[index];
+    boost->free_tokens = token->next;
+    token->generation = (token->generation + 1) & 0x7FFFFFFF;
+    token->active = true;
+    token->expired = false;
+    token->device = device_index;
+    token->level = level;
+    /* deadlines are rounded up to a tick, ticks the timer thread has passed go to the next one */
+    uint64_t tick = (deadline + boost->config.tick_ns - 1) / boost->config.tick_ns;
+    if (tick <= boost->processed_tick)
+        tick = boost->processed_tick + 1;
+    token->deadline = tick * boost->config.tick_ns;
+    int* slot = &boost->slots[tick % BOOST_WHEEL_SLOTS];
+    token->prev = -1;
+    token->next = *slot;
+    if (*slot >= 0)
+        boost->tokens[*slot].prev = index;
+    *slot = index;
+    uint32_t generation = token->generation;
+    pthread_mutex_unlock(&boost->wheel_lock);
+
+    atomic_fetch_add_explicit(&boost->acquired, 1, memory_order_relaxed);
+    return (freq_gen_boost_token_t)generation << 32 | (uint32_t)(index + 1);
+}
+
+int freq_gen_boost_release(freq_gen_boost_t* boost, freq_gen_boost_token_t token)
+{
+    int index = (int)(token & 0xFFFFFFFF) - 1;
+    uint32_t generation = token >> 32;
+    if (token <= 0 || index < 0 || index >= boost->config.max_tokens)
+        return EINVAL;
+    pthread_mutex_lock(&boost->wheel_lock);
+    struct boost_token* entry = &boost->tokens[index];
+    if (entry->generation != generation || !entry->active)
+    {
+        int ret = entry->generation == generation && entry->expired ? ETIMEDOUT : EINVAL;
+        pthread_mutex_unlock(&boost->wheel_lock);
+        return ret;
+    }
+    int device = entry->device;
+    int level = entry->level;
+    unlink_token(boost, index);
+    pthread_mutex_unlock(&boost->wheel_lock);
+
+    atomic_fetch_add_explicit(&boost->released, 1, memory_order_relaxed);
+    return put_level(boost, &boost->devices[device], level);
+}
+
+void freq_gen_boost_get_stats(freq_gen_boost_t* boost, freq_gen_boost_stats_t* stats)
+{
+    stats->acquired = atomic_load_explicit(&boost->acquired, memory_order_relaxed);
+    stats->released = atomic_load_explicit(&boost->released, memory_order_relaxed);
+    stats->expired = atomic_load_explicit(&boost->expirations, memory_order_relaxed);
+    stats->switches = atomic_load_explicit(&boost->switches, memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&boost->errors, memory_order_relaxed);
+}
+
+freq_gen_boost_t* freq_gen_boost_create(const freq_gen_boost_config_t* config)
+{
+    if (config == NULL || config->interface == NULL || config->min_frequency <= 0 ||
+        config->max_frequency < config->min_frequency || config->max_tokens < 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid boost configuration");
+        return NULL;
+    }
+    freq_gen_boost_t* boost = calloc(1, sizeof(freq_gen_boost_t));
+    if (boost == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for boosts", sizeof(freq_gen_boost_t));
+        return NULL;
+    }
+    boost->config = *config;
+    boost->config.devices = NULL;
+    if (boost->config.step <= 0)
+        boost->config.step = BOOST_DEFAULT_STEP;
+    if (boost->config.max_tokens == 0)
+        boost->config.max_tokens = BOOST_DEFAULT_MAX_TOKENS;
+    if (boost->config.default_duration_ns == 0)
+        boost->config.default_duration_ns = BOOST_DEFAULT_DURATION;
+    if (boost->config.tick_ns == 0)
+        boost->config.tick_ns = BOOST_DEFAULT_TICK;
+    pthread_mutex_init(&boost->wheel_lock, NULL);
+    atomic_init(&boost->stop, false);
+    atomic_init(&boost->acquired, 0);
+    atomic_init(&boost->released, 0);
+    atomic_init(&boost->expirations, 0);
+    atomic_init(&boost->switches, 0);
+    atomic_init(&boost->errors, 0);
+
+    /* token pool, all entries on the free list */
+    boost->tokens = calloc(boost->config.max_tokens, sizeof(struct boost_token));
+    boost->expired = calloc(boost->config.max_tokens, sizeof(struct expired_token));
+    if (boost->tokens == NULL || boost->expired == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d tokens", boost->config.max_tokens);
+        freq_gen_boost_destroy(boost);
+        return NULL;
+    }
+    for (int i = 0; i < boost->config.max_tokens; i++)
+        boost->tokens[i].next = i + 1 < boost->config.max_tokens ? i + 1 : -1;
+    boost->free_tokens = 0;
+    for (int i = 0; i < BOOST_WHEEL_SLOTS; i++)
+        boost->slots[i] = -1;
+    boost->processed_tick = freq_gen_now_ns() / boost->config.tick_ns;
+
+    /* the last setting is max_frequency, even if it is not on the grid */
+    long long int range = config->max_frequency - config->min_frequency;
+    boost->nr_settings = (range + boost->config.step - 1) / boost->config.step + 1;
+    boost->settings = calloc(boost->nr_settings, sizeof(freq_gen_setting_t));
+    if (boost->settings == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for settings");
+        freq_gen_boost_destroy(boost);
+        return NULL;
+    }
+    for (int i = 0; i < boost->nr_settings; i++)
+    {
+        boost->settings[i] = config->interface->prepare_set_frequency(frequency_of(boost, i), 0);
+        if (boost->settings[i] == NULL)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not prepare %lld Hz", frequency_of(boost, i));
+            freq_gen_boost_destroy(boost);
+            return NULL;
+        }
+    }
+
+    int nr_devices = config->devices ? config->nr_devices : config->interface->get_num_devices();
+    if (nr_devices < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not get the number of devices for %s",
+                                config->interface->name);
+        freq_gen_boost_destroy(boost);
+        return NULL;
+    }
+    boost->devices = calloc(nr_devices, sizeof(struct boosted_device));
+    if (boost->devices == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", nr_devices);
+        freq_gen_boost_destroy(boost);
+        return NULL;
+    }
+    for (int i = 0; i < nr_devices; i++)
+    {
+        struct boosted_device* device = &boost->devices[i];
+        device->nr = config->devices ? config->devices[i] : i;
+        device->active = -1;
+        device->counts = calloc(boost->nr_settings, sizeof(unsigned int));
+        if (device->counts == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for device %d", device->nr);
+            freq_gen_boost_destroy(boost);
+            return NULL;
+        }
+        device->fp = config->interface->init_device(device->nr);
+        if (device->fp < 0)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not open device %d of %s", device->nr,
+                                    config->interface->name);
+            free(device->counts);
+            freq_gen_boost_destroy(boost);
+            return NULL;
+        }
+        pthread_mutex_init(&device->lock, NULL);
+        boost->nr_devices++;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (config->cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(config->cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    int ret = pthread_create(&boost->thread, &attr, boost_thread, boost);
+    pthread_attr_destroy(&attr);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create boost timer thread (pinned to cpu %d)", config->cpu);
+        freq_gen_boost_destroy(boost);
+        return NULL;
+    }
+    boost->running = true;
+    return boost;
+}
+
+void freq_gen_boost_destroy(freq_gen_boost_t* boost)
+{
+    if (boost == NULL)
+        return;
+    if (boost->running)
+    {
+        atomic_store(&boost->stop, true);
+        pthread_join(boost->thread, NULL);
+    }
+    for (int i = 0; i < boost->nr_devices; i++)
+    {
+        struct boosted_device* device = &boost->devices[i];
+        if (device->tokens > 0)
+        {
+            memset(device->counts, 0, boost->nr_settings * sizeof(unsigned int));
+            lower_device(boost, device, 0);
+        }
+        free_baseline(boost, device);
+        boost->config.interface->close_device(device->nr, device->fp);
+        pthread_mutex_destroy(&device->lock);
+        free(device->counts);
+    }
+    for (int i = 0; i < boost->nr_settings && boost->settings != NULL; i++)
+        if (boost->settings[i] != NULL)
+            boost->config.interface->unprepare_set_frequency(boost->settings[i]);
+    pthread_mutex_destroy(&boost->wheel_lock);
+    free(boost->settings);
+    free(boost->devices);
+    free(boost->tokens);
+    free(boost->expired);
+    free(boost);
+}
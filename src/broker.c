@@ -0,0 +1,122 @@
+/*
+ * broker.c
+ *
+ * Requests file descriptors from the freqgen-broker daemon, see freqgen_broker.h
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "freq_gen_internal_broker.h"
+
+/* returns the path of the socket or NULL if the broker is disabled */
+static const char* socket_path(void)
+{
+    const char* path = getenv("LIBFREQGEN_BROKER");
+    if (path == NULL)
+        return FREQ_GEN_BROKER_DEFAULT_SOCKET;
+    return path[0] != '\0' ? path : NULL;
+}
+
+bool freq_gen_broker_available(void)
+{
+    static int available = -1;
+    if (available < 0)
+    {
+        const char* path = socket_path();
+        /* connecting needs write permission on the socket */
+        available = path != NULL && access(path, W_OK) == 0;
+    }
+    return available;
+}
+
+int freq_gen_broker_open(freq_gen_broker_file_t file, int cpu, uint32_t msr_register)
+{
+    const char* path = socket_path();
+    if (path == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("the broker is disabled by LIBFREQGEN_BROKER");
+        return -ENOENT;
+    }
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        LIBFREQGEN_SET_ERROR("broker socket path \"%s\" is too long", path);
+        return -ENAMETOOLONG;
+    }
+    strcpy(address.sun_path, path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not create a socket for the broker");
+        return -errno;
+    }
+    if (connect(sock, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        int ret = errno;
+        close(sock);
+        LIBFREQGEN_SET_ERROR("could not connect to the broker at \"%s\"", path);
+        return -ret;
+    }
+
+    freq_gen_broker_request_t request = {
+        .magic = FREQ_GEN_BROKER_MAGIC, .file = file, .cpu = cpu, .msr_register = msr_register
+    };
+    if (send(sock, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request))
+    {
+        int ret = errno ? errno : EIO;
+        close(sock);
+        LIBFREQGEN_SET_ERROR("could not send a request to the broker at \"%s\"", path);
+        return -ret;
+    }
+
+    freq_gen_broker_response_t response;
+    struct iovec iov = { .iov_base = &response, .iov_len = sizeof(response) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message = { .msg_iov = &iov,
+                              .msg_iovlen = 1,
+                              .msg_control = control.buffer,
+                              .msg_controllen = sizeof(control.buffer) };
+    ssize_t received = recvmsg(sock, &message, MSG_CMSG_CLOEXEC);
+    int ret = errno;
+    close(sock);
+
+    int fd = -1;
+    struct cmsghdr* cmsg = received > 0 ? CMSG_FIRSTHDR(&message) : NULL;
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    if (received != sizeof(response) || response.magic != FREQ_GEN_BROKER_MAGIC)
+    {
+        if (fd >= 0)
+            close(fd);
+        LIBFREQGEN_SET_ERROR("invalid response from the broker at \"%s\"", path);
+        return received < 0 ? -ret : -EPROTO;
+    }
+    if (response.error != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        LIBFREQGEN_SET_ERROR("the broker denied file %u of cpu %d: %s", file, cpu,
+                             strerror(response.error));
+        return -response.error;
+    }
+    if (fd < 0)
+    {
+        LIBFREQGEN_SET_ERROR("the broker did not pass a file descriptor");
+        return -EPROTO;
+    }
+    return fd;
+}
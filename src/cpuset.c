@@ -0,0 +1,404 @@
+/*
+ * cpuset.c
+ *
+ * Implements the cpuset scope: the allowed CPUs are the intersection of the affinity mask and the
+ * cgroup v2 cpuset.cpus.effective of the process. They are read on first use and read again when
+ * the topology generation changes (see freqgen_topology.h), so hot-plugged CPUs are enumerated.
+ * Devices are opened from several threads at the same time, so the cache is only accessed with
+ * allowed_lock held.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <mntent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_cpuset.h"
+#include "../include/freqgen_topology.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_cpuset.h"
+#include "freq_gen_internal_generic.h"
+#include "freq_gen_internal_util.h"
+
+/* -1: not decided yet, check LIBFREQGEN_CPUSET */
+static atomic_int scope = -1;
+
+/* protects allowed, nr_allowed_bits, packages and nr_packages */
+static pthread_mutex_t allowed_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* allowed CPUs, NULL if not read yet */
+static unsigned long* allowed;
+static int nr_allowed_bits;
+
+/* packages of the allowed CPUs */
+static int* packages;
+static int nr_packages;
+
+/* topology generation the cache has been read at */
+static unsigned long long allowed_generation;
+
+static bool test_bit(const unsigned long* mask, int nr_bits, int bit)
+{
+    if (bit < 0 || bit >= nr_bits)
+        return false;
+    return (mask[bit / FREQ_GEN_BITS_PER_LONG] >> (bit % FREQ_GEN_BITS_PER_LONG)) & 1UL;
+}
+
+int freq_gen_cpulist_parse(const char* string, unsigned long** mask, int* nr_bits)
+{
+    /* first pass: get the highest cpu to size the mask */
+    long highest = -1;
+    const char* current = string;
+    while (*current != '\0' && *current != '\n')
+    {
+        char* end;
+        errno = 0;
+        long first = strtol(current, &end, 10);
+        if (end == current || errno != 0 || first < 0 || first >= INT_MAX)
+            return EINVAL;
+        long last = first;
+        if (*end == '-')
+        {
+            current = end + 1;
+            last = strtol(current, &end, 10);
+            if (end == current || errno != 0 || last < first || last >= INT_MAX)
+                return EINVAL;
+        }
+        if (last > highest)
+            highest = last;
+        if (*end == ',')
+            end++;
+        else if (*end != '\0' && *end != '\n')
+            return EINVAL;
+        current = end;
+    }
+
+    int length = highest / FREQ_GEN_BITS_PER_LONG + 1;
+    *mask = calloc(length, sizeof(unsigned long));
+    if (*mask == NULL)
+        return ENOMEM;
+    *nr_bits = length * FREQ_GEN_BITS_PER_LONG;
+
+    /* second pass: set bits, the format has already been checked */
+    current = string;
+    while (*current != '\0' && *current != '\n')
+    {
+        char* end;
+        long first = strtol(current, &end, 10);
+        long last = first;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        for (long cpu = first; cpu <= last; cpu++)
+            (*mask)[cpu / FREQ_GEN_BITS_PER_LONG] |= 1UL << (cpu % FREQ_GEN_BITS_PER_LONG);
+        current = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+int freq_gen_cpulist_parse_array(const char* string, int** cpus, int* nr_cpus)
+{
+    unsigned long* mask;
+    int nr_bits;
+    int ret = freq_gen_cpulist_parse(string, &mask, &nr_bits);
+    if (ret)
+        return ret;
+    *nr_cpus = 0;
+    for (int cpu = 0; cpu < nr_bits; cpu++)
+        if (test_bit(mask, nr_bits, cpu))
+            (*nr_cpus)++;
+    *cpus = malloc((*nr_cpus > 0 ? *nr_cpus : 1) * sizeof(int));
+    if (*cpus == NULL)
+    {
+        free(mask);
+        return ENOMEM;
+    }
+    int index = 0;
+    for (int cpu = 0; cpu < nr_bits; cpu++)
+        if (test_bit(mask, nr_bits, cpu))
+            (*cpus)[index++] = cpu;
+    free(mask);
+    return 0;
+}
+
+/* reads the affinity mask, retries with larger masks on systems with many CPUs */
+static int read_affinity(unsigned long** mask, int* nr_bits)
+{
+    for (int nr_cpus = 1024; nr_cpus <= (1 << 20); nr_cpus *= 2)
+    {
+        size_t size = CPU_ALLOC_SIZE(nr_cpus);
+        cpu_set_t* set = CPU_ALLOC(nr_cpus);
+        if (set == NULL)
+            return ENOMEM;
+        if (sched_getaffinity(0, size, set) != 0)
+        {
+            int error = errno;
+            CPU_FREE(set);
+            if (error == EINVAL)
+                continue;
+            return error;
+        }
+        *nr_bits = (size / sizeof(unsigned long)) * FREQ_GEN_BITS_PER_LONG;
+        *mask = calloc(size / sizeof(unsigned long), sizeof(unsigned long));
+        if (*mask == NULL)
+        {
+            CPU_FREE(set);
+            return ENOMEM;
+        }
+        for (int cpu = 0; cpu < *nr_bits; cpu++)
+            if (CPU_ISSET_S(cpu, size, set))
+                (*mask)[cpu / FREQ_GEN_BITS_PER_LONG] |= 1UL << (cpu % FREQ_GEN_BITS_PER_LONG);
+        CPU_FREE(set);
+        return 0;
+    }
+    return EINVAL;
+}
+
+/*
+ * reads cpuset.cpus.effective of the cgroup v2 of this process, going up the hierarchy if the
+ * cpuset controller is not enabled for a cgroup.
+ * returns ENOENT if there is no cgroup v2 with cpusets
+ * */
+static int read_cgroup_cpuset(unsigned long** mask, int* nr_bits)
+{
+    char mount_point[BUFFER_SIZE] = "";
+    FILE* mounts = setmntent("/proc/mounts", "r");
+    if (mounts == NULL)
+        return errno;
+    struct mntent* entry;
+    while ((entry = getmntent(mounts)) != NULL)
+        if (strcmp(entry->mnt_type, "cgroup2") == 0)
+        {
+            snprintf(mount_point, BUFFER_SIZE, "%s", entry->mnt_dir);
+            break;
+        }
+    endmntent(mounts);
+    if (mount_point[0] == '\0')
+        return ENOENT;
+
+    /* the cgroup v2 entry in /proc/self/cgroup looks like "0::/path" */
+    char cgroup[BUFFER_SIZE];
+    FILE* file = fopen("/proc/self/cgroup", "r");
+    if (file == NULL)
+        return errno;
+    bool found = false;
+    char line[BUFFER_SIZE];
+    while (fgets(line, BUFFER_SIZE, file) != NULL)
+        if (strncmp(line, "0::", 3) == 0)
+        {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(cgroup, BUFFER_SIZE, "%s", line + 3);
+            found = true;
+            break;
+        }
+    fclose(file);
+    if (!found)
+        return ENOENT;
+
+    while (1)
+    {
+        char path[2 * BUFFER_SIZE];
+        char content[BUFFER_SIZE];
+        if (snprintf(path, sizeof(path), "%s%s/cpuset.cpus.effective", mount_point,
+                     strcmp(cgroup, "/") == 0 ? "" : cgroup) >= (int)sizeof(path))
+            return ENAMETOOLONG;
+        int ret = freq_gen_read_small_file(path, content, BUFFER_SIZE);
+        if (ret == 0)
+            return freq_gen_cpulist_parse(content, mask, nr_bits);
+        if (ret != ENOENT)
+            return ret;
+        char* slash = strrchr(cgroup, '/');
+        if (slash == NULL || strcmp(cgroup, "/") == 0)
+            return ENOENT;
+        if (slash == cgroup)
+            cgroup[1] = '\0';
+        else
+            *slash = '\0';
+    }
+}
+
+static int get_package_of_cpu(int cpu)
+{
+    char path[BUFFER_SIZE];
+    char content[64];
+    snprintf(path, BUFFER_SIZE, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    int ret = freq_gen_read_small_file(path, content, sizeof(content));
+    if (ret)
+        return -ret;
+    return atoi(content);
+}
+
+/* reads the allowed CPUs and their packages, must be called with allowed_lock held */
+static int load_allowed(void)
+{
+    unsigned long long generation = freq_gen_topology_get_generation();
+    if (allowed != NULL && allowed_generation == generation)
+        return 0;
+
+    unsigned long* affinity;
+    int nr_affinity_bits;
+    int ret = read_affinity(&affinity, &nr_affinity_bits);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not read the affinity mask of the process");
+        return ret;
+    }
+
+    unsigned long* cgroup;
+    int nr_cgroup_bits;
+    ret = read_cgroup_cpuset(&cgroup, &nr_cgroup_bits);
+    if (ret == 0)
+    {
+        for (int i = 0; i < nr_affinity_bits / FREQ_GEN_BITS_PER_LONG; i++)
+            affinity[i] &= i < nr_cgroup_bits / FREQ_GEN_BITS_PER_LONG ? cgroup[i] : 0UL;
+        free(cgroup);
+    }
+    /* without cgroup v2 cpusets, the affinity mask is all we have */
+    else if (ret != ENOENT)
+    {
+        free(affinity);
+        LIBFREQGEN_SET_ERROR("could not read cpuset.cpus.effective of the process");
+        return ret;
+    }
+
+    /* built completely before it replaces the cache */
+    int* new_packages = NULL;
+    int nr_new_packages = 0;
+    for (int cpu = 0; cpu < nr_affinity_bits; cpu++)
+    {
+        if (!test_bit(affinity, nr_affinity_bits, cpu))
+            continue;
+        int package = get_package_of_cpu(cpu);
+        /* offline CPUs have no topology */
+        if (package < 0)
+            continue;
+        bool known = false;
+        for (int i = 0; i < nr_new_packages; i++)
+            if (new_packages[i] == package)
+                known = true;
+        if (known)
+            continue;
+        int* tmp = realloc(new_packages, (nr_new_packages + 1) * sizeof(int));
+        if (tmp == NULL)
+        {
+            free(new_packages);
+            free(affinity);
+            LIBFREQGEN_SET_ERROR("could not allocate memory for packages");
+            return ENOMEM;
+        }
+        new_packages = tmp;
+        new_packages[nr_new_packages++] = package;
+    }
+    free(packages);
+    packages = new_packages;
+    nr_packages = nr_new_packages;
+    free(allowed);
+    allowed = affinity;
+    nr_allowed_bits = nr_affinity_bits;
+    allowed_generation = generation;
+    return 0;
+}
+
+void freq_gen_cpuset_set_scope(int enable)
+{
+    pthread_mutex_lock(&allowed_lock);
+    atomic_store(&scope, enable ? 1 : 0);
+    free(allowed);
+    allowed = NULL;
+    pthread_mutex_unlock(&allowed_lock);
+}
+
+int freq_gen_cpuset_get_scope(void)
+{
+    return freq_gen_cpuset_enabled() ? 1 : 0;
+}
+
+bool freq_gen_cpuset_enabled(void)
+{
+    int enabled = atomic_load(&scope);
+    if (enabled < 0)
+    {
+        char* env = getenv("LIBFREQGEN_CPUSET");
+        enabled = env != NULL && env[0] != '\0' && strcmp(env, "0") != 0;
+        /* freq_gen_cpuset_set_scope() wins over the environment */
+        int undecided = -1;
+        if (!atomic_compare_exchange_strong(&scope, &undecided, enabled))
+            enabled = undecided;
+    }
+    return enabled;
+}
+
+int freq_gen_cpuset_next_cpu(int cpu)
+{
+    pthread_mutex_lock(&allowed_lock);
+    int ret = load_allowed();
+    int next = ret ? -ret : -1;
+    for (int candidate = cpu + 1; ret == 0 && candidate < nr_allowed_bits; candidate++)
+        if (test_bit(allowed, nr_allowed_bits, candidate))
+        {
+            next = candidate;
+            break;
+        }
+    pthread_mutex_unlock(&allowed_lock);
+    return next;
+}
+
+bool freq_gen_cpuset_cpu_allowed(int cpu)
+{
+    if (!freq_gen_cpuset_enabled())
+        return true;
+    pthread_mutex_lock(&allowed_lock);
+    bool result = load_allowed() == 0 && test_bit(allowed, nr_allowed_bits, cpu);
+    pthread_mutex_unlock(&allowed_lock);
+    return result;
+}
+
+bool freq_gen_cpuset_package_allowed(int package)
+{
+    if (!freq_gen_cpuset_enabled())
+        return true;
+    pthread_mutex_lock(&allowed_lock);
+    bool result = false;
+    if (load_allowed() == 0)
+        for (int i = 0; i < nr_packages; i++)
+            if (packages[i] == package)
+                result = true;
+    pthread_mutex_unlock(&allowed_lock);
+    return result;
+}
+
+bool freq_gen_cpuset_uncore_allowed(int uncore)
+{
+    if (!freq_gen_cpuset_enabled())
+        return true;
+    int cpu = freq_gen_get_uncore_leader_cpu(uncore);
+    if (cpu < 0)
+        return false;
+    int package = get_package_of_cpu(cpu);
+    if (package < 0)
+        return false;
+    return freq_gen_cpuset_package_allowed(package);
+}
+
+int freq_gen_device_allowed(freq_gen_dev_type type, int device)
+{
+    switch (type)
+    {
+    case FREQ_GEN_DEVICE_CORE_FREQ:
+        return freq_gen_cpuset_cpu_allowed(device);
+    case FREQ_GEN_DEVICE_UNCORE_FREQ:
+        return freq_gen_cpuset_uncore_allowed(device);
+    default:
+        return 0;
+    }
+}
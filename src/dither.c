@@ -0,0 +1,520 @@
+/*
+ * dither.c
+ *
+ * Implements frequency dithering, see freqgen_dither.h. The target of a device is stored as one
+ * atomic word (index of the lower frequency and duty cycle), so set_target does not need to
+ * synchronize with the dithering thread. All devices share the time base: a device runs at its
+ * upper frequency while (now mod period) < duty * period.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_dither.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_perf.h"
+
+#define DITHER_DEFAULT_STEP 100000000LL
+#define DITHER_DEFAULT_LATENCY 50000ULL
+#define DITHER_DEFAULT_MAX_OVERHEAD 0.05
+/* shortest period, so that the thread is not woken up too often */
+#define DITHER_MIN_PERIOD 100000ULL
+/* the thread wakes up this often if no device switches, to pick up new targets */
+#define DITHER_IDLE_INTERVAL 1000000ULL
+
+/* a target word: index of the lower frequency in the upper 32 bit, duty * 2^32 in the lower */
+#define DITHER_NO_TARGET UINT64_MAX
+#define DUTY_ONE 4294967296.0
+
+/* APERF/MPERF/TSC counters of a cpu and their values at the last get_state */
+struct effective_counters
+{
+    int aperf_fd;
+    int mperf_fd;
+    int tsc_fd;
+    uint64_t last_aperf;
+    uint64_t last_mperf;
+    uint64_t last_tsc;
+    uint64_t last_time;
+};
+
+struct dithered_device
+{
+    int nr;                      /**< device number */
+    freq_gen_single_device_t fp; /**< from init_device */
+    _Atomic uint64_t target;     /**< target word or DITHER_NO_TARGET */
+    _Atomic uint64_t period_ns;
+    _Atomic long long int target_frequency;
+
+    /* only used by the thread that calls step */
+    int applied; /**< index of the applied setting, -1 if unknown */
+    uint64_t since;
+
+    /* time-weighted applied frequency (MHz * ns) and time since the last get_state */
+    _Atomic uint64_t mhz_ns;
+    _Atomic uint64_t time_ns;
+    _Atomic uint64_t switches;
+
+    struct effective_counters effective;
+};
+
+struct freq_gen_dither_s
+{
+    freq_gen_dither_config_t config;
+    struct dithered_device* devices;
+    int nr_devices;
+    freq_gen_setting_t* settings; /**< one per step between min_frequency and max_frequency */
+    int nr_settings;
+
+    pthread_t thread;
+    bool running;
+    atomic_bool stop;
+
+    /* statistics, written by the dithering thread only */
+    atomic_uint_fast64_t rounds;
+    atomic_uint_fast64_t switches;
+    atomic_uint_fast64_t errors;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+};
+
+static long long int frequency_of(freq_gen_dither_t* dither, int index)
+{
+    long long int frequency = dither->config.min_frequency + index * dither->config.step;
+    return frequency > dither->config.max_frequency ? dither->config.max_frequency : frequency;
+}
+
+static void close_effective_counters(struct effective_counters* counters)
+{
+    if (counters->aperf_fd >= 0)
+        close(counters->aperf_fd);
+    if (counters->mperf_fd >= 0)
+        close(counters->mperf_fd);
+    if (counters->tsc_fd >= 0)
+        close(counters->tsc_fd);
+    counters->aperf_fd = counters->mperf_fd = counters->tsc_fd = -1;
+}
+
+/* opens APERF, MPERF and TSC via the perf msr PMU, failures leave the counters closed */
+static void open_effective_counters(struct effective_counters* counters, int cpu)
+{
+    counters->aperf_fd = freq_gen_perf_open_named("msr", "aperf", cpu, -1);
+    counters->mperf_fd = freq_gen_perf_open_named("msr", "mperf", cpu, -1);
+    counters->tsc_fd = freq_gen_perf_open_named("msr", "tsc", cpu, -1);
+    if (counters->aperf_fd < 0 || counters->mperf_fd < 0 || counters->tsc_fd < 0)
+        close_effective_counters(counters);
+    counters->last_time = 0;
+}
+
+/* effective frequency since the last call: TSC rate * delta APERF / delta MPERF
+ * returns 0 if there is no previous value yet */
+static long long int read_effective_frequency(struct effective_counters* counters)
+{
+    if (counters->aperf_fd < 0)
+        return -ENOENT;
+    uint64_t aperf, mperf, tsc;
+    if (freq_gen_perf_read(counters->aperf_fd, &aperf) ||
+        freq_gen_perf_read(counters->mperf_fd, &mperf) ||
+        freq_gen_perf_read(counters->tsc_fd, &tsc))
+        return -EIO;
+    uint64_t now = freq_gen_now_ns();
+    long long int result = 0;
+    if (counters->last_time != 0 && mperf != counters->last_mperf && now != counters->last_time)
+    {
+        double tsc_hz =
+            (double)(tsc - counters->last_tsc) * 1e9 / (double)(now - counters->last_time);
+        result = (long long int)(tsc_hz * (double)(aperf - counters->last_aperf) /
+                                 (double)(mperf - counters->last_mperf));
+    }
+    counters->last_aperf = aperf;
+    counters->last_mperf = mperf;
+    counters->last_tsc = tsc;
+    counters->last_time = now;
+    return result;
+}
+
+static struct dithered_device* find_device(freq_gen_dither_t* dither, int nr)
+{
+    for (int i = 0; i < dither->nr_devices; i++)
+        if (dither->devices[i].nr == nr)
+            return &dither->devices[i];
+    return NULL;
+}
+
+/* period with two transitions between lower and upper taking at most max_overhead */
+static uint64_t choose_period(freq_gen_dither_t* dither, long long int lower, long long int upper)
+{
+    const freq_gen_dither_config_t* config = &dither->config;
+    if (config->period_ns)
+        return config->period_ns;
+    uint64_t latency = config->default_latency_ns;
+    if (config->latencies != NULL)
+    {
+        long long int up = freq_gen_latency_get(config->latencies, config->type, lower, upper,
+                                                FREQ_GEN_LATENCY_P90);
+        long long int down = freq_gen_latency_get(config->latencies, config->type, upper, lower,
+                                                  FREQ_GEN_LATENCY_P90);
+        if (up > 0 || down > 0)
+            latency = up > down ? up : down;
+    }
+    uint64_t period = 2 * latency / config->max_overhead;
+    return period < DITHER_MIN_PERIOD ? DITHER_MIN_PERIOD : period;
+}
+
+static void close_device(freq_gen_dither_t* dither, struct dithered_device* device)
+{
+    close_effective_counters(&device->effective);
+    dither->config.interface->close_device(device->nr, device->fp);
+}
+
+freq_gen_dither_t* freq_gen_dither_create(const freq_gen_dither_config_t* config)
+{
+    if (config == NULL || config->interface == NULL || config->min_frequency <= 0 ||
+        config->max_frequency < config->min_frequency || config->max_overhead < 0 ||
+        config->max_overhead >= 1)
+    {
+        LIBFREQGEN_SET_ERROR("invalid dithering configuration");
+        return NULL;
+    }
+    freq_gen_dither_t* dither = calloc(1, sizeof(freq_gen_dither_t));
+    if (dither == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for dithering",
+                             sizeof(freq_gen_dither_t));
+        return NULL;
+    }
+    dither->config = *config;
+    dither->config.devices = NULL;
+    if (dither->config.step <= 0)
+        dither->config.step = DITHER_DEFAULT_STEP;
+    if (dither->config.default_latency_ns == 0)
+        dither->config.default_latency_ns = DITHER_DEFAULT_LATENCY;
+    if (dither->config.max_overhead == 0)
+        dither->config.max_overhead = DITHER_DEFAULT_MAX_OVERHEAD;
+    atomic_init(&dither->stop, false);
+    atomic_init(&dither->rounds, 0);
+    atomic_init(&dither->switches, 0);
+    atomic_init(&dither->errors, 0);
+    atomic_init(&dither->total_ns, 0);
+    atomic_init(&dither->max_ns, 0);
+
+    /* the last setting is max_frequency, even if it is not on the grid */
+    long long int range = config->max_frequency - config->min_frequency;
+    dither->nr_settings = (range + dither->config.step - 1) / dither->config.step + 1;
+    dither->settings = calloc(dither->nr_settings, sizeof(freq_gen_setting_t));
+    if (dither->settings == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for settings");
+        freq_gen_dither_destroy(dither);
+        return NULL;
+    }
+    for (int i = 0; i < dither->nr_settings; i++)
+    {
+        dither->settings[i] = config->interface->prepare_set_frequency(frequency_of(dither, i), 0);
+        if (dither->settings[i] == NULL)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not prepare %lld Hz", frequency_of(dither, i));
+            freq_gen_dither_destroy(dither);
+            return NULL;
+        }
+    }
+
+    int nr_devices = config->devices ? config->nr_devices : config->interface->get_num_devices();
+    if (nr_devices < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not get the number of devices for %s",
+                                config->interface->name);
+        freq_gen_dither_destroy(dither);
+        return NULL;
+    }
+    dither->devices = calloc(nr_devices, sizeof(struct dithered_device));
+    if (dither->devices == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", nr_devices);
+        freq_gen_dither_destroy(dither);
+        return NULL;
+    }
+    for (int i = 0; i < nr_devices; i++)
+    {
+        struct dithered_device* device = &dither->devices[i];
+        device->nr = config->devices ? config->devices[i] : i;
+        device->applied = -1;
+        device->effective.aperf_fd = device->effective.mperf_fd = device->effective.tsc_fd = -1;
+        atomic_init(&device->target, DITHER_NO_TARGET);
+        atomic_init(&device->period_ns, 0);
+        atomic_init(&device->target_frequency, 0);
+        atomic_init(&device->mhz_ns, 0);
+        atomic_init(&device->time_ns, 0);
+        atomic_init(&device->switches, 0);
+        device->fp = config->interface->init_device(device->nr);
+        if (device->fp < 0)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not open device %d of %s", device->nr,
+                                    config->interface->name);
+            freq_gen_dither_destroy(dither);
+            return NULL;
+        }
+        if (config->measure_effective && config->type == FREQ_GEN_DEVICE_CORE_FREQ)
+            open_effective_counters(&device->effective, device->nr);
+        dither->nr_devices++;
+    }
+    return dither;
+}
+
+static int set_device_target(freq_gen_dither_t* dither, struct dithered_device* device,
+                             long long int frequency)
+{
+    if (frequency == 0)
+    {
+        atomic_store(&device->target, DITHER_NO_TARGET);
+        atomic_store(&device->target_frequency, 0);
+        return 0;
+    }
+    if (frequency < dither->config.min_frequency)
+        frequency = dither->config.min_frequency;
+    if (frequency > dither->config.max_frequency)
+        frequency = dither->config.max_frequency;
+    uint64_t index = (frequency - dither->config.min_frequency) / dither->config.step;
+    double duty = 0;
+    if ((int)index + 1 < dither->nr_settings)
+    {
+        long long int lower = frequency_of(dither, index);
+        long long int upper = frequency_of(dither, index + 1);
+        duty = (double)(frequency - lower) / (upper - lower);
+        atomic_store(&device->period_ns, choose_period(dither, lower, upper));
+    }
+    else
+        index = dither->nr_settings - 1;
+    uint64_t duty_fixed = duty * DUTY_ONE;
+    if (duty_fixed > UINT32_MAX)
+        duty_fixed = UINT32_MAX;
+    atomic_store(&device->target_frequency, frequency);
+    /* publishes period_ns, which step_device reads after acquiring the target */
+    atomic_store_explicit(&device->target, index << 32 | duty_fixed, memory_order_release);
+    return 0;
+}
+
+int freq_gen_dither_set_target(freq_gen_dither_t* dither, int device, long long int frequency)
+{
+    if (frequency < 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid target frequency %lld", frequency);
+        return EINVAL;
+    }
+    if (device >= 0)
+    {
+        struct dithered_device* dithered = find_device(dither, device);
+        if (dithered == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("device %d is not dithered", device);
+            return ENODEV;
+        }
+        return set_device_target(dither, dithered, frequency);
+    }
+    for (int i = 0; i < dither->nr_devices; i++)
+        set_device_target(dither, &dither->devices[i], frequency);
+    return 0;
+}
+
+/* applies the setting a device should run at now, returns 1 if it changed, 0 or -ERRNO */
+static int step_device(freq_gen_dither_t* dither, struct dithered_device* device, uint64_t now,
+                       uint64_t* next)
+{
+    uint64_t target = atomic_load_explicit(&device->target, memory_order_acquire);
+    if (device->applied >= 0 && now > device->since)
+    {
+        uint64_t duration = now - device->since;
+        atomic_fetch_add_explicit(&device->mhz_ns,
+                                  duration * (frequency_of(dither, device->applied) / 1000000),
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&device->time_ns, duration, memory_order_relaxed);
+    }
+    device->since = now;
+    if (target == DITHER_NO_TARGET)
+        return 0;
+
+    int index = target >> 32;
+    uint64_t duty = target & UINT32_MAX;
+    if (duty != 0)
+    {
+        uint64_t period = atomic_load_explicit(&device->period_ns, memory_order_relaxed);
+        /* set before the target is published, guard against a zero period anyway */
+        if (period == 0)
+            period = DITHER_MIN_PERIOD;
+        uint64_t on = period * (duty / DUTY_ONE);
+        uint64_t phase = now % period;
+        uint64_t boundary = now - phase + (phase < on ? on : period);
+        if (boundary < *next)
+            *next = boundary;
+        if (phase < on)
+            index++;
+    }
+    if (index == device->applied)
+        return 0;
+    int ret = dither->config.interface->set_frequency(device->fp, dither->settings[index]);
+    if (ret)
+    {
+        device->applied = -1;
+        return -ret;
+    }
+    device->applied = index;
+    atomic_fetch_add_explicit(&device->switches, 1, memory_order_relaxed);
+    return 1;
+}
+
+int freq_gen_dither_step(freq_gen_dither_t* dither, uint64_t now, uint64_t* next)
+{
+    uint64_t start = freq_gen_now_ns();
+    uint64_t next_switch = UINT64_MAX;
+    int changes = 0;
+    int error = 0;
+    for (int i = 0; i < dither->nr_devices; i++)
+    {
+        int ret = step_device(dither, &dither->devices[i], now, &next_switch);
+        if (ret < 0)
+        {
+            atomic_fetch_add_explicit(&dither->errors, 1, memory_order_relaxed);
+            error = ret;
+        }
+        else
+            changes += ret;
+    }
+    if (next != NULL)
+        *next = next_switch;
+    uint64_t duration = freq_gen_now_ns() - start;
+    atomic_fetch_add_explicit(&dither->rounds, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dither->switches, changes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dither->total_ns, duration, memory_order_relaxed);
+    if (duration > atomic_load_explicit(&dither->max_ns, memory_order_relaxed))
+        atomic_store_explicit(&dither->max_ns, duration, memory_order_relaxed);
+    return changes > 0 || error == 0 ? changes : error;
+}
+
+static void* dither_thread(void* arg)
+{
+    freq_gen_dither_t* dither = arg;
+    while (!atomic_load_explicit(&dither->stop, memory_order_relaxed))
+    {
+        uint64_t now = freq_gen_now_ns();
+        uint64_t next;
+        freq_gen_dither_step(dither, now, &next);
+        if (next > now + DITHER_IDLE_INTERVAL)
+            next = now + DITHER_IDLE_INTERVAL;
+        struct timespec wakeup = { .tv_sec = next / 1000000000ULL,
+                                   .tv_nsec = next % 1000000000ULL };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+int freq_gen_dither_start(freq_gen_dither_t* dither)
+{
+    if (dither->running)
+    {
+        LIBFREQGEN_SET_ERROR("dithering is already running");
+        return EBUSY;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (dither->config.cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(dither->config.cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    atomic_store(&dither->stop, false);
+    int ret = pthread_create(&dither->thread, &attr, dither_thread, dither);
+    pthread_attr_destroy(&attr);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create dithering thread (pinned to cpu %d)",
+                             dither->config.cpu);
+        return ret;
+    }
+    dither->running = true;
+    return 0;
+}
+
+int freq_gen_dither_stop(freq_gen_dither_t* dither)
+{
+    if (!dither->running)
+        return 0;
+    atomic_store(&dither->stop, true);
+    int ret = pthread_join(dither->thread, NULL);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not join dithering thread");
+        return ret;
+    }
+    dither->running = false;
+    return 0;
+}
+
+int freq_gen_dither_get_state(freq_gen_dither_t* dither, int device,
+                              freq_gen_dither_state_t* state)
+{
+    struct dithered_device* dithered = find_device(dither, device);
+    if (dithered == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("device %d is not dithered", device);
+        return ENODEV;
+    }
+    uint64_t target = atomic_load(&dithered->target);
+    *state = (freq_gen_dither_state_t){
+        .target = atomic_load(&dithered->target_frequency),
+        .switches = atomic_load_explicit(&dithered->switches, memory_order_relaxed)
+    };
+    if (target != DITHER_NO_TARGET)
+    {
+        int index = target >> 32;
+        state->lower = frequency_of(dither, index);
+        state->duty = (target & UINT32_MAX) / DUTY_ONE;
+        state->upper = state->duty > 0 ? frequency_of(dither, index + 1) : state->lower;
+        state->period_ns = state->duty > 0 ? atomic_load(&dithered->period_ns) : 0;
+    }
+    uint64_t mhz_ns = atomic_exchange_explicit(&dithered->mhz_ns, 0, memory_order_relaxed);
+    uint64_t time_ns = atomic_exchange_explicit(&dithered->time_ns, 0, memory_order_relaxed);
+    if (time_ns > 0)
+        state->applied_frequency = (long long int)((double)mhz_ns / time_ns * 1e6);
+    state->effective_frequency = read_effective_frequency(&dithered->effective);
+    return 0;
+}
+
+void freq_gen_dither_get_stats(freq_gen_dither_t* dither, freq_gen_dither_stats_t* stats)
+{
+    stats->rounds = atomic_load_explicit(&dither->rounds, memory_order_relaxed);
+    stats->switches = atomic_load_explicit(&dither->switches, memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&dither->errors, memory_order_relaxed);
+    stats->max_ns_per_round = atomic_load_explicit(&dither->max_ns, memory_order_relaxed);
+    uint64_t total_ns = atomic_load_explicit(&dither->total_ns, memory_order_relaxed);
+    stats->ns_per_round = stats->rounds ? (double)total_ns / stats->rounds : 0.0;
+}
+
+void freq_gen_dither_destroy(freq_gen_dither_t* dither)
+{
+    if (dither == NULL)
+        return;
+    freq_gen_dither_stop(dither);
+    for (int i = 0; i < dither->nr_devices; i++)
+        close_device(dither, &dither->devices[i]);
+    for (int i = 0; i < dither->nr_settings && dither->settings != NULL; i++)
+        if (dither->settings[i] != NULL)
+            dither->config.interface->unprepare_set_frequency(dither->settings[i]);
+    free(dither->settings);
+    free(dither->devices);
+    free(dither);
+}
@@ -0,0 +1,162 @@
+/*
+ * energy.c
+ *
+ * Implements the RAPL energy counters of freq_gen_internal_energy.h
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_energy.h"
+#include "freq_gen_internal_util.h"
+
+#define POWERCAP_PATH "/sys/class/powercap"
+#define RAPL_PREFIX "intel-rapl:"
+
+static int read_zone_file(const char* zone, const char* file, char* buffer, size_t size)
+{
+    char path[BUFFER_SIZE];
+    snprintf(path, BUFFER_SIZE, POWERCAP_PATH "/%s/%s", zone, file);
+    return freq_gen_read_small_file(path, buffer, size);
+}
+
+/* returns N of the name package-N or package-N-die-M of a zone or -1 */
+static int package_of_zone(const char* zone)
+{
+    char name[64];
+    int package;
+    if (read_zone_file(zone, "name", name, sizeof(name)) ||
+        sscanf(name, "package-%d", &package) != 1 || package < 0)
+        return -1;
+    return package;
+}
+
+/* returns the raw value of a zone in J or -1 */
+static double read_zone(const freq_gen_energy_zone_t* zone)
+{
+    char buffer[64];
+    ssize_t length = pread(zone->fd, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0)
+        return -1;
+    buffer[length] = '\0';
+    return strtoull(buffer, NULL, 10) / 1e6;
+}
+
+int freq_gen_energy_open(freq_gen_energy_t* energy, int package, bool dram)
+{
+    *energy = (freq_gen_energy_t){ 0 };
+    DIR* dir = opendir(POWERCAP_PATH);
+    if (dir == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open " POWERCAP_PATH);
+        return ENOENT;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, RAPL_PREFIX, strlen(RAPL_PREFIX)) != 0)
+            continue;
+        char name[64];
+        char range[64];
+        if (read_zone_file(entry->d_name, "name", name, sizeof(name)) ||
+            read_zone_file(entry->d_name, "max_energy_range_uj", range, sizeof(range)))
+            continue;
+        bool is_dram = strcmp(name, "dram") == 0;
+        int zone_package;
+        if (is_dram)
+        {
+            if (!dram)
+                continue;
+            /* intel-rapl:(parent):(index) */
+            char parent[sizeof(entry->d_name)];
+            snprintf(parent, sizeof(parent), "%s", entry->d_name);
+            char* separator = strrchr(parent, ':');
+            if (separator == NULL || separator - parent < (long)strlen(RAPL_PREFIX))
+                continue;
+            *separator = '\0';
+            zone_package = package_of_zone(parent);
+        }
+        else
+            zone_package = package_of_zone(entry->d_name);
+        if (zone_package < 0 || (package >= 0 && zone_package != package))
+            continue;
+
+        char path[BUFFER_SIZE];
+        snprintf(path, BUFFER_SIZE, POWERCAP_PATH "/%s/energy_uj", entry->d_name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        freq_gen_energy_zone_t* zones =
+            realloc(energy->zones, (energy->nr_zones + 1) * sizeof(freq_gen_energy_zone_t));
+        if (zones == NULL)
+        {
+            close(fd);
+            closedir(dir);
+            LIBFREQGEN_SET_ERROR("could not allocate memory for RAPL zones");
+            return ENOMEM;
+        }
+        energy->zones = zones;
+        freq_gen_energy_zone_t* zone = &zones[energy->nr_zones++];
+        *zone = (freq_gen_energy_zone_t){ .fd = fd,
+                                          .package = zone_package,
+                                          .dram = is_dram,
+                                          .max_energy = strtoull(range, NULL, 10) / 1e6 };
+        zone->last = read_zone(zone);
+    }
+    closedir(dir);
+    for (int i = 0; i < energy->nr_zones; i++)
+        if (!energy->zones[i].dram)
+            return 0;
+    if (package >= 0)
+        LIBFREQGEN_SET_ERROR("no readable RAPL zone package-%d in " POWERCAP_PATH, package);
+    else
+        LIBFREQGEN_SET_ERROR("no readable RAPL package zone in " POWERCAP_PATH);
+    return ENOENT;
+}
+
+int freq_gen_energy_read(freq_gen_energy_t* energy, double* package, double* dram)
+{
+    for (int i = 0; i < energy->nr_zones; i++)
+    {
+        freq_gen_energy_zone_t* zone = &energy->zones[i];
+        double value = read_zone(zone);
+        if (value < 0)
+        {
+            LIBFREQGEN_SET_ERROR("could not read RAPL energy");
+            return EIO;
+        }
+        if (zone->last >= 0)
+        {
+            double delta = value - zone->last;
+            if (delta < 0)
+                delta += zone->max_energy;
+            if (zone->dram)
+                energy->dram_energy += delta;
+            else
+                energy->package_energy += delta;
+        }
+        zone->last = value;
+    }
+    *package = energy->package_energy;
+    if (dram != NULL)
+        *dram = energy->dram_energy;
+    return 0;
+}
+
+void freq_gen_energy_close(freq_gen_energy_t* energy)
+{
+    for (int i = 0; i < energy->nr_zones; i++)
+        close(energy->zones[i].fd);
+    free(energy->zones);
+    energy->zones = NULL;
+    energy->nr_zones = 0;
+}
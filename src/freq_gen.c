@@ -10,11 +10,14 @@
 
 #include "../include/error.h"
 #include "freq_gen_internal.h"
+#include "freq_gen_internal_instrument.h"
+#include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /* store previously set core and uncore to be able to iterate through them */
 static int previous_core = -1;
@@ -56,31 +59,35 @@ static bool is_selected_uncore_interface(char* name)
         return false;
 }
 
-freq_gen_interface_t* freq_gen_init(freq_gen_dev_type type)
-{
-    /* this needs to be increased whenever there's a new implementation */
-    int nr_avail = 2
+/* this needs to be increased whenever there's a new implementation */
+static const int nr_avail = 3
 #ifdef USEX86_ADAPT
-                   + 1
+                            + 1
 #endif
 #ifdef USELIKWID
-                   + 1
+                            + 1
 #endif
-        ;
-    /* new implementations will be appended here and added to freq_gen_internal.h */
-    freq_gen_interface_internal_t* avail[] = { &freq_gen_sysfs_interface_internal,
-                                               &freq_gen_msr_interface_internal
+    ;
+/*
+ * new implementations will be appended here and added to freq_gen_internal.h
+ * sim comes first, it is only available if it has been requested
+ */
+static freq_gen_interface_internal_t* avail[] = { &freq_gen_sim_interface_internal,
+                                                  &freq_gen_sysfs_interface_internal,
+                                                  &freq_gen_msr_interface_internal
 #ifdef USEX86_ADAPT
-                                               ,
-                                               &freq_gen_x86a_interface_internal
+                                                  ,
+                                                  &freq_gen_x86a_interface_internal
 #endif
 #ifdef USELIKWID
-                                               ,
-                                               &freq_gen_likwid_interface_internal
+                                                  ,
+                                                  &freq_gen_likwid_interface_internal
 #endif
 
-    };
+};
 
+freq_gen_interface_t* freq_gen_init(freq_gen_dev_type type)
+{
     switch (type)
     {
     /* go through */
@@ -93,7 +100,7 @@ freq_gen_interface_t* freq_gen_init(freq_gen_dev_type type)
                 if (found)
                 {
                     previous_core = i;
-                    return found;
+                    return freq_gen_instrument_interface(type, found);
                 }
             }
         }
@@ -112,7 +119,7 @@ freq_gen_interface_t* freq_gen_init(freq_gen_dev_type type)
                 if (found)
                 {
                     previous_uncore = i;
-                    return found;
+                    return freq_gen_instrument_interface(type, found);
                 }
             }
         }
@@ -127,3 +134,163 @@ freq_gen_interface_t* freq_gen_init(freq_gen_dev_type type)
         return NULL;
     }
 }
+
+/* number of get and set calls that are measured per interface */
+#define RANK_ROUNDS 5
+
+static double elapsed_ns(const struct timespec* start, const struct timespec* end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/* measures get and set on an opened device, writes back the current frequency */
+static int measure_device(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                          freq_gen_ranked_interface_t* result)
+{
+    struct timespec start, end;
+    long long int frequency = interface->get_frequency(fp);
+    if (frequency < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not read the frequency with %s", interface->name);
+        return frequency;
+    }
+    /* set_frequency of range interfaces also sets the minimum, restore it afterwards */
+    long long int min_frequency = -1;
+    if (interface->get_min_frequency != NULL && interface->set_min_frequency != NULL)
+        min_frequency = interface->get_min_frequency(fp);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < RANK_ROUNDS; i++)
+        interface->get_frequency(fp);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->get_ns = elapsed_ns(&start, &end) / RANK_ROUNDS;
+
+    freq_gen_setting_t setting = interface->prepare_set_frequency(frequency, 0);
+    if (setting == NULL)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not prepare frequency %lld with %s", frequency,
+                                interface->name);
+        return -EINVAL;
+    }
+    int ret = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < RANK_ROUNDS && ret == 0; i++)
+        ret = interface->set_frequency(fp, setting);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->set_ns = elapsed_ns(&start, &end) / RANK_ROUNDS;
+    interface->unprepare_set_frequency(setting);
+    if (ret)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not set frequency %lld with %s", frequency,
+                                interface->name);
+        return ret < 0 ? ret : -ret;
+    }
+
+    if (min_frequency >= 0 && min_frequency != frequency)
+    {
+        setting = interface->prepare_set_frequency(min_frequency, 0);
+        if (setting == NULL)
+            return -EINVAL;
+        ret = interface->set_min_frequency(fp, setting);
+        interface->unprepare_set_frequency(setting);
+        if (ret)
+            return ret < 0 ? ret : -ret;
+    }
+    return 0;
+}
+
+/* measures an interface on the first device that can be opened */
+static int measure(freq_gen_interface_t* interface, freq_gen_ranked_interface_t* result)
+{
+    int nr_devices = interface->get_num_devices();
+    if (nr_devices < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not get the number of devices of %s", interface->name);
+        return nr_devices;
+    }
+    for (int device = 0; device < nr_devices; device++)
+    {
+        freq_gen_single_device_t fp = interface->init_device(device);
+        if (fp < 0)
+            continue;
+        result->interface = interface;
+        result->device = device;
+        int ret = measure_device(interface, fp, result);
+        interface->close_device(device, fp);
+        return ret;
+    }
+    LIBFREQGEN_SET_ERROR("could not open any device of %s", interface->name);
+    return -ENODEV;
+}
+
+static int compare_costs(const void* a, const void* b)
+{
+    const freq_gen_ranked_interface_t* x = a;
+    const freq_gen_ranked_interface_t* y = b;
+    double cost_x = x->get_ns + x->set_ns;
+    double cost_y = y->get_ns + y->set_ns;
+    return cost_x < cost_y ? -1 : cost_x > cost_y;
+}
+
+int freq_gen_init_ranked(freq_gen_dev_type type, freq_gen_ranked_interface_t* ranked,
+                         int max_interfaces)
+{
+    if (type != FREQ_GEN_DEVICE_CORE_FREQ && type != FREQ_GEN_DEVICE_UNCORE_FREQ)
+    {
+        LIBFREQGEN_SET_ERROR("unsupported device type %d", type);
+        return -EINVAL;
+    }
+    int nr_ranked = 0;
+    for (int i = 0; i < nr_avail && nr_ranked < max_interfaces; i++)
+    {
+        freq_gen_interface_t* found = NULL;
+        if (type == FREQ_GEN_DEVICE_CORE_FREQ)
+        {
+            if (avail[i]->init_cpufreq != NULL && is_selected_core_interface(avail[i]->name))
+                found = avail[i]->init_cpufreq();
+        }
+        else if (avail[i]->init_uncorefreq != NULL &&
+                 is_selected_uncore_interface(avail[i]->name))
+            found = avail[i]->init_uncorefreq();
+        if (found == NULL)
+            continue;
+        /* interfaces that can not read and write a device are not usable */
+        if (measure(found, &ranked[nr_ranked]) != 0)
+        {
+            found->finalize();
+            continue;
+        }
+        nr_ranked++;
+    }
+    if (nr_ranked == 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not find a usable interface for device type %d", type);
+        return -ENODEV;
+    }
+    qsort(ranked, nr_ranked, sizeof(freq_gen_ranked_interface_t), compare_costs);
+    return nr_ranked;
+}
+
+freq_gen_interface_t* freq_gen_select_ranked(freq_gen_dev_type type,
+                                             freq_gen_ranked_interface_t* ranked,
+                                             int nr_interfaces, int index)
+{
+    if (index < 0 || index >= nr_interfaces)
+    {
+        LIBFREQGEN_SET_ERROR("invalid index %d for %d ranked interfaces", index, nr_interfaces);
+        return NULL;
+    }
+    for (int i = 0; i < nr_interfaces; i++)
+        if (i != index)
+            ranked[i].interface->finalize();
+    return freq_gen_instrument_interface(type, ranked[index].interface);
+}
+
+freq_gen_interface_t* freq_gen_init_fastest(freq_gen_dev_type type)
+{
+    freq_gen_ranked_interface_t ranked[nr_avail];
+    int nr_ranked = freq_gen_init_ranked(type, ranked, nr_avail);
+    if (nr_ranked < 0)
+        return NULL;
+    return freq_gen_select_ranked(type, ranked, nr_ranked, 0);
+}
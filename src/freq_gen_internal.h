@@ -27,6 +27,8 @@ extern freq_gen_interface_internal_t freq_gen_sysfs_interface_internal;
 
 extern freq_gen_interface_internal_t freq_gen_msr_interface_internal;
 
+extern freq_gen_interface_internal_t freq_gen_sim_interface_internal;
+
 #ifdef USELIKWID
 extern freq_gen_interface_internal_t freq_gen_likwid_interface_internal;
 #endif
@@ -0,0 +1,21 @@
+/*
+ * freq_gen_internal_broker.h
+ *
+ * Fallback of the msr and sysfs backends to the freqgen-broker daemon, see freqgen_broker.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_BROKER_H_
+#define SRC_FREQ_GEN_INTERNAL_BROKER_H_
+
+#include <stdbool.h>
+
+#include "../include/freqgen_broker.h"
+
+/*
+ * whether a broker socket exists and can be connected to, the result of the first call is cached
+ * */
+bool freq_gen_broker_available(void);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_BROKER_H_ */
@@ -0,0 +1,44 @@
+/*
+ * freq_gen_internal_cpuset.h
+ *
+ * Internal helpers for the cpuset scope, see freqgen_cpuset.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_CPUSET_H_
+#define SRC_FREQ_GEN_INTERNAL_CPUSET_H_
+
+#include <stdbool.h>
+
+#include "../include/freqgen_util.h"
+
+/*
+ * parses a cpulist like "0-3,8,10-11\n" into a bitmask
+ * mask is allocated with malloc and has at least nr_bits bits
+ * returns 0 or an error defined in errno.h
+ * */
+int freq_gen_cpulist_parse(const char* string, unsigned long** mask, int* nr_bits);
+
+/* whether the cpuset scope is enabled */
+bool freq_gen_cpuset_enabled(void);
+
+/*
+ * returns the next allowed cpu after cpu (pass -1 to get the first one), -1 if there is none or
+ * -ERRNO if the allowed CPUs could not be read
+ * */
+int freq_gen_cpuset_next_cpu(int cpu);
+
+/* whether a cpu is allowed, always true if the scope is disabled */
+bool freq_gen_cpuset_cpu_allowed(int cpu);
+
+/* whether a package is allowed, always true if the scope is disabled */
+bool freq_gen_cpuset_package_allowed(int package);
+
+/*
+ * whether an uncore (/sys/devices/system/node/node(uncore)) is allowed, i.e., whether its first cpu
+ * belongs to an allowed package. Always true if the scope is disabled
+ * */
+bool freq_gen_cpuset_uncore_allowed(int uncore);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_CPUSET_H_ */
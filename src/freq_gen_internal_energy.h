@@ -0,0 +1,57 @@
+/*
+ * freq_gen_internal_energy.h
+ *
+ * Cumulative energy of the RAPL zones in /sys/class/powercap, as used by power.c, autotune.c and
+ * bandit.c
+ *
+ * Zones are matched by their name ("package-N", "package-N-die-M", "dram") rather than by their
+ * directory, as the index of intel-rapl:(index) is not the package id on systems with
+ * non-contiguous package ids or several dies per package. A DRAM zone belongs to the package of
+ * its parent zone.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_ENERGY_H_
+#define SRC_FREQ_GEN_INTERNAL_ENERGY_H_
+
+#include <stdbool.h>
+
+typedef struct
+{
+    int fd;            /**< energy_uj */
+    int package;       /**< N of package-N of the zone or its parent */
+    bool dram;         /**< DRAM domain, otherwise package */
+    double max_energy; /**< in J, the counter wraps at this value */
+    double last;       /**< last raw value in J, -1 before the first read */
+} freq_gen_energy_zone_t;
+
+typedef struct
+{
+    freq_gen_energy_zone_t* zones;
+    int nr_zones;
+    double package_energy; /**< cumulative, including wrap-arounds */
+    double dram_energy;
+} freq_gen_energy_t;
+
+/*
+ * open the energy counters of the package zones and optionally the DRAM zones
+ * @param package the package whose zones are opened or -1 for all packages
+ * @param dram whether DRAM zones are opened, too
+ * @return 0 or errno, if no package zone could be opened, the energy has to be closed with
+ * freq_gen_energy_close() in both cases
+ */
+int freq_gen_energy_open(freq_gen_energy_t* energy, int package, bool dram);
+
+/*
+ * read the energy that has been consumed since freq_gen_energy_open(), the values are
+ * cumulative and handle the wrap-around of the counters if they are read at least once per
+ * wrap-around period
+ * @param dram is set to the energy of the DRAM zones, can be NULL
+ * @return 0 or EIO
+ */
+int freq_gen_energy_read(freq_gen_energy_t* energy, double* package, double* dram);
+
+void freq_gen_energy_close(freq_gen_energy_t* energy);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_ENERGY_H_ */
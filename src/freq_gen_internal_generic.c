@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include "../include/error.h"
+#include "../include/freqgen_topology.h"
 #include "freq_gen_internal.h"
 
 static int read_file_long(char* file, long int* result)
@@ -138,7 +139,7 @@ static int read_file_long_list(char* file, long int** result, int* length)
             }
 
             for (long int i = read_cpu; i <= end_cpu; i++)
-                tmp[*length + (i - read_cpu)] = read_cpu;
+                tmp[*length + (i - read_cpu)] = i;
 
             *result = tmp;
             (*length) += end_cpu - read_cpu + 1;
@@ -207,11 +208,14 @@ static int get_package(char* sysfs_path, int node)
 int freq_gen_get_num_uncore()
 {
     static int nr_uncores = 0;
+    /* the topology watcher increments the generation when nodes come online or go offline */
+    static unsigned long long generation;
 
-    if (nr_uncores > 0)
+    if (nr_uncores > 0 && generation == freq_gen_topology_get_generation())
     {
         return nr_uncores;
     }
+    generation = freq_gen_topology_get_generation();
     /* check whether the sysfs is mounted */
     FILE* proc_mounts = setmntent("/proc/mounts", "r");
 
@@ -297,3 +301,45 @@ int freq_gen_get_num_uncore()
     nr_uncores = max + 1;
     return nr_uncores;
 }
+
+/*
+ * will return the first CPU of an uncore, i.e., the first number in
+ * /sys/devices/system/node/node(uncore)/cpulist
+ * returns -ERRNO on failure
+ * */
+int freq_gen_get_uncore_leader_cpu(int uncore)
+{
+    char buffer[BUFFER_SIZE];
+    char* tail;
+
+    if (snprintf(buffer, BUFFER_SIZE, "/sys/devices/system/node/node%d/cpulist", uncore) ==
+        BUFFER_SIZE)
+    {
+        LIBFREQGEN_SET_ERROR("could not assemble file-path to cpulist, BUFFER_SIZE(%d) exceeded",
+                             BUFFER_SIZE);
+        return -ENOMEM;
+    }
+
+    int fd = open(buffer, O_RDONLY);
+    if (fd < 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not open file \"%s\" for reading", buffer);
+        return -EIO;
+    }
+    int ret = read(fd, buffer, BUFFER_SIZE - 1);
+    close(fd);
+    if (ret <= 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not read %d bytes from file \"%s\"", BUFFER_SIZE, buffer);
+        return -EIO;
+    }
+    buffer[ret] = '\0';
+
+    long cpu = strtol(buffer, &tail, 10);
+    if (tail == buffer)
+    {
+        LIBFREQGEN_SET_ERROR("could not parse given data to long, content \"%20s\"", buffer);
+        return -EIO;
+    }
+    return cpu;
+}
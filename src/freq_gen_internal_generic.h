@@ -14,4 +14,11 @@
  * */
 int freq_gen_get_num_uncore(void);
 
+/*
+ * will return the first CPU of an uncore, i.e., the first number in
+ * /sys/devices/system/node/node(uncore)/cpulist
+ * returns -ERRNO on failure
+ * */
+int freq_gen_get_uncore_leader_cpu(int uncore);
+
 #endif /* SRC_FREQ_GEN_INTERNAL_GENERIC_H_ */
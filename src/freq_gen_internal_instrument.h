@@ -0,0 +1,41 @@
+/*
+ * freq_gen_internal_instrument.h
+ *
+ * Wraps the interfaces returned by freq_gen_init() when tracing (or another instrumentation) is
+ * enabled. Otherwise the backend interfaces are returned unchanged and cost nothing.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_INSTRUMENT_H_
+#define SRC_FREQ_GEN_INTERNAL_INSTRUMENT_H_
+
+#include <stdint.h>
+
+#include "../include/freqgen.h"
+
+/*
+ * returns the instrumented interface of backend if any instrumentation is enabled, otherwise
+ * backend. The instrumented interface is created when a backend is wrapped for the first time and
+ * returned again for the same backend. Returns NULL if too many backends have been wrapped
+ */
+freq_gen_interface_t* freq_gen_instrument_interface(freq_gen_dev_type type,
+                                                    freq_gen_interface_t* backend);
+
+/*
+ * returns the backend of an instrumented interface and replaces *setting (if not NULL) by the
+ * setting of the backend. Other interfaces are returned unchanged
+ */
+freq_gen_interface_t* freq_gen_instrument_unwrap(freq_gen_interface_t* interface,
+                                                 freq_gen_setting_t* setting);
+
+/*
+ * write the whole register of an msr device with freq_gen_msr_write_raw() and, if interface is
+ * instrumented, record the write like a set_frequency call with the frequencies max and min (-1 if
+ * unknown) encoded in the register
+ * returns 0, ENOENT if the backend is not the msr backend, or an error defined in errno.h
+ * */
+int freq_gen_instrument_write_raw(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                                  uint64_t value, long long int max, long long int min);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_INSTRUMENT_H_ */
@@ -0,0 +1,42 @@
+/*
+ * freq_gen_internal_msr.h
+ *
+ * Details of the msr backend for other parts of the library: raw register access, used by
+ * snapshots to restore the whole register instead of the frequency encoded in it, and the cost of
+ * reading the current frequency
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_MSR_H_
+#define SRC_FREQ_GEN_INTERNAL_MSR_H_
+
+#include <stdint.h>
+
+#include "../include/freqgen.h"
+
+/*
+ * read the register that set_frequency writes, IA32_PERF_CTL for cores and UNCORE_RATIO_LIMIT
+ * for uncores
+ * returns 0, ENOENT if interface is not one of the msr backend, or an error defined in errno.h
+ * */
+int freq_gen_msr_read_raw(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                          uint64_t* value);
+
+/*
+ * write the whole register that set_frequency writes
+ * returns 0, ENOENT if interface is not one of the msr backend, or an error defined in errno.h
+ * */
+int freq_gen_msr_write_raw(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                           uint64_t value);
+
+/*
+ * how long get_current_frequency blocks for a device of interface (instrumented or not): 0 if it
+ * reads a register, or the measurement window in ns if uncore clockticks are counted with perf
+ * because MSR_UNCORE_PERF_STATUS is not supported
+ * returns -ENOENT if interface is not one of the msr backend
+ * */
+long long int freq_gen_msr_current_frequency_window(freq_gen_interface_t* interface,
+                                                    freq_gen_single_device_t fp);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_MSR_H_ */
@@ -0,0 +1,66 @@
+/*
+ * freq_gen_internal_perf.h
+ *
+ * Helpers for opening perf_event counters that are described in
+ * /sys/bus/event_source/devices/(pmu)
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_PERF_H_
+#define SRC_FREQ_GEN_INTERNAL_PERF_H_
+
+#include <stdint.h>
+
+#include "../include/freqgen_util.h"
+
+/*
+ * open a counter for an event that is listed in
+ * /sys/bus/event_source/devices/(pmu)/events/(event)
+ * @param cpu the cpu to count on (-1 for any)
+ * @param pid the process to count for (-1 for all, which requires a cpu)
+ * @return a file descriptor or -ERRNO
+ */
+int freq_gen_perf_open_named(const char* pmu, const char* event, int cpu, int pid);
+
+/*
+ * open a counter with a raw config on the given pmu
+ * @return a file descriptor or -ERRNO
+ */
+int freq_gen_perf_open_raw(const char* pmu, uint64_t config, int cpu, int pid);
+
+/*
+ * open a generic hardware counter (PERF_TYPE_HARDWARE), e.g., PERF_COUNT_HW_INSTRUCTIONS
+ * @return a file descriptor or -ERRNO
+ */
+int freq_gen_perf_open_hardware(uint64_t config, int cpu, int pid);
+
+/*
+ * open an uncore clocktick counter on the package of the given cpu. Will try the uncore PMUs of
+ * client and server processors
+ * @return a file descriptor or -ERRNO
+ */
+int freq_gen_perf_open_uncore_clockticks(int cpu);
+
+/*
+ * open the read and write counters of all memory controller PMUs (uncore_imc*) on the package of
+ * the given cpu. Every count corresponds to a 64 byte transfer.
+ * @param fds is allocated with malloc and holds the opened counters
+ * @return the number of counters or -ERRNO
+ */
+int freq_gen_perf_open_memory_traffic(int cpu, int** fds);
+
+/*
+ * read the current value of a counter
+ * @return 0 or -ERRNO
+ */
+int freq_gen_perf_read(int fd, uint64_t* value);
+
+/*
+ * measure the rate of a clocktick counter over a window
+ * @param window_ns the time to wait between both reads
+ * @return frequency in Hz or -ERRNO
+ */
+long long int freq_gen_perf_measure_rate(int fd, uint64_t window_ns);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_PERF_H_ */
@@ -0,0 +1,91 @@
+/*
+ * freq_gen_internal_ring.h
+ *
+ * A lock-free single-producer/single-consumer ring buffer for fixed-size records
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_RING_H_
+#define SRC_FREQ_GEN_INTERNAL_RING_H_
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FREQ_GEN_CACHE_LINE 64
+
+typedef struct
+{
+    /** next element to write, only modified by the producer */
+    _Alignas(FREQ_GEN_CACHE_LINE) atomic_uint_fast64_t head;
+    /** next element to read, only modified by the consumer */
+    _Alignas(FREQ_GEN_CACHE_LINE) atomic_uint_fast64_t tail;
+    _Alignas(FREQ_GEN_CACHE_LINE) uint64_t mask;
+    size_t element_size;
+    char* buffer;
+} freq_gen_ring_t;
+
+/*
+ * initialize a ring that can hold at least nr_elements elements (rounded up to a power of 2)
+ * @return 0 or -ERRNO
+ */
+static inline int freq_gen_ring_init(freq_gen_ring_t* ring, size_t nr_elements,
+                                     size_t element_size)
+{
+    uint64_t size = 1;
+    while (size < nr_elements)
+        size <<= 1;
+    ring->buffer = malloc(size * element_size);
+    if (ring->buffer == NULL)
+        return -ENOMEM;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->mask = size - 1;
+    ring->element_size = element_size;
+    return 0;
+}
+
+static inline void freq_gen_ring_destroy(freq_gen_ring_t* ring)
+{
+    free(ring->buffer);
+    ring->buffer = NULL;
+}
+
+/*
+ * append an element, must only be called by the producer
+ * @return 0 or -ENOBUFS if the ring is full
+ */
+static inline int freq_gen_ring_push(freq_gen_ring_t* ring, const void* element)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask)
+        return -ENOBUFS;
+    memcpy(&ring->buffer[(head & ring->mask) * ring->element_size], element, ring->element_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/*
+ * remove up to max elements, must only be called by the consumer
+ * @return the number of elements copied to out
+ */
+static inline size_t freq_gen_ring_pop(freq_gen_ring_t* ring, void* out, size_t max)
+{
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t nr = head - tail;
+    if (nr > max)
+        nr = max;
+    for (size_t i = 0; i < nr; i++)
+        memcpy((char*)out + i * ring->element_size,
+               &ring->buffer[((tail + i) & ring->mask) * ring->element_size], ring->element_size);
+    atomic_store_explicit(&ring->tail, tail + nr, memory_order_release);
+    return nr;
+}
+
+#endif /* SRC_FREQ_GEN_INTERNAL_RING_H_ */
@@ -0,0 +1,91 @@
+/*
+ * freq_gen_internal_settings.h
+ *
+ * Prepared settings for all devices of a session, as used by models (model.c) and bandits
+ * (bandit.c). Every distinct frequency is prepared once, and the frequencies that the devices had
+ * at bind are kept as a per-device baseline.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_SETTINGS_H_
+#define SRC_FREQ_GEN_INTERNAL_SETTINGS_H_
+
+#include "../include/freqgen.h"
+#include "../include/freqgen_session.h"
+
+/* setting index of the frequencies found at bind, which can differ per device */
+#define FREQ_GEN_SETTING_BASELINE (-2)
+
+typedef struct
+{
+    freq_gen_session_t* session;
+    freq_gen_interface_t* interface;
+    freq_gen_single_device_t* handles;
+    int nr_handles;
+    freq_gen_setting_t* settings; /**< one per distinct frequency */
+    long long int* frequencies;
+    int nr_settings;
+    int* baseline; /**< index of the setting of each device found at bind */
+    int current;   /**< index of the applied setting, FREQ_GEN_SETTING_BASELINE or -1 */
+} freq_gen_settings_t;
+
+/*
+ * bind to the devices of a session and prepare their current frequencies as the baseline
+ * @param session the session or NULL to not change devices of this type
+ * @return 0 or errno, the settings have to be freed with freq_gen_settings_free() in both cases
+ */
+int freq_gen_settings_bind(freq_gen_settings_t* settings, freq_gen_session_t* session);
+
+/*
+ * get the index of the setting for a frequency, prepares it if necessary
+ * @param frequency the frequency in Hz or FREQ_GEN_MODEL_KEEP
+ * @return the index, -1 for FREQ_GEN_MODEL_KEEP, or -ERRNO
+ */
+int freq_gen_settings_add(freq_gen_settings_t* settings, long long int frequency);
+
+/*
+ * unprepare all settings and invalidate the session
+ */
+void freq_gen_settings_free(freq_gen_settings_t* settings);
+
+/*
+ * write a setting or the baseline of each device to all devices
+ * @param index the index of a setting, FREQ_GEN_SETTING_BASELINE, or -1 to keep the frequencies
+ * @return 0 or the first error of the interface
+ */
+static inline int freq_gen_settings_apply(freq_gen_settings_t* settings, int index)
+{
+    if (index == -1 || index == settings->current)
+        return 0;
+    int result = 0;
+    for (int i = 0; i < settings->nr_handles; i++)
+    {
+        freq_gen_setting_t setting =
+            settings->settings[index == FREQ_GEN_SETTING_BASELINE ? settings->baseline[i] : index];
+        int ret = settings->interface->set_frequency(settings->handles[i], setting);
+        if (ret && result == 0)
+            result = ret;
+    }
+    settings->current = index;
+    return result;
+}
+
+/*
+ * apply a setting to the devices of each type
+ * @return 0 or the first error
+ */
+static inline int freq_gen_settings_apply_all(freq_gen_settings_t settings[FREQ_GEN_DEVICE_NUM],
+                                              const int indices[FREQ_GEN_DEVICE_NUM])
+{
+    int result = 0;
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+    {
+        int ret = freq_gen_settings_apply(&settings[t], indices[t]);
+        if (ret && result == 0)
+            result = ret;
+    }
+    return result;
+}
+
+#endif /* SRC_FREQ_GEN_INTERNAL_SETTINGS_H_ */
@@ -0,0 +1,42 @@
+/*
+ * freq_gen_internal_signal.h
+ *
+ * Raw writes of backends for the async-signal-safe set path, see freqgen_signal.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_SIGNAL_H_
+#define SRC_FREQ_GEN_INTERNAL_SIGNAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "../include/freqgen.h"
+
+#define FREQ_GEN_RAW_WRITE_MAX 32
+
+/* what a backend writes for set_frequency or set_min_frequency */
+struct freq_gen_raw_write
+{
+    int fd;
+    uint32_t length; /**< number of bytes in data */
+    off_t offset;
+    uint64_t mask; /**< if not 0, 8 bytes at offset are read and only the bits of mask replaced */
+    char data[FREQ_GEN_RAW_WRITE_MAX];
+};
+
+/*
+ * describe the write of set_frequency (min = false) or set_min_frequency (min = true)
+ * returns 0, ENOENT if interface is not one of the backend, or ENOTSUP
+ * */
+int freq_gen_msr_describe_set(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                              freq_gen_setting_t setting, bool min,
+                              struct freq_gen_raw_write* write);
+
+int freq_gen_sysfs_describe_set(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                                freq_gen_setting_t setting, bool min,
+                                struct freq_gen_raw_write* write);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_SIGNAL_H_ */
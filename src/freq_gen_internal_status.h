@@ -0,0 +1,92 @@
+/*
+ * freq_gen_internal_status.h
+ *
+ * Layout of the status page (see freqgen_status.h) that is shared by the writer in libfreqgen and
+ * the reader library. The header is followed by the entries of all cores and then all uncores.
+ *
+ * Writers serialize through lock (pid of the writer or 0) and make sequence odd while they change
+ * entries. Readers retry until they see the same even sequence before and after copying.
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_STATUS_H_
+#define SRC_FREQ_GEN_INTERNAL_STATUS_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/freqgen_status.h"
+
+#define STATUS_MAGIC "FGSTATUS"
+#define STATUS_VERSION 1
+#define STATUS_PATH_FORMAT "/dev/shm/freqgen.%s"
+
+struct status_header
+{
+    _Atomic uint64_t magic; /**< STATUS_MAGIC, written last when the page is created */
+    uint32_t version;
+    uint32_t nr_devices[FREQ_GEN_DEVICE_NUM];
+    uint32_t reserved;
+    _Atomic uint32_t lock;
+    _Atomic uint32_t sequence;
+};
+
+static inline uint64_t status_magic(void)
+{
+    uint64_t magic;
+    memcpy(&magic, STATUS_MAGIC, sizeof(magic));
+    return magic;
+}
+
+static inline size_t status_size(uint32_t nr_cores, uint32_t nr_uncores)
+{
+    return sizeof(struct status_header) +
+           (size_t)(nr_cores + nr_uncores) * sizeof(freq_gen_status_entry_t);
+}
+
+static inline freq_gen_status_entry_t* status_entries(struct status_header* header,
+                                                      freq_gen_dev_type type)
+{
+    freq_gen_status_entry_t* entries = (freq_gen_status_entry_t*)(header + 1);
+    return type == FREQ_GEN_DEVICE_CORE_FREQ
+               ? entries
+               : entries + header->nr_devices[FREQ_GEN_DEVICE_CORE_FREQ];
+}
+
+/* writes the path of the status page of node (NULL for this node) to path */
+static inline int status_path(char* path, size_t size, const char* node)
+{
+    char hostname[256];
+    if (node == NULL)
+    {
+        if (gethostname(hostname, sizeof(hostname)) != 0)
+            return -1;
+        hostname[sizeof(hostname) - 1] = '\0';
+        node = hostname;
+    }
+    int length = snprintf(path, size, STATUS_PATH_FORMAT, node);
+    return length < 0 || (size_t)length >= size ? -1 : 0;
+}
+
+/* whether changes are published to the status page */
+extern atomic_bool freq_gen_status_active;
+
+/*
+ * enables the status page if LIBFREQGEN_STATUS is set and it is not already enabled
+ * @return whether the status page is enabled
+ */
+bool freq_gen_status_check_env(void);
+
+/*
+ * store the last applied setting of a device, negative frequencies are left unchanged
+ */
+void freq_gen_status_publish(freq_gen_dev_type type, int device, long long int frequency,
+                             long long int min_frequency);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_STATUS_H_ */
@@ -0,0 +1,106 @@
+/*
+ * freq_gen_internal_trace.h
+ *
+ * Layout of trace files and the functions used by instrumented interfaces to record events
+ *
+ * A trace file starts with TRACE_MAGIC, followed by chunks. Each chunk starts with a struct
+ * trace_chunk that gives its kind and the size of the following payload:
+ * - TRACE_CHUNK_HEADER: struct trace_header followed by nr_fields struct trace_field, which
+ *   describe the layout of a single event
+ * - TRACE_CHUNK_BACKEND: struct trace_backend, the name of a backend index
+ * - TRACE_CHUNK_EVENTS: events as described by the header
+ * - TRACE_CHUNK_STATS: struct trace_stats
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_TRACE_H_
+#define SRC_FREQ_GEN_INTERNAL_TRACE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../include/freqgen_trace.h"
+
+#define TRACE_MAGIC "FGTRACE"
+#define TRACE_VERSION 1
+/* maximal number of backends that can be stored */
+#define TRACE_MAX_BACKENDS 256
+
+enum trace_chunk_kind
+{
+    TRACE_CHUNK_HEADER = 1,
+    TRACE_CHUNK_BACKEND = 2,
+    TRACE_CHUNK_EVENTS = 3,
+    TRACE_CHUNK_STATS = 4
+};
+
+/* kind of a field */
+enum trace_field_kind
+{
+    TRACE_FIELD_UNSIGNED = 1,
+    TRACE_FIELD_SIGNED = 2
+};
+
+struct trace_chunk
+{
+    uint32_t kind;
+    uint32_t size;
+};
+
+struct trace_header
+{
+    uint32_t version;
+    uint32_t event_size;
+    double tsc_hz;
+    uint32_t nr_fields;
+    uint32_t reserved;
+};
+
+struct trace_field
+{
+    char name[16];
+    uint16_t offset;
+    uint8_t size;
+    uint8_t kind;
+    uint32_t reserved;
+};
+
+struct trace_backend
+{
+    uint8_t id;
+    uint8_t type;
+    char name[30];
+};
+
+struct trace_stats
+{
+    uint64_t dropped;
+};
+
+/* whether events are currently recorded */
+extern atomic_bool freq_gen_trace_active;
+
+/* whether all calls are recorded, not only set_frequency and set_min_frequency */
+extern atomic_bool freq_gen_trace_record_all;
+
+/*
+ * enables tracing if LIBFREQGEN_TRACE or LIBFREQGEN_RECORD is set and tracing is not already
+ * enabled
+ * @return whether tracing is enabled
+ */
+bool freq_gen_trace_check_env(void);
+
+/*
+ * assign an index to a backend, which is stored in the trace
+ * @return the index or -ERRNO
+ */
+int freq_gen_trace_register_backend(freq_gen_dev_type type, const char* name);
+
+/*
+ * store an event in the buffer of the calling thread
+ */
+void freq_gen_trace_record(const freq_gen_trace_event_t* event);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_TRACE_H_ */
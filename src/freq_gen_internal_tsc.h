@@ -0,0 +1,38 @@
+/*
+ * freq_gen_internal_tsc.h
+ *
+ * Reading and calibrating the time stamp counter
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_TSC_H_
+#define SRC_FREQ_GEN_INTERNAL_TSC_H_
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t freq_gen_tsc_read(void)
+{
+    return __builtin_ia32_rdtsc();
+}
+
+/*
+ * measure the TSC frequency against CLOCK_MONOTONIC over window_ns
+ * @return TSC frequency in Hz
+ */
+static inline double freq_gen_tsc_calibrate(uint64_t window_ns)
+{
+    struct timespec start, end;
+    struct timespec window = { .tv_sec = window_ns / 1000000000ULL,
+                               .tv_nsec = window_ns % 1000000000ULL };
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t tsc_start = freq_gen_tsc_read();
+    nanosleep(&window, NULL);
+    uint64_t tsc_end = freq_gen_tsc_read();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return (double)(tsc_end - tsc_start) * 1e9 / elapsed;
+}
+
+#endif /* SRC_FREQ_GEN_INTERNAL_TSC_H_ */
@@ -0,0 +1,25 @@
+/*
+ * freq_gen_internal_util.h
+ *
+ * Small helpers of the library, the ones that tools use are exported in freqgen_util.h
+ *
+ *  Created on: 19.10.2026
+ */
+
+#ifndef SRC_FREQ_GEN_INTERNAL_UTIL_H_
+#define SRC_FREQ_GEN_INTERNAL_UTIL_H_
+
+#include <stddef.h>
+
+#include "../include/freqgen_util.h"
+
+#define FREQ_GEN_BITS_PER_LONG (8 * (int)sizeof(unsigned long))
+
+/*
+ * reads a small file, e.g., from sysfs, into a null-terminated buffer and strips a trailing
+ * newline
+ * returns 0, ENOMEM if the file does not fit into the buffer, or an error defined in errno.h
+ * */
+int freq_gen_read_small_file(const char* path, char* buffer, size_t size);
+
+#endif /* SRC_FREQ_GEN_INTERNAL_UTIL_H_ */
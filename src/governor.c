@@ -0,0 +1,585 @@
+/*
+ * governor.c
+ *
+ * Implements the counter driven core frequency governor, see freqgen_governor.h
+ *
+ * For every core, the target frequency is max_frequency unless the core is idle or memory-bound.
+ * Then it is lowered by energy_bias * intensity * (max_frequency - min_frequency), where intensity
+ * is 1 for idle cores and grows from 0 at the memory-bound threshold to 1 for memory-bound cores.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_governor.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_perf.h"
+
+#define GOVERNOR_DEFAULT_STEP 100000000LL
+#define GOVERNOR_DEFAULT_STALL_RATIO 0.5
+#define GOVERNOR_DEFAULT_IPC 1.0
+#define GOVERNOR_DEFAULT_IDLE_RATIO 0.05
+#define GOVERNOR_FILE_MAGIC "FGCOUNTR"
+#define GOVERNOR_FILE_VERSION 1
+
+enum governor_counter
+{
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CYCLES,
+    COUNTER_STALLS,
+    COUNTER_APERF,
+    COUNTER_MPERF,
+    COUNTER_TSC,
+    NR_COUNTERS
+};
+
+struct governed_core
+{
+    int cpu;
+    freq_gen_single_device_t fp; /**< from init_device */
+    int fds[NR_COUNTERS];        /**< perf counters, -1 if not available */
+    uint64_t last[NR_COUNTERS];  /**< counter values at the end of the last interval */
+    bool has_last;
+    uint64_t last_change; /**< timestamp of the sample that caused the last change */
+    freq_gen_governor_state_t state;
+};
+
+struct freq_gen_governor_s
+{
+    freq_gen_governor_config_t config;
+    char* record_path;
+    struct governed_core* cores;
+    int nr_cores;
+    int* core_of_cpu; /**< index in cores for each cpu or -1 */
+    int nr_cpus;
+    freq_gen_setting_t* settings; /**< prepared settings, one per step between min and max */
+    int nr_settings;
+
+    pthread_t thread;
+    bool running;
+    atomic_bool stop;
+    FILE* record;
+
+    /* protects the state of the cores, the settings and the statistics */
+    pthread_mutex_t lock;
+    freq_gen_governor_stats_t stats;
+};
+
+/* header of a counter file, all fields in host byte order */
+struct counter_file_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t interval_ns;
+};
+
+static void close_counters(struct governed_core* core)
+{
+    for (int i = 0; i < NR_COUNTERS; i++)
+    {
+        if (core->fds[i] >= 0)
+            close(core->fds[i]);
+        core->fds[i] = -1;
+    }
+    core->has_last = false;
+}
+
+/* instructions and cycles are required, stalls and APERF/MPERF/TSC are optional */
+static int open_counters(struct governed_core* core)
+{
+    core->fds[COUNTER_INSTRUCTIONS] =
+        freq_gen_perf_open_hardware(PERF_COUNT_HW_INSTRUCTIONS, core->cpu, -1);
+    core->fds[COUNTER_CYCLES] =
+        freq_gen_perf_open_hardware(PERF_COUNT_HW_CPU_CYCLES, core->cpu, -1);
+    if (core->fds[COUNTER_INSTRUCTIONS] < 0 || core->fds[COUNTER_CYCLES] < 0)
+    {
+        int ret = core->fds[COUNTER_INSTRUCTIONS] < 0 ? core->fds[COUNTER_INSTRUCTIONS]
+                                                      : core->fds[COUNTER_CYCLES];
+        close_counters(core);
+        LIBFREQGEN_APPEND_ERROR("could not open instructions and cycles for cpu %d", core->cpu);
+        return ret;
+    }
+    core->fds[COUNTER_STALLS] =
+        freq_gen_perf_open_hardware(PERF_COUNT_HW_STALLED_CYCLES_BACKEND, core->cpu, -1);
+    core->fds[COUNTER_APERF] = freq_gen_perf_open_named("msr", "aperf", core->cpu, -1);
+    core->fds[COUNTER_MPERF] = freq_gen_perf_open_named("msr", "mperf", core->cpu, -1);
+    core->fds[COUNTER_TSC] = freq_gen_perf_open_named("msr", "tsc", core->cpu, -1);
+    if (core->fds[COUNTER_APERF] < 0 || core->fds[COUNTER_MPERF] < 0 ||
+        core->fds[COUNTER_TSC] < 0)
+    {
+        for (int i = COUNTER_APERF; i <= COUNTER_TSC; i++)
+        {
+            if (core->fds[i] >= 0)
+                close(core->fds[i]);
+            core->fds[i] = -1;
+        }
+    }
+    core->has_last = false;
+    return 0;
+}
+
+/* reads all counters of a core and stores the deltas in sample
+ * returns 1 if the sample is valid, 0 if this was the first read and -EIO on errors */
+static int read_counters(struct governed_core* core, uint64_t now,
+                         freq_gen_governor_sample_t* sample)
+{
+    uint64_t values[NR_COUNTERS] = { 0 };
+    for (int i = 0; i < NR_COUNTERS; i++)
+        if (core->fds[i] >= 0 && freq_gen_perf_read(core->fds[i], &values[i]))
+            return -EIO;
+
+    *sample = (freq_gen_governor_sample_t){
+        .timestamp = now,
+        .cpu = core->cpu,
+        .flags = (core->fds[COUNTER_STALLS] >= 0 ? FREQ_GEN_GOVERNOR_HAS_STALLS : 0) |
+                 (core->fds[COUNTER_APERF] >= 0 ? FREQ_GEN_GOVERNOR_HAS_APERF : 0),
+        .instructions = values[COUNTER_INSTRUCTIONS] - core->last[COUNTER_INSTRUCTIONS],
+        .cycles = values[COUNTER_CYCLES] - core->last[COUNTER_CYCLES],
+        .stall_cycles = values[COUNTER_STALLS] - core->last[COUNTER_STALLS],
+        .aperf = values[COUNTER_APERF] - core->last[COUNTER_APERF],
+        .mperf = values[COUNTER_MPERF] - core->last[COUNTER_MPERF],
+        .tsc = values[COUNTER_TSC] - core->last[COUNTER_TSC]
+    };
+    bool valid = core->has_last;
+    memcpy(core->last, values, sizeof(values));
+    core->has_last = true;
+    return valid;
+}
+
+static void close_cores(freq_gen_governor_t* governor)
+{
+    for (int i = 0; i < governor->nr_cores; i++)
+    {
+        close_counters(&governor->cores[i]);
+        governor->config.interface->close_device(governor->cores[i].cpu, governor->cores[i].fp);
+    }
+    governor->nr_cores = 0;
+}
+
+static int open_cores(freq_gen_governor_t* governor, const int* cpus, int nr_cpus)
+{
+    freq_gen_interface_t* interface = governor->config.interface;
+    if (cpus == NULL)
+    {
+        nr_cpus = interface->get_num_devices();
+        if (nr_cpus < 0)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not get the number of devices for %s", interface->name);
+            return nr_cpus;
+        }
+    }
+    governor->cores = calloc(nr_cpus, sizeof(struct governed_core));
+    if (governor->cores == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d cores", nr_cpus);
+        return -ENOMEM;
+    }
+    governor->nr_cpus = 0;
+    for (int i = 0; i < nr_cpus; i++)
+    {
+        int cpu = cpus ? cpus[i] : i;
+        if (cpu < 0)
+        {
+            LIBFREQGEN_SET_ERROR("invalid cpu %d", cpu);
+            return -EINVAL;
+        }
+        if (cpu >= governor->nr_cpus)
+            governor->nr_cpus = cpu + 1;
+    }
+    governor->core_of_cpu = malloc(governor->nr_cpus * sizeof(int));
+    if (governor->core_of_cpu == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d cpus", governor->nr_cpus);
+        return -ENOMEM;
+    }
+    for (int cpu = 0; cpu < governor->nr_cpus; cpu++)
+        governor->core_of_cpu[cpu] = -1;
+
+    for (int i = 0; i < nr_cpus; i++)
+    {
+        struct governed_core* core = &governor->cores[i];
+        core->cpu = cpus ? cpus[i] : i;
+        for (int counter = 0; counter < NR_COUNTERS; counter++)
+            core->fds[counter] = -1;
+        core->state = (freq_gen_governor_state_t){ .workload = FREQ_GEN_GOVERNOR_UNKNOWN,
+                                                   .stall_ratio = -1,
+                                                   .busy_ratio = -1,
+                                                   .frequency = -1 };
+        core->fp = interface->init_device(core->cpu);
+        if (core->fp < 0)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not open device %d of %s", core->cpu, interface->name);
+            return core->fp;
+        }
+        governor->core_of_cpu[core->cpu] = i;
+        governor->nr_cores++;
+    }
+    return 0;
+}
+
+freq_gen_governor_t* freq_gen_governor_create(const freq_gen_governor_config_t* config)
+{
+    if (config == NULL || config->interface == NULL || config->min_frequency <= 0 ||
+        config->max_frequency < config->min_frequency || config->interval_ns == 0 ||
+        config->energy_bias < 0 || config->energy_bias > 1)
+    {
+        LIBFREQGEN_SET_ERROR("invalid governor configuration");
+        return NULL;
+    }
+    freq_gen_governor_t* governor = calloc(1, sizeof(freq_gen_governor_t));
+    if (governor == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for governor",
+                             sizeof(freq_gen_governor_t));
+        return NULL;
+    }
+    governor->config = *config;
+    governor->config.cpus = NULL;
+    governor->config.record_path = NULL;
+    if (governor->config.step <= 0)
+        governor->config.step = GOVERNOR_DEFAULT_STEP;
+    if (governor->config.memory_stall_ratio <= 0)
+        governor->config.memory_stall_ratio = GOVERNOR_DEFAULT_STALL_RATIO;
+    if (governor->config.memory_ipc <= 0)
+        governor->config.memory_ipc = GOVERNOR_DEFAULT_IPC;
+    if (governor->config.idle_ratio <= 0)
+        governor->config.idle_ratio = GOVERNOR_DEFAULT_IDLE_RATIO;
+    pthread_mutex_init(&governor->lock, NULL);
+    atomic_init(&governor->stop, false);
+
+    governor->nr_settings =
+        (config->max_frequency - config->min_frequency) / governor->config.step + 1;
+    governor->settings = calloc(governor->nr_settings, sizeof(freq_gen_setting_t));
+    if (governor->settings == NULL ||
+        (config->record_path != NULL &&
+         (governor->record_path = strdup(config->record_path)) == NULL))
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for governor");
+        freq_gen_governor_destroy(governor);
+        return NULL;
+    }
+    if (open_cores(governor, config->cpus, config->nr_cpus))
+    {
+        LIBFREQGEN_APPEND_ERROR("could not create governor");
+        freq_gen_governor_destroy(governor);
+        return NULL;
+    }
+    return governor;
+}
+
+/* returns the prepared setting for a frequency on the grid, prepares it if necessary */
+static freq_gen_setting_t get_setting(freq_gen_governor_t* governor, long long int frequency)
+{
+    int index = (frequency - governor->config.min_frequency) / governor->config.step;
+    if (governor->settings[index] == NULL)
+        governor->settings[index] = governor->config.interface->prepare_set_frequency(frequency, 0);
+    return governor->settings[index];
+}
+
+static double clamp(double value)
+{
+    return value < 0 ? 0 : (value > 1 ? 1 : value);
+}
+
+/* classifies the core and returns its target frequency on the grid */
+static long long int decide(freq_gen_governor_t* governor, struct governed_core* core,
+                            const freq_gen_governor_sample_t* sample)
+{
+    const freq_gen_governor_config_t* config = &governor->config;
+    freq_gen_governor_state_t* state = &core->state;
+    state->ipc = sample->cycles ? (double)sample->instructions / sample->cycles : 0;
+    state->stall_ratio = (sample->flags & FREQ_GEN_GOVERNOR_HAS_STALLS) && sample->cycles
+                             ? (double)sample->stall_cycles / sample->cycles
+                             : -1;
+    state->busy_ratio = (sample->flags & FREQ_GEN_GOVERNOR_HAS_APERF) && sample->tsc
+                            ? (double)sample->mperf / sample->tsc
+                            : -1;
+
+    double intensity;
+    if (sample->cycles == 0 || (state->busy_ratio >= 0 && state->busy_ratio < config->idle_ratio))
+    {
+        state->workload = FREQ_GEN_GOVERNOR_IDLE;
+        intensity = 1;
+    }
+    else if (state->stall_ratio >= 0)
+    {
+        state->workload = state->stall_ratio >= config->memory_stall_ratio
+                              ? FREQ_GEN_GOVERNOR_MEMORY
+                              : FREQ_GEN_GOVERNOR_COMPUTE;
+        intensity = config->memory_stall_ratio < 1
+                        ? clamp((state->stall_ratio - config->memory_stall_ratio) /
+                                (1 - config->memory_stall_ratio))
+                        : 0;
+    }
+    else
+    {
+        state->workload =
+            state->ipc < config->memory_ipc ? FREQ_GEN_GOVERNOR_MEMORY : FREQ_GEN_GOVERNOR_COMPUTE;
+        intensity = clamp((config->memory_ipc - state->ipc) / config->memory_ipc);
+    }
+
+    double range = config->max_frequency - config->min_frequency;
+    double target = config->max_frequency - config->energy_bias * intensity * range;
+    long long int steps = (long long int)((target - config->min_frequency) / config->step + 0.5);
+    long long int frequency = config->min_frequency + steps * config->step;
+    return frequency > config->max_frequency ? config->max_frequency : frequency;
+}
+
+/* applies the decision for a single sample, returns 1 if the frequency has been changed */
+static int update_core(freq_gen_governor_t* governor, struct governed_core* core,
+                       const freq_gen_governor_sample_t* sample)
+{
+    governor->stats.samples++;
+    long long int target = decide(governor, core, sample);
+    long long int current = core->state.frequency;
+    if (current == target)
+        return 0;
+    if (current >= 0 && llabs(target - current) < governor->config.hysteresis)
+    {
+        governor->stats.hysteresis++;
+        return 0;
+    }
+    if (current >= 0 &&
+        sample->timestamp - core->last_change < governor->config.min_change_interval_ns)
+    {
+        governor->stats.rate_limited++;
+        return 0;
+    }
+    freq_gen_setting_t setting = get_setting(governor, target);
+    if (setting == NULL || governor->config.interface->set_frequency(core->fp, setting))
+    {
+        governor->stats.errors++;
+        return 0;
+    }
+    core->state.frequency = target;
+    core->last_change = sample->timestamp;
+    governor->stats.changes++;
+    return 1;
+}
+
+int freq_gen_governor_update(freq_gen_governor_t* governor,
+                             const freq_gen_governor_sample_t* samples, int nr_samples)
+{
+    int changes = 0;
+    pthread_mutex_lock(&governor->lock);
+    for (int i = 0; i < nr_samples; i++)
+    {
+        if (samples[i].cpu >= (uint32_t)governor->nr_cpus)
+            continue;
+        int index = governor->core_of_cpu[samples[i].cpu];
+        if (index >= 0)
+            changes += update_core(governor, &governor->cores[index], &samples[i]);
+    }
+    pthread_mutex_unlock(&governor->lock);
+    return changes;
+}
+
+static void* governor_thread(void* arg)
+{
+    freq_gen_governor_t* governor = arg;
+    freq_gen_governor_sample_t samples[governor->nr_cores];
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!atomic_load_explicit(&governor->stop, memory_order_relaxed))
+    {
+        uint64_t now = freq_gen_now_ns();
+        int nr_samples = 0;
+        for (int i = 0; i < governor->nr_cores; i++)
+        {
+            int ret = read_counters(&governor->cores[i], now, &samples[nr_samples]);
+            if (ret > 0)
+                nr_samples++;
+            else if (ret < 0)
+            {
+                pthread_mutex_lock(&governor->lock);
+                governor->stats.errors++;
+                pthread_mutex_unlock(&governor->lock);
+            }
+        }
+        if (governor->record != NULL && nr_samples > 0)
+            fwrite(samples, sizeof(freq_gen_governor_sample_t), nr_samples, governor->record);
+        freq_gen_governor_update(governor, samples, nr_samples);
+
+        /* fixed rate: next period starts interval_ns after the previous one */
+        uint64_t next_ns = next.tv_nsec + governor->config.interval_ns;
+        next.tv_sec += next_ns / 1000000000ULL;
+        next.tv_nsec = next_ns % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+static int open_record(freq_gen_governor_t* governor)
+{
+    governor->record = fopen(governor->record_path, "wb");
+    if (governor->record == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for writing", governor->record_path);
+        return errno;
+    }
+    struct counter_file_header header = { .version = GOVERNOR_FILE_VERSION,
+                                          .record_size = sizeof(freq_gen_governor_sample_t),
+                                          .interval_ns = governor->config.interval_ns };
+    memcpy(header.magic, GOVERNOR_FILE_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, governor->record) != 1)
+    {
+        LIBFREQGEN_SET_ERROR("could not write header to \"%s\"", governor->record_path);
+        fclose(governor->record);
+        governor->record = NULL;
+        return EIO;
+    }
+    return 0;
+}
+
+int freq_gen_governor_start(freq_gen_governor_t* governor)
+{
+    if (governor->running)
+    {
+        LIBFREQGEN_SET_ERROR("governor is already running");
+        return EBUSY;
+    }
+    for (int i = 0; i < governor->nr_cores; i++)
+    {
+        int ret = open_counters(&governor->cores[i]);
+        if (ret)
+        {
+            for (int j = 0; j < i; j++)
+                close_counters(&governor->cores[j]);
+            return -ret;
+        }
+    }
+    if (governor->record_path != NULL)
+    {
+        int ret = open_record(governor);
+        if (ret)
+        {
+            for (int i = 0; i < governor->nr_cores; i++)
+                close_counters(&governor->cores[i]);
+            return ret;
+        }
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (governor->config.cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(governor->config.cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    atomic_store(&governor->stop, false);
+    int ret = pthread_create(&governor->thread, &attr, governor_thread, governor);
+    pthread_attr_destroy(&attr);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create governor thread (pinned to cpu %d)",
+                             governor->config.cpu);
+        return ret;
+    }
+    governor->running = true;
+    return 0;
+}
+
+int freq_gen_governor_stop(freq_gen_governor_t* governor)
+{
+    if (!governor->running)
+        return 0;
+    atomic_store(&governor->stop, true);
+    int ret = pthread_join(governor->thread, NULL);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not join governor thread");
+        return ret;
+    }
+    governor->running = false;
+    for (int i = 0; i < governor->nr_cores; i++)
+        close_counters(&governor->cores[i]);
+    if (governor->record != NULL && fclose(governor->record) != 0)
+        ret = EIO;
+    governor->record = NULL;
+    if (ret)
+        LIBFREQGEN_SET_ERROR("could not write counters to \"%s\"", governor->record_path);
+    return ret;
+}
+
+long long int freq_gen_governor_replay(freq_gen_governor_t* governor, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for reading", path);
+        return -errno;
+    }
+    struct counter_file_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, GOVERNOR_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != GOVERNOR_FILE_VERSION ||
+        header.record_size != sizeof(freq_gen_governor_sample_t))
+    {
+        fclose(file);
+        LIBFREQGEN_SET_ERROR("\"%s\" is not a governor counter file", path);
+        return -EINVAL;
+    }
+    freq_gen_governor_sample_t samples[256];
+    long long int changes = 0;
+    size_t nr;
+    while ((nr = fread(samples, sizeof(freq_gen_governor_sample_t), 256, file)) > 0)
+        changes += freq_gen_governor_update(governor, samples, nr);
+    fclose(file);
+    return changes;
+}
+
+int freq_gen_governor_get_state(freq_gen_governor_t* governor, int cpu,
+                                freq_gen_governor_state_t* state)
+{
+    if (cpu < 0 || cpu >= governor->nr_cpus || governor->core_of_cpu[cpu] < 0)
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is not governed", cpu);
+        return EINVAL;
+    }
+    pthread_mutex_lock(&governor->lock);
+    *state = governor->cores[governor->core_of_cpu[cpu]].state;
+    pthread_mutex_unlock(&governor->lock);
+    return 0;
+}
+
+void freq_gen_governor_get_stats(freq_gen_governor_t* governor, freq_gen_governor_stats_t* stats)
+{
+    pthread_mutex_lock(&governor->lock);
+    *stats = governor->stats;
+    pthread_mutex_unlock(&governor->lock);
+}
+
+void freq_gen_governor_destroy(freq_gen_governor_t* governor)
+{
+    if (governor == NULL)
+        return;
+    freq_gen_governor_stop(governor);
+    close_cores(governor);
+    for (int i = 0; i < governor->nr_settings && governor->settings != NULL; i++)
+        if (governor->settings[i] != NULL)
+            governor->config.interface->unprepare_set_frequency(governor->settings[i]);
+    pthread_mutex_destroy(&governor->lock);
+    free(governor->settings);
+    free(governor->cores);
+    free(governor->core_of_cpu);
+    free(governor->record_path);
+    free(governor);
+}
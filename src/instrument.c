@@ -0,0 +1,430 @@
+/*
+ * instrument.c
+ *
+ * Wraps backend interfaces to record calls for tracing and to publish them to the status page.
+ * Every backend of a device type gets its own instrumented interface when it is returned by
+ * freq_gen_init() for the first time. Later calls for the same backend return the same wrapper,
+ * which is never changed, so interfaces returned before stay bound to their backend and devices.
+ * Settings are wrapped, so that the requested frequency is known when a setting is applied.
+ * While recording, the remaining calls are traced as well and settings carry an id, so that
+ * freqgen-replay can reproduce the sequence of calls.
+ *
+ *  Created on: 19.10.2026
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/error.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_instrument.h"
+#include "freq_gen_internal_msr.h"
+#include "freq_gen_internal_status.h"
+#include "freq_gen_internal_trace.h"
+#include "freq_gen_internal_tsc.h"
+
+/* a setting returned by an instrumented prepare_set_frequency */
+struct instrumented_setting
+{
+    freq_gen_setting_t setting; /**< setting of the backend */
+    long long int target;       /**< requested frequency in Hz */
+    uint32_t id;                /**< id of the setting in recorded traces */
+};
+
+struct instrumented_interface
+{
+    freq_gen_interface_t interface; /**< the instrumented interface returned to the user */
+    freq_gen_interface_t* backend;  /**< the wrapped interface */
+    freq_gen_dev_type type;
+    int trace_backend; /**< index of the backend in the trace or -1 */
+    int* devices;      /**< device number for each fp that has been returned by init_device */
+    int nr_fps;
+};
+
+/* number of backends that can be instrumented per device type, see avail[] in freq_gen.c */
+#define INSTRUMENT_MAX_BACKENDS 8
+
+static struct instrumented_interface instrumented[FREQ_GEN_DEVICE_NUM][INSTRUMENT_MAX_BACKENDS];
+
+/* protects the assignment of backends to instrumented interfaces */
+static pthread_mutex_t instrumented_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* protects devices and nr_fps, which init_device grows while other threads set frequencies */
+static pthread_mutex_t devices_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_uint_least32_t next_setting_id;
+
+static inline bool recording(void)
+{
+    return __builtin_expect(
+        atomic_load_explicit(&freq_gen_trace_record_all, memory_order_relaxed), 0);
+}
+
+static void record(struct instrumented_interface* wrapper, freq_gen_trace_op op, uint64_t begin,
+                   int device, long long int value, int result, uint32_t setting)
+{
+    freq_gen_trace_event_t event = { .tsc_begin = begin,
+                                     .tsc_end = freq_gen_tsc_read(),
+                                     .value = value,
+                                     .device = device,
+                                     .result = result,
+                                     .type = wrapper->type,
+                                     .op = op,
+                                     .backend = wrapper->trace_backend,
+                                     .setting = setting };
+    freq_gen_trace_record(&event);
+}
+
+/* only called while tracing or publishing, so the lock is not taken on the plain set path */
+static int device_of(struct instrumented_interface* wrapper, freq_gen_single_device_t fp)
+{
+    int device = -1;
+    pthread_mutex_lock(&devices_lock);
+    if (fp >= 0 && fp < wrapper->nr_fps)
+        device = wrapper->devices[fp];
+    pthread_mutex_unlock(&devices_lock);
+    return device;
+}
+
+static freq_gen_single_device_t instrumented_init_device(struct instrumented_interface* wrapper,
+                                                         int nr)
+{
+    bool record_call = recording();
+    uint64_t begin = record_call ? freq_gen_tsc_read() : 0;
+    freq_gen_single_device_t fp = wrapper->backend->init_device(nr);
+    if (record_call)
+        record(wrapper, FREQ_GEN_TRACE_INIT_DEVICE, begin, nr, 0, fp, 0);
+    if (fp < 0)
+        return fp;
+    pthread_mutex_lock(&devices_lock);
+    if (fp >= wrapper->nr_fps)
+    {
+        int* tmp = realloc(wrapper->devices, (fp + 1) * sizeof(int));
+        if (tmp == NULL)
+        {
+            pthread_mutex_unlock(&devices_lock);
+            wrapper->backend->close_device(nr, fp);
+            LIBFREQGEN_SET_ERROR("could not allocate memory for device %d", nr);
+            return -ENOMEM;
+        }
+        for (int i = wrapper->nr_fps; i <= fp; i++)
+            tmp[i] = -1;
+        wrapper->devices = tmp;
+        wrapper->nr_fps = fp + 1;
+    }
+    wrapper->devices[fp] = nr;
+    pthread_mutex_unlock(&devices_lock);
+    return fp;
+}
+
+static void instrumented_close_device(struct instrumented_interface* wrapper, int nr,
+                                      freq_gen_single_device_t fp)
+{
+    pthread_mutex_lock(&devices_lock);
+    if (fp >= 0 && fp < wrapper->nr_fps)
+        wrapper->devices[fp] = -1;
+    pthread_mutex_unlock(&devices_lock);
+    if (!recording())
+    {
+        wrapper->backend->close_device(nr, fp);
+        return;
+    }
+    uint64_t begin = freq_gen_tsc_read();
+    wrapper->backend->close_device(nr, fp);
+    record(wrapper, FREQ_GEN_TRACE_CLOSE_DEVICE, begin, nr, 0, fp, 0);
+}
+
+static freq_gen_setting_t instrumented_prepare(struct instrumented_interface* wrapper,
+                                               long long int target, int turbo)
+{
+    struct instrumented_setting* setting = malloc(sizeof(struct instrumented_setting));
+    if (setting == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes of memory for a setting",
+                             sizeof(struct instrumented_setting));
+        return NULL;
+    }
+    setting->id = atomic_fetch_add_explicit(&next_setting_id, 1, memory_order_relaxed) + 1;
+    bool record_call = recording();
+    uint64_t begin = record_call ? freq_gen_tsc_read() : 0;
+    setting->setting = wrapper->backend->prepare_set_frequency(target, turbo);
+    if (record_call)
+        record(wrapper, FREQ_GEN_TRACE_PREPARE, begin, turbo, target,
+               setting->setting == NULL ? -1 : 0, setting->id);
+    if (setting->setting == NULL)
+    {
+        free(setting);
+        return NULL;
+    }
+    setting->target = target;
+    return setting;
+}
+
+static void instrumented_unprepare(struct instrumented_interface* wrapper,
+                                   freq_gen_setting_t setting_in)
+{
+    struct instrumented_setting* setting = setting_in;
+    if (!recording())
+        wrapper->backend->unprepare_set_frequency(setting->setting);
+    else
+    {
+        uint64_t begin = freq_gen_tsc_read();
+        wrapper->backend->unprepare_set_frequency(setting->setting);
+        record(wrapper, FREQ_GEN_TRACE_UNPREPARE, begin, -1, setting->target, 0, setting->id);
+    }
+    free(setting);
+}
+
+static int instrumented_set(struct instrumented_interface* wrapper,
+                            int (*set)(freq_gen_single_device_t, freq_gen_setting_t),
+                            freq_gen_trace_op op, freq_gen_single_device_t fp,
+                            freq_gen_setting_t setting_in)
+{
+    struct instrumented_setting* setting = setting_in;
+    int result;
+    if (__builtin_expect(!atomic_load_explicit(&freq_gen_trace_active, memory_order_relaxed), 1))
+        result = set(fp, setting->setting);
+    else
+    {
+        freq_gen_trace_event_t event = { .tsc_begin = freq_gen_tsc_read(),
+                                         .value = setting->target,
+                                         .device = device_of(wrapper, fp),
+                                         .type = wrapper->type,
+                                         .op = op,
+                                         .backend = wrapper->trace_backend,
+                                         .setting = setting->id };
+        event.result = set(fp, setting->setting);
+        event.tsc_end = freq_gen_tsc_read();
+        freq_gen_trace_record(&event);
+        result = event.result;
+    }
+
+    if (result == 0 && atomic_load_explicit(&freq_gen_status_active, memory_order_relaxed))
+    {
+        /* set_frequency of interfaces with a minimal frequency sets both */
+        bool sets_min = op == FREQ_GEN_TRACE_SET_MIN_FREQUENCY ||
+                        wrapper->backend->set_min_frequency != NULL;
+        freq_gen_status_publish(wrapper->type, device_of(wrapper, fp),
+                                op == FREQ_GEN_TRACE_SET_FREQUENCY ? setting->target : -1,
+                                sets_min ? setting->target : -1);
+    }
+    return result;
+}
+
+static long long int instrumented_get(struct instrumented_interface* wrapper,
+                                      long long int (*get)(freq_gen_single_device_t),
+                                      freq_gen_trace_op op, freq_gen_single_device_t fp)
+{
+    if (!recording())
+        return get(fp);
+    uint64_t begin = freq_gen_tsc_read();
+    long long int frequency = get(fp);
+    record(wrapper, op, begin, device_of(wrapper, fp), frequency, frequency < 0 ? -1 : 0, 0);
+    return frequency;
+}
+
+static void instrumented_finalize(struct instrumented_interface* wrapper)
+{
+    if (!recording())
+    {
+        wrapper->backend->finalize();
+        return;
+    }
+    uint64_t begin = freq_gen_tsc_read();
+    wrapper->backend->finalize();
+    record(wrapper, FREQ_GEN_TRACE_FINALIZE, begin, -1, 0, 0, 0);
+}
+
+/* functions that are put into an instrumented interface of a device type */
+#define INSTRUMENT_WRAPPERS(suffix, dev_type, slot)                                                \
+    static freq_gen_single_device_t init_device_##suffix(int nr)                                   \
+    {                                                                                              \
+        return instrumented_init_device(&instrumented[dev_type][slot], nr);                        \
+    }                                                                                              \
+    static void close_device_##suffix(int nr, freq_gen_single_device_t fp)                         \
+    {                                                                                              \
+        instrumented_close_device(&instrumented[dev_type][slot], nr, fp);                          \
+    }                                                                                              \
+    static freq_gen_setting_t prepare_##suffix(long long int target, int turbo)                    \
+    {                                                                                              \
+        return instrumented_prepare(&instrumented[dev_type][slot], target, turbo);                 \
+    }                                                                                              \
+    static void unprepare_##suffix(freq_gen_setting_t setting)                                     \
+    {                                                                                              \
+        instrumented_unprepare(&instrumented[dev_type][slot], setting);                            \
+    }                                                                                              \
+    static int set_frequency_##suffix(freq_gen_single_device_t fp, freq_gen_setting_t setting)     \
+    {                                                                                              \
+        return instrumented_set(&instrumented[dev_type][slot],                                     \
+                                instrumented[dev_type][slot].backend->set_frequency,               \
+                                FREQ_GEN_TRACE_SET_FREQUENCY, fp, setting);                        \
+    }                                                                                              \
+    static int set_min_frequency_##suffix(freq_gen_single_device_t fp,                             \
+                                          freq_gen_setting_t setting)                              \
+    {                                                                                              \
+        return instrumented_set(&instrumented[dev_type][slot],                                     \
+                                instrumented[dev_type][slot].backend->set_min_frequency,           \
+                                FREQ_GEN_TRACE_SET_MIN_FREQUENCY, fp, setting);                    \
+    }                                                                                              \
+    static long long int get_frequency_##suffix(freq_gen_single_device_t fp)                       \
+    {                                                                                              \
+        return instrumented_get(&instrumented[dev_type][slot],                                     \
+                                instrumented[dev_type][slot].backend->get_frequency,               \
+                                FREQ_GEN_TRACE_GET_FREQUENCY, fp);                                 \
+    }                                                                                              \
+    static long long int get_min_frequency_##suffix(freq_gen_single_device_t fp)                   \
+    {                                                                                              \
+        return instrumented_get(&instrumented[dev_type][slot],                                     \
+                                instrumented[dev_type][slot].backend->get_min_frequency,           \
+                                FREQ_GEN_TRACE_GET_MIN_FREQUENCY, fp);                             \
+    }                                                                                              \
+    static long long int get_current_frequency_##suffix(freq_gen_single_device_t fp)               \
+    {                                                                                              \
+        return instrumented_get(&instrumented[dev_type][slot],                                     \
+                                instrumented[dev_type][slot].backend->get_current_frequency,       \
+                                FREQ_GEN_TRACE_GET_CURRENT_FREQUENCY, fp);                         \
+    }                                                                                              \
+    static void finalize_##suffix(void)                                                            \
+    {                                                                                              \
+        instrumented_finalize(&instrumented[dev_type][slot]);                                      \
+    }                                                                                              \
+    static void setup_##suffix(freq_gen_interface_t* interface, bool record_all)                   \
+    {                                                                                              \
+        interface->init_device = init_device_##suffix;                                             \
+        interface->close_device = close_device_##suffix;                                           \
+        interface->prepare_set_frequency = prepare_##suffix;                                       \
+        interface->unprepare_set_frequency = unprepare_##suffix;                                   \
+        interface->set_frequency = set_frequency_##suffix;                                         \
+        if (interface->set_min_frequency != NULL)                                                  \
+            interface->set_min_frequency = set_min_frequency_##suffix;                             \
+        if (!record_all)                                                                           \
+            return;                                                                                \
+        /* getters are only wrapped while recording, so that tracing does not slow them down */    \
+        if (interface->get_frequency != NULL)                                                      \
+            interface->get_frequency = get_frequency_##suffix;                                     \
+        if (interface->get_min_frequency != NULL)                                                  \
+            interface->get_min_frequency = get_min_frequency_##suffix;                             \
+        if (interface->get_current_frequency != NULL)                                              \
+            interface->get_current_frequency = get_current_frequency_##suffix;                     \
+        if (interface->finalize != NULL)                                                           \
+            interface->finalize = finalize_##suffix;                                               \
+    }
+
+#define INSTRUMENT_SLOT(slot)                                                                      \
+    INSTRUMENT_WRAPPERS(core##slot, FREQ_GEN_DEVICE_CORE_FREQ, slot)                               \
+    INSTRUMENT_WRAPPERS(uncore##slot, FREQ_GEN_DEVICE_UNCORE_FREQ, slot)
+
+INSTRUMENT_SLOT(0)
+INSTRUMENT_SLOT(1)
+INSTRUMENT_SLOT(2)
+INSTRUMENT_SLOT(3)
+INSTRUMENT_SLOT(4)
+INSTRUMENT_SLOT(5)
+INSTRUMENT_SLOT(6)
+INSTRUMENT_SLOT(7)
+
+static void (*const setups[FREQ_GEN_DEVICE_NUM][INSTRUMENT_MAX_BACKENDS])(freq_gen_interface_t*,
+                                                                          bool) = {
+    [FREQ_GEN_DEVICE_CORE_FREQ] = { setup_core0, setup_core1, setup_core2, setup_core3,
+                                    setup_core4, setup_core5, setup_core6, setup_core7 },
+    [FREQ_GEN_DEVICE_UNCORE_FREQ] = { setup_uncore0, setup_uncore1, setup_uncore2, setup_uncore3,
+                                      setup_uncore4, setup_uncore5, setup_uncore6, setup_uncore7 }
+};
+
+freq_gen_interface_t* freq_gen_instrument_interface(freq_gen_dev_type type,
+                                                    freq_gen_interface_t* backend)
+{
+    bool trace = freq_gen_trace_check_env();
+    bool status = freq_gen_status_check_env();
+    if (!trace && !status)
+        return backend;
+
+    pthread_mutex_lock(&instrumented_lock);
+    struct instrumented_interface* wrapper = NULL;
+    for (int slot = 0; slot < INSTRUMENT_MAX_BACKENDS; slot++)
+    {
+        struct instrumented_interface* candidate = &instrumented[type][slot];
+        if (candidate->backend == backend || candidate->backend == NULL)
+        {
+            wrapper = candidate;
+            break;
+        }
+    }
+    if (wrapper == NULL)
+    {
+        pthread_mutex_unlock(&instrumented_lock);
+        LIBFREQGEN_SET_ERROR("too many backends to instrument for device type %d", type);
+        return NULL;
+    }
+    if (wrapper->backend == NULL)
+    {
+        wrapper->type = type;
+        wrapper->trace_backend = freq_gen_trace_register_backend(type, backend->name);
+        wrapper->interface = *backend;
+        setups[type][wrapper - instrumented[type]](&wrapper->interface,
+                                                   atomic_load(&freq_gen_trace_record_all));
+        wrapper->backend = backend;
+    }
+    pthread_mutex_unlock(&instrumented_lock);
+
+    if (recording())
+    {
+        uint64_t begin = freq_gen_tsc_read();
+        record(wrapper, FREQ_GEN_TRACE_INIT, begin, -1, backend->get_num_devices(), 0, 0);
+    }
+    return &wrapper->interface;
+}
+
+freq_gen_interface_t* freq_gen_instrument_unwrap(freq_gen_interface_t* interface,
+                                                 freq_gen_setting_t* setting)
+{
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        for (int slot = 0; slot < INSTRUMENT_MAX_BACKENDS; slot++)
+            if (interface == &instrumented[type][slot].interface)
+            {
+                if (setting != NULL && *setting != NULL)
+                    *setting = ((struct instrumented_setting*)*setting)->setting;
+                return instrumented[type][slot].backend;
+            }
+    return interface;
+}
+
+int freq_gen_instrument_write_raw(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                                  uint64_t value, long long int max, long long int min)
+{
+    struct instrumented_interface* wrapper = NULL;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        for (int slot = 0; slot < INSTRUMENT_MAX_BACKENDS; slot++)
+            if (interface == &instrumented[type][slot].interface)
+                wrapper = &instrumented[type][slot];
+    if (wrapper == NULL)
+        return freq_gen_msr_write_raw(interface, fp, value);
+
+    int result;
+    if (!atomic_load_explicit(&freq_gen_trace_active, memory_order_relaxed))
+        result = freq_gen_msr_write_raw(wrapper->backend, fp, value);
+    else
+    {
+        /* no setting has been prepared, replays prepare one from the frequency */
+        freq_gen_trace_event_t event = { .tsc_begin = freq_gen_tsc_read(),
+                                         .value = max,
+                                         .device = device_of(wrapper, fp),
+                                         .type = wrapper->type,
+                                         .op = FREQ_GEN_TRACE_SET_FREQUENCY,
+                                         .backend = wrapper->trace_backend };
+        event.result = freq_gen_msr_write_raw(wrapper->backend, fp, value);
+        event.tsc_end = freq_gen_tsc_read();
+        if (event.result != ENOENT)
+            freq_gen_trace_record(&event);
+        result = event.result;
+    }
+
+    if (result == 0 && atomic_load_explicit(&freq_gen_status_active, memory_order_relaxed))
+        freq_gen_status_publish(wrapper->type, device_of(wrapper, fp), max, min);
+    return result;
+}
@@ -0,0 +1,280 @@
+/*
+ * latency.c
+ *
+ * Implements transition latency tables, see freqgen_latency.h
+ *
+ *  Created on: 19.10.2026
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_latency.h"
+#include "freq_gen_internal.h"
+
+#define LATENCY_MAGIC "FGLATNCY"
+#define LATENCY_VERSION 1
+#define LATENCY_NAME_LENGTH 24
+
+struct latency_matrix
+{
+    uint32_t type;
+    uint32_t nr_frequencies;
+    char name[LATENCY_NAME_LENGTH];
+    long long int* frequencies;
+    /* [from][to][statistic] */
+    uint32_t* values;
+};
+
+struct freq_gen_latency_table_s
+{
+    struct latency_matrix matrices[FREQ_GEN_DEVICE_NUM];
+};
+
+freq_gen_latency_table_t* freq_gen_latency_create(void)
+{
+    freq_gen_latency_table_t* table = calloc(1, sizeof(freq_gen_latency_table_t));
+    if (table == NULL)
+        LIBFREQGEN_SET_ERROR("could not allocate latency table");
+    return table;
+}
+
+static struct latency_matrix* get_matrix(const freq_gen_latency_table_t* table,
+                                         freq_gen_dev_type type)
+{
+    if (type < 0 || type >= FREQ_GEN_DEVICE_NUM || table->matrices[type].nr_frequencies == 0)
+        return NULL;
+    return (struct latency_matrix*)&table->matrices[type];
+}
+
+static size_t nr_values(const struct latency_matrix* matrix)
+{
+    return (size_t)matrix->nr_frequencies * matrix->nr_frequencies * FREQ_GEN_LATENCY_NUM;
+}
+
+static void free_matrix(struct latency_matrix* matrix)
+{
+    free(matrix->frequencies);
+    free(matrix->values);
+    memset(matrix, 0, sizeof(*matrix));
+}
+
+/* allocates frequencies and values of a matrix whose type and nr_frequencies are set */
+static int alloc_matrix(struct latency_matrix* matrix)
+{
+    matrix->frequencies = malloc(matrix->nr_frequencies * sizeof(long long int));
+    matrix->values = malloc(nr_values(matrix) * sizeof(uint32_t));
+    if (matrix->frequencies == NULL || matrix->values == NULL)
+    {
+        free_matrix(matrix);
+        LIBFREQGEN_SET_ERROR("could not allocate latency matrix");
+        return ENOMEM;
+    }
+    return 0;
+}
+
+int freq_gen_latency_add_matrix(freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                const char* interface_name, int nr_frequencies,
+                                const long long int* frequencies)
+{
+    if (type < 0 || type >= FREQ_GEN_DEVICE_NUM || nr_frequencies <= 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid device type %d or number of frequencies %d", type,
+                             nr_frequencies);
+        return EINVAL;
+    }
+    struct latency_matrix* matrix = &table->matrices[type];
+    free_matrix(matrix);
+    matrix->type = type;
+    matrix->nr_frequencies = nr_frequencies;
+    strncpy(matrix->name, interface_name, LATENCY_NAME_LENGTH - 1);
+    int ret = alloc_matrix(matrix);
+    if (ret)
+        return ret;
+    for (int i = 0; i < nr_frequencies; i++)
+        matrix->frequencies[i] = frequencies[i];
+    for (size_t i = 0; i < nr_values(matrix); i++)
+        matrix->values[i] = FREQ_GEN_LATENCY_UNKNOWN;
+    return 0;
+}
+
+static int compare_uint32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* nearest-rank percentile of sorted samples */
+static uint32_t percentile(const uint32_t* sorted, int nr, int percent)
+{
+    int rank = (percent * nr + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int freq_gen_latency_set_samples(freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                 int from_index, int to_index, uint32_t* samples, int nr_samples)
+{
+    struct latency_matrix* matrix = get_matrix(table, type);
+    if (matrix == NULL || from_index < 0 || to_index < 0 ||
+        (uint32_t)from_index >= matrix->nr_frequencies ||
+        (uint32_t)to_index >= matrix->nr_frequencies || nr_samples <= 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid transition %d -> %d for device type %d", from_index,
+                             to_index, type);
+        return EINVAL;
+    }
+    qsort(samples, nr_samples, sizeof(uint32_t), compare_uint32);
+    uint32_t* values =
+        &matrix->values[((size_t)from_index * matrix->nr_frequencies + to_index) *
+                        FREQ_GEN_LATENCY_NUM];
+    values[FREQ_GEN_LATENCY_P50] = percentile(samples, nr_samples, 50);
+    values[FREQ_GEN_LATENCY_P90] = percentile(samples, nr_samples, 90);
+    values[FREQ_GEN_LATENCY_P99] = percentile(samples, nr_samples, 99);
+    values[FREQ_GEN_LATENCY_MAX] = samples[nr_samples - 1];
+    return 0;
+}
+
+int freq_gen_latency_save(const freq_gen_latency_table_t* table, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for writing", path);
+        return errno;
+    }
+    uint32_t version = LATENCY_VERSION;
+    uint32_t nr_matrices = 0;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        if (get_matrix(table, type) != NULL)
+            nr_matrices++;
+
+    int ok = fwrite(LATENCY_MAGIC, 8, 1, file) == 1 && fwrite(&version, 4, 1, file) == 1 &&
+             fwrite(&nr_matrices, 4, 1, file) == 1;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM && ok; type++)
+    {
+        const struct latency_matrix* matrix = get_matrix(table, type);
+        if (matrix == NULL)
+            continue;
+        ok = fwrite(&matrix->type, 4, 1, file) == 1 &&
+             fwrite(&matrix->nr_frequencies, 4, 1, file) == 1 &&
+             fwrite(matrix->name, LATENCY_NAME_LENGTH, 1, file) == 1 &&
+             fwrite(matrix->frequencies, sizeof(int64_t), matrix->nr_frequencies, file) ==
+                 matrix->nr_frequencies &&
+             fwrite(matrix->values, sizeof(uint32_t), nr_values(matrix), file) ==
+                 nr_values(matrix);
+    }
+    if (fclose(file) != 0)
+        ok = 0;
+    if (!ok)
+    {
+        LIBFREQGEN_SET_ERROR("could not write latency table to \"%s\"", path);
+        return EIO;
+    }
+    return 0;
+}
+
+freq_gen_latency_table_t* freq_gen_latency_load(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for reading", path);
+        return NULL;
+    }
+    char magic[8];
+    uint32_t version, nr_matrices;
+    if (fread(magic, 8, 1, file) != 1 || memcmp(magic, LATENCY_MAGIC, 8) != 0 ||
+        fread(&version, 4, 1, file) != 1 || version != LATENCY_VERSION ||
+        fread(&nr_matrices, 4, 1, file) != 1)
+    {
+        fclose(file);
+        LIBFREQGEN_SET_ERROR("\"%s\" is not a latency table", path);
+        return NULL;
+    }
+    freq_gen_latency_table_t* table = freq_gen_latency_create();
+    if (table == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < nr_matrices; i++)
+    {
+        struct latency_matrix header;
+        if (fread(&header.type, 4, 1, file) != 1 ||
+            fread(&header.nr_frequencies, 4, 1, file) != 1 ||
+            fread(header.name, LATENCY_NAME_LENGTH, 1, file) != 1 ||
+            header.type >= FREQ_GEN_DEVICE_NUM || header.nr_frequencies == 0 ||
+            header.nr_frequencies > 4096)
+            goto error;
+        struct latency_matrix* matrix = &table->matrices[header.type];
+        free_matrix(matrix);
+        *matrix = header;
+        matrix->name[LATENCY_NAME_LENGTH - 1] = '\0';
+        if (alloc_matrix(matrix) != 0)
+            goto error;
+        if (fread(matrix->frequencies, sizeof(int64_t), matrix->nr_frequencies, file) !=
+                matrix->nr_frequencies ||
+            fread(matrix->values, sizeof(uint32_t), nr_values(matrix), file) !=
+                nr_values(matrix))
+            goto error;
+    }
+    fclose(file);
+    return table;
+
+error:
+    fclose(file);
+    freq_gen_latency_free(table);
+    LIBFREQGEN_SET_ERROR("could not read latency table from \"%s\"", path);
+    return NULL;
+}
+
+/* returns the index of the closest frequency */
+static int closest(const struct latency_matrix* matrix, long long int frequency)
+{
+    int best = 0;
+    for (uint32_t i = 1; i < matrix->nr_frequencies; i++)
+        if (llabs(matrix->frequencies[i] - frequency) < llabs(matrix->frequencies[best] - frequency))
+            best = i;
+    return best;
+}
+
+long long int freq_gen_latency_get(const freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                   long long int from, long long int to,
+                                   freq_gen_latency_stat stat)
+{
+    const struct latency_matrix* matrix = get_matrix(table, type);
+    if (matrix == NULL || stat < 0 || stat >= FREQ_GEN_LATENCY_NUM)
+        return -ENOENT;
+    int from_index = closest(matrix, from);
+    int to_index = closest(matrix, to);
+    uint32_t value =
+        matrix->values[((size_t)from_index * matrix->nr_frequencies + to_index) *
+                           FREQ_GEN_LATENCY_NUM +
+                       stat];
+    if (value == FREQ_GEN_LATENCY_UNKNOWN)
+        return -ENOENT;
+    return value;
+}
+
+int freq_gen_latency_get_frequencies(const freq_gen_latency_table_t* table, freq_gen_dev_type type,
+                                     const long long int** frequencies)
+{
+    const struct latency_matrix* matrix = get_matrix(table, type);
+    if (matrix == NULL)
+        return -ENOENT;
+    *frequencies = matrix->frequencies;
+    return matrix->nr_frequencies;
+}
+
+void freq_gen_latency_free(freq_gen_latency_table_t* table)
+{
+    if (table == NULL)
+        return;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        free_matrix(&table->matrices[type]);
+    free(table);
+}
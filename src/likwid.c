@@ -20,7 +20,12 @@
 
 #include "../include/error.h"
 #include "freq_gen_internal.h"
+#include "freq_gen_internal_cpuset.h"
 #include "freq_gen_internal_generic.h"
+#include "freq_gen_internal_perf.h"
+
+/* window for measuring the uncore frequency with perf */
+#define UNCORE_CLOCK_WINDOW_NS 10000000ULL
 
 /* implementations of the interface */
 static freq_gen_interface_t freq_gen_likwid_cpu_interface;
@@ -115,6 +120,11 @@ static freq_gen_interface_t* freq_gen_likwid_init_uncore(void)
  */
 static freq_gen_single_device_t freq_gen_likwid_device_init(int cpu_id)
 {
+    if (!freq_gen_cpuset_cpu_allowed(cpu_id))
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is not in the cpuset of the process", cpu_id);
+        return -EPERM;
+    }
     if (avail_freqs == NULL)
     {
         avail_freqs = freq_getAvailFreq(cpu_id);
@@ -124,6 +134,11 @@ static freq_gen_single_device_t freq_gen_likwid_device_init(int cpu_id)
 /* will just return the uncore */
 static freq_gen_single_device_t freq_gen_likwid_device_init_uncore(int uncore)
 {
+    if (!freq_gen_cpuset_uncore_allowed(uncore))
+    {
+        LIBFREQGEN_SET_ERROR("uncore %d is not in a package of the cpuset of the process", uncore);
+        return -EPERM;
+    }
     return uncore;
 }
 
@@ -274,6 +289,25 @@ static long long int freq_gen_likwid_get_min_frequency_uncore(freq_gen_single_de
     }
 }
 
+/* likwid can not read the current uncore frequency, so uncore clockticks are counted via perf on
+ * the first cpu of the uncore
+ */
+static long long int freq_gen_likwid_get_current_frequency_uncore(freq_gen_single_device_t fp)
+{
+    int cpu = freq_gen_get_uncore_leader_cpu(fp);
+    if (cpu < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not get the first cpu of uncore %d", fp);
+        return cpu;
+    }
+    int perf_fd = freq_gen_perf_open_uncore_clockticks(cpu);
+    if (perf_fd < 0)
+        return perf_fd;
+    long long int frequency = freq_gen_perf_measure_rate(perf_fd, UNCORE_CLOCK_WINDOW_NS);
+    close(perf_fd);
+    return frequency;
+}
+
 /* applies uncore frequency setting
  * O(freq_setUncoreFreqMin)+O(freq_setUncoreFreqMax)
  * If AVOID_LIKWID_BUG is activated during compilation, return codes are not checked
@@ -348,7 +382,8 @@ static freq_gen_interface_t freq_gen_likwid_cpu_interface = {
     .set_min_frequency = freq_gen_likwid_set_min_frequency,
     .unprepare_set_frequency = freq_gen_likwid_unprepare_access,
     .close_device = freq_gen_likwid_do_nothing,
-    .finalize = freq_gen_likwid_finalize
+    .finalize = freq_gen_likwid_finalize,
+    .get_current_frequency = NULL
 };
 
 static freq_gen_interface_t freq_gen_likwid_uncore_interface = {
@@ -362,7 +397,8 @@ static freq_gen_interface_t freq_gen_likwid_uncore_interface = {
     .set_min_frequency = freq_gen_likwid_set_min_frequency_uncore,
     .unprepare_set_frequency = freq_gen_likwid_unprepare_access,
     .close_device = freq_gen_likwid_do_nothing,
-    .finalize = freq_gen_likwid_do_nothing
+    .finalize = freq_gen_likwid_do_nothing,
+    .get_current_frequency = freq_gen_likwid_get_current_frequency_uncore
 };
 
 freq_gen_interface_internal_t freq_gen_likwid_interface_internal = {
@@ -0,0 +1,412 @@
+/*
+ * model.c
+ *
+ * Implements tuning models, see freqgen_model.h
+ *
+ * A model file starts with a struct model_header, followed by nr_regions struct model_entry, then
+ * nr_buckets uint32_t buckets and finally names_size bytes of null-terminated names. A bucket holds
+ * the index of an entry + 1 or 0 if it is empty. Collisions are resolved by linear probing, and
+ * there are at least twice as many buckets as regions.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_model.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_settings.h"
+
+#define MODEL_MAGIC "FGMODEL"
+#define MODEL_VERSION 1
+#define MODEL_MAX_DEPTH 64
+
+struct model_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t nr_regions;
+    uint32_t nr_buckets; /**< a power of 2 */
+    uint32_t names_size;
+};
+
+struct model_entry
+{
+    uint64_t id;
+    int64_t core;   /**< frequency in Hz or FREQ_GEN_MODEL_KEEP */
+    int64_t uncore; /**< frequency in Hz or FREQ_GEN_MODEL_KEEP */
+    uint32_t name;  /**< offset of the name + 1 or 0 */
+    uint32_t reserved;
+};
+
+struct freq_gen_model_builder_s
+{
+    struct model_entry* entries;
+    int nr_entries;
+    char* names;
+    size_t names_size;
+};
+
+struct freq_gen_model_s
+{
+    void* mapping;
+    size_t size;
+    const struct model_header* header;
+    const struct model_entry* entries;
+    const uint32_t* buckets;
+    const char* names;
+};
+
+struct freq_gen_model_runtime_s
+{
+    const freq_gen_model_t* model;
+    freq_gen_settings_t types[FREQ_GEN_DEVICE_NUM];
+    /* index of the setting of each region and type, -1 to keep */
+    int (*region_settings)[FREQ_GEN_DEVICE_NUM];
+    uint64_t ids[MODEL_MAX_DEPTH];
+    /* settings at each depth, [0] is FREQ_GEN_SETTING_BASELINE or -1 without devices */
+    int effective[MODEL_MAX_DEPTH + 1][FREQ_GEN_DEVICE_NUM];
+    int depth;
+};
+
+uint64_t freq_gen_region_hash(const char* name)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* c = (const unsigned char*)name; *c != '\0'; c++)
+    {
+        hash ^= *c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash ? hash : 1;
+}
+
+freq_gen_model_builder_t* freq_gen_model_builder_create(void)
+{
+    freq_gen_model_builder_t* builder = calloc(1, sizeof(freq_gen_model_builder_t));
+    if (builder == NULL)
+        LIBFREQGEN_SET_ERROR("could not allocate model builder");
+    return builder;
+}
+
+int freq_gen_model_builder_add(freq_gen_model_builder_t* builder, uint64_t id, const char* name,
+                               long long int core_frequency, long long int uncore_frequency)
+{
+    if (id == 0)
+    {
+        if (name == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("a region needs an id or a name");
+            return EINVAL;
+        }
+        id = freq_gen_region_hash(name);
+    }
+    struct model_entry* entry = NULL;
+    for (int i = 0; i < builder->nr_entries; i++)
+        if (builder->entries[i].id == id)
+            entry = &builder->entries[i];
+    if (entry == NULL)
+    {
+        struct model_entry* tmp =
+            realloc(builder->entries, (builder->nr_entries + 1) * sizeof(struct model_entry));
+        if (tmp == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for region %s", name ? name : "");
+            return ENOMEM;
+        }
+        builder->entries = tmp;
+        entry = &builder->entries[builder->nr_entries++];
+        memset(entry, 0, sizeof(*entry));
+        entry->id = id;
+    }
+    entry->core = core_frequency;
+    entry->uncore = uncore_frequency;
+    if (name != NULL)
+    {
+        size_t length = strlen(name) + 1;
+        char* tmp = realloc(builder->names, builder->names_size + length);
+        if (tmp == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for region %s", name);
+            return ENOMEM;
+        }
+        memcpy(tmp + builder->names_size, name, length);
+        builder->names = tmp;
+        entry->name = builder->names_size + 1;
+        builder->names_size += length;
+    }
+    return 0;
+}
+
+int freq_gen_model_builder_save(freq_gen_model_builder_t* builder, const char* path)
+{
+    uint32_t nr_buckets = 2;
+    while (nr_buckets < 2 * (uint32_t)builder->nr_entries)
+        nr_buckets <<= 1;
+    uint32_t* buckets = calloc(nr_buckets, sizeof(uint32_t));
+    if (buckets == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %u buckets", nr_buckets);
+        return ENOMEM;
+    }
+    for (int i = 0; i < builder->nr_entries; i++)
+    {
+        uint32_t bucket = builder->entries[i].id & (nr_buckets - 1);
+        while (buckets[bucket] != 0)
+            bucket = (bucket + 1) & (nr_buckets - 1);
+        buckets[bucket] = i + 1;
+    }
+
+    struct model_header header = { .version = MODEL_VERSION,
+                                   .nr_regions = builder->nr_entries,
+                                   .nr_buckets = nr_buckets,
+                                   .names_size = builder->names_size };
+    memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        free(buckets);
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for writing", path);
+        return errno;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(builder->entries, sizeof(struct model_entry), builder->nr_entries, file) ==
+                 (size_t)builder->nr_entries &&
+             fwrite(buckets, sizeof(uint32_t), nr_buckets, file) == nr_buckets &&
+             fwrite(builder->names, 1, builder->names_size, file) == builder->names_size;
+    free(buckets);
+    if (fclose(file) != 0)
+        ok = 0;
+    if (!ok)
+    {
+        LIBFREQGEN_SET_ERROR("could not write model to \"%s\"", path);
+        return EIO;
+    }
+    return 0;
+}
+
+void freq_gen_model_builder_free(freq_gen_model_builder_t* builder)
+{
+    if (builder == NULL)
+        return;
+    free(builder->entries);
+    free(builder->names);
+    free(builder);
+}
+
+freq_gen_model_t* freq_gen_model_open(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for reading", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct model_header))
+    {
+        close(fd);
+        LIBFREQGEN_SET_ERROR("\"%s\" is not a model", path);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        LIBFREQGEN_SET_ERROR("could not map \"%s\"", path);
+        return NULL;
+    }
+    const struct model_header* header = mapping;
+    size_t size = sizeof(struct model_header) +
+                  (size_t)header->nr_regions * sizeof(struct model_entry) +
+                  (size_t)header->nr_buckets * sizeof(uint32_t) + header->names_size;
+    if (memcmp(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0 ||
+        header->version != MODEL_VERSION || header->nr_buckets == 0 ||
+        (header->nr_buckets & (header->nr_buckets - 1)) != 0 ||
+        header->nr_buckets <= header->nr_regions || size > (size_t)st.st_size)
+    {
+        munmap(mapping, st.st_size);
+        LIBFREQGEN_SET_ERROR("\"%s\" is not a model", path);
+        return NULL;
+    }
+    /* lookups of missing regions stop at an empty bucket */
+    const uint32_t* buckets = (const uint32_t*)((const struct model_entry*)(header + 1) +
+                                                header->nr_regions);
+    uint32_t nr_empty = 0;
+    for (uint32_t i = 0; i < header->nr_buckets; i++)
+        nr_empty += buckets[i] == 0;
+    if (nr_empty == 0)
+    {
+        munmap(mapping, st.st_size);
+        LIBFREQGEN_SET_ERROR("\"%s\" is not a model, its hash table has no empty bucket", path);
+        return NULL;
+    }
+    freq_gen_model_t* model = malloc(sizeof(freq_gen_model_t));
+    if (model == NULL)
+    {
+        munmap(mapping, st.st_size);
+        LIBFREQGEN_SET_ERROR("could not allocate model");
+        return NULL;
+    }
+    model->mapping = mapping;
+    model->size = st.st_size;
+    model->header = header;
+    model->entries = (const struct model_entry*)(header + 1);
+    model->buckets = (const uint32_t*)(model->entries + header->nr_regions);
+    model->names = (const char*)(model->buckets + header->nr_buckets);
+    return model;
+}
+
+/* returns the index of the entry of a region or -1 */
+static inline int find_entry(const freq_gen_model_t* model, uint64_t id)
+{
+    uint32_t mask = model->header->nr_buckets - 1;
+    uint32_t bucket = id & mask;
+    for (uint32_t probes = 0; probes < model->header->nr_buckets; probes++)
+    {
+        uint32_t index = model->buckets[bucket];
+        if (index == 0 || index > model->header->nr_regions)
+            return -1;
+        if (model->entries[index - 1].id == id)
+            return index - 1;
+        bucket = (bucket + 1) & mask;
+    }
+    return -1;
+}
+
+int freq_gen_model_get_num_regions(const freq_gen_model_t* model)
+{
+    return model->header->nr_regions;
+}
+
+int freq_gen_model_get_region(const freq_gen_model_t* model, int index, uint64_t* id,
+                              const char** name, long long int* core_frequency,
+                              long long int* uncore_frequency)
+{
+    if (index < 0 || (uint32_t)index >= model->header->nr_regions)
+        return EINVAL;
+    const struct model_entry* entry = &model->entries[index];
+    *id = entry->id;
+    *core_frequency = entry->core;
+    *uncore_frequency = entry->uncore;
+    if (name != NULL)
+        *name = entry->name != 0 && entry->name <= model->header->names_size
+                    ? &model->names[entry->name - 1]
+                    : NULL;
+    return 0;
+}
+
+int freq_gen_model_lookup(const freq_gen_model_t* model, uint64_t id, long long int* core_frequency,
+                          long long int* uncore_frequency)
+{
+    int index = find_entry(model, id);
+    if (index < 0)
+        return ENOENT;
+    *core_frequency = model->entries[index].core;
+    *uncore_frequency = model->entries[index].uncore;
+    return 0;
+}
+
+void freq_gen_model_close(freq_gen_model_t* model)
+{
+    if (model == NULL)
+        return;
+    munmap(model->mapping, model->size);
+    free(model);
+}
+
+freq_gen_model_runtime_t* freq_gen_model_bind(const freq_gen_model_t* model,
+                                              freq_gen_session_t* core,
+                                              freq_gen_session_t* uncore)
+{
+    freq_gen_model_runtime_t* runtime = calloc(1, sizeof(freq_gen_model_runtime_t));
+    if (runtime == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate model runtime");
+        return NULL;
+    }
+    runtime->model = model;
+    runtime->region_settings = malloc((model->header->nr_regions + 1) *
+                                      sizeof(*runtime->region_settings));
+    if (runtime->region_settings == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %u regions",
+                             model->header->nr_regions);
+        freq_gen_model_runtime_free(runtime);
+        return NULL;
+    }
+    freq_gen_session_t* sessions[FREQ_GEN_DEVICE_NUM] = { core, uncore };
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+    {
+        freq_gen_settings_t* type = &runtime->types[t];
+        if (freq_gen_settings_bind(type, sessions[t]))
+        {
+            freq_gen_model_runtime_free(runtime);
+            return NULL;
+        }
+        /* the settings outside of all regions */
+        runtime->effective[0][t] = type->current;
+        for (uint32_t i = 0; i < model->header->nr_regions; i++)
+        {
+            long long int frequency = t == FREQ_GEN_DEVICE_CORE_FREQ ? model->entries[i].core
+                                                                     : model->entries[i].uncore;
+            int index = type->session != NULL ? freq_gen_settings_add(type, frequency) : -1;
+            if (index < -1)
+            {
+                freq_gen_model_runtime_free(runtime);
+                return NULL;
+            }
+            runtime->region_settings[i][t] = index;
+        }
+    }
+    return runtime;
+}
+
+int freq_gen_model_enter_region(freq_gen_model_runtime_t* runtime, uint64_t id)
+{
+    if (runtime->depth >= MODEL_MAX_DEPTH)
+    {
+        LIBFREQGEN_SET_ERROR("regions are nested deeper than %d", MODEL_MAX_DEPTH);
+        return EOVERFLOW;
+    }
+    int entry = find_entry(runtime->model, id);
+    int depth = runtime->depth;
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+    {
+        int index = entry >= 0 ? runtime->region_settings[entry][t] : -1;
+        runtime->effective[depth + 1][t] = index >= 0 ? index : runtime->effective[depth][t];
+    }
+    runtime->ids[depth] = id;
+    runtime->depth = depth + 1;
+    return freq_gen_settings_apply_all(runtime->types, runtime->effective[depth + 1]);
+}
+
+int freq_gen_model_exit_region(freq_gen_model_runtime_t* runtime, uint64_t id)
+{
+    if (runtime->depth == 0 || runtime->ids[runtime->depth - 1] != id)
+    {
+        LIBFREQGEN_SET_ERROR("region %llx is not the innermost region", (unsigned long long)id);
+        return EINVAL;
+    }
+    runtime->depth--;
+    return freq_gen_settings_apply_all(runtime->types, runtime->effective[runtime->depth]);
+}
+
+void freq_gen_model_runtime_free(freq_gen_model_runtime_t* runtime)
+{
+    if (runtime == NULL)
+        return;
+    for (int t = 0; t < FREQ_GEN_DEVICE_NUM; t++)
+        freq_gen_settings_free(&runtime->types[t]);
+    free(runtime->region_settings);
+    free(runtime);
+}
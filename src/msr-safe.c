@@ -12,6 +12,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -20,8 +21,15 @@
 #include <unistd.h>
 
 #include "../include/error.h"
+#include "../include/freqgen_topology.h"
 #include "freq_gen_internal.h"
+#include "freq_gen_internal_broker.h"
+#include "freq_gen_internal_cpuset.h"
 #include "freq_gen_internal_generic.h"
+#include "freq_gen_internal_instrument.h"
+#include "freq_gen_internal_msr.h"
+#include "freq_gen_internal_perf.h"
+#include "freq_gen_internal_signal.h"
 
 /* some definitions to parse cpuid */
 #define STEPPING(eax) (eax & 0xF)
@@ -35,6 +43,10 @@
 #define IA32_PERF_STATUS 0x198
 #define IA32_PERF_CTL 0x199
 #define UNCORE_RATIO_LIMIT 0x620
+#define MSR_UNCORE_PERF_STATUS 0x621
+
+/* window for measuring the uncore frequency with perf, if MSR_UNCORE_PERF_STATUS is not there */
+#define UNCORE_CLOCK_WINDOW_NS 10000000ULL
 
 /* implementations of the interface */
 static freq_gen_interface_t freq_gen_msr_cpu_interface;
@@ -42,6 +54,23 @@ static freq_gen_interface_t freq_gen_msr_uncore_interface;
 
 static int is_newer = 1;
 
+/* the CPU that is used to access an uncore, filled in freq_gen_msr_device_init_uncore. Uncores can
+ * be opened and closed from several threads, which moves entries, so the array is only accessed
+ * with uncore_leaders_lock held and no pointers to entries are kept outside of it */
+struct uncore_leader
+{
+    int fd;              /**< the msr file descriptor returned by init_device */
+    int cpu;             /**< first cpu of the uncore */
+    int perf_fd;         /**< uncore clockticks counter, opened on first fallback */
+    int has_perf_status; /**< whether MSR_UNCORE_PERF_STATUS can be read */
+    int measuring;       /**< number of measurements with perf_fd in progress */
+};
+static struct uncore_leader* uncore_leaders;
+static int nr_uncore_leaders;
+static pthread_mutex_t uncore_leaders_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when the last measurement of an uncore ends, so that it can be closed */
+static pthread_cond_t uncore_measurement_done = PTHREAD_COND_INITIALIZER;
+
 /* cpuid call in C */
 static inline void cpuid(unsigned int* eax, unsigned int* ebx, unsigned int* ecx, unsigned int* edx)
 {
@@ -222,19 +251,79 @@ static int is_supported_uncore()
     return 0;
 }
 
+/* checks whether /dev/cpu/(cpu)/msr[-safe] can be written
+ * returns 1 if it can be written, 0 if not, -ENOMEM if the filepath does not fit into the buffer
+ */
+static int msr_writable(long long int cpu)
+{
+    char buffer[BUFFER_SIZE];
+    /* check access to msr */
+    if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%lli/msr", cpu) == BUFFER_SIZE)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate enough memory to store filepath to "
+                             "msr-file, BUFFER_SIZE (%d) exceeded",
+                             BUFFER_SIZE);
+        return -ENOMEM;
+    }
+
+    /* can not be accessed? check msr-safe */
+    if (access(buffer, W_OK) != 0)
+    {
+
+        /* check access to msr */
+        if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%lli/msr_safe", cpu) == BUFFER_SIZE)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate enough memory to store filepath to "
+                                 "msr-safe-file, BUFFER_SIZE (%d) exceeded",
+                                 BUFFER_SIZE);
+            return -ENOMEM;
+        }
+        if (access(buffer, W_OK) != 0)
+        {
+            /* the broker decides per cpu in init_device */
+            return freq_gen_broker_available() && access(buffer, F_OK) == 0;
+        }
+    }
+    return 1;
+}
+
 /* this will return the maximal number of CPUs by looking for /dev/cpu/(nr)/msr[-safe]
  * It will also check whether these can be written
  * time complexity is O(num_cpus) for the first call. Afterwards its O(1), since the return value is
  * buffered
+ * If the cpuset scope is enabled, only the CPUs of the process are checked
  */
 static int freq_gen_msr_get_max_entries()
 {
     static long long int max = -1;
-    if (max != -1)
+    /* the topology watcher increments the generation when CPUs come online or go offline */
+    static unsigned long long generation;
+    if (max != -1 && generation == freq_gen_topology_get_generation())
     {
         return max;
     }
-    char buffer[BUFFER_SIZE];
+    max = -1;
+    generation = freq_gen_topology_get_generation();
+
+    if (freq_gen_cpuset_enabled())
+    {
+        for (int cpu = freq_gen_cpuset_next_cpu(-1); cpu >= 0; cpu = freq_gen_cpuset_next_cpu(cpu))
+        {
+            int writable = msr_writable(cpu);
+            if (writable < 0)
+                return writable;
+            if (writable)
+                max = cpu;
+        }
+        if (max == -1)
+        {
+            LIBFREQGEN_SET_ERROR("Could not access the msr files of the cpus of the process");
+            return -EACCES;
+        }
+        max = max + 1;
+        return max;
+    }
+
     DIR* dir = opendir("/dev/cpu/");
     if (dir == NULL)
     {
@@ -254,34 +343,14 @@ static int freq_gen_msr_get_max_entries()
             if (end != (entry->d_name + strlen(entry->d_name)))
                 continue;
 
-            /* check access to msr */
-            if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%lli/msr", current) == BUFFER_SIZE)
+            int writable = msr_writable(current);
+            if (writable < 0)
             {
                 closedir(dir);
-                LIBFREQGEN_SET_ERROR("could not allocate enough memory to store filepath to "
-                                     "msr-file, BUFFER_SIZE (%d) exceeded",
-                                     BUFFER_SIZE);
-                return -ENOMEM;
-            }
-
-            /* can not be accessed? check msr-safe */
-            if (access(buffer, W_OK) != 0)
-            {
-
-                /* check access to msr */
-                if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%lli/msr_safe", current) == BUFFER_SIZE)
-                {
-                    closedir(dir);
-                    LIBFREQGEN_SET_ERROR("could not allocate enough memory to store filepath to "
-                                         "msr-safe-file, BUFFER_SIZE (%d) exceeded",
-                                         BUFFER_SIZE);
-                    return -ENOMEM;
-                }
-                if (access(buffer, W_OK) != 0)
-                {
-                    continue;
-                }
+                return writable;
             }
+            if (!writable)
+                continue;
 
             if (current > max)
                 max = current;
@@ -336,15 +405,15 @@ static freq_gen_interface_t* freq_gen_msr_init_uncore(void)
     return &freq_gen_msr_uncore_interface;
 }
 
-/* will open a file descriptor for /dev/cpu/(cpu_id)/msr[-safe] and return it.
- * /dev/cpu/(cpu)/msr[-safe] must be writable
+/* will open /dev/cpu/(cpu)/msr or /dev/cpu/(cpu)/msr_safe for reading and writing. If neither
+ * can be opened due to missing permissions, the file descriptor is requested from the broker for
+ * writing msr_register.
+ * returns the file descriptor or -ERRNO
  */
-static freq_gen_single_device_t freq_gen_msr_device_init(int cpu_id)
+static int open_msr(long cpu, uint32_t msr_register)
 {
     char buffer[BUFFER_SIZE];
-    /* get uncore msr */
-
-    if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%d/msr", cpu_id) == BUFFER_SIZE)
+    if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%ld/msr", cpu) == BUFFER_SIZE)
     {
         LIBFREQGEN_SET_ERROR("could not assemble file-path to msr file, BUFFER_SIZE(%d) exceeded",
                              BUFFER_SIZE);
@@ -352,23 +421,49 @@ static freq_gen_single_device_t freq_gen_msr_device_init(int cpu_id)
     }
 
     int fd = open(buffer, O_RDWR);
-    if (fd < 0)
+    if (fd >= 0)
+        return fd;
+    if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%ld/msr_safe", cpu) == BUFFER_SIZE)
     {
-        if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%d/msr_safe", cpu_id) == BUFFER_SIZE)
-        {
-            LIBFREQGEN_SET_ERROR(
-                "could not assemble file-path to msr-safe file, BUFFER_SIZE(%d) exceeded",
-                BUFFER_SIZE);
-            return ENOMEM;
-        }
-        fd = open(buffer, O_RDWR);
-        if (fd < 0)
-        {
-            LIBFREQGEN_SET_ERROR("could not open file \"%s\" for reading", buffer);
-            return -errno;
-        }
+        LIBFREQGEN_SET_ERROR(
+            "could not assemble file-path to msr-safe file, BUFFER_SIZE(%d) exceeded",
+            BUFFER_SIZE);
+        return -ENOMEM;
     }
-    return fd;
+    fd = open(buffer, O_RDWR);
+    if (fd >= 0)
+        return fd;
+    int ret = -errno;
+    if ((ret == -EACCES || ret == -EPERM) && freq_gen_broker_available())
+    {
+        fd = freq_gen_broker_open(FREQ_GEN_BROKER_MSR, cpu, msr_register);
+        if (fd >= 0)
+            return fd;
+        LIBFREQGEN_APPEND_ERROR("could not open file \"%s\" and request it from the broker",
+                                buffer);
+        return fd;
+    }
+    LIBFREQGEN_SET_ERROR("could not open file \"%s\" for reading", buffer);
+    return ret;
+}
+
+/* will open a file descriptor for /dev/cpu/(cpu_id)/msr[-safe] and return it.
+ * /dev/cpu/(cpu)/msr[-safe] must be writable
+ */
+static freq_gen_single_device_t freq_gen_msr_device_init(int cpu_id)
+{
+    if (!freq_gen_cpuset_cpu_allowed(cpu_id))
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is not in the cpuset of the process", cpu_id);
+        return -EPERM;
+    }
+    if (!freq_gen_topology_cpu_online(cpu_id))
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is offline", cpu_id);
+        return -ENODEV;
+    }
+
+    return open_msr(cpu_id, IA32_PERF_CTL);
 }
 
 /* will open a file descriptor to the first cpu of a given uncore /dev/cpu/(cpu)/msr[-safe] and
@@ -379,66 +474,54 @@ static freq_gen_single_device_t freq_gen_msr_device_init(int cpu_id)
  */
 static freq_gen_single_device_t freq_gen_msr_device_init_uncore(int uncore)
 {
-    char buffer[BUFFER_SIZE];
-    char* tail;
-    /* get uncore id */
-
-    if (snprintf(buffer, BUFFER_SIZE, "/sys/devices/system/node/node%d/cpulist", uncore) ==
-        BUFFER_SIZE)
+    if (!freq_gen_cpuset_uncore_allowed(uncore))
     {
-        LIBFREQGEN_SET_ERROR("could not assemble file-path to cpulist, BUFFER_SIZE(%d) exceeded",
-                             BUFFER_SIZE);
-        return -ENOMEM;
+        LIBFREQGEN_SET_ERROR("uncore %d is not in a package of the cpuset of the process", uncore);
+        return -EPERM;
     }
 
-    int fd = open(buffer, O_RDONLY);
-    if (fd < 0)
+    long cpu = freq_gen_get_uncore_leader_cpu(uncore);
+    if (cpu < 0)
     {
-        LIBFREQGEN_SET_ERROR("could not open file \"%s\" for reading", buffer);
-        return -EIO;
-    }
-    int ret = read(fd, buffer, BUFFER_SIZE);
-    close(fd);
-    if (ret <= 0)
-    {
-        LIBFREQGEN_SET_ERROR("could not read %d bytes from file \"%s\"", BUFFER_SIZE, buffer);
-        return -EIO;
+        LIBFREQGEN_APPEND_ERROR("could not get the first cpu of uncore %d", uncore);
+        return cpu;
     }
-    buffer[ret] = '\0';
 
-    long cpu = strtol(buffer, &tail, 10);
-    if (tail == buffer)
-    {
-        LIBFREQGEN_SET_ERROR("could not parse given data to long, content \"%20s\"", buffer);
-        return -EIO;
-    }
+    int fd = open_msr(cpu, UNCORE_RATIO_LIMIT);
+    if (fd < 0)
+        return fd;
 
-    if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%ld/msr", cpu) == BUFFER_SIZE)
+    pthread_mutex_lock(&uncore_leaders_lock);
+    struct uncore_leader* tmp =
+        realloc(uncore_leaders, (nr_uncore_leaders + 1) * sizeof(struct uncore_leader));
+    if (tmp == NULL)
     {
-        LIBFREQGEN_SET_ERROR("could not assemble file-path to msr file, BUFFER_SIZE(%d) exceeded",
-                             BUFFER_SIZE);
+        pthread_mutex_unlock(&uncore_leaders_lock);
+        close(fd);
+        LIBFREQGEN_SET_ERROR("could not allocate memory for uncore %d", uncore);
         return -ENOMEM;
     }
-
-    fd = open(buffer, O_RDWR);
-    if (fd < 0)
-    {
-        if (snprintf(buffer, BUFFER_SIZE, "/dev/cpu/%ld/msr_safe", cpu) == BUFFER_SIZE)
-        {
-            LIBFREQGEN_SET_ERROR(
-                "could not assemble file-path to msr-safe file, BUFFER_SIZE(%d) exceeded",
-                BUFFER_SIZE);
-            return -ENOMEM;
-        }
-        fd = open(buffer, O_RDWR);
-        if (fd < 0)
-        {
-            LIBFREQGEN_SET_ERROR("could not open file \"%s\" for reading", buffer);
-            return -errno;
-        }
-    }
+    uncore_leaders = tmp;
+    uncore_leaders[nr_uncore_leaders].fd = fd;
+    uncore_leaders[nr_uncore_leaders].cpu = cpu;
+    uncore_leaders[nr_uncore_leaders].perf_fd = -1;
+    uncore_leaders[nr_uncore_leaders].has_perf_status = 1;
+    uncore_leaders[nr_uncore_leaders].measuring = 0;
+    nr_uncore_leaders++;
+    pthread_mutex_unlock(&uncore_leaders_lock);
     return fd;
 }
+
+/* returns the bookkeeping of an uncore device opened with freq_gen_msr_device_init_uncore, must be
+ * called with uncore_leaders_lock held */
+static struct uncore_leader* get_uncore_leader(freq_gen_single_device_t fp)
+{
+    for (int i = 0; i < nr_uncore_leaders; i++)
+        if (uncore_leaders[i].fd == fp)
+            return &uncore_leaders[i];
+    return NULL;
+}
+
 static freq_gen_setting_t freq_gen_msr_prepare_access(long long target, int turbo)
 {
     long long int* setting = malloc(sizeof(long long int));
@@ -469,6 +552,26 @@ static long long int freq_gen_msr_get_frequency(freq_gen_single_device_t fp)
     }
 }
 
+/* will get the current core frequency from IA32_PERF_STATUS */
+static long long int freq_gen_msr_get_current_frequency(freq_gen_single_device_t fp)
+{
+    long long int status = 0;
+    int result = pread(fp, &status, 8, IA32_PERF_STATUS);
+
+    if (result == 8)
+        if (is_newer)
+            return ((status >> 8) & 0xFF) * 100000000;
+        else
+            return (status & 0xFF) * 100000000;
+    else
+    {
+        LIBFREQGEN_SET_ERROR(
+            "could not read 8 bytes of data from msr file at offset IA32_PERF_STATUS (%d)",
+            IA32_PERF_STATUS);
+        return -EIO;
+    }
+}
+
 /* will write the frequency to the MSR */
 static int freq_gen_msr_set_frequency(freq_gen_single_device_t fp, freq_gen_setting_t setting_in)
 {
@@ -493,7 +596,7 @@ static long long int freq_gen_msr_get_frequency_uncore(freq_gen_single_device_t
     int result = pread(fp, &setting, 8, UNCORE_RATIO_LIMIT);
 
     if (result == 8)
-        return (setting & 0x77) * 100000000;
+        return (setting & 0x7F) * 100000000;
     else
     {
         LIBFREQGEN_SET_ERROR(
@@ -510,7 +613,7 @@ static long long int freq_gen_msr_get_min_frequency_uncore(freq_gen_single_devic
     int result = pread(fp, &setting, 8, UNCORE_RATIO_LIMIT);
 
     if (result == 8)
-        return ((setting << 8) & 0x77) * 100000000;
+        return ((setting >> 8) & 0x7F) * 100000000;
     else
     {
         LIBFREQGEN_SET_ERROR(
@@ -520,6 +623,85 @@ static long long int freq_gen_msr_get_min_frequency_uncore(freq_gen_single_devic
     }
 }
 
+/* will read the current uncore frequency from MSR_UNCORE_PERF_STATUS. If the register is not
+ * supported, uncore clockticks are counted via perf on the first cpu of the uncore
+ */
+static long long int freq_gen_msr_get_current_frequency_uncore(freq_gen_single_device_t fp)
+{
+    pthread_mutex_lock(&uncore_leaders_lock);
+    struct uncore_leader* leader = get_uncore_leader(fp);
+    if (leader == NULL)
+    {
+        pthread_mutex_unlock(&uncore_leaders_lock);
+        LIBFREQGEN_SET_ERROR("unknown uncore device (%d)", fp);
+        return -EINVAL;
+    }
+    if (leader->has_perf_status)
+    {
+        long long int setting = 0;
+        int result = pread(fp, &setting, 8, MSR_UNCORE_PERF_STATUS);
+        if (result == 8 && (setting & 0x7F) != 0)
+        {
+            pthread_mutex_unlock(&uncore_leaders_lock);
+            return (setting & 0x7F) * 100000000;
+        }
+        /* not supported on this processor, don't try again */
+        leader->has_perf_status = 0;
+    }
+    if (leader->perf_fd < 0)
+    {
+        leader->perf_fd = freq_gen_perf_open_uncore_clockticks(leader->cpu);
+        if (leader->perf_fd < 0)
+        {
+            int ret = leader->perf_fd;
+            LIBFREQGEN_APPEND_ERROR("could neither read MSR_UNCORE_PERF_STATUS (%d) nor count "
+                                    "uncore clockticks on cpu %d",
+                                    MSR_UNCORE_PERF_STATUS, leader->cpu);
+            leader->perf_fd = -1;
+            pthread_mutex_unlock(&uncore_leaders_lock);
+            return ret;
+        }
+    }
+    /* do not hold the lock during the measurement window, close_device waits for its end */
+    int perf_fd = leader->perf_fd;
+    leader->measuring++;
+    pthread_mutex_unlock(&uncore_leaders_lock);
+    long long int frequency = freq_gen_perf_measure_rate(perf_fd, UNCORE_CLOCK_WINDOW_NS);
+    pthread_mutex_lock(&uncore_leaders_lock);
+    /* entries may have moved, but this one is not removed while measuring */
+    leader = get_uncore_leader(fp);
+    if (--leader->measuring == 0)
+        pthread_cond_broadcast(&uncore_measurement_done);
+    pthread_mutex_unlock(&uncore_leaders_lock);
+    return frequency;
+}
+
+long long int freq_gen_msr_current_frequency_window(freq_gen_interface_t* interface,
+                                                    freq_gen_single_device_t fp)
+{
+    interface = freq_gen_instrument_unwrap(interface, NULL);
+    if (interface == &freq_gen_msr_cpu_interface)
+        return 0;
+    if (interface != &freq_gen_msr_uncore_interface)
+        return -ENOENT;
+    long long int window = UNCORE_CLOCK_WINDOW_NS;
+    pthread_mutex_lock(&uncore_leaders_lock);
+    struct uncore_leader* leader = get_uncore_leader(fp);
+    if (leader == NULL)
+        window = -EINVAL;
+    else if (leader->has_perf_status)
+    {
+        /* same check as in freq_gen_msr_get_current_frequency_uncore */
+        long long int setting = 0;
+        if (pread(fp, &setting, 8, MSR_UNCORE_PERF_STATUS) == 8 && (setting & 0x7F) != 0)
+            window = 0;
+        else
+            leader->has_perf_status = 0;
+    }
+    pthread_mutex_unlock(&uncore_leaders_lock);
+    return window;
+}
+
 /* will allocate a small datastructure, containing freq information for uncore min and max */
 static freq_gen_setting_t freq_gen_msr_prepare_access_uncore(long long target, int turbo)
 {
@@ -579,14 +761,97 @@ static void freq_gen_msr_unprepare_access(freq_gen_setting_t setting)
 }
 
 /* closes an open file descriptor */
-static void freq_gen_msr_close_file(freq_gen_single_device_t fd, int cpu)
+static void freq_gen_msr_close_file(int cpu, freq_gen_single_device_t fd)
 {
+    (void)cpu;
     close(fd);
 }
 
-/* no allocate variables :) nothing to do */
+/* closes an open file descriptor and the uncore clockticks counter, after running measurements */
+static void freq_gen_msr_close_file_uncore(int uncore, freq_gen_single_device_t fd)
+{
+    (void)uncore;
+    pthread_mutex_lock(&uncore_leaders_lock);
+    struct uncore_leader* leader = get_uncore_leader(fd);
+    /* perf_fd must stay open until running measurements are done */
+    while (leader != NULL && leader->measuring > 0)
+    {
+        pthread_cond_wait(&uncore_measurement_done, &uncore_leaders_lock);
+        leader = get_uncore_leader(fd);
+    }
+    if (leader != NULL)
+    {
+        if (leader->perf_fd >= 0)
+            close(leader->perf_fd);
+        *leader = uncore_leaders[nr_uncore_leaders - 1];
+        nr_uncore_leaders--;
+    }
+    pthread_mutex_unlock(&uncore_leaders_lock);
+    close(fd);
+}
+
+/* frees the uncore bookkeeping once all uncores are closed */
 static void freq_gen_msr_finalize()
 {
+    pthread_mutex_lock(&uncore_leaders_lock);
+    if (nr_uncore_leaders == 0)
+    {
+        free(uncore_leaders);
+        uncore_leaders = NULL;
+    }
+    pthread_mutex_unlock(&uncore_leaders_lock);
+}
+
+int freq_gen_msr_describe_set(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                              freq_gen_setting_t setting, bool min,
+                              struct freq_gen_raw_write* write)
+{
+    if (interface != &freq_gen_msr_cpu_interface && interface != &freq_gen_msr_uncore_interface)
+        return ENOENT;
+    /* there is no minimal core frequency */
+    if (min && interface == &freq_gen_msr_cpu_interface)
+        return ENOTSUP;
+    *write = (struct freq_gen_raw_write){
+        .fd = fp,
+        .length = 8,
+        .offset = interface == &freq_gen_msr_cpu_interface ? IA32_PERF_CTL : UNCORE_RATIO_LIMIT,
+        /* like freq_gen_msr_set_min_frequency_uncore */
+        .mask = min ? 0xFF00 : 0
+    };
+    memcpy(write->data, setting, 8);
+    return 0;
+}
+
+int freq_gen_msr_read_raw(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                          uint64_t* value)
+{
+    if (interface != &freq_gen_msr_cpu_interface && interface != &freq_gen_msr_uncore_interface)
+        return ENOENT;
+    off_t offset = interface == &freq_gen_msr_cpu_interface ? IA32_PERF_CTL : UNCORE_RATIO_LIMIT;
+    ssize_t result = pread(fp, value, 8, offset);
+    if (result != 8)
+    {
+        int ret = result < 0 ? errno : EIO;
+        LIBFREQGEN_SET_ERROR("could not read msr 0x%lx", (unsigned long)offset);
+        return ret;
+    }
+    return 0;
+}
+
+int freq_gen_msr_write_raw(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                           uint64_t value)
+{
+    if (interface != &freq_gen_msr_cpu_interface && interface != &freq_gen_msr_uncore_interface)
+        return ENOENT;
+    off_t offset = interface == &freq_gen_msr_cpu_interface ? IA32_PERF_CTL : UNCORE_RATIO_LIMIT;
+    ssize_t result = pwrite(fp, &value, 8, offset);
+    if (result != 8)
+    {
+        int ret = result < 0 ? errno : EIO;
+        LIBFREQGEN_SET_ERROR("could not write msr 0x%lx", (unsigned long)offset);
+        return ret;
+    }
+    return 0;
 }
 
 static freq_gen_interface_t freq_gen_msr_cpu_interface = {
@@ -600,7 +865,8 @@ static freq_gen_interface_t freq_gen_msr_cpu_interface = {
     .set_min_frequency = NULL,
     .unprepare_set_frequency = freq_gen_msr_unprepare_access,
     .close_device = freq_gen_msr_close_file,
-    .finalize = freq_gen_msr_finalize
+    .finalize = freq_gen_msr_finalize,
+    .get_current_frequency = freq_gen_msr_get_current_frequency
 };
 
 static freq_gen_interface_t freq_gen_msr_uncore_interface = {
@@ -613,8 +879,9 @@ static freq_gen_interface_t freq_gen_msr_uncore_interface = {
     .set_frequency = freq_gen_msr_set_frequency_uncore,
     .set_min_frequency = freq_gen_msr_set_min_frequency_uncore,
     .unprepare_set_frequency = freq_gen_msr_unprepare_access,
-    .close_device = freq_gen_msr_close_file,
-    .finalize = freq_gen_msr_finalize
+    .close_device = freq_gen_msr_close_file_uncore,
+    .finalize = freq_gen_msr_finalize,
+    .get_current_frequency = freq_gen_msr_get_current_frequency_uncore
 };
 
 freq_gen_interface_internal_t freq_gen_msr_interface_internal = {
@@ -0,0 +1,640 @@
+/*
+ * ompt.c
+ *
+ * An OMPT tool that applies the core and uncore frequencies of a tuning model (see freqgen_model.h)
+ * to OpenMP regions. Load it with OMP_TOOL_LIBRARIES=libfreqgen-ompt.so.
+ *
+ * Regions are parallel regions, worksharing constructs and synchronization regions. They are
+ * identified by the return address passed by the runtime (codeptr_ra), which is translated to
+ * "<object file>+0x<offset>" and, if the object file exports it, "<function>". Worksharing and
+ * synchronization regions get a suffix, e.g., ":loop" or ":barrier". The model is searched for
+ * the hash of the first and then the second name.
+ *
+ * Every thread binds the model to a session with the cpu it runs on, so core frequencies are set
+ * by the threads themselves. Uncore frequencies are set for all uncores by the thread that starts
+ * an outermost parallel region.
+ *
+ * Environment:
+ *   LIBFREQGEN_OMPT_MODEL     model file, without a model regions are only measured
+ *   LIBFREQGEN_OMPT_REPORT    write a per-region report to this file at exit, - for stderr
+ *
+ * Select the sim interface (LIBFREQGEN_CORE_INTERFACE=sim and LIBFREQGEN_UNCORE_INTERFACE=sim, see
+ * freqgen_sim.h) to test models without hardware, the report then includes the number of
+ * simulated frequency transitions.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <omp-tools.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/freqgen.h"
+#include "../include/freqgen_model.h"
+#include "../include/freqgen_session.h"
+#include "../include/freqgen_sim.h"
+#include "freq_gen_internal_perf.h"
+
+#define OMPT_MAX_REGIONS 4096
+#define OMPT_MAX_DEPTH 64
+#define OMPT_NAME_SIZE 256
+/* regions that spend more than this fraction in switches are marked in the report */
+#define OMPT_OVERHEAD_WARNING 0.05
+
+enum region_kind
+{
+    REGION_PARALLEL,
+    REGION_LOOP,
+    REGION_SECTIONS,
+    REGION_SINGLE,
+    REGION_WORKSHARE,
+    REGION_DISTRIBUTE,
+    REGION_TASKLOOP,
+    REGION_WORK,
+    REGION_BARRIER,
+    REGION_TASKWAIT,
+    REGION_TASKGROUP,
+    REGION_SYNC,
+    REGION_KIND_NUM
+};
+
+static const char* region_kind_names[REGION_KIND_NUM] = {
+    "", "loop", "sections", "single", "workshare", "distribute", "taskloop", "work", "barrier",
+    "taskwait", "taskgroup", "sync"
+};
+
+struct region
+{
+    const void* codeptr;
+    enum region_kind kind;
+    uint64_t id;
+    char name[OMPT_NAME_SIZE];
+    char symbol[OMPT_NAME_SIZE];
+    long long int core_frequency;
+    long long int uncore_frequency;
+    _Atomic uint64_t calls;
+    _Atomic uint64_t time_ns;   /**< time inside the region, summed over all threads */
+    _Atomic uint64_t switch_ns; /**< time needed to enter and exit the region */
+};
+
+struct region_slot
+{
+    _Atomic uintptr_t key; /**< (codeptr << 4) | kind, 0 if empty */
+    struct region* region;
+};
+
+struct stack_entry
+{
+    struct region* region;
+    uint64_t start;
+    uint64_t switch_ns;
+    bool applied;
+};
+
+struct ompt_thread
+{
+    int cpu;
+    freq_gen_session_t* session;
+    freq_gen_model_runtime_t* runtime;
+    struct stack_entry stack[OMPT_MAX_DEPTH];
+    int depth;
+    struct region* uncore_region; /**< outermost parallel region that set the uncores */
+    struct ompt_thread* next;
+};
+
+static freq_gen_model_t* model;
+static freq_gen_interface_t* interfaces[FREQ_GEN_DEVICE_NUM];
+static const char* report_path;
+
+static struct region_slot slots[OMPT_MAX_REGIONS];
+static struct region* regions;
+static int nr_regions;
+static pthread_mutex_t regions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static freq_gen_session_t* uncore_session;
+static freq_gen_model_runtime_t* uncore_runtime;
+static _Atomic(struct ompt_thread*) uncore_owner;
+
+static struct ompt_thread* threads;
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool finalized;
+static atomic_bool bind_failed;
+static __thread struct ompt_thread* local_thread;
+
+/* fills the names of a region and looks up its frequencies */
+static void init_region(struct region* region, const void* codeptr, enum region_kind kind)
+{
+    region->codeptr = codeptr;
+    region->kind = kind;
+    const char* separator = kind == REGION_PARALLEL ? "" : ":";
+    Dl_info info;
+    if (codeptr != NULL && dladdr(codeptr, &info) && info.dli_fname != NULL)
+    {
+        const char* file = strrchr(info.dli_fname, '/');
+        file = file ? file + 1 : info.dli_fname;
+        snprintf(region->name, OMPT_NAME_SIZE, "%s+0x%" PRIxPTR "%s%s", file,
+                 (uintptr_t)codeptr - (uintptr_t)info.dli_fbase, separator,
+                 region_kind_names[kind]);
+        if (info.dli_sname != NULL)
+            snprintf(region->symbol, OMPT_NAME_SIZE, "%s%s%s", info.dli_sname, separator,
+                     region_kind_names[kind]);
+    }
+    else
+        snprintf(region->name, OMPT_NAME_SIZE, "%p%s%s", codeptr, separator,
+                 region_kind_names[kind]);
+
+    region->id = freq_gen_region_hash(region->name);
+    region->core_frequency = FREQ_GEN_MODEL_KEEP;
+    region->uncore_frequency = FREQ_GEN_MODEL_KEEP;
+    if (model == NULL)
+        return;
+    if (freq_gen_model_lookup(model, region->id, &region->core_frequency,
+                              &region->uncore_frequency) == 0)
+        return;
+    if (region->symbol[0] != '\0')
+    {
+        uint64_t id = freq_gen_region_hash(region->symbol);
+        if (freq_gen_model_lookup(model, id, &region->core_frequency,
+                                  &region->uncore_frequency) == 0)
+            region->id = id;
+    }
+}
+
+/* returns the region of a construct, creates it on first use, NULL if the table is full */
+static struct region* find_region(const void* codeptr, enum region_kind kind)
+{
+    uintptr_t key = ((uintptr_t)codeptr << 4) | kind;
+    if (key == 0)
+        key = REGION_KIND_NUM;
+    uint32_t start = (key * 0x9e3779b97f4a7c15ULL) >> 52;
+    for (uint32_t i = 0; i < OMPT_MAX_REGIONS; i++)
+    {
+        struct region_slot* slot = &slots[(start + i) & (OMPT_MAX_REGIONS - 1)];
+        uintptr_t current = atomic_load_explicit(&slot->key, memory_order_acquire);
+        if (current == key)
+            return slot->region;
+        if (current != 0)
+            continue;
+
+        pthread_mutex_lock(&regions_lock);
+        current = atomic_load_explicit(&slot->key, memory_order_relaxed);
+        if (current == 0)
+        {
+            struct region* region = &regions[nr_regions++];
+            init_region(region, codeptr, kind);
+            slot->region = region;
+            atomic_store_explicit(&slot->key, key, memory_order_release);
+            current = key;
+        }
+        pthread_mutex_unlock(&regions_lock);
+        if (current == key)
+            return slot->region;
+    }
+    return NULL;
+}
+
+/* binds the model to the cpu the thread runs on, if it has changed */
+static void bind_cpu(struct ompt_thread* thread)
+{
+    int cpu = sched_getcpu();
+    if (cpu == thread->cpu)
+        return;
+    freq_gen_model_runtime_free(thread->runtime);
+    freq_gen_session_close(thread->session);
+    thread->runtime = NULL;
+    thread->session = NULL;
+    thread->cpu = cpu;
+    if (cpu < 0)
+        return;
+    thread->session = freq_gen_session_open(interfaces[FREQ_GEN_DEVICE_CORE_FREQ], &cpu, 1);
+    if (thread->session != NULL)
+        thread->runtime = freq_gen_model_bind(model, thread->session, NULL);
+    if (thread->runtime == NULL && !atomic_exchange(&bind_failed, true))
+        fprintf(stderr, "libfreqgen-ompt: could not set frequencies of cpu %d: %s\n", cpu,
+                freq_gen_error_string());
+}
+
+static struct ompt_thread* get_thread(void)
+{
+    if (local_thread != NULL)
+        return local_thread;
+    struct ompt_thread* thread = calloc(1, sizeof(struct ompt_thread));
+    if (thread == NULL)
+        return NULL;
+    thread->cpu = -1;
+    pthread_mutex_lock(&threads_lock);
+    thread->next = threads;
+    threads = thread;
+    pthread_mutex_unlock(&threads_lock);
+    local_thread = thread;
+    return thread;
+}
+
+static void free_thread(struct ompt_thread* thread)
+{
+    freq_gen_model_runtime_free(thread->runtime);
+    freq_gen_session_close(thread->session);
+    free(thread);
+}
+
+static void enter(struct ompt_thread* thread, struct region* region)
+{
+    if (thread == NULL || region == NULL || thread->depth == OMPT_MAX_DEPTH)
+        return;
+    uint64_t start = freq_gen_now_ns();
+    struct stack_entry* entry = &thread->stack[thread->depth++];
+    entry->region = region;
+    entry->applied = false;
+    if (region->core_frequency != FREQ_GEN_MODEL_KEEP &&
+        interfaces[FREQ_GEN_DEVICE_CORE_FREQ] != NULL)
+    {
+        /* rebinding resets the runtime, so only do it outside of all regions */
+        if (thread->depth == 1)
+            bind_cpu(thread);
+        if (thread->runtime != NULL)
+        {
+            freq_gen_model_enter_region(thread->runtime, region->id);
+            entry->applied = true;
+        }
+    }
+    entry->start = freq_gen_now_ns();
+    entry->switch_ns = entry->start - start;
+}
+
+/* exits all regions down to and including the innermost instance of region */
+static void leave(struct ompt_thread* thread, struct region* region)
+{
+    if (thread == NULL || region == NULL)
+        return;
+    int depth = thread->depth;
+    while (depth > 0 && thread->stack[depth - 1].region != region)
+        depth--;
+    /* e.g., the implicit barrier of a parallel region that ends after its implicit task */
+    if (depth == 0)
+        return;
+    while (thread->depth >= depth)
+    {
+        struct stack_entry* entry = &thread->stack[--thread->depth];
+        uint64_t start = freq_gen_now_ns();
+        if (entry->applied)
+            freq_gen_model_exit_region(thread->runtime, entry->region->id);
+        uint64_t end = freq_gen_now_ns();
+        atomic_fetch_add_explicit(&entry->region->calls, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&entry->region->time_ns, start - entry->start,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&entry->region->switch_ns, entry->switch_ns + end - start,
+                                  memory_order_relaxed);
+    }
+}
+
+/*
+ * enters or leaves a worksharing or synchronization region. Some runtimes pass no codeptr_ra,
+ * e.g., for implicit barriers, so such regions are attributed to the enclosing region.
+ * */
+static void enter_or_leave(ompt_scope_endpoint_t endpoint, const void* codeptr,
+                           enum region_kind kind)
+{
+    struct ompt_thread* thread = endpoint == ompt_scope_begin ? get_thread() : local_thread;
+    if (thread == NULL)
+        return;
+    if (codeptr == NULL && endpoint == ompt_scope_begin)
+        codeptr = thread->depth > 0 ? thread->stack[thread->depth - 1].region->codeptr : NULL;
+    else if (codeptr == NULL)
+    {
+        for (int depth = thread->depth; depth > 0; depth--)
+            if (thread->stack[depth - 1].region->kind == kind)
+            {
+                leave(thread, thread->stack[depth - 1].region);
+                break;
+            }
+        return;
+    }
+    struct region* region = find_region(codeptr, kind);
+    if (endpoint == ompt_scope_begin)
+        enter(thread, region);
+    else
+        leave(thread, region);
+}
+
+static void on_thread_begin(ompt_thread_t thread_type, ompt_data_t* thread_data)
+{
+    (void)thread_type;
+    thread_data->ptr = get_thread();
+}
+
+static void on_thread_end(ompt_data_t* thread_data)
+{
+    struct ompt_thread* thread = thread_data->ptr;
+    if (thread == NULL)
+        return;
+    pthread_mutex_lock(&threads_lock);
+    if (finalized)
+    {
+        pthread_mutex_unlock(&threads_lock);
+        return;
+    }
+    for (struct ompt_thread** current = &threads; *current != NULL; current = &(*current)->next)
+        if (*current == thread)
+        {
+            *current = thread->next;
+            break;
+        }
+    pthread_mutex_unlock(&threads_lock);
+    local_thread = NULL;
+    free_thread(thread);
+}
+
+static void on_parallel_begin(ompt_data_t* encountering_task_data,
+                              const ompt_frame_t* encountering_task_frame,
+                              ompt_data_t* parallel_data, unsigned int requested_parallelism,
+                              int flags, const void* codeptr_ra)
+{
+    (void)encountering_task_data;
+    (void)encountering_task_frame;
+    (void)requested_parallelism;
+    (void)flags;
+    struct region* region = find_region(codeptr_ra, REGION_PARALLEL);
+    parallel_data->ptr = region;
+    if (region == NULL || uncore_runtime == NULL ||
+        region->uncore_frequency == FREQ_GEN_MODEL_KEEP)
+        return;
+    struct ompt_thread* thread = get_thread();
+    struct ompt_thread* expected = NULL;
+    if (thread == NULL || thread->depth != 0 ||
+        !atomic_compare_exchange_strong(&uncore_owner, &expected, thread))
+        return;
+    uint64_t start = freq_gen_now_ns();
+    freq_gen_model_enter_region(uncore_runtime, region->id);
+    thread->uncore_region = region;
+    atomic_fetch_add_explicit(&region->switch_ns, freq_gen_now_ns() - start,
+                              memory_order_relaxed);
+}
+
+static void on_parallel_end(ompt_data_t* parallel_data, ompt_data_t* encountering_task_data,
+                            int flags, const void* codeptr_ra)
+{
+    (void)parallel_data;
+    (void)encountering_task_data;
+    (void)flags;
+    (void)codeptr_ra;
+    /* the implicit task of the encountering thread has ended, so only an outermost region has an
+     * empty stack */
+    struct ompt_thread* thread = local_thread;
+    if (thread == NULL || thread->uncore_region == NULL || thread->depth != 0)
+        return;
+    struct region* region = thread->uncore_region;
+    uint64_t start = freq_gen_now_ns();
+    freq_gen_model_exit_region(uncore_runtime, region->id);
+    thread->uncore_region = NULL;
+    atomic_store(&uncore_owner, NULL);
+    atomic_fetch_add_explicit(&region->switch_ns, freq_gen_now_ns() - start,
+                              memory_order_relaxed);
+}
+
+static void on_implicit_task(ompt_scope_endpoint_t endpoint, ompt_data_t* parallel_data,
+                             ompt_data_t* task_data, unsigned int actual_parallelism,
+                             unsigned int index, int flags)
+{
+    (void)actual_parallelism;
+    (void)index;
+    if (flags & ompt_task_initial)
+        return;
+    if (endpoint == ompt_scope_begin)
+    {
+        task_data->ptr = parallel_data->ptr;
+        enter(get_thread(), task_data->ptr);
+    }
+    else
+        leave(local_thread, task_data->ptr);
+}
+
+static void on_work(ompt_work_t wstype, ompt_scope_endpoint_t endpoint, ompt_data_t* parallel_data,
+                    ompt_data_t* task_data, uint64_t count, const void* codeptr_ra)
+{
+    (void)parallel_data;
+    (void)task_data;
+    (void)count;
+    enum region_kind kind;
+    switch (wstype)
+    {
+    case ompt_work_loop:
+        kind = REGION_LOOP;
+        break;
+    case ompt_work_sections:
+        kind = REGION_SECTIONS;
+        break;
+    case ompt_work_single_executor:
+    case ompt_work_single_other:
+        kind = REGION_SINGLE;
+        break;
+    case ompt_work_workshare:
+        kind = REGION_WORKSHARE;
+        break;
+    case ompt_work_distribute:
+        kind = REGION_DISTRIBUTE;
+        break;
+    case ompt_work_taskloop:
+        kind = REGION_TASKLOOP;
+        break;
+    default:
+        kind = REGION_WORK;
+    }
+    enter_or_leave(endpoint, codeptr_ra, kind);
+}
+
+static void on_sync_region(ompt_sync_region_t kind, ompt_scope_endpoint_t endpoint,
+                           ompt_data_t* parallel_data, ompt_data_t* task_data,
+                           const void* codeptr_ra)
+{
+    (void)parallel_data;
+    (void)task_data;
+    enum region_kind region_kind;
+    switch (kind)
+    {
+    case ompt_sync_region_taskwait:
+        region_kind = REGION_TASKWAIT;
+        break;
+    case ompt_sync_region_taskgroup:
+        region_kind = REGION_TASKGROUP;
+        break;
+    /* reductions are short and nested inside barriers */
+    case ompt_sync_region_reduction:
+        return;
+    case ompt_sync_region_barrier:
+    case ompt_sync_region_barrier_implicit:
+    case ompt_sync_region_barrier_explicit:
+    case ompt_sync_region_barrier_implementation:
+    case ompt_sync_region_barrier_implicit_workshare:
+    case ompt_sync_region_barrier_implicit_parallel:
+    case ompt_sync_region_barrier_teams:
+        region_kind = REGION_BARRIER;
+        break;
+    default:
+        region_kind = REGION_SYNC;
+    }
+    enter_or_leave(endpoint, codeptr_ra, region_kind);
+}
+
+static void print_frequency(FILE* file, long long int frequency)
+{
+    if (frequency == FREQ_GEN_MODEL_KEEP)
+        fprintf(file, " %8s", "-");
+    else
+        fprintf(file, " %8.3f", frequency / 1e9);
+}
+
+static int compare_time(const void* a, const void* b)
+{
+    uint64_t time_a = atomic_load(&(*(struct region* const*)a)->time_ns);
+    uint64_t time_b = atomic_load(&(*(struct region* const*)b)->time_ns);
+    return time_a < time_b ? 1 : time_a > time_b ? -1 : 0;
+}
+
+static void write_report(void)
+{
+    FILE* file = strcmp(report_path, "-") == 0 ? stderr : fopen(report_path, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "libfreqgen-ompt: could not write report to \"%s\": %s\n", report_path,
+                strerror(errno));
+        return;
+    }
+    struct region** sorted = malloc(nr_regions * sizeof(struct region*));
+    if (sorted == NULL)
+    {
+        if (file != stderr)
+            fclose(file);
+        return;
+    }
+    int nr_sorted = 0;
+    for (int i = 0; i < nr_regions; i++)
+        if (atomic_load(&regions[i].calls) > 0)
+            sorted[nr_sorted++] = &regions[i];
+    qsort(sorted, nr_sorted, sizeof(struct region*), compare_time);
+
+    fprintf(file, "%-40s %10s %12s %12s %12s %9s %8s %8s %s\n", "region", "calls", "time [ms]",
+            "mean [us]", "switch [us]", "overhead", "core", "uncore", "function");
+    for (int i = 0; i < nr_sorted; i++)
+    {
+        struct region* region = sorted[i];
+        uint64_t calls = atomic_load(&region->calls);
+        double time = atomic_load(&region->time_ns);
+        double switches = atomic_load(&region->switch_ns);
+        double overhead = time + switches > 0 ? switches / (time + switches) : 0;
+        fprintf(file, "%-40s %10" PRIu64 " %12.3f %12.3f %12.3f %8.2f%%", region->name, calls,
+                time / 1e6, time / calls / 1e3, switches / calls / 1e3, overhead * 100);
+        print_frequency(file, region->core_frequency);
+        print_frequency(file, region->uncore_frequency);
+        fprintf(file, " %s%s\n", region->symbol,
+                overhead > OMPT_OVERHEAD_WARNING &&
+                        (region->core_frequency != FREQ_GEN_MODEL_KEEP ||
+                         region->uncore_frequency != FREQ_GEN_MODEL_KEEP)
+                    ? " !"
+                    : "");
+    }
+    fprintf(file, "regions marked with ! spend more than %.0f%% of their time switching "
+                  "frequencies\n",
+            OMPT_OVERHEAD_WARNING * 100);
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        if (interfaces[type] != NULL && strcmp(interfaces[type]->name, "sim") == 0)
+            fprintf(file, "simulated %s frequency transitions: %" PRIu64 "\n",
+                    type == FREQ_GEN_DEVICE_CORE_FREQ ? "core" : "uncore",
+                    freq_gen_sim_get_transitions(type));
+    free(sorted);
+    if (file != stderr)
+        fclose(file);
+}
+
+static int initialize(ompt_function_lookup_t lookup, int initial_device_num, ompt_data_t* data)
+{
+    (void)initial_device_num;
+    (void)data;
+    regions = calloc(OMPT_MAX_REGIONS, sizeof(struct region));
+    if (regions == NULL)
+        return 0;
+
+    const char* model_path = getenv("LIBFREQGEN_OMPT_MODEL");
+    if (model_path != NULL)
+    {
+        model = freq_gen_model_open(model_path);
+        if (model == NULL)
+            fprintf(stderr, "libfreqgen-ompt: %s\n", freq_gen_error_string());
+    }
+    if (model != NULL)
+    {
+        for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        {
+            interfaces[type] = freq_gen_init(type);
+            if (interfaces[type] == NULL)
+                fprintf(stderr, "libfreqgen-ompt: %s frequencies are not changed: %s\n",
+                        type == FREQ_GEN_DEVICE_CORE_FREQ ? "core" : "uncore",
+                        freq_gen_error_string());
+        }
+        if (interfaces[FREQ_GEN_DEVICE_UNCORE_FREQ] != NULL)
+        {
+            uncore_session = freq_gen_session_open(interfaces[FREQ_GEN_DEVICE_UNCORE_FREQ], NULL, 0);
+            if (uncore_session != NULL)
+                uncore_runtime = freq_gen_model_bind(model, NULL, uncore_session);
+            if (uncore_runtime == NULL)
+                fprintf(stderr, "libfreqgen-ompt: uncore frequencies are not changed: %s\n",
+                        freq_gen_error_string());
+        }
+    }
+
+    ompt_set_callback_t set_callback = (ompt_set_callback_t)lookup("ompt_set_callback");
+    set_callback(ompt_callback_thread_begin, (ompt_callback_t)on_thread_begin);
+    set_callback(ompt_callback_thread_end, (ompt_callback_t)on_thread_end);
+    set_callback(ompt_callback_parallel_begin, (ompt_callback_t)on_parallel_begin);
+    set_callback(ompt_callback_parallel_end, (ompt_callback_t)on_parallel_end);
+    set_callback(ompt_callback_implicit_task, (ompt_callback_t)on_implicit_task);
+    set_callback(ompt_callback_work, (ompt_callback_t)on_work);
+    set_callback(ompt_callback_sync_region, (ompt_callback_t)on_sync_region);
+    return 1;
+}
+
+static void finalize(ompt_data_t* data)
+{
+    (void)data;
+    if (report_path != NULL)
+        write_report();
+
+    pthread_mutex_lock(&threads_lock);
+    finalized = true;
+    while (threads != NULL)
+    {
+        struct ompt_thread* thread = threads;
+        threads = thread->next;
+        free_thread(thread);
+    }
+    pthread_mutex_unlock(&threads_lock);
+    local_thread = NULL;
+
+    freq_gen_model_runtime_free(uncore_runtime);
+    freq_gen_session_close(uncore_session);
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        if (interfaces[type] != NULL)
+            interfaces[type]->finalize();
+    freq_gen_model_close(model);
+}
+
+ompt_start_tool_result_t* ompt_start_tool(unsigned int omp_version, const char* runtime_version)
+{
+    (void)omp_version;
+    (void)runtime_version;
+    static ompt_start_tool_result_t result = { .initialize = initialize, .finalize = finalize };
+    report_path = getenv("LIBFREQGEN_OMPT_REPORT");
+    if (report_path == NULL && getenv("LIBFREQGEN_OMPT_MODEL") == NULL)
+        return NULL;
+    return &result;
+}
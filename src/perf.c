@@ -0,0 +1,335 @@
+/*
+ * perf.c
+ *
+ * Implements opening perf_event counters that are described by the sysfs entries of a PMU, e.g.,
+ * /sys/bus/event_source/devices/uncore_clock/events/clockticks
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_perf.h"
+#include "freq_gen_internal_util.h"
+
+#define PMU_PATH "/sys/bus/event_source/devices"
+
+/* uncore PMUs that provide clockticks, tried in this order. If event is NULL, config is used */
+static const struct
+{
+    const char* pmu;
+    const char* event;
+    uint64_t config;
+} uncore_clock_candidates[] = {
+    /* client processors (Skylake and newer) */
+    { "uncore_clock", "clockticks", 0 },
+    /* server processors (Skylake-SP and newer): CHA clockticks */
+    { "uncore_cha_0", NULL, 0x00 },
+    /* server processors (Haswell-EP, Broadwell-EP): C-Box clockticks */
+    { "uncore_cbox_0", NULL, 0x00 },
+    /* U-Box fixed counter counts uncore clockticks */
+    { "uncore_ubox", NULL, 0xff },
+};
+
+/* read /sys/bus/event_source/devices/(pmu)/type */
+static int get_pmu_type(const char* pmu)
+{
+    char buffer[BUFFER_SIZE];
+    char content[64];
+    if (snprintf(buffer, BUFFER_SIZE, PMU_PATH "/%s/type", pmu) >= BUFFER_SIZE)
+        return -ENOMEM;
+    int ret = freq_gen_read_small_file(buffer, content, sizeof(content));
+    if (ret)
+        return -ret;
+    char* end;
+    long type = strtol(content, &end, 10);
+    if (end == content)
+        return -EINVAL;
+    return type;
+}
+
+/* read and write events of memory controllers, tried in this order */
+static const struct
+{
+    const char* read;
+    const char* write;
+} memory_traffic_candidates[] = {
+    /* server processors */
+    { "cas_count_read", "cas_count_write" },
+    /* client processors */
+    { "data_reads", "data_writes" },
+};
+
+/* applies value to config according to the format of a term, e.g., "config:0-7,21" */
+static int apply_format(const char* pmu, const char* term, uint64_t value, uint64_t* config)
+{
+    char buffer[BUFFER_SIZE];
+    char format[128];
+    if (snprintf(buffer, BUFFER_SIZE, PMU_PATH "/%s/format/%s", pmu, term) >= BUFFER_SIZE)
+        return -ENOMEM;
+    int ret = freq_gen_read_small_file(buffer, format, sizeof(format));
+    if (ret)
+        return -ret;
+    /* only config is supported, config1/config2 are not used by the events we open */
+    if (strncmp(format, "config:", 7) != 0)
+        return -EINVAL;
+
+    char* current = &format[7];
+    int value_bit = 0;
+    while (*current != '\0')
+    {
+        char* end;
+        long start_bit = strtol(current, &end, 10);
+        if (end == current)
+            return -EINVAL;
+        long end_bit = start_bit;
+        if (*end == '-')
+        {
+            current = end + 1;
+            end_bit = strtol(current, &end, 10);
+            if (end == current)
+                return -EINVAL;
+        }
+        for (long bit = start_bit; bit <= end_bit && bit < 64; bit++, value_bit++)
+            if (value & (1ULL << value_bit))
+                *config |= 1ULL << bit;
+        if (*end == ',')
+            end++;
+        current = end;
+    }
+    return 0;
+}
+
+/* parse an event description like "event=0x3c,umask=0x01" */
+static int parse_event(const char* pmu, char* description, uint64_t* config)
+{
+    char* saveptr;
+    *config = 0;
+    for (char* term = strtok_r(description, ",", &saveptr); term != NULL;
+         term = strtok_r(NULL, ",", &saveptr))
+    {
+        uint64_t value = 1;
+        char* equals = strchr(term, '=');
+        if (equals != NULL)
+        {
+            *equals = '\0';
+            value = strtoull(equals + 1, NULL, 0);
+        }
+        int ret = apply_format(pmu, term, value, config);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+static int perf_open(int type, uint64_t config, int cpu, int pid)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    int fd = syscall(__NR_perf_event_open, &attr, pid, cpu, -1, 0);
+    if (fd < 0)
+        return -errno;
+    return fd;
+}
+
+int freq_gen_perf_open_named(const char* pmu, const char* event, int cpu, int pid)
+{
+    char buffer[BUFFER_SIZE];
+    char description[256];
+    int type = get_pmu_type(pmu);
+    if (type < 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not read type of PMU \"%s\"", pmu);
+        return type;
+    }
+    if (snprintf(buffer, BUFFER_SIZE, PMU_PATH "/%s/events/%s", pmu, event) >= BUFFER_SIZE)
+    {
+        LIBFREQGEN_SET_ERROR("could not assemble event path, BUFFER_SIZE(%d) exceeded",
+                             BUFFER_SIZE);
+        return -ENOMEM;
+    }
+    int ret = freq_gen_read_small_file(buffer, description, sizeof(description));
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not read event description \"%s\"", buffer);
+        return -ret;
+    }
+    uint64_t config;
+    ret = parse_event(pmu, description, &config);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not parse event %s/%s", pmu, event);
+        return ret;
+    }
+    ret = perf_open(type, config, cpu, pid);
+    if (ret < 0)
+        LIBFREQGEN_SET_ERROR("perf_event_open failed for %s/%s on cpu %d, errno %d", pmu, event,
+                             cpu, -ret);
+    return ret;
+}
+
+int freq_gen_perf_open_raw(const char* pmu, uint64_t config, int cpu, int pid)
+{
+    int type = get_pmu_type(pmu);
+    if (type < 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not read type of PMU \"%s\"", pmu);
+        return type;
+    }
+    int ret = perf_open(type, config, cpu, pid);
+    if (ret < 0)
+        LIBFREQGEN_SET_ERROR("perf_event_open failed for %s/0x%llx on cpu %d, errno %d", pmu,
+                             (unsigned long long)config, cpu, -ret);
+    return ret;
+}
+
+int freq_gen_perf_open_hardware(uint64_t config, int cpu, int pid)
+{
+    int ret = perf_open(PERF_TYPE_HARDWARE, config, cpu, pid);
+    if (ret < 0)
+        LIBFREQGEN_SET_ERROR("perf_event_open failed for hardware event %llu on cpu %d, errno %d",
+                             (unsigned long long)config, cpu, -ret);
+    return ret;
+}
+
+int freq_gen_perf_open_uncore_clockticks(int cpu)
+{
+    int ret = -ENODEV;
+    for (size_t i = 0; i < sizeof(uncore_clock_candidates) / sizeof(uncore_clock_candidates[0]);
+         i++)
+    {
+        if (uncore_clock_candidates[i].event != NULL)
+            ret = freq_gen_perf_open_named(uncore_clock_candidates[i].pmu,
+                                           uncore_clock_candidates[i].event, cpu, -1);
+        else
+            ret = freq_gen_perf_open_raw(uncore_clock_candidates[i].pmu,
+                                         uncore_clock_candidates[i].config, cpu, -1);
+        if (ret >= 0)
+            return ret;
+    }
+    LIBFREQGEN_SET_ERROR("could not open an uncore clockticks counter for cpu %d", cpu);
+    return ret;
+}
+
+/* appends the read and write counters of a memory controller PMU to fds */
+static int open_memory_controller(const char* pmu, int cpu, int** fds, int nr_fds)
+{
+    for (size_t i = 0;
+         i < sizeof(memory_traffic_candidates) / sizeof(memory_traffic_candidates[0]); i++)
+    {
+        int read_fd = freq_gen_perf_open_named(pmu, memory_traffic_candidates[i].read, cpu, -1);
+        if (read_fd < 0)
+            continue;
+        int write_fd = freq_gen_perf_open_named(pmu, memory_traffic_candidates[i].write, cpu, -1);
+        if (write_fd < 0)
+        {
+            close(read_fd);
+            continue;
+        }
+        int* tmp = realloc(*fds, (nr_fds + 2) * sizeof(int));
+        if (tmp == NULL)
+        {
+            close(read_fd);
+            close(write_fd);
+            return -ENOMEM;
+        }
+        tmp[nr_fds] = read_fd;
+        tmp[nr_fds + 1] = write_fd;
+        *fds = tmp;
+        return 2;
+    }
+    return 0;
+}
+
+int freq_gen_perf_open_memory_traffic(int cpu, int** fds)
+{
+    DIR* dir = opendir(PMU_PATH);
+    if (dir == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\"", PMU_PATH);
+        return -errno;
+    }
+    *fds = NULL;
+    int nr_fds = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        /* free running counters cannot be opened per event */
+        if (strncmp(entry->d_name, "uncore_imc", 10) != 0 ||
+            strstr(entry->d_name, "free_running") != NULL)
+            continue;
+        int ret = open_memory_controller(entry->d_name, cpu, fds, nr_fds);
+        if (ret < 0)
+        {
+            for (int i = 0; i < nr_fds; i++)
+                close((*fds)[i]);
+            free(*fds);
+            *fds = NULL;
+            closedir(dir);
+            LIBFREQGEN_SET_ERROR("could not allocate memory for memory controller counters");
+            return ret;
+        }
+        nr_fds += ret;
+    }
+    closedir(dir);
+    if (nr_fds == 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not open memory controller counters for cpu %d", cpu);
+        return -ENODEV;
+    }
+    return nr_fds;
+}
+
+int freq_gen_perf_read(int fd, uint64_t* value)
+{
+    if (read(fd, value, sizeof(*value)) != sizeof(*value))
+    {
+        LIBFREQGEN_SET_ERROR("could not read perf counter (%d)", fd);
+        return -EIO;
+    }
+    return 0;
+}
+
+long long int freq_gen_perf_measure_rate(int fd, uint64_t window_ns)
+{
+    uint64_t start_value, end_value;
+    struct timespec window = { .tv_sec = window_ns / 1000000000ULL,
+                               .tv_nsec = window_ns % 1000000000ULL };
+
+    uint64_t start = freq_gen_now_ns();
+    if (freq_gen_perf_read(fd, &start_value))
+        return -EIO;
+    nanosleep(&window, NULL);
+    if (freq_gen_perf_read(fd, &end_value))
+        return -EIO;
+    uint64_t end = freq_gen_now_ns();
+
+    if (end <= start)
+        return -EINVAL;
+    return (long long int)((double)(end_value - start_value) * 1e9 / (double)(end - start));
+}
+
+uint64_t freq_gen_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
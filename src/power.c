@@ -0,0 +1,897 @@
+/*
+ * power.c
+ *
+ * Implements the power budget allocator, see freqgen_power.h. Cores and uncores are kept in one
+ * array of devices. For every device, raise_key is the ratio of utility gain to power cost of its
+ * next higher frequency and lower_key the ratio of its last step up. A max heap over raise_key
+ * yields the best device to raise, a min heap over lower_key the cheapest device to lower. As the
+ * power model is convex, the ratios of a device fall with its frequency, so taking the best raise
+ * and the worst lowering approximates the optimal allocation.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_power.h"
+#include "../include/freqgen_session.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_energy.h"
+#include "freq_gen_internal_perf.h"
+
+#define POWER_DEFAULT_STEP 100000000LL
+#define POWER_DEFAULT_STATIC 10.0
+#define POWER_DEFAULT_CORE_COEFFICIENT 0.5
+#define POWER_DEFAULT_UNCORE_COEFFICIENT 2.0
+#define POWER_DEFAULT_CALIBRATION_INTERVAL 100000000ULL
+#define POWER_DEFAULT_FORGETTING 0.98
+#define POWER_DEFAULT_HYSTERESIS 0.01
+#define POWER_DEFAULT_INTERVAL 1000000ULL
+/* initial uncertainty of the power model for recursive least squares */
+#define POWER_INITIAL_COVARIANCE 100.0
+/* lower bound of fitted coefficients, so that every frequency step has a cost */
+#define POWER_MIN_COEFFICIENT 1e-6
+/* relative change of a fitted coefficient that re-sorts all devices */
+#define POWER_REKEY_CHANGE 0.01
+
+/* parameters of the power model */
+enum power_parameter
+{
+    PARAMETER_STATIC,
+    PARAMETER_CORE,
+    PARAMETER_UNCORE,
+    NR_PARAMETERS
+};
+
+/* frequencies of a device type */
+struct frequency_grid
+{
+    long long int min_frequency;
+    long long int max_frequency;
+    long long int step;
+    int nr_levels;
+    double* cubes; /**< (frequency in GHz)^3 per level */
+};
+
+struct allocated_device
+{
+    int nr; /**< device number */
+    freq_gen_dev_type type;
+    int index;   /**< index in the session of its type */
+    int package; /**< index in packages */
+    _Atomic double utility;
+    double used_utility; /**< utility the keys have been computed with */
+    int level;
+    atomic_int applied_level; /**< level for freq_gen_power_get_frequency() */
+    double raise_key;
+    double lower_key;
+    int raise_position; /**< position in the raise heap */
+    int lower_position; /**< position in the lower heap */
+
+    /* C0 residency of cores, -1 if not measured */
+    int mperf_fd;
+    int tsc_fd;
+    uint64_t last_mperf;
+    uint64_t last_tsc;
+    bool has_last;
+    double activity;
+};
+
+struct allocated_package
+{
+    int nr;        /**< package number */
+    freq_gen_energy_t energy; /**< RAPL zones of the package, unused if measure is set */
+    double last_energy;
+    bool has_energy;
+    /* time-weighted features of the power model since the last calibration sample */
+    double core_feature;
+    double uncore_feature;
+};
+
+/* an indexed binary heap of devices, ordered by one of their keys */
+struct device_heap
+{
+    int* items;
+    int size;
+    bool max; /**< max heap over raise_key or min heap over lower_key */
+};
+
+struct freq_gen_power_s
+{
+    freq_gen_power_config_t config;
+    freq_gen_session_t* sessions[FREQ_GEN_DEVICE_NUM];
+    struct frequency_grid grids[FREQ_GEN_DEVICE_NUM];
+    long long int* targets[FREQ_GEN_DEVICE_NUM]; /**< per session device, for bulk writes */
+    struct allocated_device* devices;
+    int nr_devices;
+    struct allocated_package* packages;
+    int nr_packages;
+
+    struct device_heap raise_heap;
+    struct device_heap lower_heap;
+
+    /* power model, written by the thread that calls step */
+    double parameters[NR_PARAMETERS];
+    double covariance[NR_PARAMETERS][NR_PARAMETERS];
+    double estimated_power;
+    uint64_t last_now;
+    uint64_t last_calibration;
+    bool rekey_all;
+    bool write_all; /**< a bulk write failed, write all devices in the next round */
+
+    _Atomic double budget;
+
+    pthread_t thread;
+    bool running;
+    atomic_bool stop;
+
+    /* protects state and stats */
+    pthread_mutex_t lock;
+    freq_gen_power_state_t state;
+    freq_gen_power_stats_t stats;
+    uint64_t total_ns;
+};
+
+static long long int frequency_of(const struct frequency_grid* grid, int level)
+{
+    long long int frequency = grid->min_frequency + level * grid->step;
+    return frequency > grid->max_frequency ? grid->max_frequency : frequency;
+}
+
+static double coefficient_of(freq_gen_power_t* power, const struct allocated_device* device)
+{
+    return device->type == FREQ_GEN_DEVICE_CORE_FREQ ? power->parameters[PARAMETER_CORE]
+                                                     : power->parameters[PARAMETER_UNCORE];
+}
+
+static double power_of(freq_gen_power_t* power, const struct allocated_device* device, int level)
+{
+    return coefficient_of(power, device) * power->grids[device->type].cubes[level];
+}
+
+/* utility gain per W when going from level to level + 1 */
+static double ratio_of(freq_gen_power_t* power, const struct allocated_device* device, int level)
+{
+    const struct frequency_grid* grid = &power->grids[device->type];
+    double gain = device->used_utility *
+                  (frequency_of(grid, level + 1) - frequency_of(grid, level)) / 1e9;
+    double cost = power_of(power, device, level + 1) - power_of(power, device, level);
+    return cost > 0 ? gain / cost : INFINITY;
+}
+
+static void update_keys(freq_gen_power_t* power, struct allocated_device* device)
+{
+    int nr_levels = power->grids[device->type].nr_levels;
+    /* devices without utility are never raised, so the budget is not wasted */
+    if (device->level + 1 < nr_levels && device->used_utility > 0)
+        device->raise_key = ratio_of(power, device, device->level);
+    else
+        device->raise_key = -1;
+    device->lower_key = device->level > 0 ? ratio_of(power, device, device->level - 1) : INFINITY;
+}
+
+/* heap helpers, positions are stored in the devices */
+
+static double heap_key(freq_gen_power_t* power, const struct device_heap* heap, int item)
+{
+    return heap->max ? power->devices[item].raise_key : power->devices[item].lower_key;
+}
+
+static bool heap_before(freq_gen_power_t* power, const struct device_heap* heap, int a, int b)
+{
+    double key_a = heap_key(power, heap, a);
+    double key_b = heap_key(power, heap, b);
+    return heap->max ? key_a > key_b : key_a < key_b;
+}
+
+static void heap_place(freq_gen_power_t* power, struct device_heap* heap, int position, int item)
+{
+    heap->items[position] = item;
+    if (heap->max)
+        power->devices[item].raise_position = position;
+    else
+        power->devices[item].lower_position = position;
+}
+
+static void heap_update(freq_gen_power_t* power, struct device_heap* heap, int position)
+{
+    int item = heap->items[position];
+    while (position > 0)
+    {
+        int parent = (position - 1) / 2;
+        if (!heap_before(power, heap, item, heap->items[parent]))
+            break;
+        heap_place(power, heap, position, heap->items[parent]);
+        position = parent;
+    }
+    for (;;)
+    {
+        int child = 2 * position + 1;
+        if (child >= heap->size)
+            break;
+        if (child + 1 < heap->size && heap_before(power, heap, heap->items[child + 1],
+                                                  heap->items[child]))
+            child++;
+        if (!heap_before(power, heap, heap->items[child], item))
+            break;
+        heap_place(power, heap, position, heap->items[child]);
+        position = child;
+    }
+    heap_place(power, heap, position, item);
+}
+
+static void heap_build(freq_gen_power_t* power, struct device_heap* heap)
+{
+    for (int i = 0; i < heap->size; i++)
+        heap_place(power, heap, i, i);
+    for (int i = heap->size / 2 - 1; i >= 0; i--)
+        heap_update(power, heap, i);
+}
+
+/* changes the level of a device and re-sorts it in both heaps */
+static void move_device(freq_gen_power_t* power, int item, int delta)
+{
+    struct allocated_device* device = &power->devices[item];
+    power->estimated_power -= power_of(power, device, device->level);
+    device->level += delta;
+    power->estimated_power += power_of(power, device, device->level);
+    update_keys(power, device);
+    heap_update(power, &power->raise_heap, device->raise_position);
+    heap_update(power, &power->lower_heap, device->lower_position);
+}
+
+static double raise_cost(freq_gen_power_t* power, int item)
+{
+    struct allocated_device* device = &power->devices[item];
+    return power_of(power, device, device->level + 1) - power_of(power, device, device->level);
+}
+
+static double lower_saving(freq_gen_power_t* power, int item)
+{
+    struct allocated_device* device = &power->devices[item];
+    return power_of(power, device, device->level) - power_of(power, device, device->level - 1);
+}
+
+/* moves devices until the allocation fits the budget and no exchange improves it
+ * returns the number of moves */
+static uint64_t rebalance(freq_gen_power_t* power, double budget)
+{
+    uint64_t moves = 0;
+    /* bounds the number of exchanges, every device can go through its grid twice */
+    uint64_t limit = 2 * (uint64_t)power->nr_devices *
+                     (power->grids[FREQ_GEN_DEVICE_CORE_FREQ].nr_levels +
+                      power->grids[FREQ_GEN_DEVICE_UNCORE_FREQ].nr_levels);
+    /* devices whose utility dropped to 0 go back to their minimal frequency */
+    while (power->devices[power->lower_heap.items[0]].lower_key <= 0 ||
+           (power->estimated_power > budget &&
+            power->devices[power->lower_heap.items[0]].lower_key != INFINITY))
+    {
+        move_device(power, power->lower_heap.items[0], -1);
+        moves++;
+    }
+    while (moves < limit)
+    {
+        int best = power->raise_heap.items[0];
+        if (power->devices[best].raise_key <= 0)
+            break;
+        double cost = raise_cost(power, best);
+        if (power->estimated_power + cost <= budget)
+        {
+            move_device(power, best, 1);
+            moves++;
+            continue;
+        }
+        /* exchange a step of the worst device for a step of the best one */
+        int worst = power->lower_heap.items[0];
+        if (worst == best || power->devices[worst].lower_key >= power->devices[best].raise_key ||
+            power->estimated_power - lower_saving(power, worst) + cost > budget)
+            break;
+        move_device(power, worst, -1);
+        move_device(power, best, 1);
+        moves += 2;
+    }
+    return moves;
+}
+
+/* reads the C0 residency of a core since the last round */
+static void measure_activity(struct allocated_device* device)
+{
+    uint64_t mperf, tsc;
+    if (device->mperf_fd < 0 || freq_gen_perf_read(device->mperf_fd, &mperf) ||
+        freq_gen_perf_read(device->tsc_fd, &tsc))
+        return;
+    if (device->has_last && tsc != device->last_tsc)
+    {
+        double activity = (double)(mperf - device->last_mperf) / (tsc - device->last_tsc);
+        device->activity = activity > 1 ? 1 : activity;
+    }
+    device->last_mperf = mperf;
+    device->last_tsc = tsc;
+    device->has_last = true;
+}
+
+static int read_energy(freq_gen_power_t* power, struct allocated_package* package, double* joules)
+{
+    if (power->config.measure != NULL)
+        return power->config.measure(package->nr, joules, power->config.measure_data);
+    return freq_gen_energy_read(&package->energy, joules, NULL);
+}
+
+/* recursive least squares update of the power model with a sample of a package */
+static void fit_sample(freq_gen_power_t* power, const double x[NR_PARAMETERS], double y)
+{
+    double lambda = power->config.forgetting;
+    double px[NR_PARAMETERS] = { 0 };
+    for (int i = 0; i < NR_PARAMETERS; i++)
+        for (int j = 0; j < NR_PARAMETERS; j++)
+            px[i] += power->covariance[i][j] * x[j];
+    double denominator = lambda;
+    double prediction = 0;
+    for (int i = 0; i < NR_PARAMETERS; i++)
+    {
+        denominator += x[i] * px[i];
+        prediction += x[i] * power->parameters[i];
+    }
+    double gain[NR_PARAMETERS];
+    for (int i = 0; i < NR_PARAMETERS; i++)
+        gain[i] = px[i] / denominator;
+    for (int i = 0; i < NR_PARAMETERS; i++)
+        power->parameters[i] += gain[i] * (y - prediction);
+    /* P = (P - gain * (P x)^T) / lambda, P is symmetric */
+    for (int i = 0; i < NR_PARAMETERS; i++)
+        for (int j = 0; j < NR_PARAMETERS; j++)
+            power->covariance[i][j] = (power->covariance[i][j] - gain[i] * px[j]) / lambda;
+    if (power->parameters[PARAMETER_STATIC] < 0)
+        power->parameters[PARAMETER_STATIC] = 0;
+    if (power->parameters[PARAMETER_CORE] < POWER_MIN_COEFFICIENT)
+        power->parameters[PARAMETER_CORE] = POWER_MIN_COEFFICIENT;
+    if (power->parameters[PARAMETER_UNCORE] < POWER_MIN_COEFFICIENT)
+        power->parameters[PARAMETER_UNCORE] = POWER_MIN_COEFFICIENT;
+}
+
+/* adds a sample per package to the power model, returns the measured power of all packages */
+static double calibrate(freq_gen_power_t* power, uint64_t now, bool* rekey)
+{
+    double interval = (now - power->last_calibration) / 1e9;
+    double old_core = power->parameters[PARAMETER_CORE];
+    double old_uncore = power->parameters[PARAMETER_UNCORE];
+    double measured = 0;
+    for (int i = 0; i < power->nr_packages; i++)
+    {
+        struct allocated_package* package = &power->packages[i];
+        double joules;
+        if (read_energy(power, package, &joules))
+        {
+            pthread_mutex_lock(&power->lock);
+            power->stats.errors++;
+            pthread_mutex_unlock(&power->lock);
+            package->has_energy = false;
+            continue;
+        }
+        double consumed = joules - package->last_energy;
+        if (package->has_energy && interval > 0 && consumed >= 0)
+        {
+            double x[NR_PARAMETERS] = { 1, package->core_feature / interval,
+                                        package->uncore_feature / interval };
+            fit_sample(power, x, consumed / interval);
+            measured += consumed / interval;
+        }
+        package->last_energy = joules;
+        package->has_energy = true;
+        package->core_feature = package->uncore_feature = 0;
+    }
+    power->last_calibration = now;
+    *rekey = fabs(power->parameters[PARAMETER_CORE] - old_core) > POWER_REKEY_CHANGE * old_core ||
+             fabs(power->parameters[PARAMETER_UNCORE] - old_uncore) >
+                 POWER_REKEY_CHANGE * old_uncore;
+    return measured;
+}
+
+/* recomputes the estimated power and all keys after the power model changed */
+static void rekey_all(freq_gen_power_t* power)
+{
+    power->estimated_power = power->parameters[PARAMETER_STATIC] * power->nr_packages;
+    for (int i = 0; i < power->nr_devices; i++)
+    {
+        power->estimated_power += power_of(power, &power->devices[i], power->devices[i].level);
+        update_keys(power, &power->devices[i]);
+    }
+    heap_build(power, &power->raise_heap);
+    heap_build(power, &power->lower_heap);
+}
+
+int freq_gen_power_step(freq_gen_power_t* power, uint64_t now)
+{
+    uint64_t start = freq_gen_now_ns();
+    double interval = power->last_now != 0 && now > power->last_now
+                          ? (now - power->last_now) / 1e9
+                          : 0;
+    power->last_now = now;
+    double hysteresis = power->config.utility_hysteresis;
+    uint64_t updates = 0;
+    bool rekey = power->rekey_all;
+
+    /* inputs and calibration features for the frequencies of the last interval */
+    for (int i = 0; i < power->nr_devices; i++)
+    {
+        struct allocated_device* device = &power->devices[i];
+        double utility = atomic_load_explicit(&device->utility, memory_order_relaxed);
+        if (device->mperf_fd >= 0)
+        {
+            measure_activity(device);
+            if (power->config.counter_utilities)
+                utility = device->activity;
+        }
+        double cube = power->grids[device->type].cubes[device->level];
+        if (device->type == FREQ_GEN_DEVICE_CORE_FREQ)
+            power->packages[device->package].core_feature += device->activity * cube * interval;
+        else
+            power->packages[device->package].uncore_feature += cube * interval;
+        if (fabs(utility - device->used_utility) > hysteresis ||
+            (utility == 0) != (device->used_utility == 0))
+        {
+            device->used_utility = utility;
+            updates++;
+            if (!rekey)
+            {
+                update_keys(power, device);
+                heap_update(power, &power->raise_heap, device->raise_position);
+                heap_update(power, &power->lower_heap, device->lower_position);
+            }
+        }
+    }
+
+    double measured = -1;
+    if (power->config.calibrate &&
+        now - power->last_calibration >= power->config.calibration_interval_ns)
+    {
+        bool changed;
+        measured = calibrate(power, now, &changed);
+        rekey = rekey || changed;
+    }
+    if (rekey)
+        rekey_all(power);
+    power->rekey_all = false;
+
+    double budget = atomic_load_explicit(&power->budget, memory_order_relaxed);
+    uint64_t moves = rebalance(power, budget);
+
+    /* apply changed levels with bulk writes */
+    int changes = 0;
+    int error = 0;
+    for (int i = 0; i < power->nr_devices; i++)
+    {
+        struct allocated_device* device = &power->devices[i];
+        if (device->level != atomic_load_explicit(&device->applied_level, memory_order_relaxed))
+        {
+            atomic_store_explicit(&device->applied_level, device->level, memory_order_relaxed);
+            changes++;
+        }
+        power->targets[device->type][device->index] =
+            frequency_of(&power->grids[device->type], device->level);
+    }
+    uint64_t errors = 0;
+    bool write_all = false;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM && (changes > 0 || power->write_all); type++)
+    {
+        if (power->sessions[type] == NULL)
+            continue;
+        int ret = freq_gen_session_set_frequency(power->sessions[type], power->targets[type]);
+        if (ret)
+        {
+            /* write all devices in the next round */
+            freq_gen_session_invalidate(power->sessions[type]);
+            write_all = true;
+            errors++;
+            error = ret;
+        }
+    }
+
+    power->write_all = write_all;
+
+    uint64_t duration = freq_gen_now_ns() - start;
+    pthread_mutex_lock(&power->lock);
+    power->state.budget = budget;
+    power->state.estimated_power = power->estimated_power;
+    if (measured >= 0)
+    {
+        power->state.measured_power = measured;
+        power->stats.calibrations++;
+    }
+    power->state.static_power = power->parameters[PARAMETER_STATIC];
+    power->state.core_coefficient = power->parameters[PARAMETER_CORE];
+    power->state.uncore_coefficient = power->parameters[PARAMETER_UNCORE];
+    power->state.over_budget = power->estimated_power > budget;
+    power->stats.rounds++;
+    power->stats.updates += updates;
+    power->stats.moves += moves;
+    power->stats.changes += changes;
+    power->stats.errors += errors;
+    power->total_ns += duration;
+    if (duration > power->stats.max_ns_per_round)
+        power->stats.max_ns_per_round = duration;
+    pthread_mutex_unlock(&power->lock);
+    return error ? -error : changes;
+}
+
+static void* power_thread(void* arg)
+{
+    freq_gen_power_t* power = arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load_explicit(&power->stop, memory_order_relaxed))
+    {
+        freq_gen_power_step(power, freq_gen_now_ns());
+        next.tv_nsec += power->config.interval_ns;
+        while (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+int freq_gen_power_start(freq_gen_power_t* power)
+{
+    if (power->running)
+    {
+        LIBFREQGEN_SET_ERROR("power allocator is already running");
+        return EBUSY;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (power->config.cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(power->config.cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    atomic_store(&power->stop, false);
+    int ret = pthread_create(&power->thread, &attr, power_thread, power);
+    pthread_attr_destroy(&attr);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create power allocator thread (pinned to cpu %d)",
+                             power->config.cpu);
+        return ret;
+    }
+    power->running = true;
+    return 0;
+}
+
+int freq_gen_power_stop(freq_gen_power_t* power)
+{
+    if (!power->running)
+        return 0;
+    atomic_store(&power->stop, true);
+    int ret = pthread_join(power->thread, NULL);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not join power allocator thread");
+        return ret;
+    }
+    power->running = false;
+    return 0;
+}
+
+static struct allocated_device* find_device(freq_gen_power_t* power, freq_gen_dev_type type,
+                                            int nr)
+{
+    for (int i = 0; i < power->nr_devices; i++)
+        if (power->devices[i].type == type && power->devices[i].nr == nr)
+            return &power->devices[i];
+    return NULL;
+}
+
+void freq_gen_power_set_budget(freq_gen_power_t* power, double watts)
+{
+    atomic_store_explicit(&power->budget, watts, memory_order_relaxed);
+}
+
+int freq_gen_power_set_utility(freq_gen_power_t* power, freq_gen_dev_type type, int device,
+                               double utility)
+{
+    struct allocated_device* allocated = find_device(power, type, device);
+    if (allocated == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("device %d is not allocated", device);
+        return ENODEV;
+    }
+    if (!(utility >= 0))
+    {
+        LIBFREQGEN_SET_ERROR("invalid utility %f", utility);
+        return EINVAL;
+    }
+    atomic_store_explicit(&allocated->utility, utility, memory_order_relaxed);
+    return 0;
+}
+
+long long int freq_gen_power_get_frequency(freq_gen_power_t* power, freq_gen_dev_type type,
+                                           int device)
+{
+    struct allocated_device* allocated = find_device(power, type, device);
+    if (allocated == NULL)
+        return -ENODEV;
+    return frequency_of(&power->grids[type],
+                        atomic_load_explicit(&allocated->applied_level, memory_order_relaxed));
+}
+
+void freq_gen_power_get_state(freq_gen_power_t* power, freq_gen_power_state_t* state)
+{
+    pthread_mutex_lock(&power->lock);
+    *state = power->state;
+    pthread_mutex_unlock(&power->lock);
+}
+
+void freq_gen_power_get_stats(freq_gen_power_t* power, freq_gen_power_stats_t* stats)
+{
+    pthread_mutex_lock(&power->lock);
+    *stats = power->stats;
+    stats->ns_per_round = stats->rounds ? (double)power->total_ns / stats->rounds : 0.0;
+    pthread_mutex_unlock(&power->lock);
+}
+
+static int init_grid(struct frequency_grid* grid, long long int min_frequency,
+                     long long int max_frequency, long long int step)
+{
+    if (min_frequency <= 0 || max_frequency < min_frequency)
+    {
+        LIBFREQGEN_SET_ERROR("invalid frequency range %lld - %lld Hz", min_frequency,
+                             max_frequency);
+        return EINVAL;
+    }
+    grid->min_frequency = min_frequency;
+    grid->max_frequency = max_frequency;
+    grid->step = step > 0 ? step : POWER_DEFAULT_STEP;
+    /* the last level is max_frequency, even if it is not on the grid */
+    grid->nr_levels = (max_frequency - min_frequency + grid->step - 1) / grid->step + 1;
+    grid->cubes = malloc(grid->nr_levels * sizeof(double));
+    if (grid->cubes == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d frequencies", grid->nr_levels);
+        return ENOMEM;
+    }
+    for (int i = 0; i < grid->nr_levels; i++)
+    {
+        double ghz = frequency_of(grid, i) / 1e9;
+        grid->cubes[i] = ghz * ghz * ghz;
+    }
+    return 0;
+}
+
+static int get_package_of_cpu(int cpu)
+{
+    char path[BUFFER_SIZE];
+    snprintf(path, BUFFER_SIZE, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    FILE* file = fopen(path, "r");
+    int package;
+    if (file == NULL)
+        return -errno;
+    int ret = fscanf(file, "%d", &package);
+    fclose(file);
+    return ret == 1 ? package : -EIO;
+}
+
+/* returns the index of a package in packages, adds it if it is new */
+static int add_package(freq_gen_power_t* power, int nr)
+{
+    for (int i = 0; i < power->nr_packages; i++)
+        if (power->packages[i].nr == nr)
+            return i;
+    struct allocated_package* packages =
+        realloc(power->packages, (power->nr_packages + 1) * sizeof(struct allocated_package));
+    if (packages == NULL)
+        return -ENOMEM;
+    power->packages = packages;
+    packages[power->nr_packages] = (struct allocated_package){ .nr = nr };
+    return power->nr_packages++;
+}
+
+/* opens a session and adds its devices, returns 0 or an error */
+static int add_devices(freq_gen_power_t* power, freq_gen_dev_type type,
+                       freq_gen_interface_t* interface, const int* numbers, int nr_numbers)
+{
+    freq_gen_session_t* session = freq_gen_session_open(interface, numbers, nr_numbers);
+    if (session == NULL)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not open devices of %s", interface->name);
+        return EIO;
+    }
+    power->sessions[type] = session;
+    int nr = freq_gen_session_get_num_devices(session);
+    const int* opened = freq_gen_session_get_devices(session);
+    power->targets[type] = malloc(nr * sizeof(long long int));
+    struct allocated_device* devices =
+        realloc(power->devices, (power->nr_devices + nr) * sizeof(struct allocated_device));
+    if (power->targets[type] == NULL || devices == NULL)
+    {
+        if (devices != NULL)
+            power->devices = devices;
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", nr);
+        return ENOMEM;
+    }
+    power->devices = devices;
+    for (int i = 0; i < nr; i++)
+    {
+        int package_nr = opened[i];
+        if (type == FREQ_GEN_DEVICE_CORE_FREQ)
+        {
+            /* core_packages follows the config, the session may have skipped devices */
+            package_nr = -ENOENT;
+            for (int j = 0; j < nr_numbers && numbers != NULL && power->config.core_packages; j++)
+                if (numbers[j] == opened[i])
+                    package_nr = power->config.core_packages[j];
+            if (numbers == NULL && power->config.core_packages)
+                package_nr = power->config.core_packages[opened[i]];
+            if (package_nr < 0)
+                package_nr = get_package_of_cpu(opened[i]);
+            if (package_nr < 0)
+            {
+                LIBFREQGEN_SET_ERROR("could not get the package of cpu %d", opened[i]);
+                return -package_nr;
+            }
+        }
+        int package = add_package(power, package_nr);
+        if (package < 0)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for packages");
+            return -package;
+        }
+        struct allocated_device* device = &power->devices[power->nr_devices++];
+        *device = (struct allocated_device){ .nr = opened[i],
+                                             .type = type,
+                                             .index = i,
+                                             .package = package,
+                                             .mperf_fd = -1,
+                                             .tsc_fd = -1,
+                                             .activity = 1.0 };
+        atomic_init(&device->utility, 0.0);
+        /* nothing has been applied yet, so the first round writes all devices */
+        atomic_init(&device->applied_level, -1);
+        if (type == FREQ_GEN_DEVICE_CORE_FREQ)
+        {
+            device->mperf_fd = freq_gen_perf_open_named("msr", "mperf", opened[i], -1);
+            device->tsc_fd = freq_gen_perf_open_named("msr", "tsc", opened[i], -1);
+            if (device->mperf_fd < 0 || device->tsc_fd < 0)
+            {
+                if (device->mperf_fd >= 0)
+                    close(device->mperf_fd);
+                if (device->tsc_fd >= 0)
+                    close(device->tsc_fd);
+                device->mperf_fd = device->tsc_fd = -1;
+            }
+        }
+    }
+    return 0;
+}
+
+freq_gen_power_t* freq_gen_power_create(const freq_gen_power_config_t* config)
+{
+    if (config == NULL || config->core_interface == NULL || config->budget <= 0 ||
+        config->forgetting < 0 || config->forgetting > 1)
+    {
+        LIBFREQGEN_SET_ERROR("invalid power allocator configuration");
+        return NULL;
+    }
+    freq_gen_power_t* power = calloc(1, sizeof(freq_gen_power_t));
+    if (power == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for the power allocator",
+                             sizeof(freq_gen_power_t));
+        return NULL;
+    }
+    power->config = *config;
+    power->config.cores = NULL;
+    power->config.uncores = NULL;
+    if (power->config.calibration_interval_ns == 0)
+        power->config.calibration_interval_ns = POWER_DEFAULT_CALIBRATION_INTERVAL;
+    if (power->config.forgetting == 0)
+        power->config.forgetting = POWER_DEFAULT_FORGETTING;
+    if (power->config.utility_hysteresis == 0)
+        power->config.utility_hysteresis = POWER_DEFAULT_HYSTERESIS;
+    if (power->config.interval_ns == 0)
+        power->config.interval_ns = POWER_DEFAULT_INTERVAL;
+    power->parameters[PARAMETER_STATIC] =
+        config->static_power > 0 ? config->static_power : POWER_DEFAULT_STATIC;
+    power->parameters[PARAMETER_CORE] =
+        config->core_coefficient > 0 ? config->core_coefficient : POWER_DEFAULT_CORE_COEFFICIENT;
+    power->parameters[PARAMETER_UNCORE] = config->uncore_coefficient > 0
+                                              ? config->uncore_coefficient
+                                              : POWER_DEFAULT_UNCORE_COEFFICIENT;
+    for (int i = 0; i < NR_PARAMETERS; i++)
+        power->covariance[i][i] = POWER_INITIAL_COVARIANCE;
+    atomic_init(&power->budget, config->budget);
+    atomic_init(&power->stop, false);
+    pthread_mutex_init(&power->lock, NULL);
+
+    /* core_packages is only used while adding devices */
+    int ret = init_grid(&power->grids[FREQ_GEN_DEVICE_CORE_FREQ], config->core_min_frequency,
+                        config->core_max_frequency, config->core_step);
+    if (ret == 0)
+        ret = add_devices(power, FREQ_GEN_DEVICE_CORE_FREQ, config->core_interface,
+                          config->cores, config->cores ? config->nr_cores : 0);
+    if (ret == 0 && config->uncore_interface != NULL)
+    {
+        ret = init_grid(&power->grids[FREQ_GEN_DEVICE_UNCORE_FREQ], config->uncore_min_frequency,
+                        config->uncore_max_frequency, config->uncore_step);
+        if (ret == 0)
+            ret = add_devices(power, FREQ_GEN_DEVICE_UNCORE_FREQ, config->uncore_interface,
+                              config->uncores, config->uncores ? config->nr_uncores : 0);
+    }
+    power->config.core_packages = NULL;
+    for (int i = 0; ret == 0 && config->calibrate && config->measure == NULL &&
+                    i < power->nr_packages;
+         i++)
+        ret = freq_gen_energy_open(&power->packages[i].energy, power->packages[i].nr, false);
+    if (ret == 0 && power->nr_devices == 0)
+    {
+        LIBFREQGEN_SET_ERROR("no devices to allocate");
+        ret = ENODEV;
+    }
+    if (ret)
+    {
+        freq_gen_power_destroy(power);
+        return NULL;
+    }
+
+    power->raise_heap = (struct device_heap){ .items = malloc(power->nr_devices * sizeof(int)),
+                                              .size = power->nr_devices,
+                                              .max = true };
+    power->lower_heap = (struct device_heap){ .items = malloc(power->nr_devices * sizeof(int)),
+                                              .size = power->nr_devices,
+                                              .max = false };
+    if (power->raise_heap.items == NULL || power->lower_heap.items == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", power->nr_devices);
+        freq_gen_power_destroy(power);
+        return NULL;
+    }
+    /* all devices start at their minimal frequency */
+    rekey_all(power);
+    return power;
+}
+
+void freq_gen_power_destroy(freq_gen_power_t* power)
+{
+    if (power == NULL)
+        return;
+    freq_gen_power_stop(power);
+    for (int i = 0; i < power->nr_devices; i++)
+    {
+        if (power->devices[i].mperf_fd >= 0)
+            close(power->devices[i].mperf_fd);
+        if (power->devices[i].tsc_fd >= 0)
+            close(power->devices[i].tsc_fd);
+    }
+    for (int i = 0; i < power->nr_packages; i++)
+        freq_gen_energy_close(&power->packages[i].energy);
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        freq_gen_session_close(power->sessions[type]);
+        free(power->targets[type]);
+        free(power->grids[type].cubes);
+    }
+    pthread_mutex_destroy(&power->lock);
+    free(power->raise_heap.items);
+    free(power->lower_heap.items);
+    free(power->devices);
+    free(power->packages);
+    free(power);
+}
@@ -0,0 +1,495 @@
+/*
+ * sampler.c
+ *
+ * Implements a pinned background thread that reads core and uncore frequencies of all devices at
+ * a fixed rate and pushes freq_gen_sample_t records to a lock-free SPSC ring
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_sampler.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_msr.h"
+#include "freq_gen_internal_perf.h"
+#include "freq_gen_internal_ring.h"
+
+#define DEFAULT_RING_SIZE 65536
+#define SAMPLE_FILE_MAGIC "FGSAMPLE"
+#define SAMPLE_FILE_VERSION 1
+
+/* APERF/MPERF/TSC counters of a cpu, used for the effective frequency */
+struct effective_counters
+{
+    int aperf_fd;
+    int mperf_fd;
+    int tsc_fd;
+    uint64_t last_aperf;
+    uint64_t last_mperf;
+    uint64_t last_tsc;
+    uint64_t last_time;
+};
+
+struct sampled_device
+{
+    int nr;                      /**< cpu or uncore number */
+    freq_gen_single_device_t fp; /**< from init_device */
+    struct effective_counters effective;
+};
+
+struct sampled_interface
+{
+    freq_gen_interface_t* interface;
+    freq_gen_dev_type type;
+    int quantities;
+    struct sampled_device* devices;
+    int nr_devices;
+    /* time get_current_frequency blocks for all devices, e.g., msr uncores measured with perf */
+    uint64_t current_window_ns;
+};
+
+struct freq_gen_sampler_s
+{
+    struct sampled_interface interfaces[FREQ_GEN_DEVICE_NUM];
+    uint64_t interval_ns;
+    int cpu;
+    freq_gen_ring_t ring;
+    pthread_t thread;
+    bool running;
+    atomic_bool stop;
+
+    /* statistics, written by the sampling thread only */
+    atomic_uint_fast64_t samples;
+    atomic_uint_fast64_t records;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+};
+
+struct freq_gen_sample_writer_s
+{
+    FILE* file;
+};
+
+/* header of a sample file, all fields in host byte order */
+struct sample_file_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t interval_ns;
+};
+
+static void close_effective_counters(struct effective_counters* counters)
+{
+    if (counters->aperf_fd >= 0)
+        close(counters->aperf_fd);
+    if (counters->mperf_fd >= 0)
+        close(counters->mperf_fd);
+    if (counters->tsc_fd >= 0)
+        close(counters->tsc_fd);
+    counters->aperf_fd = counters->mperf_fd = counters->tsc_fd = -1;
+}
+
+/* opens APERF, MPERF and TSC via the perf msr PMU */
+static int open_effective_counters(struct effective_counters* counters, int cpu)
+{
+    counters->aperf_fd = freq_gen_perf_open_named("msr", "aperf", cpu, -1);
+    counters->mperf_fd = freq_gen_perf_open_named("msr", "mperf", cpu, -1);
+    counters->tsc_fd = freq_gen_perf_open_named("msr", "tsc", cpu, -1);
+    if (counters->aperf_fd < 0 || counters->mperf_fd < 0 || counters->tsc_fd < 0)
+    {
+        close_effective_counters(counters);
+        LIBFREQGEN_APPEND_ERROR("could not open APERF/MPERF/TSC for cpu %d", cpu);
+        return -EACCES;
+    }
+    counters->last_time = 0;
+    return 0;
+}
+
+/* effective frequency since the last call: TSC rate * delta APERF / delta MPERF
+ * returns 0 if there is no previous value yet */
+static long long int read_effective_frequency(struct effective_counters* counters)
+{
+    uint64_t aperf, mperf, tsc;
+    if (freq_gen_perf_read(counters->aperf_fd, &aperf) ||
+        freq_gen_perf_read(counters->mperf_fd, &mperf) ||
+        freq_gen_perf_read(counters->tsc_fd, &tsc))
+        return -EIO;
+    uint64_t now = freq_gen_now_ns();
+    long long int result = 0;
+    if (counters->last_time != 0 && mperf != counters->last_mperf && now != counters->last_time)
+    {
+        double tsc_hz = (double)(tsc - counters->last_tsc) * 1e9 / (double)(now - counters->last_time);
+        result = (long long int)(tsc_hz * (double)(aperf - counters->last_aperf) /
+                                 (double)(mperf - counters->last_mperf));
+    }
+    counters->last_aperf = aperf;
+    counters->last_mperf = mperf;
+    counters->last_tsc = tsc;
+    counters->last_time = now;
+    return result;
+}
+
+static void close_interface(struct sampled_interface* sampled)
+{
+    for (int i = 0; i < sampled->nr_devices; i++)
+    {
+        sampled->interface->close_device(sampled->devices[i].nr, sampled->devices[i].fp);
+        close_effective_counters(&sampled->devices[i].effective);
+    }
+    free(sampled->devices);
+    sampled->devices = NULL;
+    sampled->nr_devices = 0;
+}
+
+static int open_interface(struct sampled_interface* sampled, freq_gen_interface_t* interface,
+                          freq_gen_dev_type type, const int* devices, int nr_devices,
+                          int quantities)
+{
+    sampled->interface = interface;
+    sampled->type = type;
+    sampled->quantities = quantities;
+    if (interface == NULL)
+        return 0;
+
+    if (devices == NULL)
+    {
+        nr_devices = interface->get_num_devices();
+        if (nr_devices < 0)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not get the number of devices for %s", interface->name);
+            return nr_devices;
+        }
+    }
+    if ((quantities & FREQ_GEN_SAMPLE_CURRENT) && interface->get_current_frequency == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("interface %s does not provide get_current_frequency",
+                             interface->name);
+        return -EINVAL;
+    }
+    if ((quantities & FREQ_GEN_SAMPLE_EFFECTIVE) && type != FREQ_GEN_DEVICE_CORE_FREQ)
+    {
+        LIBFREQGEN_SET_ERROR("effective frequencies can only be sampled for cores");
+        return -EINVAL;
+    }
+
+    sampled->devices = calloc(nr_devices, sizeof(struct sampled_device));
+    if (sampled->devices == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", nr_devices);
+        return -ENOMEM;
+    }
+    for (int i = 0; i < nr_devices; i++)
+    {
+        struct sampled_device* device = &sampled->devices[i];
+        device->nr = devices ? devices[i] : i;
+        device->effective.aperf_fd = device->effective.mperf_fd = device->effective.tsc_fd = -1;
+        device->fp = interface->init_device(device->nr);
+        if (device->fp < 0)
+        {
+            int ret = device->fp;
+            LIBFREQGEN_APPEND_ERROR("could not open device %d of %s", device->nr,
+                                    interface->name);
+            close_interface(sampled);
+            return ret;
+        }
+        sampled->nr_devices++;
+        if (quantities & FREQ_GEN_SAMPLE_CURRENT)
+        {
+            long long int window = freq_gen_msr_current_frequency_window(interface, device->fp);
+            if (window > 0)
+                sampled->current_window_ns += window;
+        }
+        if (quantities & FREQ_GEN_SAMPLE_EFFECTIVE)
+        {
+            int ret = open_effective_counters(&device->effective, device->nr);
+            if (ret)
+            {
+                close_interface(sampled);
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
+
+freq_gen_sampler_t* freq_gen_sampler_create(const freq_gen_sampler_config_t* config)
+{
+    if (config == NULL || config->interval_ns == 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid sampler configuration");
+        return NULL;
+    }
+    freq_gen_sampler_t* sampler = calloc(1, sizeof(freq_gen_sampler_t));
+    if (sampler == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for sampler", sizeof(freq_gen_sampler_t));
+        return NULL;
+    }
+    sampler->interval_ns = config->interval_ns;
+    sampler->cpu = config->cpu;
+    atomic_init(&sampler->stop, false);
+    atomic_init(&sampler->samples, 0);
+    atomic_init(&sampler->records, 0);
+    atomic_init(&sampler->dropped, 0);
+    atomic_init(&sampler->total_ns, 0);
+    atomic_init(&sampler->max_ns, 0);
+
+    if (freq_gen_ring_init(&sampler->ring, config->ring_size ? config->ring_size : DEFAULT_RING_SIZE,
+                           sizeof(freq_gen_sample_t)))
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate ring buffer for sampler");
+        free(sampler);
+        return NULL;
+    }
+
+    if (open_interface(&sampler->interfaces[FREQ_GEN_DEVICE_CORE_FREQ], config->core,
+                       FREQ_GEN_DEVICE_CORE_FREQ, config->core_devices, config->nr_core_devices,
+                       config->core_quantities) ||
+        open_interface(&sampler->interfaces[FREQ_GEN_DEVICE_UNCORE_FREQ], config->uncore,
+                       FREQ_GEN_DEVICE_UNCORE_FREQ, config->uncore_devices,
+                       config->nr_uncore_devices, config->uncore_quantities))
+    {
+        LIBFREQGEN_APPEND_ERROR("could not create sampler");
+        freq_gen_sampler_destroy(sampler);
+        return NULL;
+    }
+    /* devices are read one after the other, blocking reads would delay every period */
+    uint64_t window_ns = sampler->interfaces[FREQ_GEN_DEVICE_CORE_FREQ].current_window_ns +
+                         sampler->interfaces[FREQ_GEN_DEVICE_UNCORE_FREQ].current_window_ns;
+    if (window_ns >= sampler->interval_ns)
+    {
+        LIBFREQGEN_SET_ERROR("reading the current frequencies blocks for %" PRIu64 " ns, which "
+                             "exceeds the interval of %" PRIu64 " ns",
+                             window_ns, sampler->interval_ns);
+        freq_gen_sampler_destroy(sampler);
+        return NULL;
+    }
+    return sampler;
+}
+
+static void push_record(freq_gen_sampler_t* sampler, uint64_t timestamp, freq_gen_dev_type type,
+                        int device, int quantity, long long int value)
+{
+    freq_gen_sample_t record = { .timestamp = timestamp,
+                                 .device = device,
+                                 .type = type,
+                                 .quantity = quantity,
+                                 .reserved = 0,
+                                 .value = value };
+    if (freq_gen_ring_push(&sampler->ring, &record))
+        atomic_fetch_add_explicit(&sampler->dropped, 1, memory_order_relaxed);
+    else
+        atomic_fetch_add_explicit(&sampler->records, 1, memory_order_relaxed);
+}
+
+/* reads all configured quantities of all devices once */
+static void sample_all(freq_gen_sampler_t* sampler)
+{
+    uint64_t start = freq_gen_now_ns();
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        struct sampled_interface* sampled = &sampler->interfaces[type];
+        for (int i = 0; i < sampled->nr_devices; i++)
+        {
+            struct sampled_device* device = &sampled->devices[i];
+            if (sampled->quantities & FREQ_GEN_SAMPLE_REQUESTED)
+                push_record(sampler, start, type, device->nr, FREQ_GEN_SAMPLE_REQUESTED,
+                            sampled->interface->get_frequency(device->fp));
+            if (sampled->quantities & FREQ_GEN_SAMPLE_EFFECTIVE)
+            {
+                long long int value = read_effective_frequency(&device->effective);
+                /* the first read only initializes the counters */
+                if (value != 0)
+                    push_record(sampler, start, type, device->nr, FREQ_GEN_SAMPLE_EFFECTIVE,
+                                value);
+            }
+            if (sampled->quantities & FREQ_GEN_SAMPLE_CURRENT)
+                push_record(sampler, start, type, device->nr, FREQ_GEN_SAMPLE_CURRENT,
+                            sampled->interface->get_current_frequency(device->fp));
+        }
+    }
+    uint64_t duration = freq_gen_now_ns() - start;
+    atomic_fetch_add_explicit(&sampler->samples, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sampler->total_ns, duration, memory_order_relaxed);
+    if (duration > atomic_load_explicit(&sampler->max_ns, memory_order_relaxed))
+        atomic_store_explicit(&sampler->max_ns, duration, memory_order_relaxed);
+}
+
+static void* sampler_thread(void* arg)
+{
+    freq_gen_sampler_t* sampler = arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!atomic_load_explicit(&sampler->stop, memory_order_relaxed))
+    {
+        sample_all(sampler);
+
+        /* fixed rate: next period starts interval_ns after the previous one */
+        uint64_t next_ns = next.tv_nsec + sampler->interval_ns;
+        next.tv_sec += next_ns / 1000000000ULL;
+        next.tv_nsec = next_ns % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+int freq_gen_sampler_start(freq_gen_sampler_t* sampler)
+{
+    if (sampler->running)
+    {
+        LIBFREQGEN_SET_ERROR("sampler is already running");
+        return EBUSY;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (sampler->cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(sampler->cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    atomic_store(&sampler->stop, false);
+    int ret = pthread_create(&sampler->thread, &attr, sampler_thread, sampler);
+    pthread_attr_destroy(&attr);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create sampling thread (pinned to cpu %d)", sampler->cpu);
+        return ret;
+    }
+    sampler->running = true;
+    return 0;
+}
+
+int freq_gen_sampler_stop(freq_gen_sampler_t* sampler)
+{
+    if (!sampler->running)
+        return 0;
+    atomic_store(&sampler->stop, true);
+    int ret = pthread_join(sampler->thread, NULL);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not join sampling thread");
+        return ret;
+    }
+    sampler->running = false;
+    return 0;
+}
+
+size_t freq_gen_sampler_drain(freq_gen_sampler_t* sampler, freq_gen_sample_t* records, size_t max)
+{
+    return freq_gen_ring_pop(&sampler->ring, records, max);
+}
+
+void freq_gen_sampler_get_stats(freq_gen_sampler_t* sampler, freq_gen_sampler_stats_t* stats)
+{
+    int nr_devices = 0;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        nr_devices += sampler->interfaces[type].nr_devices;
+
+    stats->samples = atomic_load_explicit(&sampler->samples, memory_order_relaxed);
+    stats->records = atomic_load_explicit(&sampler->records, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&sampler->dropped, memory_order_relaxed);
+    stats->max_ns_per_sample = atomic_load_explicit(&sampler->max_ns, memory_order_relaxed);
+    uint64_t total_ns = atomic_load_explicit(&sampler->total_ns, memory_order_relaxed);
+    stats->ns_per_sample = stats->samples ? (double)total_ns / stats->samples : 0.0;
+    stats->ns_per_device = nr_devices ? stats->ns_per_sample / nr_devices : 0.0;
+}
+
+void freq_gen_sampler_destroy(freq_gen_sampler_t* sampler)
+{
+    if (sampler == NULL)
+        return;
+    freq_gen_sampler_stop(sampler);
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+        if (sampler->interfaces[type].interface != NULL)
+            close_interface(&sampler->interfaces[type]);
+    freq_gen_ring_destroy(&sampler->ring);
+    free(sampler);
+}
+
+freq_gen_sample_writer_t* freq_gen_sample_writer_open(const char* path, uint64_t interval_ns)
+{
+    freq_gen_sample_writer_t* writer = malloc(sizeof(freq_gen_sample_writer_t));
+    if (writer == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate sample writer");
+        return NULL;
+    }
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for writing", path);
+        free(writer);
+        return NULL;
+    }
+    struct sample_file_header header = { .version = SAMPLE_FILE_VERSION,
+                                         .record_size = sizeof(freq_gen_sample_t),
+                                         .interval_ns = interval_ns };
+    memcpy(header.magic, SAMPLE_FILE_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1)
+    {
+        LIBFREQGEN_SET_ERROR("could not write header to \"%s\"", path);
+        fclose(writer->file);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int freq_gen_sample_writer_write(freq_gen_sample_writer_t* writer, const freq_gen_sample_t* records,
+                                 size_t nr_records)
+{
+    if (fwrite(records, sizeof(freq_gen_sample_t), nr_records, writer->file) != nr_records)
+    {
+        LIBFREQGEN_SET_ERROR("could not write %zu records", nr_records);
+        return EIO;
+    }
+    return 0;
+}
+
+long long int freq_gen_sample_writer_drain(freq_gen_sample_writer_t* writer,
+                                           freq_gen_sampler_t* sampler)
+{
+    freq_gen_sample_t records[256];
+    long long int written = 0;
+    size_t nr;
+    while ((nr = freq_gen_sampler_drain(sampler, records, 256)) > 0)
+    {
+        int ret = freq_gen_sample_writer_write(writer, records, nr);
+        if (ret)
+            return -ret;
+        written += nr;
+    }
+    return written;
+}
+
+int freq_gen_sample_writer_close(freq_gen_sample_writer_t* writer)
+{
+    int ret = fclose(writer->file);
+    free(writer);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not close sample file");
+        return EIO;
+    }
+    return 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * session.c
+ *
+ * Implements bulk operations on a set of open devices
+ *
+ *  Created on: 19.10.2026
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_session.h"
+#include "freq_gen_internal.h"
+
+/* a setting that has been prepared for a frequency */
+struct prepared_setting
+{
+    long long int frequency;
+    freq_gen_setting_t setting;
+};
+
+struct freq_gen_session_s
+{
+    freq_gen_interface_t* interface;
+    int nr_devices;
+    int* devices;
+    freq_gen_single_device_t* handles;
+    /* last frequency set by this session per device, FREQ_GEN_SESSION_KEEP if unknown */
+    long long int* last_max;
+    long long int* last_min;
+    /* cache of prepared settings, there are only few distinct frequencies */
+    struct prepared_setting* prepared;
+    int nr_prepared;
+};
+
+static int add_device(freq_gen_session_t* session, int device, freq_gen_single_device_t handle)
+{
+    int nr = session->nr_devices;
+    int* devices = realloc(session->devices, (nr + 1) * sizeof(int));
+    if (devices == NULL)
+        return -ENOMEM;
+    session->devices = devices;
+    freq_gen_single_device_t* handles =
+        realloc(session->handles, (nr + 1) * sizeof(freq_gen_single_device_t));
+    if (handles == NULL)
+        return -ENOMEM;
+    session->handles = handles;
+    session->devices[nr] = device;
+    session->handles[nr] = handle;
+    session->nr_devices++;
+    return 0;
+}
+
+freq_gen_session_t* freq_gen_session_open(freq_gen_interface_t* interface, const int* devices,
+                                          int nr_devices)
+{
+    freq_gen_session_t* session = calloc(1, sizeof(freq_gen_session_t));
+    if (session == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate session");
+        return NULL;
+    }
+    session->interface = interface;
+
+    bool all = devices == NULL;
+    if (all)
+    {
+        nr_devices = interface->get_num_devices();
+        if (nr_devices < 0)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not get the number of devices of %s", interface->name);
+            free(session);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < nr_devices; i++)
+    {
+        int device = all ? i : devices[i];
+        freq_gen_single_device_t handle = interface->init_device(device);
+        if (handle < 0)
+        {
+            /* when using all devices, skip those that are offline or not accessible */
+            if (all)
+                continue;
+            LIBFREQGEN_APPEND_ERROR("could not open device %d of %s", device, interface->name);
+            freq_gen_session_close(session);
+            return NULL;
+        }
+        if (add_device(session, device, handle))
+        {
+            interface->close_device(device, handle);
+            LIBFREQGEN_SET_ERROR("could not allocate memory for device %d", device);
+            freq_gen_session_close(session);
+            return NULL;
+        }
+    }
+    if (session->nr_devices == 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not open any device of %s", interface->name);
+        freq_gen_session_close(session);
+        return NULL;
+    }
+
+    session->last_max = malloc(session->nr_devices * sizeof(long long int));
+    session->last_min = malloc(session->nr_devices * sizeof(long long int));
+    if (session->last_max == NULL || session->last_min == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", session->nr_devices);
+        freq_gen_session_close(session);
+        return NULL;
+    }
+    freq_gen_session_invalidate(session);
+    return session;
+}
+
+freq_gen_interface_t* freq_gen_session_get_interface(freq_gen_session_t* session)
+{
+    return session->interface;
+}
+
+int freq_gen_session_get_num_devices(freq_gen_session_t* session)
+{
+    return session->nr_devices;
+}
+
+const int* freq_gen_session_get_devices(freq_gen_session_t* session)
+{
+    return session->devices;
+}
+
+int freq_gen_session_find_device(freq_gen_session_t* session, int device)
+{
+    for (int i = 0; i < session->nr_devices; i++)
+        if (session->devices[i] == device)
+            return i;
+    return -1;
+}
+
+freq_gen_single_device_t freq_gen_session_get_handle(freq_gen_session_t* session, int index)
+{
+    return session->handles[index];
+}
+
+/* returns a cached prepared setting for a frequency */
+static freq_gen_setting_t get_prepared(freq_gen_session_t* session, long long int frequency)
+{
+    for (int i = 0; i < session->nr_prepared; i++)
+        if (session->prepared[i].frequency == frequency)
+            return session->prepared[i].setting;
+
+    struct prepared_setting* tmp =
+        realloc(session->prepared, (session->nr_prepared + 1) * sizeof(struct prepared_setting));
+    if (tmp == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for prepared setting");
+        return NULL;
+    }
+    session->prepared = tmp;
+    freq_gen_setting_t setting = session->interface->prepare_set_frequency(frequency, 0);
+    if (setting == NULL)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not prepare frequency %lld", frequency);
+        return NULL;
+    }
+    session->prepared[session->nr_prepared].frequency = frequency;
+    session->prepared[session->nr_prepared].setting = setting;
+    session->nr_prepared++;
+    return setting;
+}
+
+static int bulk_get(freq_gen_session_t* session,
+                    long long int (*get)(freq_gen_single_device_t fp), long long int* frequencies)
+{
+    int ret = 0;
+    for (int i = 0; i < session->nr_devices; i++)
+    {
+        frequencies[i] = get(session->handles[i]);
+        if (frequencies[i] < 0 && ret == 0)
+            ret = -frequencies[i];
+    }
+    return ret;
+}
+
+/* applies frequencies to all devices, skips a device if last (and also, if given) already hold the
+ * frequency */
+static int bulk_set(freq_gen_session_t* session,
+                    int (*set)(freq_gen_single_device_t fp, freq_gen_setting_t setting),
+                    const long long int* frequencies, long long int* last, long long int* also)
+{
+    int ret = 0;
+    for (int i = 0; i < session->nr_devices; i++)
+    {
+        if (frequencies[i] == FREQ_GEN_SESSION_KEEP ||
+            (frequencies[i] == last[i] && (also == NULL || frequencies[i] == also[i])))
+            continue;
+        freq_gen_setting_t setting = get_prepared(session, frequencies[i]);
+        if (setting == NULL)
+        {
+            if (ret == 0)
+                ret = EINVAL;
+            continue;
+        }
+        int result = set(session->handles[i], setting);
+        if (result == 0)
+            last[i] = frequencies[i];
+        else
+        {
+            last[i] = FREQ_GEN_SESSION_KEEP;
+            if (ret == 0)
+                ret = result < 0 ? -result : result;
+        }
+    }
+    return ret;
+}
+
+int freq_gen_session_get_frequency(freq_gen_session_t* session, long long int* frequencies)
+{
+    return bulk_get(session, session->interface->get_frequency, frequencies);
+}
+
+int freq_gen_session_get_min_frequency(freq_gen_session_t* session, long long int* frequencies)
+{
+    if (session->interface->get_min_frequency == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("interface %s does not support get_min_frequency",
+                             session->interface->name);
+        return ENOTSUP;
+    }
+    return bulk_get(session, session->interface->get_min_frequency, frequencies);
+}
+
+int freq_gen_session_set_frequency(freq_gen_session_t* session, const long long int* frequencies)
+{
+    /* for range interfaces, set_frequency sets min and max, so both have to match */
+    bool is_range = session->interface->set_min_frequency != NULL;
+    int ret = bulk_set(session, session->interface->set_frequency, frequencies, session->last_max,
+                       is_range ? session->last_min : NULL);
+    if (is_range)
+        for (int i = 0; i < session->nr_devices; i++)
+            if (frequencies[i] != FREQ_GEN_SESSION_KEEP)
+                session->last_min[i] = session->last_max[i];
+    return ret;
+}
+
+int freq_gen_session_set_min_frequency(freq_gen_session_t* session,
+                                       const long long int* frequencies)
+{
+    if (session->interface->set_min_frequency == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("interface %s does not support set_min_frequency",
+                             session->interface->name);
+        return ENOTSUP;
+    }
+    return bulk_set(session, session->interface->set_min_frequency, frequencies,
+                    session->last_min, NULL);
+}
+
+void freq_gen_session_invalidate(freq_gen_session_t* session)
+{
+    for (int i = 0; i < session->nr_devices; i++)
+    {
+        session->last_max[i] = FREQ_GEN_SESSION_KEEP;
+        session->last_min[i] = FREQ_GEN_SESSION_KEEP;
+    }
+}
+
+void freq_gen_session_close(freq_gen_session_t* session)
+{
+    if (session == NULL)
+        return;
+    for (int i = 0; i < session->nr_prepared; i++)
+        session->interface->unprepare_set_frequency(session->prepared[i].setting);
+    for (int i = 0; i < session->nr_devices; i++)
+        session->interface->close_device(session->devices[i], session->handles[i]);
+    free(session->prepared);
+    free(session->devices);
+    free(session->handles);
+    free(session->last_max);
+    free(session->last_min);
+    free(session);
+}
@@ -0,0 +1,100 @@
+/*
+ * settings.c
+ *
+ * Implements the prepared settings of freq_gen_internal_settings.h
+ *
+ *  Created on: 19.10.2026
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_model.h"
+#include "freq_gen_internal_settings.h"
+
+int freq_gen_settings_add(freq_gen_settings_t* settings, long long int frequency)
+{
+    if (frequency == FREQ_GEN_MODEL_KEEP)
+        return -1;
+    for (int i = 0; i < settings->nr_settings; i++)
+        if (settings->frequencies[i] == frequency)
+            return i;
+    freq_gen_setting_t* prepared =
+        realloc(settings->settings, (settings->nr_settings + 1) * sizeof(freq_gen_setting_t));
+    if (prepared != NULL)
+        settings->settings = prepared;
+    long long int* frequencies =
+        realloc(settings->frequencies, (settings->nr_settings + 1) * sizeof(long long int));
+    if (frequencies != NULL)
+        settings->frequencies = frequencies;
+    if (prepared == NULL || frequencies == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for settings");
+        return -ENOMEM;
+    }
+    settings->settings[settings->nr_settings] =
+        settings->interface->prepare_set_frequency(frequency, 0);
+    if (settings->settings[settings->nr_settings] == NULL)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not prepare %lld Hz for %s", frequency,
+                                settings->interface->name);
+        return -EINVAL;
+    }
+    settings->frequencies[settings->nr_settings] = frequency;
+    return settings->nr_settings++;
+}
+
+int freq_gen_settings_bind(freq_gen_settings_t* settings, freq_gen_session_t* session)
+{
+    settings->current = -1;
+    settings->session = session;
+    if (session == NULL)
+        return 0;
+    settings->interface = freq_gen_session_get_interface(session);
+    settings->nr_handles = freq_gen_session_get_num_devices(session);
+    settings->handles = malloc(settings->nr_handles * sizeof(freq_gen_single_device_t));
+    if (settings->handles == NULL && settings->nr_handles > 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", settings->nr_handles);
+        return ENOMEM;
+    }
+    for (int i = 0; i < settings->nr_handles; i++)
+        settings->handles[i] = freq_gen_session_get_handle(session, i);
+
+    /* the frequency of every device is restored when the outermost region is left */
+    settings->baseline = malloc(settings->nr_handles * sizeof(int));
+    if (settings->baseline == NULL && settings->nr_handles > 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d devices", settings->nr_handles);
+        return ENOMEM;
+    }
+    for (int i = 0; i < settings->nr_handles; i++)
+    {
+        long long int current = settings->interface->get_frequency(settings->handles[i]);
+        if (current <= 0)
+        {
+            LIBFREQGEN_SET_ERROR("could not read the frequency of device %d of %s",
+                                 freq_gen_session_get_devices(session)[i],
+                                 settings->interface->name);
+            return current < 0 ? (int)-current : EIO;
+        }
+        settings->baseline[i] = freq_gen_settings_add(settings, current);
+        if (settings->baseline[i] < 0)
+            return -settings->baseline[i];
+    }
+    settings->current = settings->nr_handles > 0 ? FREQ_GEN_SETTING_BASELINE : -1;
+    return 0;
+}
+
+void freq_gen_settings_free(freq_gen_settings_t* settings)
+{
+    for (int i = 0; i < settings->nr_settings; i++)
+        if (settings->settings[i] != NULL)
+            settings->interface->unprepare_set_frequency(settings->settings[i]);
+    if (settings->session != NULL)
+        freq_gen_session_invalidate(settings->session);
+    free(settings->settings);
+    free(settings->frequencies);
+    free(settings->handles);
+    free(settings->baseline);
+}
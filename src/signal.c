@@ -0,0 +1,132 @@
+/*
+ * signal.c
+ *
+ * The async-signal-safe set path, see freqgen_signal.h
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_signal.h"
+#include "freq_gen_internal_instrument.h"
+#include "freq_gen_internal_signal.h"
+
+struct freq_gen_signal_setting_s
+{
+    struct freq_gen_raw_write write;
+};
+
+/* counters of a thread, written by handlers that interrupt the thread itself */
+struct signal_slot
+{
+    _Atomic uint64_t applied;
+    _Atomic uint64_t failed;
+    _Atomic int last_error;
+    _Atomic int last_fd;
+};
+
+/* initial-exec puts the slot into static TLS, dynamic TLS could be allocated in the handler */
+static __thread struct signal_slot slot __attribute__((tls_model("initial-exec"))) = {
+    .last_fd = -1
+};
+
+freq_gen_signal_setting_t* freq_gen_signal_setting_create(freq_gen_interface_t* interface,
+                                                          freq_gen_single_device_t fp,
+                                                          freq_gen_setting_t setting, int min)
+{
+    if (interface == NULL || setting == NULL || fp < 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid interface, device or setting");
+        return NULL;
+    }
+    freq_gen_signal_setting_t* signal_setting = malloc(sizeof(freq_gen_signal_setting_t));
+    if (signal_setting == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes of memory for a signal setting",
+                             sizeof(freq_gen_signal_setting_t));
+        return NULL;
+    }
+
+    /* instrumentation is bypassed, the backend write is done directly */
+    freq_gen_interface_t* backend = freq_gen_instrument_unwrap(interface, &setting);
+    int ret = freq_gen_msr_describe_set(backend, fp, setting, min, &signal_setting->write);
+    if (ret == ENOENT)
+        ret = freq_gen_sysfs_describe_set(backend, fp, setting, min, &signal_setting->write);
+    if (ret)
+    {
+        free(signal_setting);
+        if (ret == ENOENT)
+            LIBFREQGEN_SET_ERROR("the %s interface has no async-signal-safe set path",
+                                 backend->name);
+        else
+            LIBFREQGEN_SET_ERROR("the %s interface can not apply %s async-signal-safe",
+                                 backend->name, min ? "set_min_frequency" : "set_frequency");
+        return NULL;
+    }
+    return signal_setting;
+}
+
+int freq_gen_signal_apply(const freq_gen_signal_setting_t* setting)
+{
+    int saved_errno = errno;
+    const struct freq_gen_raw_write* write = &setting->write;
+    ssize_t result;
+    if (write->mask == 0)
+        result = pwrite(write->fd, write->data, write->length, write->offset);
+    else
+    {
+        uint64_t value, target;
+        result = pread(write->fd, &value, sizeof(value), write->offset);
+        if (result == sizeof(value))
+        {
+            memcpy(&target, write->data, sizeof(target));
+            value = (value & ~write->mask) | (target & write->mask);
+            result = pwrite(write->fd, &value, sizeof(value), write->offset);
+        }
+    }
+
+    int ret = 0;
+    if (result != (ssize_t)write->length)
+    {
+        ret = result < 0 ? errno : EIO;
+        atomic_fetch_add_explicit(&slot.failed, 1, memory_order_relaxed);
+        atomic_store_explicit(&slot.last_error, ret, memory_order_relaxed);
+        atomic_store_explicit(&slot.last_fd, write->fd, memory_order_relaxed);
+    }
+    else
+        atomic_fetch_add_explicit(&slot.applied, 1, memory_order_relaxed);
+    errno = saved_errno;
+    return ret;
+}
+
+void freq_gen_signal_get_stats(freq_gen_signal_stats_t* stats, int reset)
+{
+    if (reset)
+    {
+        stats->applied = atomic_exchange_explicit(&slot.applied, 0, memory_order_relaxed);
+        stats->failed = atomic_exchange_explicit(&slot.failed, 0, memory_order_relaxed);
+        stats->last_error = atomic_exchange_explicit(&slot.last_error, 0, memory_order_relaxed);
+        stats->last_fd = atomic_exchange_explicit(&slot.last_fd, -1, memory_order_relaxed);
+    }
+    else
+    {
+        stats->applied = atomic_load_explicit(&slot.applied, memory_order_relaxed);
+        stats->failed = atomic_load_explicit(&slot.failed, memory_order_relaxed);
+        stats->last_error = atomic_load_explicit(&slot.last_error, memory_order_relaxed);
+        stats->last_fd = atomic_load_explicit(&slot.last_fd, memory_order_relaxed);
+    }
+}
+
+void freq_gen_signal_setting_free(freq_gen_signal_setting_t* setting)
+{
+    free(setting);
+}
@@ -0,0 +1,583 @@
+/*
+ * sim.c
+ *
+ * Implements the sim interface, see freqgen_sim.h
+ *
+ * All state is protected by a single mutex. The energy of a domain is integrated lazily whenever
+ * the domain is changed or queried.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_sim.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_perf.h"
+
+struct sim_device
+{
+    long long int requested;
+    long long int min_requested;
+    int domain;
+};
+
+struct sim_domain
+{
+    long long int current;
+    long long int target;
+    uint64_t switch_at; /**< when current becomes target */
+    uint64_t last;      /**< time up to which energy has been integrated */
+    uint64_t transitions;
+    double energy;
+};
+
+struct sim_type
+{
+    freq_gen_interface_t interface;
+    struct sim_device* devices;
+    int nr_devices;
+    struct sim_domain* domains;
+    int nr_domains;
+    int domain_size;
+};
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool configured;
+static freq_gen_sim_config_t sim_config;
+static struct sim_type sim[FREQ_GEN_DEVICE_NUM];
+static uint64_t start_ns;
+static uint64_t virtual_ns;
+
+/* must be called with sim_lock held */
+static uint64_t sim_now(void)
+{
+    return sim_config.virtual_clock ? virtual_ns : freq_gen_now_ns() - start_ns;
+}
+
+static double sim_power(const freq_gen_sim_domain_config_t* config, long long int frequency)
+{
+    double relative = (double)frequency / config->max_frequency;
+    return config->static_power + config->dynamic_power * relative * relative * relative;
+}
+
+/* rounds a frequency to the grid and clamps it to its range */
+static long long int sim_round(const freq_gen_sim_domain_config_t* config, long long int frequency)
+{
+    if (frequency <= config->min_frequency)
+        return config->min_frequency;
+    long long int steps = llround((double)(frequency - config->min_frequency) / config->step);
+    frequency = config->min_frequency + steps * config->step;
+    return frequency > config->max_frequency ? config->max_frequency : frequency;
+}
+
+/* integrates the energy of a domain up to now and completes a due transition */
+static void sim_advance(freq_gen_dev_type type, struct sim_domain* domain, uint64_t now)
+{
+    const freq_gen_sim_domain_config_t* config = &sim_config.domains[type];
+    if (domain->current != domain->target && domain->switch_at <= now)
+    {
+        if (domain->switch_at > domain->last)
+        {
+            domain->energy +=
+                sim_power(config, domain->current) * (domain->switch_at - domain->last) / 1e9;
+            domain->last = domain->switch_at;
+        }
+        domain->current = domain->target;
+    }
+    if (now > domain->last)
+    {
+        domain->energy += sim_power(config, domain->current) * (now - domain->last) / 1e9;
+        domain->last = now;
+    }
+}
+
+/* sets the target of a domain to the highest frequency requested by its devices */
+static void sim_update_domain(freq_gen_dev_type type, int nr)
+{
+    struct sim_type* state = &sim[type];
+    struct sim_domain* domain = &state->domains[nr];
+    long long int target = 0;
+    for (int i = nr * state->domain_size; i < (nr + 1) * state->domain_size; i++)
+        if (state->devices[i].requested > target)
+            target = state->devices[i].requested;
+    if (target == domain->target)
+        return;
+    uint64_t now = sim_now();
+    sim_advance(type, domain, now);
+    domain->target = target;
+    domain->switch_at = now + sim_config.domains[type].latency_ns;
+    domain->transitions++;
+    sim_advance(type, domain, now);
+}
+
+static freq_gen_setting_t sim_prepare(freq_gen_dev_type type, long long int target)
+{
+    long long int* setting = malloc(sizeof(long long int));
+    if (setting == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for a setting");
+        return NULL;
+    }
+    pthread_mutex_lock(&sim_lock);
+    *setting = sim_round(&sim_config.domains[type], target);
+    pthread_mutex_unlock(&sim_lock);
+    return setting;
+}
+
+static void sim_unprepare(freq_gen_setting_t setting)
+{
+    free(setting);
+}
+
+static int sim_get_num_devices(freq_gen_dev_type type)
+{
+    pthread_mutex_lock(&sim_lock);
+    int nr_devices = sim[type].nr_devices;
+    pthread_mutex_unlock(&sim_lock);
+    return nr_devices;
+}
+
+static freq_gen_single_device_t sim_init_device(freq_gen_dev_type type, int nr)
+{
+    if (nr < 0 || nr >= sim_get_num_devices(type))
+    {
+        LIBFREQGEN_SET_ERROR("simulated device %d does not exist", nr);
+        return -EINVAL;
+    }
+    return nr;
+}
+
+static int sim_set(freq_gen_dev_type type, freq_gen_single_device_t fp, freq_gen_setting_t setting,
+                   int set_min)
+{
+    long long int frequency = *(long long int*)setting;
+    pthread_mutex_lock(&sim_lock);
+    if (fp < 0 || fp >= sim[type].nr_devices)
+    {
+        pthread_mutex_unlock(&sim_lock);
+        return EINVAL;
+    }
+    struct sim_device* device = &sim[type].devices[fp];
+    device->min_requested = frequency;
+    if (!set_min)
+    {
+        device->requested = frequency;
+        sim_update_domain(type, device->domain);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return 0;
+}
+
+enum sim_value
+{
+    SIM_REQUESTED,
+    SIM_MIN_REQUESTED,
+    SIM_CURRENT
+};
+
+static long long int sim_get(freq_gen_dev_type type, freq_gen_single_device_t fp,
+                             enum sim_value value)
+{
+    long long int result = -EINVAL;
+    pthread_mutex_lock(&sim_lock);
+    if (fp >= 0 && fp < sim[type].nr_devices)
+    {
+        struct sim_device* device = &sim[type].devices[fp];
+        struct sim_domain* domain = &sim[type].domains[device->domain];
+        switch (value)
+        {
+        case SIM_REQUESTED:
+            result = device->requested;
+            break;
+        case SIM_MIN_REQUESTED:
+            result = device->min_requested;
+            break;
+        case SIM_CURRENT:
+            sim_advance(type, domain, sim_now());
+            result = domain->current;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return result;
+}
+
+static void sim_close_device(int nr, freq_gen_single_device_t fp)
+{
+    (void)nr;
+    (void)fp;
+}
+
+/* the state is kept after finalize, so it can still be queried */
+static void sim_finalize(void)
+{
+}
+
+/* functions that are put into the interface of a device type */
+#define SIM_FUNCTIONS(suffix, dev_type)                                                            \
+    static freq_gen_setting_t prepare_##suffix(long long int target, int turbo)                    \
+    {                                                                                              \
+        (void)turbo;                                                                               \
+        return sim_prepare(dev_type, target);                                                      \
+    }                                                                                              \
+    static int get_num_devices_##suffix(void)                                                      \
+    {                                                                                              \
+        return sim_get_num_devices(dev_type);                                                      \
+    }                                                                                              \
+    static freq_gen_single_device_t init_device_##suffix(int nr)                                   \
+    {                                                                                              \
+        return sim_init_device(dev_type, nr);                                                      \
+    }                                                                                              \
+    static long long int get_frequency_##suffix(freq_gen_single_device_t fp)                       \
+    {                                                                                              \
+        return sim_get(dev_type, fp, SIM_REQUESTED);                                               \
+    }                                                                                              \
+    static long long int get_current_frequency_##suffix(freq_gen_single_device_t fp)               \
+    {                                                                                              \
+        return sim_get(dev_type, fp, SIM_CURRENT);                                                 \
+    }                                                                                              \
+    static int set_frequency_##suffix(freq_gen_single_device_t fp, freq_gen_setting_t setting)     \
+    {                                                                                              \
+        return sim_set(dev_type, fp, setting, 0);                                                  \
+    }
+
+SIM_FUNCTIONS(core, FREQ_GEN_DEVICE_CORE_FREQ)
+SIM_FUNCTIONS(uncore, FREQ_GEN_DEVICE_UNCORE_FREQ)
+
+static long long int get_min_frequency_uncore(freq_gen_single_device_t fp)
+{
+    return sim_get(FREQ_GEN_DEVICE_UNCORE_FREQ, fp, SIM_MIN_REQUESTED);
+}
+
+static int set_min_frequency_uncore(freq_gen_single_device_t fp, freq_gen_setting_t setting)
+{
+    return sim_set(FREQ_GEN_DEVICE_UNCORE_FREQ, fp, setting, 1);
+}
+
+void freq_gen_sim_default_config(freq_gen_sim_config_t* config)
+{
+    *config = (freq_gen_sim_config_t){
+        .packages = 1,
+        .cores_per_package = 4,
+        .threads_per_core = 1,
+        .core_domain_size = 1,
+        .domains[FREQ_GEN_DEVICE_CORE_FREQ] = { .min_frequency = 800000000LL,
+                                                .max_frequency = 3000000000LL,
+                                                .step = 100000000LL,
+                                                .latency_ns = 30000,
+                                                .static_power = 0.5,
+                                                .dynamic_power = 4.0 },
+        .domains[FREQ_GEN_DEVICE_UNCORE_FREQ] = { .min_frequency = 1200000000LL,
+                                                  .max_frequency = 2400000000LL,
+                                                  .step = 100000000LL,
+                                                  .latency_ns = 20000,
+                                                  .static_power = 5.0,
+                                                  .dynamic_power = 15.0 }
+    };
+}
+
+/* must be called with sim_lock held */
+static int sim_init_type(freq_gen_dev_type type, int nr_devices, int domain_size)
+{
+    struct sim_type* state = &sim[type];
+    const freq_gen_sim_domain_config_t* config = &sim_config.domains[type];
+    free(state->devices);
+    free(state->domains);
+    state->nr_domains = nr_devices / domain_size;
+    state->devices = malloc(nr_devices * sizeof(struct sim_device));
+    state->domains = calloc(state->nr_domains, sizeof(struct sim_domain));
+    if (state->devices == NULL || state->domains == NULL)
+    {
+        free(state->devices);
+        free(state->domains);
+        state->devices = NULL;
+        state->domains = NULL;
+        state->nr_devices = 0;
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d simulated devices", nr_devices);
+        return ENOMEM;
+    }
+    state->nr_devices = nr_devices;
+    state->domain_size = domain_size;
+    long long int initial = sim_round(
+        config, config->initial_frequency ? config->initial_frequency : config->max_frequency);
+    for (int i = 0; i < nr_devices; i++)
+        state->devices[i] = (struct sim_device){ .requested = initial,
+                                                 .min_requested = initial,
+                                                 .domain = i / domain_size };
+    for (int i = 0; i < state->nr_domains; i++)
+        state->domains[i] = (struct sim_domain){ .current = initial, .target = initial };
+    return 0;
+}
+
+int freq_gen_sim_configure(const freq_gen_sim_config_t* config)
+{
+    int cpus_per_package = config->cores_per_package * config->threads_per_core;
+    if (config->packages < 1 || cpus_per_package < 1 || config->core_domain_size < 1 ||
+        cpus_per_package % config->core_domain_size != 0)
+    {
+        LIBFREQGEN_SET_ERROR("invalid simulated topology");
+        return EINVAL;
+    }
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        const freq_gen_sim_domain_config_t* domain = &config->domains[type];
+        if (domain->min_frequency <= 0 || domain->max_frequency < domain->min_frequency ||
+            domain->step <= 0)
+        {
+            LIBFREQGEN_SET_ERROR("invalid simulated frequency grid");
+            return EINVAL;
+        }
+    }
+
+    pthread_mutex_lock(&sim_lock);
+    sim_config = *config;
+    int ret = sim_init_type(FREQ_GEN_DEVICE_CORE_FREQ, config->packages * cpus_per_package,
+                            config->core_domain_size);
+    if (ret == 0)
+        ret = sim_init_type(FREQ_GEN_DEVICE_UNCORE_FREQ, config->packages, 1);
+    start_ns = freq_gen_now_ns();
+    virtual_ns = 0;
+    configured = ret == 0;
+    pthread_mutex_unlock(&sim_lock);
+    return ret;
+}
+
+/* applies a key=value pair of LIBFREQGEN_SIM_CONFIG */
+static int sim_parse_option(freq_gen_sim_config_t* config, const char* key, double value)
+{
+    struct
+    {
+        const char* name;
+        int* value;
+    } ints[] = { { "packages", &config->packages },
+                 { "cores", &config->cores_per_package },
+                 { "threads", &config->threads_per_core },
+                 { "core_domain", &config->core_domain_size },
+                 { "virtual", &config->virtual_clock } };
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++)
+        if (strcmp(key, ints[i].name) == 0)
+        {
+            *ints[i].value = value;
+            return 0;
+        }
+
+    freq_gen_sim_domain_config_t* domain;
+    if (strncmp(key, "core_", 5) == 0)
+    {
+        domain = &config->domains[FREQ_GEN_DEVICE_CORE_FREQ];
+        key += 5;
+    }
+    else if (strncmp(key, "uncore_", 7) == 0)
+    {
+        domain = &config->domains[FREQ_GEN_DEVICE_UNCORE_FREQ];
+        key += 7;
+    }
+    else
+        return EINVAL;
+    if (strcmp(key, "min") == 0)
+        domain->min_frequency = llround(value);
+    else if (strcmp(key, "max") == 0)
+        domain->max_frequency = llround(value);
+    else if (strcmp(key, "step") == 0)
+        domain->step = llround(value);
+    else if (strcmp(key, "initial") == 0)
+        domain->initial_frequency = llround(value);
+    else if (strcmp(key, "latency") == 0)
+        domain->latency_ns = llround(value);
+    else if (strcmp(key, "static_power") == 0)
+        domain->static_power = value;
+    else if (strcmp(key, "dynamic_power") == 0)
+        domain->dynamic_power = value;
+    else
+        return EINVAL;
+    return 0;
+}
+
+/* configures the simulator from the environment if it has not been configured */
+static int sim_configure_from_env(void)
+{
+    pthread_mutex_lock(&sim_lock);
+    bool done = configured;
+    pthread_mutex_unlock(&sim_lock);
+    if (done)
+        return 0;
+
+    freq_gen_sim_config_t config;
+    freq_gen_sim_default_config(&config);
+    const char* env = getenv("LIBFREQGEN_SIM_CONFIG");
+    if (env != NULL)
+    {
+        char* options = strdup(env);
+        if (options == NULL)
+        {
+            LIBFREQGEN_SET_ERROR("could not allocate memory for LIBFREQGEN_SIM_CONFIG");
+            return ENOMEM;
+        }
+        char* saveptr;
+        for (char* option = strtok_r(options, ",", &saveptr); option != NULL;
+             option = strtok_r(NULL, ",", &saveptr))
+        {
+            char* value = strchr(option, '=');
+            char* end = NULL;
+            if (value != NULL)
+            {
+                *value = '\0';
+                value++;
+            }
+            double number = value ? strtod(value, &end) : 0;
+            if (value == NULL || end == value || *end != '\0' ||
+                sim_parse_option(&config, option, number))
+            {
+                LIBFREQGEN_SET_ERROR("invalid option \"%s\" in LIBFREQGEN_SIM_CONFIG", option);
+                free(options);
+                return EINVAL;
+            }
+        }
+        free(options);
+    }
+    return freq_gen_sim_configure(&config);
+}
+
+/* whether the sim interface may be returned by freq_gen_init() */
+static bool sim_available(const char* selection)
+{
+    if (configured || getenv("LIBFREQGEN_SIM_CONFIG") != NULL)
+        return true;
+    const char* selected = getenv(selection);
+    return selected != NULL && strcmp(selected, "sim") == 0;
+}
+
+static freq_gen_interface_t* sim_init(freq_gen_dev_type type)
+{
+    if (!sim_available(type == FREQ_GEN_DEVICE_CORE_FREQ ? "LIBFREQGEN_CORE_INTERFACE"
+                                                         : "LIBFREQGEN_UNCORE_INTERFACE"))
+    {
+        LIBFREQGEN_SET_ERROR("the simulator is neither selected nor configured");
+        return NULL;
+    }
+    if (sim_configure_from_env())
+        return NULL;
+    freq_gen_interface_t* interface = &sim[type].interface;
+    *interface = (freq_gen_interface_t){ .name = "sim",
+                                         .unprepare_set_frequency = sim_unprepare,
+                                         .close_device = sim_close_device,
+                                         .finalize = sim_finalize };
+    if (type == FREQ_GEN_DEVICE_CORE_FREQ)
+    {
+        interface->get_num_devices = get_num_devices_core;
+        interface->init_device = init_device_core;
+        interface->prepare_set_frequency = prepare_core;
+        interface->get_frequency = get_frequency_core;
+        interface->set_frequency = set_frequency_core;
+        interface->get_current_frequency = get_current_frequency_core;
+    }
+    else
+    {
+        interface->get_num_devices = get_num_devices_uncore;
+        interface->init_device = init_device_uncore;
+        interface->prepare_set_frequency = prepare_uncore;
+        interface->get_frequency = get_frequency_uncore;
+        interface->get_min_frequency = get_min_frequency_uncore;
+        interface->set_frequency = set_frequency_uncore;
+        interface->set_min_frequency = set_min_frequency_uncore;
+        interface->get_current_frequency = get_current_frequency_uncore;
+    }
+    return interface;
+}
+
+static freq_gen_interface_t* sim_init_cpufreq(void)
+{
+    return sim_init(FREQ_GEN_DEVICE_CORE_FREQ);
+}
+
+static freq_gen_interface_t* sim_init_uncorefreq(void)
+{
+    return sim_init(FREQ_GEN_DEVICE_UNCORE_FREQ);
+}
+
+freq_gen_interface_internal_t freq_gen_sim_interface_internal = {
+    .name = "sim", .init_cpufreq = sim_init_cpufreq, .init_uncorefreq = sim_init_uncorefreq
+};
+
+uint64_t freq_gen_sim_get_time(void)
+{
+    pthread_mutex_lock(&sim_lock);
+    uint64_t now = sim_now();
+    pthread_mutex_unlock(&sim_lock);
+    return now;
+}
+
+int freq_gen_sim_set_time(uint64_t ns)
+{
+    int ret = 0;
+    pthread_mutex_lock(&sim_lock);
+    if (!sim_config.virtual_clock)
+        ret = ENOTSUP;
+    else if (ns < virtual_ns)
+        ret = EINVAL;
+    else
+        virtual_ns = ns;
+    pthread_mutex_unlock(&sim_lock);
+    return ret;
+}
+
+int freq_gen_sim_get_state(freq_gen_dev_type type, int device, freq_gen_sim_state_t* state)
+{
+    if (type < 0 || type >= FREQ_GEN_DEVICE_NUM)
+        return EINVAL;
+    pthread_mutex_lock(&sim_lock);
+    if (device < 0 || device >= sim[type].nr_devices)
+    {
+        pthread_mutex_unlock(&sim_lock);
+        return EINVAL;
+    }
+    struct sim_device* sim_device = &sim[type].devices[device];
+    struct sim_domain* domain = &sim[type].domains[sim_device->domain];
+    sim_advance(type, domain, sim_now());
+    *state = (freq_gen_sim_state_t){ .requested = sim_device->requested,
+                                     .min_requested = sim_device->min_requested,
+                                     .target = domain->target,
+                                     .current = domain->current,
+                                     .transitions = domain->transitions,
+                                     .energy = domain->energy };
+    pthread_mutex_unlock(&sim_lock);
+    return 0;
+}
+
+double freq_gen_sim_get_energy(freq_gen_dev_type type)
+{
+    if (type < 0 || type >= FREQ_GEN_DEVICE_NUM)
+        return 0;
+    double energy = 0;
+    pthread_mutex_lock(&sim_lock);
+    uint64_t now = sim_now();
+    for (int i = 0; i < sim[type].nr_domains; i++)
+    {
+        sim_advance(type, &sim[type].domains[i], now);
+        energy += sim[type].domains[i].energy;
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return energy;
+}
+
+uint64_t freq_gen_sim_get_transitions(freq_gen_dev_type type)
+{
+    if (type < 0 || type >= FREQ_GEN_DEVICE_NUM)
+        return 0;
+    uint64_t transitions = 0;
+    pthread_mutex_lock(&sim_lock);
+    for (int i = 0; i < sim[type].nr_domains; i++)
+        transitions += sim[type].domains[i].transitions;
+    pthread_mutex_unlock(&sim_lock);
+    return transitions;
+}
@@ -0,0 +1,240 @@
+/*
+ * snapshot.c
+ *
+ * Implements capturing and restoring the settings of all devices of a session
+ *
+ *  Created on: 19.10.2026
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_snapshot.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_instrument.h"
+#include "freq_gen_internal_msr.h"
+
+#define SNAPSHOT_MAGIC "FGSNAP"
+#define SNAPSHOT_VERSION 1
+
+/* raw holds the register of the msr backend */
+#define SNAPSHOT_RAW 1U
+
+/* no minimal frequency, e.g., for sysfs */
+#define SNAPSHOT_NO_MIN (-1LL)
+
+struct snapshot_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t nr_entries;
+    uint32_t reserved[2];
+    char backend[24]; /**< name of the interface the snapshot has been taken with */
+};
+
+struct snapshot_entry
+{
+    int32_t device;
+    uint32_t flags; /**< SNAPSHOT_RAW */
+    int64_t max;    /**< frequency in Hz, <0 if it could not be read */
+    int64_t min;    /**< minimal frequency in Hz or SNAPSHOT_NO_MIN */
+    uint64_t raw;   /**< IA32_PERF_CTL or UNCORE_RATIO_LIMIT if SNAPSHOT_RAW is set */
+};
+
+int freq_gen_snapshot(freq_gen_session_t* session, void** blob, size_t* size)
+{
+    freq_gen_interface_t* interface = freq_gen_session_get_interface(session);
+    int nr = freq_gen_session_get_num_devices(session);
+    const int* devices = freq_gen_session_get_devices(session);
+    long long int max[nr], min[nr];
+
+    /* errors of single devices are stored in the entries and skipped during restore */
+    freq_gen_session_get_frequency(session, max);
+    bool has_min = interface->get_min_frequency != NULL;
+    if (has_min)
+        freq_gen_session_get_min_frequency(session, min);
+
+    *size = sizeof(struct snapshot_header) + nr * sizeof(struct snapshot_entry);
+    char* buffer = calloc(1, *size);
+    if (buffer == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for snapshot", *size);
+        return ENOMEM;
+    }
+    struct snapshot_header header = { .version = SNAPSHOT_VERSION, .nr_entries = nr };
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    strncpy(header.backend, interface->name, sizeof(header.backend) - 1);
+    memcpy(buffer, &header, sizeof(header));
+
+    /* the msr backend encodes more than the frequency in its registers, keep all bits */
+    freq_gen_interface_t* backend = freq_gen_instrument_unwrap(interface, NULL);
+    bool is_msr = true;
+    struct snapshot_entry* entries = (struct snapshot_entry*)(buffer + sizeof(header));
+    for (int i = 0; i < nr; i++)
+    {
+        entries[i].device = devices[i];
+        entries[i].max = max[i];
+        entries[i].min = has_min ? min[i] : SNAPSHOT_NO_MIN;
+        if (is_msr)
+        {
+            int ret = freq_gen_msr_read_raw(backend, freq_gen_session_get_handle(session, i),
+                                            &entries[i].raw);
+            is_msr = ret != ENOENT;
+            if (ret == 0)
+                entries[i].flags |= SNAPSHOT_RAW;
+        }
+    }
+    *blob = buffer;
+    return 0;
+}
+
+int freq_gen_restore(freq_gen_session_t* session, const void* blob, size_t size)
+{
+    freq_gen_interface_t* interface = freq_gen_session_get_interface(session);
+    struct snapshot_header header;
+    if (size < sizeof(header))
+    {
+        LIBFREQGEN_SET_ERROR("snapshot is too small (%zu bytes)", size);
+        return EINVAL;
+    }
+    memcpy(&header, blob, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header.version != SNAPSHOT_VERSION ||
+        size < sizeof(header) + (size_t)header.nr_entries * sizeof(struct snapshot_entry))
+    {
+        LIBFREQGEN_SET_ERROR("invalid snapshot");
+        return EINVAL;
+    }
+
+    int nr = freq_gen_session_get_num_devices(session);
+    long long int current_max[nr], current_min[nr];
+    long long int target_max[nr], target_min[nr];
+    bool is_range = interface->get_min_frequency != NULL && interface->set_min_frequency != NULL;
+
+    freq_gen_session_get_frequency(session, current_max);
+    if (is_range)
+        freq_gen_session_get_min_frequency(session, current_min);
+    for (int i = 0; i < nr; i++)
+        target_max[i] = target_min[i] = FREQ_GEN_SESSION_KEEP;
+
+    int ret = 0;
+    int raw_error = 0;
+    freq_gen_interface_t* backend = freq_gen_instrument_unwrap(interface, NULL);
+    const char* entries = (const char*)blob + sizeof(header);
+    for (uint32_t e = 0; e < header.nr_entries; e++)
+    {
+        struct snapshot_entry entry;
+        memcpy(&entry, entries + e * sizeof(entry), sizeof(entry));
+        int i = freq_gen_session_find_device(session, entry.device);
+        if (i < 0)
+        {
+            ret = ENODEV;
+            continue;
+        }
+        /* restored with the msr backend, write the whole register back */
+        if (entry.flags & SNAPSHOT_RAW)
+        {
+            freq_gen_single_device_t handle = freq_gen_session_get_handle(session, i);
+            uint64_t current;
+            int result = freq_gen_msr_read_raw(backend, handle, &current);
+            /* through the instrumented interface, so that traces and the status page see it */
+            if (result == 0 && current != entry.raw)
+                result = freq_gen_instrument_write_raw(
+                    interface, handle, entry.raw, entry.max,
+                    entry.min != SNAPSHOT_NO_MIN && entry.min >= 0 ? entry.min : -1);
+            if (result != ENOENT)
+            {
+                if (result && raw_error == 0)
+                    raw_error = result;
+                continue;
+            }
+        }
+        /* could not be read when the snapshot was taken */
+        if (entry.max < 0)
+            continue;
+        bool restore_min = is_range && entry.min != SNAPSHOT_NO_MIN && entry.min >= 0;
+        if (current_max[i] != entry.max)
+        {
+            target_max[i] = entry.max;
+            /* set_frequency of range interfaces sets the minimum as well */
+            if (restore_min && entry.min != entry.max)
+                target_min[i] = entry.min;
+        }
+        else if (restore_min && current_min[i] != entry.min)
+            target_min[i] = entry.min;
+    }
+
+    /* the session does not know what has been changed by others since it was opened */
+    freq_gen_session_invalidate(session);
+    int result = freq_gen_session_set_frequency(session, target_max);
+    if (result == 0 && is_range)
+        result = freq_gen_session_set_min_frequency(session, target_min);
+    if (result == 0)
+        result = raw_error;
+    if (result)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not restore snapshot");
+        return result;
+    }
+    if (ret)
+        LIBFREQGEN_SET_ERROR("some devices of the snapshot are not part of the session");
+    return ret;
+}
+
+int freq_gen_snapshot_save(const char* path, const void* blob, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for writing", path);
+        return errno;
+    }
+    int ret = fwrite(blob, size, 1, file) == 1 ? 0 : EIO;
+    if (fclose(file) != 0)
+        ret = EIO;
+    if (ret)
+        LIBFREQGEN_SET_ERROR("could not write snapshot to \"%s\"", path);
+    return ret;
+}
+
+int freq_gen_snapshot_load(const char* path, void** blob, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open \"%s\" for reading", path);
+        return errno;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length <= 0)
+    {
+        fclose(file);
+        LIBFREQGEN_SET_ERROR("snapshot file \"%s\" is empty", path);
+        return EINVAL;
+    }
+    *blob = malloc(length);
+    if (*blob == NULL)
+    {
+        fclose(file);
+        LIBFREQGEN_SET_ERROR("could not allocate %ld bytes for snapshot", length);
+        return ENOMEM;
+    }
+    if (fread(*blob, length, 1, file) != 1)
+    {
+        fclose(file);
+        free(*blob);
+        *blob = NULL;
+        LIBFREQGEN_SET_ERROR("could not read snapshot from \"%s\"", path);
+        return EIO;
+    }
+    fclose(file);
+    *size = length;
+    return 0;
+}
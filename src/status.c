@@ -0,0 +1,206 @@
+/*
+ * status.c
+ *
+ * Publishes the settings applied by this process to the node-wide status page, see
+ * freqgen_status.h. The instrumented interfaces call freq_gen_status_publish() after every
+ * successful set_frequency/set_min_frequency.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_status.h"
+
+/* how long to wait for another process that creates the page */
+#define STATUS_CREATE_TIMEOUT_MS 1000
+
+atomic_bool freq_gen_status_active = false;
+
+static struct status_header* page;
+
+/* initializes a page that has just been created, magic is written last */
+static struct status_header* create_page(int fd, const char* path)
+{
+    long nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (nr_cpus <= 0)
+        nr_cpus = 1;
+    /* uncore devices are packages or nodes, of which there are never more than cpus */
+    size_t size = status_size(nr_cpus, nr_cpus);
+    if (ftruncate(fd, size) != 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not resize status page \"%s\"", path);
+        return NULL;
+    }
+    struct status_header* header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED)
+    {
+        LIBFREQGEN_SET_ERROR("could not map status page \"%s\"", path);
+        return NULL;
+    }
+    header->version = STATUS_VERSION;
+    header->nr_devices[FREQ_GEN_DEVICE_CORE_FREQ] = nr_cpus;
+    header->nr_devices[FREQ_GEN_DEVICE_UNCORE_FREQ] = nr_cpus;
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        freq_gen_status_entry_t* entries = status_entries(header, type);
+        for (long i = 0; i < nr_cpus; i++)
+            entries[i] = (freq_gen_status_entry_t){ .frequency = -1, .min_frequency = -1 };
+    }
+    atomic_store_explicit(&header->magic, status_magic(), memory_order_release);
+    return header;
+}
+
+/* maps a page that has been created by another process, which might still initialize it */
+static struct status_header* map_page(int fd, const char* path)
+{
+    for (int waited = 0; waited < STATUS_CREATE_TIMEOUT_MS; waited++)
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            break;
+        if ((size_t)st.st_size >= sizeof(struct status_header))
+        {
+            struct status_header* header =
+                mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (header == MAP_FAILED)
+                break;
+            if (atomic_load_explicit(&header->magic, memory_order_acquire) == status_magic())
+            {
+                if (header->version == STATUS_VERSION &&
+                    status_size(header->nr_devices[FREQ_GEN_DEVICE_CORE_FREQ],
+                                header->nr_devices[FREQ_GEN_DEVICE_UNCORE_FREQ]) <=
+                        (size_t)st.st_size)
+                    return header;
+                munmap(header, st.st_size);
+                LIBFREQGEN_SET_ERROR("status page \"%s\" has an incompatible layout", path);
+                return NULL;
+            }
+            munmap(header, st.st_size);
+        }
+        usleep(1000);
+    }
+    LIBFREQGEN_SET_ERROR("could not map status page \"%s\"", path);
+    return NULL;
+}
+
+int freq_gen_status_enable(void)
+{
+    if (atomic_load(&freq_gen_status_active))
+        return 0;
+    char path[PATH_MAX];
+    if (status_path(path, sizeof(path), NULL) != 0)
+    {
+        LIBFREQGEN_SET_ERROR("could not determine the path of the status page");
+        return EINVAL;
+    }
+    struct status_header* header;
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd >= 0)
+    {
+        header = create_page(fd, path);
+        if (header == NULL)
+            unlink(path);
+    }
+    else if (errno == EEXIST)
+    {
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+        {
+            int ret = errno;
+            LIBFREQGEN_SET_ERROR("could not open status page \"%s\"", path);
+            return ret;
+        }
+        header = map_page(fd, path);
+    }
+    else
+    {
+        int ret = errno;
+        LIBFREQGEN_SET_ERROR("could not create status page \"%s\"", path);
+        return ret;
+    }
+    close(fd);
+    if (header == NULL)
+        return EIO;
+    page = header;
+    atomic_store(&freq_gen_status_active, true);
+    return 0;
+}
+
+bool freq_gen_status_check_env(void)
+{
+    static bool checked = false;
+    if (!checked)
+    {
+        checked = true;
+        char* value = getenv("LIBFREQGEN_STATUS");
+        if (value != NULL && strcmp(value, "0") != 0 && freq_gen_status_enable() != 0)
+            fprintf(stderr, "libfreqgen: could not enable the status page: %s\n",
+                    freq_gen_error_string());
+    }
+    return atomic_load(&freq_gen_status_active);
+}
+
+/* takes the writer lock, recovers it from writers that died while holding it */
+static void lock_page(struct status_header* header)
+{
+    uint32_t self = getpid();
+    uint32_t owner = 0;
+    for (unsigned long spins = 1; !atomic_compare_exchange_weak_explicit(
+             &header->lock, &owner, self, memory_order_acquire, memory_order_relaxed);
+         spins++)
+    {
+        if (owner != 0 && spins % 1024 == 0 && kill(owner, 0) != 0 && errno == ESRCH &&
+            atomic_compare_exchange_strong(&header->lock, &owner, self))
+        {
+            uint32_t sequence = atomic_load_explicit(&header->sequence, memory_order_relaxed);
+            if (sequence & 1)
+                atomic_store_explicit(&header->sequence, sequence + 1, memory_order_relaxed);
+            return;
+        }
+        if (spins % 1024 == 0)
+            sched_yield();
+        owner = 0;
+    }
+}
+
+void freq_gen_status_publish(freq_gen_dev_type type, int device, long long int frequency,
+                             long long int min_frequency)
+{
+    struct status_header* header = page;
+    if (header == NULL || device < 0 || (uint32_t)device >= header->nr_devices[type])
+        return;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    freq_gen_status_entry_t* entry = &status_entries(header, type)[device];
+
+    lock_page(header);
+    uint32_t sequence = atomic_load_explicit(&header->sequence, memory_order_relaxed);
+    atomic_store_explicit(&header->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (frequency >= 0)
+        entry->frequency = frequency;
+    if (min_frequency >= 0)
+        entry->min_frequency = min_frequency;
+    entry->timestamp = now.tv_sec * 1000000000ULL + now.tv_nsec;
+    entry->pid = getpid();
+    atomic_store_explicit(&header->sequence, sequence + 2, memory_order_release);
+    atomic_store_explicit(&header->lock, 0, memory_order_release);
+}
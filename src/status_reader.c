@@ -0,0 +1,120 @@
+/*
+ * status_reader.c
+ *
+ * Reads the node-wide status page, see freqgen_status.h. This is built into the freqgen-status
+ * library, which monitors can use without loading libfreqgen and its backends.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "freq_gen_internal_status.h"
+
+/* how often a read is retried while writers change the page */
+#define STATUS_READ_RETRIES 10000
+
+struct freq_gen_status_reader_s
+{
+    struct status_header* header;
+    size_t size;
+};
+
+freq_gen_status_reader_t* freq_gen_status_open(const char* node)
+{
+    char path[PATH_MAX];
+    if (status_path(path, sizeof(path), node) != 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(struct status_header))
+    {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+    struct status_header* header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+        return NULL;
+
+    int error = 0;
+    if (atomic_load_explicit(&header->magic, memory_order_acquire) != status_magic())
+        error = EAGAIN;
+    else if (header->version != STATUS_VERSION ||
+             status_size(header->nr_devices[FREQ_GEN_DEVICE_CORE_FREQ],
+                         header->nr_devices[FREQ_GEN_DEVICE_UNCORE_FREQ]) > (size_t)st.st_size)
+        error = EPROTO;
+    freq_gen_status_reader_t* reader = error ? NULL : malloc(sizeof(freq_gen_status_reader_t));
+    if (reader == NULL)
+    {
+        munmap(header, st.st_size);
+        errno = error ? error : ENOMEM;
+        return NULL;
+    }
+    reader->header = header;
+    reader->size = st.st_size;
+    return reader;
+}
+
+int freq_gen_status_get_num_devices(freq_gen_status_reader_t* reader, freq_gen_dev_type type)
+{
+    if (type < 0 || type >= FREQ_GEN_DEVICE_NUM)
+        return -EINVAL;
+    return reader->header->nr_devices[type];
+}
+
+int freq_gen_status_read(freq_gen_status_reader_t* reader, freq_gen_status_entry_t* cores,
+                         freq_gen_status_entry_t* uncores)
+{
+    struct status_header* header = reader->header;
+    for (int retry = 0; retry < STATUS_READ_RETRIES; retry++)
+    {
+        uint32_t begin = atomic_load_explicit(&header->sequence, memory_order_acquire);
+        if (begin & 1)
+        {
+            sched_yield();
+            continue;
+        }
+        if (cores != NULL)
+            memcpy(cores, status_entries(header, FREQ_GEN_DEVICE_CORE_FREQ),
+                   header->nr_devices[FREQ_GEN_DEVICE_CORE_FREQ] *
+                       sizeof(freq_gen_status_entry_t));
+        if (uncores != NULL)
+            memcpy(uncores, status_entries(header, FREQ_GEN_DEVICE_UNCORE_FREQ),
+                   header->nr_devices[FREQ_GEN_DEVICE_UNCORE_FREQ] *
+                       sizeof(freq_gen_status_entry_t));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&header->sequence, memory_order_relaxed) == begin)
+            return 0;
+    }
+    return EAGAIN;
+}
+
+void freq_gen_status_close(freq_gen_status_reader_t* reader)
+{
+    if (reader == NULL)
+        return;
+    munmap(reader->header, reader->size);
+    free(reader);
+}
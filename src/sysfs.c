@@ -19,7 +19,11 @@
 #include <unistd.h>
 
 #include "../include/error.h"
+#include "../include/freqgen_topology.h"
 #include "freq_gen_internal.h"
+#include "freq_gen_internal_broker.h"
+#include "freq_gen_internal_cpuset.h"
+#include "freq_gen_internal_signal.h"
 
 static freq_gen_interface_t sysfs_interface;
 
@@ -108,11 +112,22 @@ static int freq_gen_sysfs_init(void)
  * /sys/devices/system/cpu/(cpu)/cpufreq/scaling_governor is either userspace
  * will check for access to
  * /sys/devices/system/cpu/(cpu)/cpufreq/scaling_setspeed
+ * and request it from the broker if it can not be opened due to missing permissions
  * */
 static freq_gen_single_device_t freq_gen_sysfs_init_device(int cpu)
 {
     char buffer[BUFFER_SIZE];
     int fd;
+    if (!freq_gen_cpuset_cpu_allowed(cpu))
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is not in the cpuset of the process", cpu);
+        return -EPERM;
+    }
+    if (!freq_gen_topology_cpu_online(cpu))
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is offline", cpu);
+        return -ENODEV;
+    }
     if (snprintf(buffer, BUFFER_SIZE, "%scpu%d/cpufreq/scaling_governor", sysfs_start, cpu) ==
         BUFFER_SIZE)
     {
@@ -152,6 +167,9 @@ static freq_gen_single_device_t freq_gen_sysfs_init_device(int cpu)
         return -ENOMEM;
     }
     fd = open(buffer, O_RDWR);
+    /* hot-path writes go directly to the file descriptor passed by the broker */
+    if (fd < 0 && (errno == EACCES || errno == EPERM) && freq_gen_broker_available())
+        fd = freq_gen_broker_open(FREQ_GEN_BROKER_SCALING_SETSPEED, cpu, 0);
     return fd;
 }
 
@@ -162,16 +180,34 @@ static freq_gen_single_device_t freq_gen_sysfs_init_device(int cpu)
 static int freq_gen_sysfs_get_max_sysfs_entries()
 {
     static long long int max = -1;
-    if (max != -1)
+    /* the topology watcher increments the generation when CPUs come online or go offline */
+    static unsigned long long generation;
+    if (max != -1 && generation == freq_gen_topology_get_generation())
     {
         return max;
     }
+    max = -1;
+    generation = freq_gen_topology_get_generation();
     if (sysfs_start == NULL)
     {
         LIBFREQGEN_SET_ERROR("sysfs_start is NULL. Looks like it was not initialized.");
         return -EAGAIN;
     }
 
+    /* only look at the CPUs of the process */
+    if (freq_gen_cpuset_enabled())
+    {
+        for (int cpu = freq_gen_cpuset_next_cpu(-1); cpu >= 0; cpu = freq_gen_cpuset_next_cpu(cpu))
+            max = cpu;
+        if (max == -1)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not read the cpus of the process");
+            return -EACCES;
+        }
+        max = max + 1;
+        return max;
+    }
+
     DIR* dir = opendir(sysfs_start);
     if (dir == NULL)
     {
@@ -308,7 +344,22 @@ static freq_gen_interface_t sysfs_interface = {.name = "sysfs",
                                                .set_min_frequency = NULL,
                                                .unprepare_set_frequency = unprepare_sysfs_access,
                                                .close_device = freq_gen_sysfs_close_file,
-                                               .finalize = ignore };
+                                               .finalize = ignore,
+                                               .get_current_frequency = NULL };
+
+int freq_gen_sysfs_describe_set(freq_gen_interface_t* interface, freq_gen_single_device_t fp,
+                                freq_gen_setting_t setting_in, bool min,
+                                struct freq_gen_raw_write* write)
+{
+    if (interface != &sysfs_interface)
+        return ENOENT;
+    struct setting_s* setting = (struct setting_s*)setting_in;
+    if (min || setting->len > FREQ_GEN_RAW_WRITE_MAX)
+        return ENOTSUP;
+    *write = (struct freq_gen_raw_write){ .fd = fp, .length = setting->len, .offset = 0 };
+    memcpy(write->data, setting->string, setting->len);
+    return 0;
+}
 
 static freq_gen_interface_t* freq_gen_init_cpufreq(void)
 {
@@ -0,0 +1,315 @@
+/*
+ * topology.c
+ *
+ * Implements the topology watcher. Kernel uevents look like
+ * "online@/devices/system/cpu/cpu3\0ACTION=online\0DEVPATH=/devices/system/cpu/cpu3\0
+ * SUBSYSTEM=cpu\0...". Only the ACTION and DEVPATH of cpu and node devices are used.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_topology.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_cpuset.h"
+#include "freq_gen_internal_util.h"
+
+/* interval for polling the online files if netlink is not available */
+#define TOPOLOGY_POLL_MS 1000
+
+#define CPU_ONLINE_FILE "/sys/devices/system/cpu/online"
+#define NODE_ONLINE_FILE "/sys/devices/system/node/online"
+
+/* a growing bitmask of online devices */
+struct online_mask
+{
+    unsigned long* mask;
+    int nr_bits;
+};
+
+static struct
+{
+    pthread_t thread;
+    bool running;
+    /* the netlink socket, -1 when polling */
+    int netlink_fd;
+    /* signals the thread to stop */
+    int stop_fd;
+    /* signals the user about changes */
+    int notify_fd;
+    freq_gen_topology_callback_t callback;
+    void* data;
+    /* protects cpus and nodes */
+    pthread_mutex_t lock;
+    struct online_mask cpus;
+    struct online_mask nodes;
+} watcher = { .lock = PTHREAD_MUTEX_INITIALIZER, .netlink_fd = -1, .stop_fd = -1, .notify_fd = -1 };
+
+static atomic_ullong generation;
+
+static bool test_bit(const struct online_mask* mask, int bit)
+{
+    if (bit < 0 || bit >= mask->nr_bits)
+        return false;
+    return (mask->mask[bit / FREQ_GEN_BITS_PER_LONG] >> (bit % FREQ_GEN_BITS_PER_LONG)) & 1UL;
+}
+
+/* sets or clears a bit, grows the mask if needed. returns 0 or ENOMEM */
+static int assign_bit(struct online_mask* mask, int bit, bool value)
+{
+    if (bit >= mask->nr_bits)
+    {
+        if (!value)
+            return 0;
+        int length = bit / FREQ_GEN_BITS_PER_LONG + 1;
+        unsigned long* tmp = realloc(mask->mask, length * sizeof(unsigned long));
+        if (tmp == NULL)
+            return ENOMEM;
+        memset(tmp + mask->nr_bits / FREQ_GEN_BITS_PER_LONG, 0,
+               (length - mask->nr_bits / FREQ_GEN_BITS_PER_LONG) * sizeof(unsigned long));
+        mask->mask = tmp;
+        mask->nr_bits = length * FREQ_GEN_BITS_PER_LONG;
+    }
+    if (value)
+        mask->mask[bit / FREQ_GEN_BITS_PER_LONG] |= 1UL << (bit % FREQ_GEN_BITS_PER_LONG);
+    else
+        mask->mask[bit / FREQ_GEN_BITS_PER_LONG] &= ~(1UL << (bit % FREQ_GEN_BITS_PER_LONG));
+    return 0;
+}
+
+/* reads an online file into a mask, a missing file results in an empty mask */
+static int read_online_file(const char* path, struct online_mask* mask)
+{
+    char buffer[BUFFER_SIZE];
+    mask->mask = NULL;
+    mask->nr_bits = 0;
+    int ret = freq_gen_read_small_file(path, buffer, BUFFER_SIZE);
+    if (ret)
+        return ret == ENOENT ? 0 : ret;
+    return freq_gen_cpulist_parse(buffer, &mask->mask, &mask->nr_bits);
+}
+
+/* applies a change to the table and notifies the user if something changed */
+static void update(freq_gen_dev_type type, int device, bool online)
+{
+    struct online_mask* mask =
+        type == FREQ_GEN_DEVICE_CORE_FREQ ? &watcher.cpus : &watcher.nodes;
+    pthread_mutex_lock(&watcher.lock);
+    bool changed = test_bit(mask, device) != online;
+    if (changed && assign_bit(mask, device, online) != 0)
+        changed = false;
+    pthread_mutex_unlock(&watcher.lock);
+    if (!changed)
+        return;
+
+    atomic_fetch_add(&generation, 1);
+    if (watcher.callback != NULL)
+        watcher.callback(type, device, online, watcher.data);
+    uint64_t one = 1;
+    if (write(watcher.notify_fd, &one, sizeof(one)) != sizeof(one))
+    {
+        /* the counter is saturated, the user has not read it for a long time */
+    }
+}
+
+/* compares a freshly read online file with the table */
+static void update_from_file(freq_gen_dev_type type, const char* path)
+{
+    struct online_mask current;
+    if (read_online_file(path, &current))
+        return;
+    struct online_mask* known =
+        type == FREQ_GEN_DEVICE_CORE_FREQ ? &watcher.cpus : &watcher.nodes;
+    /* the table is only written by the watcher thread, so it is safe to read it unlocked here */
+    int nr_bits = known->nr_bits > current.nr_bits ? known->nr_bits : current.nr_bits;
+    for (int device = 0; device < nr_bits; device++)
+        if (test_bit(known, device) != test_bit(&current, device))
+            update(type, device, test_bit(&current, device));
+    free(current.mask);
+}
+
+/* parses a uevent and applies it */
+static void handle_uevent(const char* buffer, ssize_t length)
+{
+    const char* action = NULL;
+    const char* devpath = NULL;
+    for (const char* entry = buffer; entry < buffer + length; entry += strlen(entry) + 1)
+    {
+        if (strncmp(entry, "ACTION=", 7) == 0)
+            action = entry + 7;
+        else if (strncmp(entry, "DEVPATH=", 8) == 0)
+            devpath = entry + 8;
+    }
+    if (action == NULL || devpath == NULL)
+        return;
+
+    bool online;
+    if (strcmp(action, "online") == 0 || strcmp(action, "add") == 0)
+        online = true;
+    else if (strcmp(action, "offline") == 0 || strcmp(action, "remove") == 0)
+        online = false;
+    else
+        return;
+
+    int device;
+    char tail;
+    if (sscanf(devpath, "/devices/system/cpu/cpu%d%c", &device, &tail) == 1)
+    {
+        /* an added CPU is not online yet, wait for the online event */
+        if (strcmp(action, "add") != 0)
+            update(FREQ_GEN_DEVICE_CORE_FREQ, device, online);
+    }
+    else if (sscanf(devpath, "/devices/system/node/node%d%c", &device, &tail) == 1)
+        update(FREQ_GEN_DEVICE_UNCORE_FREQ, device, online);
+}
+
+static void* watcher_thread(void* arg)
+{
+    (void)arg;
+    struct pollfd fds[2] = { { .fd = watcher.stop_fd, .events = POLLIN },
+                             { .fd = watcher.netlink_fd, .events = POLLIN } };
+    int nr_fds = watcher.netlink_fd >= 0 ? 2 : 1;
+    int timeout = watcher.netlink_fd >= 0 ? -1 : TOPOLOGY_POLL_MS;
+    char buffer[8192];
+
+    while (1)
+    {
+        int ret = poll(fds, nr_fds, timeout);
+        if (ret < 0 && errno != EINTR)
+            break;
+        if (fds[0].revents & POLLIN)
+            break;
+        if (watcher.netlink_fd < 0)
+        {
+            update_from_file(FREQ_GEN_DEVICE_CORE_FREQ, CPU_ONLINE_FILE);
+            update_from_file(FREQ_GEN_DEVICE_UNCORE_FREQ, NODE_ONLINE_FILE);
+            continue;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            ssize_t length = recv(watcher.netlink_fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
+            if (length > 0)
+            {
+                buffer[length] = '\0';
+                handle_uevent(buffer, length);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* opens the netlink socket for kernel uevents, returns -1 if not possible */
+static int open_netlink(void)
+{
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+        return -1;
+    struct sockaddr_nl address = { .nl_family = AF_NETLINK, .nl_pid = 0, .nl_groups = 1 };
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int freq_gen_topology_watch(freq_gen_topology_callback_t callback, void* data)
+{
+    if (watcher.running)
+    {
+        LIBFREQGEN_SET_ERROR("topology watcher is already running");
+        return EBUSY;
+    }
+    int ret = read_online_file(CPU_ONLINE_FILE, &watcher.cpus);
+    if (ret == 0)
+        ret = read_online_file(NODE_ONLINE_FILE, &watcher.nodes);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not read the online CPUs and nodes");
+        freq_gen_topology_unwatch();
+        return ret;
+    }
+
+    watcher.stop_fd = eventfd(0, EFD_CLOEXEC);
+    watcher.notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (watcher.stop_fd < 0 || watcher.notify_fd < 0)
+    {
+        ret = errno;
+        LIBFREQGEN_SET_ERROR("could not create eventfds for the topology watcher");
+        freq_gen_topology_unwatch();
+        return ret;
+    }
+    /* e.g., in containers without a network namespace, fall back to polling */
+    watcher.netlink_fd = open_netlink();
+    watcher.callback = callback;
+    watcher.data = data;
+
+    ret = pthread_create(&watcher.thread, NULL, watcher_thread, NULL);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create topology watcher thread");
+        freq_gen_topology_unwatch();
+        return ret;
+    }
+    watcher.running = true;
+    /* a change between the start of the process and now is not visible in cached device counts */
+    atomic_fetch_add(&generation, 1);
+    return 0;
+}
+
+int freq_gen_topology_get_eventfd(void)
+{
+    return watcher.running ? watcher.notify_fd : -1;
+}
+
+unsigned long long freq_gen_topology_get_generation(void)
+{
+    return atomic_load(&generation);
+}
+
+int freq_gen_topology_cpu_online(int cpu)
+{
+    if (!watcher.running)
+        return 1;
+    pthread_mutex_lock(&watcher.lock);
+    int online = test_bit(&watcher.cpus, cpu);
+    pthread_mutex_unlock(&watcher.lock);
+    return online;
+}
+
+void freq_gen_topology_unwatch(void)
+{
+    if (watcher.running)
+    {
+        uint64_t one = 1;
+        if (write(watcher.stop_fd, &one, sizeof(one)) == sizeof(one))
+            pthread_join(watcher.thread, NULL);
+        watcher.running = false;
+    }
+    if (watcher.netlink_fd >= 0)
+        close(watcher.netlink_fd);
+    if (watcher.stop_fd >= 0)
+        close(watcher.stop_fd);
+    if (watcher.notify_fd >= 0)
+        close(watcher.notify_fd);
+    watcher.netlink_fd = watcher.stop_fd = watcher.notify_fd = -1;
+    free(watcher.cpus.mask);
+    free(watcher.nodes.mask);
+    watcher.cpus.mask = watcher.nodes.mask = NULL;
+    watcher.cpus.nr_bits = watcher.nodes.nr_bits = 0;
+}
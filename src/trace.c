@@ -0,0 +1,320 @@
+/*
+ * trace.c
+ *
+ * Implements the opt-in event trace. Each thread stores events in its own lock-free buffer, a
+ * background thread writes these buffers to the trace file.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_ring.h"
+#include "freq_gen_internal_trace.h"
+#include "freq_gen_internal_tsc.h"
+
+/* number of events per thread buffer */
+#define TRACE_BUFFER_EVENTS 4096
+/* time between two flushes of the thread buffers */
+#define TRACE_FLUSH_INTERVAL_NS 10000000ULL
+
+/* the buffer of a thread. Buffers are never freed, but reused after their thread exited */
+struct trace_buffer
+{
+    freq_gen_ring_t ring;
+    atomic_bool in_use;
+    struct trace_buffer* next;
+};
+
+atomic_bool freq_gen_trace_active;
+atomic_bool freq_gen_trace_record_all;
+
+static FILE* trace_file;
+static pthread_mutex_t trace_file_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(struct trace_buffer*) trace_buffers;
+static atomic_uint_fast64_t trace_dropped;
+static int nr_backends;
+
+static pthread_t flush_thread;
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_cond = PTHREAD_COND_INITIALIZER;
+static bool flush_stop;
+
+static pthread_key_t buffer_key;
+static pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+static __thread struct trace_buffer* local_buffer;
+static __thread uint32_t local_tid;
+
+/* describes freq_gen_trace_event_t in the file header */
+#define TRACE_FIELD(member, field_kind)                                                            \
+    {                                                                                              \
+        .name = #member, .offset = offsetof(freq_gen_trace_event_t, member),                       \
+        .size = sizeof(((freq_gen_trace_event_t*)0)->member), .kind = field_kind                   \
+    }
+static const struct trace_field trace_fields[] = {
+    TRACE_FIELD(tsc_begin, TRACE_FIELD_UNSIGNED), TRACE_FIELD(tsc_end, TRACE_FIELD_UNSIGNED),
+    TRACE_FIELD(value, TRACE_FIELD_SIGNED),       TRACE_FIELD(tid, TRACE_FIELD_UNSIGNED),
+    TRACE_FIELD(device, TRACE_FIELD_SIGNED),      TRACE_FIELD(result, TRACE_FIELD_SIGNED),
+    TRACE_FIELD(type, TRACE_FIELD_UNSIGNED),      TRACE_FIELD(op, TRACE_FIELD_UNSIGNED),
+    TRACE_FIELD(backend, TRACE_FIELD_UNSIGNED),   TRACE_FIELD(setting, TRACE_FIELD_UNSIGNED),
+};
+#define NR_TRACE_FIELDS (sizeof(trace_fields) / sizeof(trace_fields[0]))
+
+/* releases the buffer of an exiting thread, so that it can be reused */
+static void release_buffer(void* buffer)
+{
+    atomic_store(&((struct trace_buffer*)buffer)->in_use, false);
+}
+
+static void create_buffer_key(void)
+{
+    pthread_key_create(&buffer_key, release_buffer);
+}
+
+/* returns a buffer for the calling thread, reuses buffers of exited threads */
+static struct trace_buffer* acquire_buffer(void)
+{
+    pthread_once(&buffer_key_once, create_buffer_key);
+    struct trace_buffer* buffer;
+    for (buffer = atomic_load(&trace_buffers); buffer != NULL; buffer = buffer->next)
+    {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&buffer->in_use, &expected, true))
+            break;
+    }
+    if (buffer == NULL)
+    {
+        buffer = malloc(sizeof(struct trace_buffer));
+        if (buffer == NULL)
+            return NULL;
+        if (freq_gen_ring_init(&buffer->ring, TRACE_BUFFER_EVENTS, sizeof(freq_gen_trace_event_t)))
+        {
+            free(buffer);
+            return NULL;
+        }
+        atomic_init(&buffer->in_use, true);
+        buffer->next = atomic_load(&trace_buffers);
+        while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer))
+            ;
+    }
+    pthread_setspecific(buffer_key, buffer);
+    return buffer;
+}
+
+void freq_gen_trace_record(const freq_gen_trace_event_t* event)
+{
+    if (local_buffer == NULL)
+    {
+        local_buffer = acquire_buffer();
+        local_tid = syscall(SYS_gettid);
+        if (local_buffer == NULL)
+        {
+            atomic_fetch_add_explicit(&trace_dropped, 1, memory_order_relaxed);
+            return;
+        }
+    }
+    freq_gen_trace_event_t copy = *event;
+    copy.tid = local_tid;
+    if (freq_gen_ring_push(&local_buffer->ring, &copy))
+        atomic_fetch_add_explicit(&trace_dropped, 1, memory_order_relaxed);
+}
+
+/* writes a chunk, trace_file_lock must be held */
+static int write_chunk(uint32_t kind, const void* payload, uint32_t size)
+{
+    struct trace_chunk chunk = { .kind = kind, .size = size };
+    if (fwrite(&chunk, sizeof(chunk), 1, trace_file) != 1)
+        return EIO;
+    if (size > 0 && fwrite(payload, size, 1, trace_file) != 1)
+        return EIO;
+    return 0;
+}
+
+/* writes all buffered events to the file */
+static void flush_buffers(void)
+{
+    freq_gen_trace_event_t events[512];
+    pthread_mutex_lock(&trace_file_lock);
+    for (struct trace_buffer* buffer = atomic_load(&trace_buffers); buffer != NULL;
+         buffer = buffer->next)
+    {
+        size_t nr;
+        while ((nr = freq_gen_ring_pop(&buffer->ring, events, 512)) > 0)
+            if (trace_file != NULL)
+                write_chunk(TRACE_CHUNK_EVENTS, events, nr * sizeof(freq_gen_trace_event_t));
+    }
+    pthread_mutex_unlock(&trace_file_lock);
+}
+
+static void* flush_thread_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&flush_lock);
+    while (!flush_stop)
+    {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        uint64_t nsec = until.tv_nsec + TRACE_FLUSH_INTERVAL_NS;
+        until.tv_sec += nsec / 1000000000ULL;
+        until.tv_nsec = nsec % 1000000000ULL;
+        pthread_cond_timedwait(&flush_cond, &flush_lock, &until);
+        pthread_mutex_unlock(&flush_lock);
+        flush_buffers();
+        pthread_mutex_lock(&flush_lock);
+    }
+    pthread_mutex_unlock(&flush_lock);
+    return NULL;
+}
+
+int freq_gen_trace_register_backend(freq_gen_dev_type type, const char* name)
+{
+    pthread_mutex_lock(&trace_file_lock);
+    if (trace_file == NULL || nr_backends >= TRACE_MAX_BACKENDS)
+    {
+        pthread_mutex_unlock(&trace_file_lock);
+        LIBFREQGEN_SET_ERROR("can not register backend %s for tracing", name);
+        return -EINVAL;
+    }
+    struct trace_backend backend = { .id = nr_backends, .type = type };
+    strncpy(backend.name, name, sizeof(backend.name) - 1);
+    int ret = write_chunk(TRACE_CHUNK_BACKEND, &backend, sizeof(backend));
+    if (ret == 0)
+        ret = nr_backends++;
+    else
+        ret = -ret;
+    pthread_mutex_unlock(&trace_file_lock);
+    return ret;
+}
+
+int freq_gen_trace_enable(const char* path)
+{
+    /* discard events of a previous trace, there is no file, yet */
+    flush_buffers();
+
+    pthread_mutex_lock(&trace_file_lock);
+    if (trace_file != NULL)
+    {
+        pthread_mutex_unlock(&trace_file_lock);
+        LIBFREQGEN_SET_ERROR("tracing is already enabled");
+        return EBUSY;
+    }
+    trace_file = fopen(path, "wb");
+    if (trace_file == NULL)
+    {
+        pthread_mutex_unlock(&trace_file_lock);
+        LIBFREQGEN_SET_ERROR("could not open trace file \"%s\"", path);
+        return errno;
+    }
+
+    struct
+    {
+        struct trace_header header;
+        struct trace_field fields[NR_TRACE_FIELDS];
+    } header = { .header = { .version = TRACE_VERSION,
+                             .event_size = sizeof(freq_gen_trace_event_t),
+                             .tsc_hz = freq_gen_tsc_calibrate(10000000ULL),
+                             .nr_fields = NR_TRACE_FIELDS } };
+    memcpy(header.fields, trace_fields, sizeof(trace_fields));
+
+    if (fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, trace_file) != 1 ||
+        write_chunk(TRACE_CHUNK_HEADER, &header, sizeof(header)))
+    {
+        fclose(trace_file);
+        trace_file = NULL;
+        pthread_mutex_unlock(&trace_file_lock);
+        LIBFREQGEN_SET_ERROR("could not write trace header to \"%s\"", path);
+        return EIO;
+    }
+    nr_backends = 0;
+    atomic_store(&trace_dropped, 0);
+    pthread_mutex_unlock(&trace_file_lock);
+
+    flush_stop = false;
+    int ret = pthread_create(&flush_thread, NULL, flush_thread_main, NULL);
+    if (ret)
+    {
+        pthread_mutex_lock(&trace_file_lock);
+        fclose(trace_file);
+        trace_file = NULL;
+        pthread_mutex_unlock(&trace_file_lock);
+        LIBFREQGEN_SET_ERROR("could not create trace flush thread");
+        return ret;
+    }
+    atomic_store(&freq_gen_trace_active, true);
+    return 0;
+}
+
+int freq_gen_record_enable(const char* path)
+{
+    int ret = freq_gen_trace_enable(path);
+    if (ret == 0)
+        atomic_store(&freq_gen_trace_record_all, true);
+    return ret;
+}
+
+int freq_gen_trace_disable(void)
+{
+    if (!atomic_exchange(&freq_gen_trace_active, false))
+        return 0;
+    atomic_store(&freq_gen_trace_record_all, false);
+
+    pthread_mutex_lock(&flush_lock);
+    flush_stop = true;
+    pthread_cond_signal(&flush_cond);
+    pthread_mutex_unlock(&flush_lock);
+    pthread_join(flush_thread, NULL);
+
+    flush_buffers();
+
+    pthread_mutex_lock(&trace_file_lock);
+    struct trace_stats stats = { .dropped = atomic_load(&trace_dropped) };
+    int ret = write_chunk(TRACE_CHUNK_STATS, &stats, sizeof(stats));
+    if (fclose(trace_file) != 0)
+        ret = EIO;
+    trace_file = NULL;
+    pthread_mutex_unlock(&trace_file_lock);
+    if (ret)
+        LIBFREQGEN_SET_ERROR("could not finish trace file");
+    return ret;
+}
+
+static void disable_at_exit(void)
+{
+    freq_gen_trace_disable();
+}
+
+static void enable_from_env(void)
+{
+    char* path = getenv("LIBFREQGEN_RECORD");
+    bool record = path != NULL;
+    if (!record)
+        path = getenv("LIBFREQGEN_TRACE");
+    if (path != NULL && !atomic_load(&freq_gen_trace_active))
+    {
+        if ((record ? freq_gen_record_enable(path) : freq_gen_trace_enable(path)) == 0)
+            atexit(disable_at_exit);
+        else
+            fprintf(stderr, "libfreqgen: could not enable tracing to \"%s\"\n", path);
+    }
+}
+
+bool freq_gen_trace_check_env(void)
+{
+    /* the first backends can be initialized on several threads at once */
+    static pthread_once_t checked = PTHREAD_ONCE_INIT;
+    pthread_once(&checked, enable_from_env);
+    return atomic_load(&freq_gen_trace_active);
+}
@@ -0,0 +1,324 @@
+/*
+ * trace_reader.c
+ *
+ * Reads trace files written by trace.c and converts them to CSV or Chrome trace JSON. Events are
+ * decoded with the field descriptions from the file header, so that files with additional fields
+ * can still be read.
+ *
+ *  Created on: 19.10.2026
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_trace.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_trace.h"
+
+/* where a field of freq_gen_trace_event_t is located in the events of the file */
+struct field_mapping
+{
+    const char* name;
+    size_t event_offset;
+    size_t event_size;
+    int file_offset; /**< -1 if the field is not in the file */
+    int file_size;
+    int file_kind;
+};
+
+/* number of fields in freq_gen_trace_event_t */
+#define NR_MAPPED_FIELDS 10
+
+struct freq_gen_trace_reader_s
+{
+    char* data;
+    size_t size;
+    size_t position;
+    /* current events chunk */
+    size_t events_position;
+    size_t events_end;
+
+    uint32_t event_size;
+    double tsc_hz;
+    uint64_t dropped;
+    char backends[TRACE_MAX_BACKENDS][sizeof(((struct trace_backend*)0)->name) + 1];
+    struct field_mapping fields[NR_MAPPED_FIELDS];
+};
+
+#define MAP_FIELD(member)                                                                          \
+    {                                                                                              \
+        .name = #member, .event_offset = offsetof(freq_gen_trace_event_t, member),                 \
+        .event_size = sizeof(((freq_gen_trace_event_t*)0)->member), .file_offset = -1              \
+    }
+
+static const struct field_mapping default_mapping[NR_MAPPED_FIELDS] = {
+    MAP_FIELD(tsc_begin), MAP_FIELD(tsc_end), MAP_FIELD(value),
+    MAP_FIELD(tid),       MAP_FIELD(device),  MAP_FIELD(result),
+    MAP_FIELD(type),      MAP_FIELD(op),      MAP_FIELD(backend),
+    MAP_FIELD(setting),
+};
+
+static const char* op_names[] = { "unknown",
+                                  "set_frequency",
+                                  "set_min_frequency",
+                                  "init",
+                                  "init_device",
+                                  "close_device",
+                                  "prepare_set_frequency",
+                                  "unprepare_set_frequency",
+                                  "get_frequency",
+                                  "get_min_frequency",
+                                  "get_current_frequency",
+                                  "finalize" };
+
+static const char* op_name(int op)
+{
+    if (op > 0 && op < (int)(sizeof(op_names) / sizeof(op_names[0])))
+        return op_names[op];
+    return op_names[0];
+}
+
+/* reads the header chunk */
+static int parse_header(freq_gen_trace_reader_t* reader, const char* payload, uint32_t size)
+{
+    struct trace_header header;
+    if (size < sizeof(header))
+        return EINVAL;
+    memcpy(&header, payload, sizeof(header));
+    if (header.version != TRACE_VERSION ||
+        size < sizeof(header) + header.nr_fields * sizeof(struct trace_field))
+        return EINVAL;
+    reader->event_size = header.event_size;
+    reader->tsc_hz = header.tsc_hz;
+
+    const char* fields = payload + sizeof(header);
+    for (uint32_t i = 0; i < header.nr_fields; i++)
+    {
+        struct trace_field field;
+        memcpy(&field, fields + i * sizeof(field), sizeof(field));
+        field.name[sizeof(field.name) - 1] = '\0';
+        for (size_t j = 0; j < sizeof(reader->fields) / sizeof(reader->fields[0]); j++)
+        {
+            if (strcmp(reader->fields[j].name, field.name) == 0 &&
+                field.offset + field.size <= header.event_size && field.size <= 8)
+            {
+                reader->fields[j].file_offset = field.offset;
+                reader->fields[j].file_size = field.size;
+                reader->fields[j].file_kind = field.kind;
+            }
+        }
+    }
+    return 0;
+}
+
+freq_gen_trace_reader_t* freq_gen_trace_reader_open(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not open trace file \"%s\"", path);
+        return NULL;
+    }
+    freq_gen_trace_reader_t* reader = calloc(1, sizeof(freq_gen_trace_reader_t));
+    if (reader == NULL)
+    {
+        fclose(file);
+        LIBFREQGEN_SET_ERROR("could not allocate trace reader");
+        return NULL;
+    }
+    memcpy(reader->fields, default_mapping, sizeof(default_mapping));
+
+    /* traces are post-mortem data, so just read it completely */
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    reader->data = size > 0 ? malloc(size) : NULL;
+    if (reader->data == NULL || fread(reader->data, size, 1, file) != 1)
+    {
+        fclose(file);
+        freq_gen_trace_reader_close(reader);
+        LIBFREQGEN_SET_ERROR("could not read trace file \"%s\"", path);
+        return NULL;
+    }
+    fclose(file);
+    reader->size = size;
+
+    if (reader->size < sizeof(TRACE_MAGIC) || memcmp(reader->data, TRACE_MAGIC, sizeof(TRACE_MAGIC)))
+    {
+        freq_gen_trace_reader_close(reader);
+        LIBFREQGEN_SET_ERROR("\"%s\" is not a libfreqgen trace file", path);
+        return NULL;
+    }
+
+    /* read everything but events, so that backends and statistics are known in advance */
+    bool has_header = false;
+    for (size_t position = sizeof(TRACE_MAGIC); position + sizeof(struct trace_chunk) <= reader->size;)
+    {
+        struct trace_chunk chunk;
+        memcpy(&chunk, reader->data + position, sizeof(chunk));
+        position += sizeof(chunk);
+        if (position + chunk.size > reader->size)
+            break;
+        const char* payload = reader->data + position;
+        switch (chunk.kind)
+        {
+        case TRACE_CHUNK_HEADER:
+            if (parse_header(reader, payload, chunk.size) == 0)
+                has_header = true;
+            break;
+        case TRACE_CHUNK_BACKEND:
+            if (chunk.size >= sizeof(struct trace_backend))
+            {
+                struct trace_backend backend;
+                memcpy(&backend, payload, sizeof(backend));
+                memcpy(reader->backends[backend.id], backend.name, sizeof(backend.name));
+            }
+            break;
+        case TRACE_CHUNK_STATS:
+            if (chunk.size >= sizeof(struct trace_stats))
+                memcpy(&reader->dropped, payload, sizeof(reader->dropped));
+            break;
+        default:
+            break;
+        }
+        position += chunk.size;
+    }
+    if (!has_header)
+    {
+        freq_gen_trace_reader_close(reader);
+        LIBFREQGEN_SET_ERROR("trace file \"%s\" has no valid header", path);
+        return NULL;
+    }
+    reader->position = sizeof(TRACE_MAGIC);
+    return reader;
+}
+
+/* copies a field of an event in the file to the event struct, sign extends if necessary */
+static void decode_field(const struct field_mapping* mapping, const char* raw,
+                         freq_gen_trace_event_t* event)
+{
+    uint64_t value = 0;
+    if (mapping->file_offset < 0)
+        return;
+    memcpy(&value, raw + mapping->file_offset, mapping->file_size);
+    if (mapping->file_kind == TRACE_FIELD_SIGNED && mapping->file_size < 8 &&
+        (value & (1ULL << (mapping->file_size * 8 - 1))))
+        value |= ~0ULL << (mapping->file_size * 8);
+    memcpy((char*)event + mapping->event_offset, &value, mapping->event_size);
+}
+
+int freq_gen_trace_reader_next(freq_gen_trace_reader_t* reader, freq_gen_trace_event_t* event)
+{
+    while (reader->events_position + reader->event_size > reader->events_end)
+    {
+        /* find the next events chunk */
+        if (reader->position + sizeof(struct trace_chunk) > reader->size)
+            return 0;
+        struct trace_chunk chunk;
+        memcpy(&chunk, reader->data + reader->position, sizeof(chunk));
+        reader->position += sizeof(chunk);
+        if (reader->position + chunk.size > reader->size)
+        {
+            LIBFREQGEN_SET_ERROR("trace file is truncated");
+            return -EIO;
+        }
+        if (chunk.kind == TRACE_CHUNK_EVENTS)
+        {
+            reader->events_position = reader->position;
+            reader->events_end = reader->position + chunk.size;
+        }
+        reader->position += chunk.size;
+    }
+    memset(event, 0, sizeof(*event));
+    const char* raw = reader->data + reader->events_position;
+    for (size_t i = 0; i < sizeof(reader->fields) / sizeof(reader->fields[0]); i++)
+        decode_field(&reader->fields[i], raw, event);
+    reader->events_position += reader->event_size;
+    return 1;
+}
+
+double freq_gen_trace_reader_tsc_hz(freq_gen_trace_reader_t* reader)
+{
+    return reader->tsc_hz;
+}
+
+const char* freq_gen_trace_reader_backend(freq_gen_trace_reader_t* reader, int backend)
+{
+    if (backend < 0 || backend >= TRACE_MAX_BACKENDS || reader->backends[backend][0] == '\0')
+        return NULL;
+    return reader->backends[backend];
+}
+
+uint64_t freq_gen_trace_reader_dropped(freq_gen_trace_reader_t* reader)
+{
+    return reader->dropped;
+}
+
+void freq_gen_trace_reader_close(freq_gen_trace_reader_t* reader)
+{
+    if (reader == NULL)
+        return;
+    free(reader->data);
+    free(reader);
+}
+
+int freq_gen_trace_convert_csv(const char* path, FILE* out)
+{
+    freq_gen_trace_reader_t* reader = freq_gen_trace_reader_open(path);
+    if (reader == NULL)
+        return EIO;
+    freq_gen_trace_event_t event;
+    int ret;
+    fprintf(out,
+            "tsc_begin,tsc_end,duration_ns,tid,type,backend,op,device,value,result,setting\n");
+    while ((ret = freq_gen_trace_reader_next(reader, &event)) > 0)
+    {
+        const char* backend = freq_gen_trace_reader_backend(reader, event.backend);
+        fprintf(out, "%llu,%llu,%.0f,%u,%s,%s,%s,%d,%lld,%d,%u\n",
+                (unsigned long long)event.tsc_begin, (unsigned long long)event.tsc_end,
+                (event.tsc_end - event.tsc_begin) * 1e9 / reader->tsc_hz, event.tid,
+                event.type == FREQ_GEN_DEVICE_CORE_FREQ ? "core" : "uncore",
+                backend ? backend : "unknown", op_name(event.op), event.device,
+                (long long)event.value, event.result, event.setting);
+    }
+    freq_gen_trace_reader_close(reader);
+    return ret < 0 ? -ret : 0;
+}
+
+int freq_gen_trace_convert_chrome(const char* path, FILE* out)
+{
+    freq_gen_trace_reader_t* reader = freq_gen_trace_reader_open(path);
+    if (reader == NULL)
+        return EIO;
+    freq_gen_trace_event_t event;
+    int ret;
+    bool first = true;
+    uint64_t start = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    while ((ret = freq_gen_trace_reader_next(reader, &event)) > 0)
+    {
+        const char* backend = freq_gen_trace_reader_backend(reader, event.backend);
+        if (first)
+            start = event.tsc_begin;
+        /* timestamps in us relative to the first event */
+        double ts = (double)(int64_t)(event.tsc_begin - start) * 1e6 / reader->tsc_hz;
+        double dur = (double)(event.tsc_end - event.tsc_begin) * 1e6 / reader->tsc_hz;
+        fprintf(out,
+                "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":0,\"tid\":%u,\"args\":{\"backend\":\"%s\",\"device\":%d,"
+                "\"value\":%lld,\"result\":%d}}",
+                first ? "" : ",\n", op_name(event.op),
+                event.type == FREQ_GEN_DEVICE_CORE_FREQ ? "core" : "uncore", ts, dur, event.tid,
+                backend ? backend : "unknown", event.device, (long long)event.value,
+                event.result);
+        first = false;
+    }
+    fprintf(out, "\n]}\n");
+    freq_gen_trace_reader_close(reader);
+    return ret < 0 ? -ret : 0;
+}
@@ -0,0 +1,545 @@
+/*
+ * uncore_controller.c
+ *
+ * Implements the bandwidth driven uncore frequency controller, see freqgen_uncore_controller.h.
+ * All settings are prepared when the controller is created, so a control round only reads counters
+ * and calls set_frequency. For interfaces with a frequency range, set_frequency pins minimal and
+ * maximal frequency, so the measured bandwidth belongs to the selected frequency.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/error.h"
+#include "../include/freqgen_uncore_controller.h"
+#include "freq_gen_internal.h"
+#include "freq_gen_internal_cpuset.h"
+#include "freq_gen_internal_generic.h"
+#include "freq_gen_internal_perf.h"
+#include "freq_gen_internal_ring.h"
+
+#define CONTROLLER_DEFAULT_STEP 100000000LL
+#define CONTROLLER_DEFAULT_TOLERANCE 0.05
+#define CONTROLLER_DEFAULT_PHASE_CHANGE 0.3
+#define CONTROLLER_DEFAULT_INTERVAL 1000000ULL
+#define CONTROLLER_DEFAULT_LOG_SIZE 4096
+/* differences below these are not considered a phase change */
+#define CONTROLLER_BANDWIDTH_FLOOR 1e9
+#define CONTROLLER_MISS_RATE_FLOOR 1e6
+/* bytes per memory controller count */
+#define CONTROLLER_BYTES_PER_COUNT 64
+
+enum uncore_state
+{
+    STATE_PROBE,   /**< running at max_frequency, the next measurement is the reference */
+    STATE_DESCEND, /**< lowering the frequency while the bandwidth stays within tolerance */
+    STATE_HOLD     /**< found the frequency, waiting for a phase change */
+};
+
+struct controlled_uncore
+{
+    int nr;                      /**< uncore number */
+    freq_gen_single_device_t fp; /**< from init_device */
+    int* traffic_fds;
+    int nr_traffic_fds;
+    int* miss_fds;
+    int nr_miss_fds;
+
+    freq_gen_uncore_traffic_t last;
+    uint64_t last_time;
+    bool has_last;
+
+    int index; /**< index of the current frequency */
+    enum uncore_state state;
+    double reference_bandwidth;
+    double reference_miss_rate;
+    double hold_bandwidth; /**< <0 until measured at the held frequency */
+    double hold_miss_rate;
+};
+
+struct freq_gen_uncore_controller_s
+{
+    freq_gen_uncore_controller_config_t config;
+    struct controlled_uncore* uncores;
+    int nr_uncores;
+    freq_gen_setting_t* settings; /**< one per step between min_frequency and max_frequency */
+    int nr_settings;
+    freq_gen_ring_t log;
+
+    pthread_t thread;
+    bool running;
+    atomic_bool stop;
+
+    /* statistics, written by the controlling thread only */
+    atomic_uint_fast64_t rounds;
+    atomic_uint_fast64_t changes;
+    atomic_uint_fast64_t phases;
+    atomic_uint_fast64_t errors;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+};
+
+static long long int frequency_of(freq_gen_uncore_controller_t* controller, int index)
+{
+    long long int frequency = controller->config.min_frequency + index * controller->config.step;
+    return frequency > controller->config.max_frequency ? controller->config.max_frequency
+                                                        : frequency;
+}
+
+/* opens LLC miss counters on all cpus of /sys/devices/system/node/node(nr) */
+static int open_miss_counters(struct controlled_uncore* uncore)
+{
+    char path[BUFFER_SIZE];
+    char cpulist[BUFFER_SIZE];
+    snprintf(path, BUFFER_SIZE, "/sys/devices/system/node/node%d/cpulist", uncore->nr);
+    FILE* file = fopen(path, "r");
+    if (file == NULL || fgets(cpulist, BUFFER_SIZE, file) == NULL)
+    {
+        if (file != NULL)
+            fclose(file);
+        LIBFREQGEN_SET_ERROR("could not read \"%s\"", path);
+        return -EIO;
+    }
+    fclose(file);
+
+    unsigned long* mask;
+    int nr_bits;
+    int ret = freq_gen_cpulist_parse(cpulist, &mask, &nr_bits);
+    if (ret)
+        return -ret;
+    const int bits = sizeof(unsigned long) * 8;
+    uncore->miss_fds = malloc(nr_bits * sizeof(int));
+    if (uncore->miss_fds == NULL)
+    {
+        free(mask);
+        LIBFREQGEN_SET_ERROR("could not allocate memory for LLC miss counters");
+        return -ENOMEM;
+    }
+    for (int cpu = 0; cpu < nr_bits; cpu++)
+    {
+        if (!(mask[cpu / bits] & (1UL << (cpu % bits))))
+            continue;
+        int fd = freq_gen_perf_open_hardware(PERF_COUNT_HW_CACHE_MISSES, cpu, -1);
+        if (fd < 0)
+        {
+            free(mask);
+            LIBFREQGEN_APPEND_ERROR("could not open LLC miss counter for uncore %d", uncore->nr);
+            return fd;
+        }
+        uncore->miss_fds[uncore->nr_miss_fds++] = fd;
+    }
+    free(mask);
+    return 0;
+}
+
+static void close_uncore(freq_gen_uncore_controller_t* controller,
+                         struct controlled_uncore* uncore)
+{
+    for (int i = 0; i < uncore->nr_traffic_fds; i++)
+        close(uncore->traffic_fds[i]);
+    for (int i = 0; i < uncore->nr_miss_fds; i++)
+        close(uncore->miss_fds[i]);
+    free(uncore->traffic_fds);
+    free(uncore->miss_fds);
+    controller->config.interface->close_device(uncore->nr, uncore->fp);
+}
+
+static int open_uncore(freq_gen_uncore_controller_t* controller, struct controlled_uncore* uncore,
+                       int nr)
+{
+    freq_gen_interface_t* interface = controller->config.interface;
+    uncore->nr = nr;
+    uncore->state = STATE_PROBE;
+    uncore->index = controller->nr_settings - 1;
+    uncore->fp = interface->init_device(nr);
+    if (uncore->fp < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not open device %d of %s", nr, interface->name);
+        return uncore->fp;
+    }
+    int ret = 0;
+    if (controller->config.measure == NULL)
+    {
+        int cpu = freq_gen_get_uncore_leader_cpu(nr);
+        ret = cpu < 0 ? cpu : freq_gen_perf_open_memory_traffic(cpu, &uncore->traffic_fds);
+        if (ret >= 0)
+        {
+            uncore->nr_traffic_fds = ret;
+            ret = 0;
+        }
+        if (ret == 0 && controller->config.count_llc_misses)
+            ret = open_miss_counters(uncore);
+    }
+    if (ret)
+    {
+        close_uncore(controller, uncore);
+        LIBFREQGEN_APPEND_ERROR("could not open counters for uncore %d", nr);
+    }
+    return ret;
+}
+
+freq_gen_uncore_controller_t* freq_gen_uncore_controller_create(
+    const freq_gen_uncore_controller_config_t* config)
+{
+    if (config == NULL || config->interface == NULL || config->min_frequency <= 0 ||
+        config->max_frequency < config->min_frequency || config->tolerance < 0 ||
+        config->tolerance >= 1)
+    {
+        LIBFREQGEN_SET_ERROR("invalid uncore controller configuration");
+        return NULL;
+    }
+    freq_gen_uncore_controller_t* controller = calloc(1, sizeof(freq_gen_uncore_controller_t));
+    if (controller == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate %zu bytes for uncore controller",
+                             sizeof(freq_gen_uncore_controller_t));
+        return NULL;
+    }
+    controller->config = *config;
+    controller->config.uncores = NULL;
+    if (controller->config.step <= 0)
+        controller->config.step = CONTROLLER_DEFAULT_STEP;
+    if (controller->config.tolerance == 0)
+        controller->config.tolerance = CONTROLLER_DEFAULT_TOLERANCE;
+    if (controller->config.phase_change <= 0)
+        controller->config.phase_change = CONTROLLER_DEFAULT_PHASE_CHANGE;
+    if (controller->config.interval_ns == 0)
+        controller->config.interval_ns = CONTROLLER_DEFAULT_INTERVAL;
+    atomic_init(&controller->stop, false);
+    atomic_init(&controller->rounds, 0);
+    atomic_init(&controller->changes, 0);
+    atomic_init(&controller->phases, 0);
+    atomic_init(&controller->errors, 0);
+    atomic_init(&controller->dropped, 0);
+    atomic_init(&controller->total_ns, 0);
+    atomic_init(&controller->max_ns, 0);
+
+    if (freq_gen_ring_init(&controller->log,
+                           config->log_size ? config->log_size : CONTROLLER_DEFAULT_LOG_SIZE,
+                           sizeof(freq_gen_uncore_decision_t)))
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate decision log for uncore controller");
+        free(controller);
+        return NULL;
+    }
+
+    /* the last setting is max_frequency, even if it is not on the grid */
+    long long int range = config->max_frequency - config->min_frequency;
+    controller->nr_settings = (range + controller->config.step - 1) / controller->config.step + 1;
+    controller->settings = calloc(controller->nr_settings, sizeof(freq_gen_setting_t));
+    if (controller->settings == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for settings");
+        freq_gen_uncore_controller_destroy(controller);
+        return NULL;
+    }
+    for (int i = 0; i < controller->nr_settings; i++)
+    {
+        controller->settings[i] =
+            config->interface->prepare_set_frequency(frequency_of(controller, i), 0);
+        if (controller->settings[i] == NULL)
+        {
+            LIBFREQGEN_APPEND_ERROR("could not prepare %lld Hz", frequency_of(controller, i));
+            freq_gen_uncore_controller_destroy(controller);
+            return NULL;
+        }
+    }
+
+    int nr_uncores = config->uncores ? config->nr_uncores : config->interface->get_num_devices();
+    if (nr_uncores < 0)
+    {
+        LIBFREQGEN_APPEND_ERROR("could not get the number of devices for %s",
+                                config->interface->name);
+        freq_gen_uncore_controller_destroy(controller);
+        return NULL;
+    }
+    controller->uncores = calloc(nr_uncores, sizeof(struct controlled_uncore));
+    if (controller->uncores == NULL)
+    {
+        LIBFREQGEN_SET_ERROR("could not allocate memory for %d uncores", nr_uncores);
+        freq_gen_uncore_controller_destroy(controller);
+        return NULL;
+    }
+    for (int i = 0; i < nr_uncores; i++)
+    {
+        int nr = config->uncores ? config->uncores[i] : i;
+        if (open_uncore(controller, &controller->uncores[i], nr))
+        {
+            LIBFREQGEN_APPEND_ERROR("could not create uncore controller");
+            freq_gen_uncore_controller_destroy(controller);
+            return NULL;
+        }
+        controller->nr_uncores++;
+    }
+    return controller;
+}
+
+static int measure(freq_gen_uncore_controller_t* controller, struct controlled_uncore* uncore,
+                   freq_gen_uncore_traffic_t* traffic)
+{
+    if (controller->config.measure != NULL)
+        return controller->config.measure(uncore->nr, traffic, controller->config.measure_data);
+    *traffic = (freq_gen_uncore_traffic_t){ 0 };
+    for (int i = 0; i < uncore->nr_traffic_fds; i++)
+    {
+        uint64_t value;
+        if (freq_gen_perf_read(uncore->traffic_fds[i], &value))
+            return EIO;
+        traffic->bytes += value * CONTROLLER_BYTES_PER_COUNT;
+    }
+    for (int i = 0; i < uncore->nr_miss_fds; i++)
+    {
+        uint64_t value;
+        if (freq_gen_perf_read(uncore->miss_fds[i], &value))
+            return EIO;
+        traffic->llc_misses += value;
+    }
+    return 0;
+}
+
+static bool phase_changed(double value, double previous, double floor, double threshold)
+{
+    double scale = fmax(fmax(value, previous), floor);
+    return fabs(value - previous) / scale > threshold;
+}
+
+/* sets the frequency at index and logs the decision, returns 1 on success or -ERRNO */
+static int change(freq_gen_uncore_controller_t* controller, struct controlled_uncore* uncore,
+                  int index, freq_gen_uncore_decision_reason reason, uint64_t now,
+                  double bandwidth, double miss_rate)
+{
+    int ret = controller->config.interface->set_frequency(uncore->fp, controller->settings[index]);
+    if (ret)
+        return -ret;
+    uncore->index = index;
+    atomic_fetch_add_explicit(&controller->changes, 1, memory_order_relaxed);
+    freq_gen_uncore_decision_t decision = { .timestamp = now,
+                                            .uncore = uncore->nr,
+                                            .reason = reason,
+                                            .frequency = frequency_of(controller, index),
+                                            .bandwidth = bandwidth,
+                                            .reference = uncore->reference_bandwidth,
+                                            .llc_miss_rate = miss_rate };
+    if (freq_gen_ring_push(&controller->log, &decision))
+        atomic_fetch_add_explicit(&controller->dropped, 1, memory_order_relaxed);
+    return 1;
+}
+
+/* restarts the search at max_frequency */
+static int probe(freq_gen_uncore_controller_t* controller, struct controlled_uncore* uncore,
+                 uint64_t now, double bandwidth, double miss_rate)
+{
+    uncore->state = STATE_PROBE;
+    return change(controller, uncore, controller->nr_settings - 1, FREQ_GEN_UNCORE_DECISION_PROBE,
+                  now, bandwidth, miss_rate);
+}
+
+/* one control round for an uncore, returns the number of changes or -ERRNO */
+static int control_uncore(freq_gen_uncore_controller_t* controller,
+                          struct controlled_uncore* uncore, uint64_t now)
+{
+    const freq_gen_uncore_controller_config_t* config = &controller->config;
+    freq_gen_uncore_traffic_t traffic;
+    int ret = measure(controller, uncore, &traffic);
+    if (ret)
+        return -ret;
+    if (!uncore->has_last || now <= uncore->last_time)
+    {
+        bool first = !uncore->has_last;
+        uncore->last = traffic;
+        uncore->last_time = now;
+        uncore->has_last = true;
+        return first ? probe(controller, uncore, now, 0, 0) : 0;
+    }
+    double seconds = (now - uncore->last_time) / 1e9;
+    double bandwidth = (traffic.bytes - uncore->last.bytes) / seconds;
+    double miss_rate = (traffic.llc_misses - uncore->last.llc_misses) / seconds;
+    uncore->last = traffic;
+    uncore->last_time = now;
+
+    switch (uncore->state)
+    {
+    case STATE_PROBE:
+        uncore->reference_bandwidth = bandwidth;
+        uncore->reference_miss_rate = miss_rate;
+        uncore->state = STATE_DESCEND;
+        /* fall through */
+    case STATE_DESCEND:
+        if (bandwidth > uncore->reference_bandwidth * (1 + config->phase_change) &&
+            bandwidth > CONTROLLER_BANDWIDTH_FLOOR)
+        {
+            atomic_fetch_add_explicit(&controller->phases, 1, memory_order_relaxed);
+            return probe(controller, uncore, now, bandwidth, miss_rate);
+        }
+        if (bandwidth >= (1 - config->tolerance) * uncore->reference_bandwidth)
+        {
+            if (uncore->index > 0)
+                return change(controller, uncore, uncore->index - 1,
+                              FREQ_GEN_UNCORE_DECISION_LOWER, now, bandwidth, miss_rate);
+            uncore->state = STATE_HOLD;
+            uncore->hold_bandwidth = bandwidth;
+            uncore->hold_miss_rate = miss_rate;
+            return 0;
+        }
+        uncore->state = STATE_HOLD;
+        uncore->hold_bandwidth = -1;
+        if (uncore->index + 1 >= controller->nr_settings)
+            return 0;
+        return change(controller, uncore, uncore->index + 1, FREQ_GEN_UNCORE_DECISION_RAISE, now,
+                      bandwidth, miss_rate);
+    case STATE_HOLD:
+        if (uncore->hold_bandwidth < 0)
+        {
+            uncore->hold_bandwidth = bandwidth;
+            uncore->hold_miss_rate = miss_rate;
+            return 0;
+        }
+        if (phase_changed(bandwidth, uncore->hold_bandwidth, CONTROLLER_BANDWIDTH_FLOOR,
+                          config->phase_change) ||
+            phase_changed(miss_rate, uncore->hold_miss_rate, CONTROLLER_MISS_RATE_FLOOR,
+                          config->phase_change))
+        {
+            atomic_fetch_add_explicit(&controller->phases, 1, memory_order_relaxed);
+            return probe(controller, uncore, now, bandwidth, miss_rate);
+        }
+        return 0;
+    }
+    return 0;
+}
+
+int freq_gen_uncore_controller_step(freq_gen_uncore_controller_t* controller, uint64_t now)
+{
+    uint64_t start = freq_gen_now_ns();
+    int changes = 0;
+    int error = 0;
+    for (int i = 0; i < controller->nr_uncores; i++)
+    {
+        int ret = control_uncore(controller, &controller->uncores[i], now);
+        if (ret < 0)
+        {
+            atomic_fetch_add_explicit(&controller->errors, 1, memory_order_relaxed);
+            error = ret;
+        }
+        else
+            changes += ret;
+    }
+    uint64_t duration = freq_gen_now_ns() - start;
+    atomic_fetch_add_explicit(&controller->rounds, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&controller->total_ns, duration, memory_order_relaxed);
+    if (duration > atomic_load_explicit(&controller->max_ns, memory_order_relaxed))
+        atomic_store_explicit(&controller->max_ns, duration, memory_order_relaxed);
+    return changes > 0 || error == 0 ? changes : error;
+}
+
+static void* controller_thread(void* arg)
+{
+    freq_gen_uncore_controller_t* controller = arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!atomic_load_explicit(&controller->stop, memory_order_relaxed))
+    {
+        freq_gen_uncore_controller_step(controller, freq_gen_now_ns());
+
+        /* fixed rate: next period starts interval_ns after the previous one */
+        uint64_t next_ns = next.tv_nsec + controller->config.interval_ns;
+        next.tv_sec += next_ns / 1000000000ULL;
+        next.tv_nsec = next_ns % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+int freq_gen_uncore_controller_start(freq_gen_uncore_controller_t* controller)
+{
+    if (controller->running)
+    {
+        LIBFREQGEN_SET_ERROR("uncore controller is already running");
+        return EBUSY;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (controller->config.cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(controller->config.cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    atomic_store(&controller->stop, false);
+    int ret = pthread_create(&controller->thread, &attr, controller_thread, controller);
+    pthread_attr_destroy(&attr);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not create uncore controller thread (pinned to cpu %d)",
+                             controller->config.cpu);
+        return ret;
+    }
+    controller->running = true;
+    return 0;
+}
+
+int freq_gen_uncore_controller_stop(freq_gen_uncore_controller_t* controller)
+{
+    if (!controller->running)
+        return 0;
+    atomic_store(&controller->stop, true);
+    int ret = pthread_join(controller->thread, NULL);
+    if (ret)
+    {
+        LIBFREQGEN_SET_ERROR("could not join uncore controller thread");
+        return ret;
+    }
+    controller->running = false;
+    return 0;
+}
+
+size_t freq_gen_uncore_controller_drain(freq_gen_uncore_controller_t* controller,
+                                        freq_gen_uncore_decision_t* decisions, size_t max)
+{
+    return freq_gen_ring_pop(&controller->log, decisions, max);
+}
+
+void freq_gen_uncore_controller_get_stats(freq_gen_uncore_controller_t* controller,
+                                          freq_gen_uncore_controller_stats_t* stats)
+{
+    stats->rounds = atomic_load_explicit(&controller->rounds, memory_order_relaxed);
+    stats->changes = atomic_load_explicit(&controller->changes, memory_order_relaxed);
+    stats->phases = atomic_load_explicit(&controller->phases, memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&controller->errors, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&controller->dropped, memory_order_relaxed);
+    stats->max_ns_per_round = atomic_load_explicit(&controller->max_ns, memory_order_relaxed);
+    uint64_t total_ns = atomic_load_explicit(&controller->total_ns, memory_order_relaxed);
+    stats->ns_per_round = stats->rounds ? (double)total_ns / stats->rounds : 0.0;
+}
+
+void freq_gen_uncore_controller_destroy(freq_gen_uncore_controller_t* controller)
+{
+    if (controller == NULL)
+        return;
+    freq_gen_uncore_controller_stop(controller);
+    for (int i = 0; i < controller->nr_uncores; i++)
+        close_uncore(controller, &controller->uncores[i]);
+    for (int i = 0; i < controller->nr_settings && controller->settings != NULL; i++)
+        if (controller->settings[i] != NULL)
+            controller->config.interface->unprepare_set_frequency(controller->settings[i]);
+    freq_gen_ring_destroy(&controller->log);
+    free(controller->settings);
+    free(controller->uncores);
+    free(controller);
+}
@@ -0,0 +1,59 @@
+/*
+ * util.c
+ *
+ * Implements the helpers of freq_gen_internal_util.h
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "freq_gen_internal_msr.h"
+#include "freq_gen_internal_util.h"
+
+int freq_gen_read_small_file(const char* path, char* buffer, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+    ssize_t read_bytes = read(fd, buffer, size - 1);
+    int error = errno;
+    close(fd);
+    if (read_bytes < 0)
+        return error;
+    if ((size_t)read_bytes == size - 1)
+        return ENOMEM;
+    buffer[read_bytes] = '\0';
+    if (read_bytes > 0 && buffer[read_bytes - 1] == '\n')
+        buffer[read_bytes - 1] = '\0';
+    return 0;
+}
+
+int freq_gen_parse_frequency(const char* string, long long int* frequency)
+{
+    char* end;
+    double value = strtod(string, &end);
+    if (end == string || value < 0)
+        return EINVAL;
+    if (strcasecmp(end, "GHz") == 0)
+        value *= 1e9;
+    else if (strcasecmp(end, "MHz") == 0)
+        value *= 1e6;
+    else if (strcasecmp(end, "kHz") == 0)
+        value *= 1e3;
+    else if (*end != '\0' && strcasecmp(end, "Hz") != 0)
+        return EINVAL;
+    *frequency = (long long int)(value + 0.5);
+    return 0;
+}
+
+long long int freq_gen_current_frequency_window(freq_gen_interface_t* interface,
+                                                freq_gen_single_device_t device)
+{
+    long long int window = freq_gen_msr_current_frequency_window(interface, device);
+    return window > 0 ? window : 0;
+}
@@ -0,0 +1,468 @@
+/*
+ * wait.c
+ *
+ * A preload library that lowers the core frequency while a thread is blocked. Load it with
+ * LD_PRELOAD=libfreqgen-wait.so.
+ *
+ * poll, ppoll, select, epoll_wait, nanosleep, clock_nanosleep, usleep, futex waits issued with
+ * syscall() and, if built with MPI, blocking MPI calls are wrapped. Every thread keeps an estimate
+ * of the duration of the calls at each call site (an exponential moving average in TSC ticks). If
+ * the predicted wait is at least the threshold, the cpu of the thread is set to the wait frequency
+ * before the call and restored afterwards. Calls with a timeout use the timeout if it is shorter
+ * than the estimate, non-blocking calls (timeout 0) are not measured. The wait setting is
+ * prepared at startup, so calls that do not switch only read the TSC and update the estimate.
+ *
+ * The first waiter on a cpu reads its current setting before lowering it, and the last waiter
+ * restores that setting, so changes made by the application (or other tools) between waits are
+ * kept. Settings for restored frequencies are prepared once and cached.
+ *
+ * The frequency is a property of the cpu, not of the thread: other threads that the scheduler
+ * runs on a lowered cpu while a thread waits there also run at the wait frequency until the wait
+ * ends. Pin compute threads to their own cpus if this matters.
+ *
+ * Environment:
+ *   LIBFREQGEN_WAIT_FREQUENCY  core frequency in Hz during waits, the library is inactive without
+ *   LIBFREQGEN_WAIT_THRESHOLD  minimal predicted wait in ns for a switch, default 100000
+ *   LIBFREQGEN_WAIT_REPORT     print the number of switches at exit
+ *
+ * Select the sim interface (LIBFREQGEN_CORE_INTERFACE=sim, see freqgen_sim.h) to test without
+ * hardware, the report then includes the number of simulated frequency transitions.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef FREQGEN_WAIT_MPI
+#include <mpi.h>
+#endif
+
+#include "../include/freqgen.h"
+#include "../include/freqgen_session.h"
+#include "../include/freqgen_sim.h"
+#include "freq_gen_internal_tsc.h"
+
+#define WAIT_SITES 256
+#define WAIT_DEFAULT_THRESHOLD_NS 100000ULL
+/* the estimate moves by 1/2^WAIT_EWMA_SHIFT of the error per call */
+#define WAIT_EWMA_SHIFT 2
+/* distinct frequencies whose settings are cached for restoring */
+#define WAIT_MAX_RESTORE_SETTINGS 64
+
+struct site
+{
+    uintptr_t address;
+    int64_t estimate; /**< in TSC ticks */
+};
+
+struct cpu_state
+{
+    freq_gen_single_device_t handle;
+    bool available; /**< the cpu is part of the session */
+    /** the setting found when the first waiter lowered the cpu, NULL if unknown */
+    _Atomic(freq_gen_setting_t) restore;
+    _Atomic int waiters;
+} __attribute__((aligned(64)));
+
+struct restore_setting
+{
+    long long int frequency;
+    freq_gen_setting_t setting;
+};
+
+struct wait
+{
+    struct site* site;
+    uint64_t start;
+    int cpu; /**< the lowered cpu or -1 */
+};
+
+static int (*real_poll)(struct pollfd*, nfds_t, int);
+static int (*real_ppoll)(struct pollfd*, nfds_t, const struct timespec*, const sigset_t*);
+static int (*real_select)(int, fd_set*, fd_set*, fd_set*, struct timeval*);
+static int (*real_epoll_wait)(int, struct epoll_event*, int, int);
+static int (*real_nanosleep)(const struct timespec*, struct timespec*);
+static int (*real_clock_nanosleep)(clockid_t, int, const struct timespec*, struct timespec*);
+static int (*real_usleep)(useconds_t);
+static long (*real_syscall)(long, ...);
+
+static bool active;
+static bool report;
+static freq_gen_interface_t* interface;
+static freq_gen_session_t* session;
+static freq_gen_setting_t wait_setting;
+static long long int wait_frequency;
+static struct restore_setting restore_settings[WAIT_MAX_RESTORE_SETTINGS];
+static int nr_restore_settings;
+static pthread_mutex_t restore_settings_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cpu_state* cpus;
+static int nr_cpus;
+static uint64_t threshold; /**< in TSC ticks */
+static double ticks_per_ns;
+
+static _Atomic uint64_t switches;
+static _Atomic uint64_t short_switches; /**< switches for waits shorter than the threshold */
+static _Atomic uint64_t switched_ticks;
+
+static __thread struct site sites[WAIT_SITES];
+/* set while the library itself changes frequencies, so its own calls are not wrapped */
+static __thread bool in_wait;
+
+static inline uint64_t ns_to_ticks(uint64_t ns)
+{
+    return ns * ticks_per_ns;
+}
+
+static inline uint64_t timespec_to_ticks(const struct timespec* ts)
+{
+    return ns_to_ticks((uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec);
+}
+
+/* returns a prepared setting for frequency, NULL if it can not be prepared */
+static freq_gen_setting_t restore_setting_of(long long int frequency)
+{
+    freq_gen_setting_t setting = NULL;
+    pthread_mutex_lock(&restore_settings_lock);
+    for (int i = 0; i < nr_restore_settings && setting == NULL; i++)
+        if (restore_settings[i].frequency == frequency)
+            setting = restore_settings[i].setting;
+    if (setting == NULL && nr_restore_settings < WAIT_MAX_RESTORE_SETTINGS)
+    {
+        setting = interface->prepare_set_frequency(frequency, 0);
+        if (setting != NULL)
+            restore_settings[nr_restore_settings++] =
+                (struct restore_setting){ .frequency = frequency, .setting = setting };
+    }
+    pthread_mutex_unlock(&restore_settings_lock);
+    return setting;
+}
+
+/*
+ * remembers the current setting of a cpu before it is lowered. If the cpu is still at the wait
+ * frequency, e.g., because the restore of the previous waiter has not been written yet, the
+ * previous setting is kept.
+ */
+static void save_restore_setting(struct cpu_state* cpu)
+{
+    long long int current = interface->get_frequency(cpu->handle);
+    if (current <= 0 || current == wait_frequency)
+        return;
+    freq_gen_setting_t setting = restore_setting_of(current);
+    if (setting != NULL)
+        atomic_store_explicit(&cpu->restore, setting, memory_order_release);
+}
+
+/*
+ * @param address the call site
+ * @param limit upper bound of the wait in TSC ticks, UINT64_MAX if unknown
+ */
+static inline void wait_begin(struct wait* wait, const void* address, uint64_t limit)
+{
+    wait->site = NULL;
+    wait->cpu = -1;
+    if (!active || in_wait || limit == 0)
+        return;
+    uintptr_t key = (uintptr_t)address;
+    struct site* site = &sites[(key ^ (key >> 8) ^ (key >> 16)) & (WAIT_SITES - 1)];
+    if (site->address != key)
+    {
+        site->address = key;
+        site->estimate = 0;
+    }
+    wait->site = site;
+    uint64_t predicted = (uint64_t)site->estimate < limit ? (uint64_t)site->estimate : limit;
+    if (predicted >= threshold)
+    {
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && cpu < nr_cpus && cpus[cpu].available)
+        {
+            wait->cpu = cpu;
+            if (atomic_fetch_add_explicit(&cpus[cpu].waiters, 1, memory_order_acq_rel) == 0)
+            {
+                in_wait = true;
+                save_restore_setting(&cpus[cpu]);
+                /* without a setting to restore, the cpu is not lowered */
+                if (atomic_load_explicit(&cpus[cpu].restore, memory_order_relaxed) != NULL)
+                    interface->set_frequency(cpus[cpu].handle, wait_setting);
+                in_wait = false;
+            }
+        }
+    }
+    wait->start = freq_gen_tsc_read();
+}
+
+static inline void wait_end(struct wait* wait)
+{
+    if (wait->site == NULL)
+        return;
+    int saved_errno = errno;
+    int64_t duration = freq_gen_tsc_read() - wait->start;
+    wait->site->estimate += (duration - wait->site->estimate) >> WAIT_EWMA_SHIFT;
+    if (wait->cpu >= 0)
+    {
+        struct cpu_state* cpu = &cpus[wait->cpu];
+        if (atomic_fetch_sub_explicit(&cpu->waiters, 1, memory_order_acq_rel) == 1)
+        {
+            freq_gen_setting_t restore =
+                atomic_load_explicit(&cpu->restore, memory_order_acquire);
+            in_wait = true;
+            if (restore != NULL)
+                interface->set_frequency(cpu->handle, restore);
+            in_wait = false;
+        }
+        atomic_fetch_add_explicit(&switches, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&switched_ticks, duration, memory_order_relaxed);
+        if ((uint64_t)duration < threshold)
+            atomic_fetch_add_explicit(&short_switches, 1, memory_order_relaxed);
+    }
+    errno = saved_errno;
+}
+
+int poll(struct pollfd* fds, nfds_t nfds, int timeout)
+{
+    struct wait wait;
+    wait_begin(&wait, __builtin_return_address(0),
+               timeout < 0 ? UINT64_MAX : ns_to_ticks(timeout * 1000000ULL));
+    int result = real_poll(fds, nfds, timeout);
+    wait_end(&wait);
+    return result;
+}
+
+int ppoll(struct pollfd* fds, nfds_t nfds, const struct timespec* timeout, const sigset_t* sigmask)
+{
+    struct wait wait;
+    wait_begin(&wait, __builtin_return_address(0),
+               timeout == NULL ? UINT64_MAX : timespec_to_ticks(timeout));
+    int result = real_ppoll(fds, nfds, timeout, sigmask);
+    wait_end(&wait);
+    return result;
+}
+
+int select(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout)
+{
+    struct wait wait;
+    wait_begin(&wait, __builtin_return_address(0),
+               timeout == NULL ? UINT64_MAX
+                               : ns_to_ticks((uint64_t)timeout->tv_sec * 1000000000ULL +
+                                             timeout->tv_usec * 1000ULL));
+    int result = real_select(nfds, readfds, writefds, exceptfds, timeout);
+    wait_end(&wait);
+    return result;
+}
+
+int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout)
+{
+    struct wait wait;
+    wait_begin(&wait, __builtin_return_address(0),
+               timeout < 0 ? UINT64_MAX : ns_to_ticks(timeout * 1000000ULL));
+    int result = real_epoll_wait(epfd, events, maxevents, timeout);
+    wait_end(&wait);
+    return result;
+}
+
+int nanosleep(const struct timespec* req, struct timespec* rem)
+{
+    /* the real call fails with EFAULT */
+    if (req == NULL)
+        return real_nanosleep(req, rem);
+    struct wait wait;
+    wait_begin(&wait, __builtin_return_address(0), timespec_to_ticks(req));
+    int result = real_nanosleep(req, rem);
+    wait_end(&wait);
+    return result;
+}
+
+int clock_nanosleep(clockid_t clockid, int flags, const struct timespec* request,
+                    struct timespec* remain)
+{
+    if (request == NULL)
+        return real_clock_nanosleep(clockid, flags, request, remain);
+    struct wait wait;
+    uint64_t limit = UINT64_MAX;
+    if (!(flags & TIMER_ABSTIME))
+        limit = timespec_to_ticks(request);
+    wait_begin(&wait, __builtin_return_address(0), limit);
+    int result = real_clock_nanosleep(clockid, flags, request, remain);
+    wait_end(&wait);
+    return result;
+}
+
+int usleep(useconds_t usec)
+{
+    struct wait wait;
+    wait_begin(&wait, __builtin_return_address(0), ns_to_ticks(usec * 1000ULL));
+    int result = real_usleep(usec);
+    wait_end(&wait);
+    return result;
+}
+
+long syscall(long number, ...)
+{
+    va_list args;
+    va_start(args, number);
+    long a = va_arg(args, long), b = va_arg(args, long), c = va_arg(args, long);
+    long d = va_arg(args, long), e = va_arg(args, long), f = va_arg(args, long);
+    va_end(args);
+    struct wait wait = { .site = NULL };
+    if (number == SYS_futex &&
+        ((b & FUTEX_CMD_MASK) == FUTEX_WAIT || (b & FUTEX_CMD_MASK) == FUTEX_WAIT_BITSET))
+    {
+        /* the timeout of FUTEX_WAIT_BITSET is absolute */
+        const struct timespec* timeout = (const struct timespec*)d;
+        wait_begin(&wait, __builtin_return_address(0),
+                   timeout == NULL || (b & FUTEX_CMD_MASK) == FUTEX_WAIT_BITSET
+                       ? UINT64_MAX
+                       : timespec_to_ticks(timeout));
+    }
+    long result = real_syscall(number, a, b, c, d, e, f);
+    wait_end(&wait);
+    return result;
+}
+
+#ifdef FREQGEN_WAIT_MPI
+
+#define WAIT_MPI(call)                                                                             \
+    struct wait wait;                                                                              \
+    wait_begin(&wait, __builtin_return_address(0), UINT64_MAX);                                    \
+    int result = call;                                                                             \
+    wait_end(&wait);                                                                               \
+    return result;
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status)
+{
+    WAIT_MPI(PMPI_Wait(request, status))
+}
+
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[])
+{
+    WAIT_MPI(PMPI_Waitall(count, requests, statuses))
+}
+
+int MPI_Waitany(int count, MPI_Request requests[], int* index, MPI_Status* status)
+{
+    WAIT_MPI(PMPI_Waitany(count, requests, index, status))
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm,
+             MPI_Status* status)
+{
+    WAIT_MPI(PMPI_Recv(buf, count, datatype, source, tag, comm, status))
+}
+
+int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status* status)
+{
+    WAIT_MPI(PMPI_Probe(source, tag, comm, status))
+}
+
+int MPI_Barrier(MPI_Comm comm)
+{
+    WAIT_MPI(PMPI_Barrier(comm))
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op,
+                  MPI_Comm comm)
+{
+    WAIT_MPI(PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm))
+}
+
+#endif /* FREQGEN_WAIT_MPI */
+
+/* prepares the wait setting and the current frequency of every cpu */
+static int prepare_cpus(long long int frequency)
+{
+    nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+    cpus = calloc(nr_cpus, sizeof(struct cpu_state));
+    if (cpus == NULL)
+        return ENOMEM;
+    wait_setting = interface->prepare_set_frequency(frequency, 0);
+    if (wait_setting == NULL)
+        return EINVAL;
+    wait_frequency = frequency;
+    for (int cpu = 0; cpu < nr_cpus; cpu++)
+    {
+        int index = freq_gen_session_find_device(session, cpu);
+        if (index < 0)
+            continue;
+        cpus[cpu].handle = freq_gen_session_get_handle(session, index);
+        cpus[cpu].available = true;
+        /* a fallback for the first wait, in case the cpu is already at the wait frequency */
+        long long int current = interface->get_frequency(cpus[cpu].handle);
+        if (current > 0)
+            atomic_store(&cpus[cpu].restore, restore_setting_of(current));
+    }
+    return 0;
+}
+
+__attribute__((constructor)) static void wait_init(void)
+{
+    real_poll = dlsym(RTLD_NEXT, "poll");
+    real_ppoll = dlsym(RTLD_NEXT, "ppoll");
+    real_select = dlsym(RTLD_NEXT, "select");
+    real_epoll_wait = dlsym(RTLD_NEXT, "epoll_wait");
+    real_nanosleep = dlsym(RTLD_NEXT, "nanosleep");
+    real_clock_nanosleep = dlsym(RTLD_NEXT, "clock_nanosleep");
+    real_usleep = dlsym(RTLD_NEXT, "usleep");
+    real_syscall = dlsym(RTLD_NEXT, "syscall");
+
+    const char* frequency = getenv("LIBFREQGEN_WAIT_FREQUENCY");
+    if (frequency == NULL)
+        return;
+    report = getenv("LIBFREQGEN_WAIT_REPORT") != NULL;
+    const char* value = getenv("LIBFREQGEN_WAIT_THRESHOLD");
+    uint64_t threshold_ns = value ? strtoull(value, NULL, 10) : WAIT_DEFAULT_THRESHOLD_NS;
+
+    interface = freq_gen_init(FREQ_GEN_DEVICE_CORE_FREQ);
+    if (interface != NULL)
+        session = freq_gen_session_open(interface, NULL, 0);
+    int ret = session != NULL ? prepare_cpus(strtoll(frequency, NULL, 10)) : EINVAL;
+    if (ret)
+    {
+        fprintf(stderr, "libfreqgen-wait: core frequencies are not changed: %s\n",
+                freq_gen_error_string());
+        return;
+    }
+    ticks_per_ns = freq_gen_tsc_calibrate(10000000ULL) / 1e9;
+    threshold = ns_to_ticks(threshold_ns);
+    active = true;
+}
+
+__attribute__((destructor)) static void wait_finalize(void)
+{
+    if (!active)
+        return;
+    active = false;
+    if (report)
+    {
+        fprintf(stderr, "libfreqgen-wait: %llu switches, %.3f ms at the wait frequency, %llu "
+                        "waits shorter than the threshold\n",
+                (unsigned long long)switches, switched_ticks / ticks_per_ns / 1e6,
+                (unsigned long long)short_switches);
+        if (strcmp(interface->name, "sim") == 0)
+            fprintf(stderr, "libfreqgen-wait: simulated core frequency transitions: %llu\n",
+                    (unsigned long long)freq_gen_sim_get_transitions(FREQ_GEN_DEVICE_CORE_FREQ));
+    }
+    /* other threads may still wait, so only restore their cpus and keep all settings */
+    for (int cpu = 0; cpu < nr_cpus; cpu++)
+    {
+        freq_gen_setting_t restore = atomic_load(&cpus[cpu].restore);
+        if (restore != NULL && atomic_load(&cpus[cpu].waiters) > 0)
+            interface->set_frequency(cpus[cpu].handle, restore);
+    }
+}
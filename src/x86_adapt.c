@@ -18,6 +18,7 @@
 
 #include "../include/error.h"
 #include "freq_gen_internal.h"
+#include "freq_gen_internal_cpuset.h"
 
 static freq_gen_interface_t freq_gen_x86a_cpu_interface;
 static freq_gen_interface_t freq_gen_x86a_uncore_interface;
@@ -179,11 +180,22 @@ static int freq_gen_x86a_init_uncore(void)
 
 static freq_gen_single_device_t freq_gen_x86a_init_cpu_device(int cpu)
 {
+    if (!freq_gen_cpuset_cpu_allowed(cpu))
+    {
+        LIBFREQGEN_SET_ERROR("cpu %d is not in the cpuset of the process", cpu);
+        return -EPERM;
+    }
     return x86_adapt_get_device(X86_ADAPT_CPU, cpu);
 }
 
 static freq_gen_single_device_t freq_gen_x86a_init_uncore_device(int cpu)
 {
+    /* x86_adapt uncore devices are dies, i.e., packages */
+    if (!freq_gen_cpuset_package_allowed(cpu))
+    {
+        LIBFREQGEN_SET_ERROR("die %d is not in a package of the cpuset of the process", cpu);
+        return -EPERM;
+    }
     return x86_adapt_get_device(X86_ADAPT_DIE, cpu);
 }
 
@@ -356,7 +368,8 @@ static freq_gen_interface_t freq_gen_x86a_cpu_interface = {
     .set_min_frequency = NULL,
     .unprepare_set_frequency = freq_gen_x86a_unprepare_access,
     .close_device = freq_gen_x86a_close_file,
-    .finalize = freq_gen_x86a_finalize_core
+    .finalize = freq_gen_x86a_finalize_core,
+    .get_current_frequency = NULL
 };
 
 static freq_gen_interface_t* freq_gen_x86a_init_cpufreq(void)
@@ -382,7 +395,8 @@ static freq_gen_interface_t freq_gen_x86a_uncore_interface = {
     .set_min_frequency = freq_gen_x86_set_min_frequency_uncore,
     .unprepare_set_frequency = freq_gen_x86a_unprepare_access_uncore,
     .close_device = freq_gen_x86a_close_file_uncore,
-    .finalize = freq_gen_x86a_finalize_uncore
+    .finalize = freq_gen_x86a_finalize_uncore,
+    .get_current_frequency = NULL
 };
 
 static freq_gen_interface_t* freq_gen_x86a_init_uncorefreq(void)
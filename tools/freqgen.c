@@ -0,0 +1,444 @@
+/*
+ * freqgen.c
+ *
+ * Command line tool to read and set core and uncore frequencies. In batch mode, many commands are
+ * read from a file or stdin and applied through a single session per device type. Consecutive set
+ * commands are collected and applied in one bulk operation.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <freqgen.h>
+#include <freqgen_cpuset.h>
+#include <freqgen_session.h>
+#include <freqgen_snapshot.h>
+#include <freqgen_util.h>
+
+#define MAX_TOKENS 8
+
+/* use the interface with the lowest measured costs instead of the first one */
+static bool use_fastest;
+
+/* everything that is needed for one device type */
+struct device_type
+{
+    const char* name;
+    freq_gen_dev_type type;
+    freq_gen_interface_t* interface;
+    freq_gen_session_t* session;
+    /* set commands that have not been applied yet, FREQ_GEN_SESSION_KEEP if none */
+    long long int* pending_max;
+    long long int* pending_min;
+    bool has_pending;
+};
+
+static struct device_type device_types[FREQ_GEN_DEVICE_NUM] = {
+    { .name = "core", .type = FREQ_GEN_DEVICE_CORE_FREQ },
+    { .name = "uncore", .type = FREQ_GEN_DEVICE_UNCORE_FREQ }
+};
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] <command>\n"
+            "Options:\n"
+            "  -c <interface>  core interface (likwid, msr, sysfs, x86_adapt)\n"
+            "  -u <interface>  uncore interface (likwid, msr, x86_adapt)\n"
+            "  -f              use the fastest interface, see the rank command\n"
+            "  -s              only use the cpus (and their packages) of the process's cpuset\n"
+            "  -t              print the time needed for all commands to stderr\n"
+            "Commands:\n"
+            "  get core|uncore [<cpulist>|all]            print configured frequencies\n"
+            "  current core|uncore [<cpulist>|all]        print observed frequencies\n"
+            "  set core|uncore <cpulist>|all <freq>       set frequency (range)\n"
+            "  setmin core|uncore <cpulist>|all <freq>    set minimal frequency\n"
+            "  snapshot core|uncore <file>                save the settings of all devices\n"
+            "  restore core|uncore <file>                 restore settings saved with snapshot\n"
+            "  rank core|uncore                           measure and rank all interfaces\n"
+            "  batch [<file>|-]                           read commands from a file or stdin\n"
+            "Frequencies can have a suffix GHz, MHz, kHz or Hz (default).\n",
+            name);
+}
+
+static struct device_type* parse_type(const char* string)
+{
+    for (int i = 0; i < FREQ_GEN_DEVICE_NUM; i++)
+        if (strcmp(string, device_types[i].name) == 0)
+            return &device_types[i];
+    fprintf(stderr, "Unknown device type \"%s\", expected core or uncore\n", string);
+    return NULL;
+}
+
+/* opens the interface and a session with all devices on first use */
+static int open_type(struct device_type* type)
+{
+    if (type->session != NULL)
+        return 0;
+    type->interface = use_fastest ? freq_gen_init_fastest(type->type) : freq_gen_init(type->type);
+    if (type->interface == NULL)
+    {
+        fprintf(stderr, "Could not initialize %s interface:\n%s", type->name,
+                freq_gen_error_string());
+        return EIO;
+    }
+    type->session = freq_gen_session_open(type->interface, NULL, 0);
+    if (type->session == NULL)
+    {
+        fprintf(stderr, "Could not open %s devices:\n%s", type->name, freq_gen_error_string());
+        return EIO;
+    }
+    int nr = freq_gen_session_get_num_devices(type->session);
+    type->pending_max = malloc(nr * sizeof(long long int));
+    type->pending_min = malloc(nr * sizeof(long long int));
+    if (type->pending_max == NULL || type->pending_min == NULL)
+        return ENOMEM;
+    for (int i = 0; i < nr; i++)
+        type->pending_max[i] = type->pending_min[i] = FREQ_GEN_SESSION_KEEP;
+    return 0;
+}
+
+/* parses a cpulist like 0-3,8 or all into a mask of session indices */
+static int parse_devices(struct device_type* type, const char* string, bool* selected)
+{
+    int nr = freq_gen_session_get_num_devices(type->session);
+    if (string == NULL || strcmp(string, "all") == 0)
+    {
+        for (int i = 0; i < nr; i++)
+            selected[i] = true;
+        return 0;
+    }
+    for (int i = 0; i < nr; i++)
+        selected[i] = false;
+
+    int* devices;
+    int nr_devices;
+    if (freq_gen_cpulist_parse_array(string, &devices, &nr_devices) != 0 || nr_devices == 0)
+    {
+        fprintf(stderr, "Invalid cpulist \"%s\"\n", string);
+        return EINVAL;
+    }
+    for (int i = 0; i < nr_devices; i++)
+    {
+        int index = freq_gen_session_find_device(type->session, devices[i]);
+        if (index < 0)
+        {
+            fprintf(stderr, "%s device %d is not available\n", type->name, devices[i]);
+            free(devices);
+            return ENODEV;
+        }
+        selected[index] = true;
+    }
+    free(devices);
+    return 0;
+}
+
+/* applies all collected set commands of a device type */
+static int flush_type(struct device_type* type)
+{
+    if (!type->has_pending)
+        return 0;
+    int nr = freq_gen_session_get_num_devices(type->session);
+    int ret = freq_gen_session_set_frequency(type->session, type->pending_max);
+    if (ret == 0 && type->interface->set_min_frequency != NULL)
+        ret = freq_gen_session_set_min_frequency(type->session, type->pending_min);
+    for (int i = 0; i < nr; i++)
+        type->pending_max[i] = type->pending_min[i] = FREQ_GEN_SESSION_KEEP;
+    type->has_pending = false;
+    if (ret)
+        fprintf(stderr, "Could not set %s frequencies:\n%s", type->name, freq_gen_error_string());
+    return ret;
+}
+
+static int flush_all(void)
+{
+    int ret = 0;
+    for (int i = 0; i < FREQ_GEN_DEVICE_NUM; i++)
+    {
+        int result = flush_type(&device_types[i]);
+        if (ret == 0)
+            ret = result;
+    }
+    return ret;
+}
+
+static int command_get(struct device_type* type, const char* devices, bool current)
+{
+    int nr = freq_gen_session_get_num_devices(type->session);
+    const int* numbers = freq_gen_session_get_devices(type->session);
+    bool selected[nr];
+    long long int max[nr], min[nr];
+    int ret = parse_devices(type, devices, selected);
+    if (ret)
+        return ret;
+    /* print what has been set before */
+    ret = flush_type(type);
+    if (ret)
+        return ret;
+
+    if (current)
+    {
+        if (type->interface->get_current_frequency == NULL)
+        {
+            fprintf(stderr, "The %s interface %s can not read the current frequency\n",
+                    type->name, type->interface->name);
+            return ENOTSUP;
+        }
+        for (int i = 0; i < nr; i++)
+            if (selected[i])
+                printf("%s %d %lld\n", type->name, numbers[i],
+                       type->interface->get_current_frequency(
+                           freq_gen_session_get_handle(type->session, i)));
+        return 0;
+    }
+
+    freq_gen_session_get_frequency(type->session, max);
+    bool has_min = type->interface->get_min_frequency != NULL;
+    if (has_min)
+        freq_gen_session_get_min_frequency(type->session, min);
+    for (int i = 0; i < nr; i++)
+    {
+        if (!selected[i])
+            continue;
+        if (has_min)
+            printf("%s %d %lld %lld\n", type->name, numbers[i], max[i], min[i]);
+        else
+            printf("%s %d %lld\n", type->name, numbers[i], max[i]);
+    }
+    return 0;
+}
+
+static int command_set(struct device_type* type, const char* devices, const char* frequency,
+                       bool min)
+{
+    int nr = freq_gen_session_get_num_devices(type->session);
+    bool selected[nr];
+    long long int target;
+    if (freq_gen_parse_frequency(frequency, &target))
+    {
+        fprintf(stderr, "Invalid frequency \"%s\"\n", frequency);
+        return EINVAL;
+    }
+    if (min && type->interface->set_min_frequency == NULL)
+    {
+        fprintf(stderr, "The %s interface %s does not support setmin\n", type->name,
+                type->interface->name);
+        return ENOTSUP;
+    }
+    int ret = parse_devices(type, devices, selected);
+    if (ret)
+        return ret;
+    for (int i = 0; i < nr; i++)
+    {
+        if (!selected[i])
+            continue;
+        if (min)
+            type->pending_min[i] = target;
+        else
+        {
+            /* set replaces the whole range */
+            type->pending_max[i] = target;
+            type->pending_min[i] = FREQ_GEN_SESSION_KEEP;
+        }
+    }
+    type->has_pending = true;
+    return 0;
+}
+
+static int command_snapshot(struct device_type* type, const char* path)
+{
+    void* blob;
+    size_t size;
+    /* save what has been set before */
+    int ret = flush_type(type);
+    if (ret)
+        return ret;
+    ret = freq_gen_snapshot(type->session, &blob, &size);
+    if (ret == 0)
+    {
+        ret = freq_gen_snapshot_save(path, blob, size);
+        free(blob);
+    }
+    if (ret)
+        fprintf(stderr, "Could not save %s snapshot:\n%s", type->name, freq_gen_error_string());
+    return ret;
+}
+
+static int command_restore(struct device_type* type, const char* path)
+{
+    void* blob;
+    size_t size;
+    /* keep the order of commands */
+    int ret = flush_type(type);
+    if (ret)
+        return ret;
+    ret = freq_gen_snapshot_load(path, &blob, &size);
+    if (ret == 0)
+    {
+        ret = freq_gen_restore(type->session, blob, size);
+        free(blob);
+    }
+    if (ret)
+        fprintf(stderr, "Could not restore %s snapshot:\n%s", type->name, freq_gen_error_string());
+    return ret;
+}
+
+static int command_rank(struct device_type* type)
+{
+    freq_gen_ranked_interface_t ranked[16];
+    int nr = freq_gen_init_ranked(type->type, ranked, 16);
+    if (nr < 0)
+    {
+        fprintf(stderr, "Could not rank %s interfaces:\n%s", type->name, freq_gen_error_string());
+        return -nr;
+    }
+    for (int i = 0; i < nr; i++)
+    {
+        printf("%s %s device %d get %.0f ns set %.0f ns\n", type->name, ranked[i].interface->name,
+               ranked[i].device, ranked[i].get_ns, ranked[i].set_ns);
+        ranked[i].interface->finalize();
+    }
+    return 0;
+}
+
+static int execute(int nr_tokens, char** tokens)
+{
+    if (nr_tokens < 2)
+    {
+        fprintf(stderr, "Incomplete command \"%s\"\n", tokens[0]);
+        return EINVAL;
+    }
+    struct device_type* type = parse_type(tokens[1]);
+    if (type == NULL)
+        return EINVAL;
+    /* measures interfaces without opening the session */
+    if (strcmp(tokens[0], "rank") == 0 && nr_tokens == 2)
+        return command_rank(type);
+    int ret = open_type(type);
+    if (ret)
+        return ret;
+
+    if (strcmp(tokens[0], "get") == 0 && nr_tokens <= 3)
+        return command_get(type, nr_tokens == 3 ? tokens[2] : NULL, false);
+    if (strcmp(tokens[0], "current") == 0 && nr_tokens <= 3)
+        return command_get(type, nr_tokens == 3 ? tokens[2] : NULL, true);
+    if (strcmp(tokens[0], "set") == 0 && nr_tokens == 4)
+        return command_set(type, tokens[2], tokens[3], false);
+    if (strcmp(tokens[0], "setmin") == 0 && nr_tokens == 4)
+        return command_set(type, tokens[2], tokens[3], true);
+    if (strcmp(tokens[0], "snapshot") == 0 && nr_tokens == 3)
+        return command_snapshot(type, tokens[2]);
+    if (strcmp(tokens[0], "restore") == 0 && nr_tokens == 3)
+        return command_restore(type, tokens[2]);
+
+    fprintf(stderr, "Invalid command \"%s\"\n", tokens[0]);
+    return EINVAL;
+}
+
+static int batch(const char* path)
+{
+    FILE* file = stdin;
+    if (path != NULL && strcmp(path, "-") != 0)
+    {
+        file = fopen(path, "r");
+        if (file == NULL)
+        {
+            fprintf(stderr, "Could not open %s\n", path);
+            return EIO;
+        }
+    }
+    char* line = NULL;
+    size_t length = 0;
+    int line_nr = 0;
+    int ret = 0;
+    while (getline(&line, &length, file) > 0)
+    {
+        char* tokens[MAX_TOKENS];
+        int nr_tokens = 0;
+        char* saveptr;
+        line_nr++;
+        /* strip comments */
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        for (char* token = strtok_r(line, " \t\r\n", &saveptr);
+             token != NULL && nr_tokens < MAX_TOKENS; token = strtok_r(NULL, " \t\r\n", &saveptr))
+            tokens[nr_tokens++] = token;
+        if (nr_tokens == 0)
+            continue;
+        ret = execute(nr_tokens, tokens);
+        if (ret)
+        {
+            fprintf(stderr, "Error in line %d\n", line_nr);
+            break;
+        }
+    }
+    free(line);
+    if (file != stdin)
+        fclose(file);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    bool print_time = false;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc)
+            setenv("LIBFREQGEN_CORE_INTERFACE", argv[++arg], 1);
+        else if (strcmp(argv[arg], "-u") == 0 && arg + 1 < argc)
+            setenv("LIBFREQGEN_UNCORE_INTERFACE", argv[++arg], 1);
+        else if (strcmp(argv[arg], "-f") == 0)
+            use_fastest = true;
+        else if (strcmp(argv[arg], "-s") == 0)
+            freq_gen_cpuset_set_scope(1);
+        else if (strcmp(argv[arg], "-t") == 0)
+            print_time = true;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (arg >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int ret;
+    if (strcmp(argv[arg], "batch") == 0)
+        ret = batch(arg + 1 < argc ? argv[arg + 1] : NULL);
+    else
+        ret = execute(argc - arg, &argv[arg]);
+    int flush_ret = flush_all();
+    if (ret == 0)
+        ret = flush_ret;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (print_time)
+        fprintf(stderr, "%.3f ms\n",
+                (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    for (int i = 0; i < FREQ_GEN_DEVICE_NUM; i++)
+    {
+        if (device_types[i].session != NULL)
+            freq_gen_session_close(device_types[i].session);
+        if (device_types[i].interface != NULL)
+            device_types[i].interface->finalize();
+        free(device_types[i].pending_max);
+        free(device_types[i].pending_min);
+    }
+    return ret ? 1 : 0;
+}
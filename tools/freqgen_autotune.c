@@ -0,0 +1,284 @@
+/*
+ * freqgen_autotune.c
+ *
+ * Finds the energy-optimal core and uncore frequency of a command. The command is the kernel of
+ * freq_gen_autotune_run() and is started once per warm-up run and repetition. All measured points
+ * are written as CSV, the best point for the selected objective is stored as a region in a tuning
+ * model (see freqgen_model.h).
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <freqgen.h>
+#include <freqgen_autotune.h>
+#include <freqgen_model.h>
+#include <freqgen_session.h>
+#include <freqgen_util.h>
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] -- <command> [args...]\n"
+            "Options:\n"
+            "  -c <interface>     core interface (likwid, msr, sysfs, x86_adapt)\n"
+            "  -u <interface>     uncore interface (likwid, msr, x86_adapt)\n"
+            "  -C <min>:<max>[:<step>]  core frequencies to sweep\n"
+            "  -U <min>:<max>[:<step>]  uncore frequencies to sweep\n"
+            "  -d <cpulist>       cores to change (default all)\n"
+            "  -D <list>          uncores to change (default all)\n"
+            "  -n <number>        measured runs per point (default 5)\n"
+            "  -w <number>        warm-up runs per point (default 1)\n"
+            "  -s <number>        coarse stride, measure every n-th frequency first (default 1)\n"
+            "  -e <fraction>      stop points that are worse than the best by this fraction\n"
+            "  -O energy|edp|ed2p objective for pruning and the model (default edp)\n"
+            "  -o <file>          write the best point to a model file\n"
+            "  -r <name>          region name in the model (default kernel)\n"
+            "  -f <file>          write all points as CSV to a file instead of stdout\n"
+            "At least one of -C and -U is required.\n"
+            "Frequencies can have a suffix GHz, MHz, kHz or Hz (default).\n",
+            name);
+}
+
+/* parses a range like 1.2GHz:3GHz:100MHz */
+static int parse_range(const char* string, long long int* min, long long int* max,
+                       long long int* step)
+{
+    char* copy = strdup(string);
+    if (copy == NULL)
+        return ENOMEM;
+    char* saveptr;
+    char* first = strtok_r(copy, ":", &saveptr);
+    char* second = strtok_r(NULL, ":", &saveptr);
+    char* third = strtok_r(NULL, ":", &saveptr);
+    int ret = EINVAL;
+    *step = 0;
+    if (first != NULL && second != NULL && freq_gen_parse_frequency(first, min) == 0 &&
+        freq_gen_parse_frequency(second, max) == 0 &&
+        (third == NULL || freq_gen_parse_frequency(third, step) == 0))
+        ret = *min > 0 && *max >= *min ? 0 : EINVAL;
+    free(copy);
+    return ret;
+}
+
+/* runs the command and waits for it, a non-zero exit status aborts the sweep */
+static int run_command(void* data)
+{
+    char** argv = data;
+    pid_t pid = fork();
+    if (pid < 0)
+        return errno;
+    if (pid == 0)
+    {
+        execvp(argv[0], argv);
+        fprintf(stderr, "Could not execute %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return errno;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "%s failed with status %d\n", argv[0],
+                WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return ECHILD;
+    }
+    return 0;
+}
+
+static void print_progress(int measured, int total, void* data)
+{
+    (void)data;
+    fprintf(stderr, "\rmeasured %d of %d points", measured, total);
+}
+
+static freq_gen_session_t* open_session(freq_gen_dev_type type, const char* list)
+{
+    int* devices = NULL;
+    int nr_devices = 0;
+    if (list != NULL &&
+        (freq_gen_cpulist_parse_array(list, &devices, &nr_devices) || nr_devices == 0))
+    {
+        fprintf(stderr, "Invalid device list \"%s\"\n", list);
+        return NULL;
+    }
+    freq_gen_interface_t* interface = freq_gen_init(type);
+    if (interface == NULL)
+    {
+        fprintf(stderr, "Could not initialize %s interface:\n%s",
+                type == FREQ_GEN_DEVICE_CORE_FREQ ? "core" : "uncore", freq_gen_error_string());
+        free(devices);
+        return NULL;
+    }
+    freq_gen_session_t* session = freq_gen_session_open(interface, devices, nr_devices);
+    free(devices);
+    if (session == NULL)
+        fprintf(stderr, "Could not open devices:\n%s", freq_gen_error_string());
+    return session;
+}
+
+int main(int argc, char** argv)
+{
+    const char* core_range = NULL;
+    const char* uncore_range = NULL;
+    const char* core_list = NULL;
+    const char* uncore_list = NULL;
+    const char* model_path = NULL;
+    const char* region = "kernel";
+    const char* csv_path = NULL;
+    freq_gen_autotune_config_t config = { .objective = FREQ_GEN_AUTOTUNE_EDP };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:u:C:U:d:D:n:w:s:e:O:o:r:f:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            setenv("LIBFREQGEN_CORE_INTERFACE", optarg, 1);
+            break;
+        case 'u':
+            setenv("LIBFREQGEN_UNCORE_INTERFACE", optarg, 1);
+            break;
+        case 'C':
+            core_range = optarg;
+            break;
+        case 'U':
+            uncore_range = optarg;
+            break;
+        case 'd':
+            core_list = optarg;
+            break;
+        case 'D':
+            uncore_list = optarg;
+            break;
+        case 'n':
+            config.repetitions = atoi(optarg);
+            break;
+        case 'w':
+            /* 0 warm-up runs is passed as -1 */
+            config.warmup = atoi(optarg) > 0 ? atoi(optarg) : -1;
+            break;
+        case 's':
+            config.coarse_stride = atoi(optarg);
+            break;
+        case 'e':
+            config.early_stop = strtod(optarg, NULL);
+            break;
+        case 'O':
+            if (strcmp(optarg, "energy") == 0)
+                config.objective = FREQ_GEN_AUTOTUNE_ENERGY;
+            else if (strcmp(optarg, "edp") == 0)
+                config.objective = FREQ_GEN_AUTOTUNE_EDP;
+            else if (strcmp(optarg, "ed2p") == 0)
+                config.objective = FREQ_GEN_AUTOTUNE_ED2P;
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            model_path = optarg;
+            break;
+        case 'r':
+            region = optarg;
+            break;
+        case 'f':
+            csv_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || (core_range == NULL && uncore_range == NULL) ||
+        config.repetitions < 0 || config.early_stop < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (core_range != NULL &&
+        parse_range(core_range, &config.core_min_frequency, &config.core_max_frequency,
+                    &config.core_step))
+    {
+        fprintf(stderr, "Invalid core frequency range \"%s\"\n", core_range);
+        return 1;
+    }
+    if (uncore_range != NULL &&
+        parse_range(uncore_range, &config.uncore_min_frequency, &config.uncore_max_frequency,
+                    &config.uncore_step))
+    {
+        fprintf(stderr, "Invalid uncore frequency range \"%s\"\n", uncore_range);
+        return 1;
+    }
+    if (core_range != NULL &&
+        (config.core = open_session(FREQ_GEN_DEVICE_CORE_FREQ, core_list)) == NULL)
+        return 1;
+    if (uncore_range != NULL &&
+        (config.uncore = open_session(FREQ_GEN_DEVICE_UNCORE_FREQ, uncore_list)) == NULL)
+        return 1;
+    config.progress = print_progress;
+
+    freq_gen_autotune_result_t* result;
+    int ret = freq_gen_autotune_run(&config, run_command, &argv[optind], &result);
+    fprintf(stderr, "\n");
+    if (ret)
+    {
+        fprintf(stderr, "Autotuning failed:\n%s", freq_gen_error_string());
+        return 1;
+    }
+
+    FILE* csv = csv_path != NULL ? fopen(csv_path, "w") : stdout;
+    if (csv == NULL || freq_gen_autotune_write_csv(result, csv))
+    {
+        fprintf(stderr, "Could not write \"%s\"\n", csv_path);
+        return 1;
+    }
+    if (csv != stdout)
+        fclose(csv);
+
+    static const char* names[FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES] = { "energy", "EDP", "ED2P" };
+    fprintf(stderr, "measured %d of %d points\n", result->nr_points, result->nr_candidates);
+    for (int objective = 0; objective < FREQ_GEN_AUTOTUNE_NUM_OBJECTIVES; objective++)
+    {
+        const freq_gen_autotune_point_t* best = &result->points[result->best[objective]];
+        fprintf(stderr, "best %-6s core %lld Hz, uncore %lld Hz: %.6f s, %.3f J\n",
+                names[objective], best->core_frequency, best->uncore_frequency, best->time,
+                best->package_energy + best->dram_energy);
+    }
+
+    if (model_path != NULL)
+    {
+        freq_gen_model_builder_t* builder = freq_gen_model_builder_create();
+        if (builder == NULL ||
+            freq_gen_autotune_add_to_model(result, config.objective, builder, 0, region) ||
+            freq_gen_model_builder_save(builder, model_path))
+        {
+            fprintf(stderr, "Could not write model \"%s\":\n%s", model_path,
+                    freq_gen_error_string());
+            return 1;
+        }
+        freq_gen_model_builder_free(builder);
+    }
+    freq_gen_autotune_result_free(result);
+    freq_gen_session_t* sessions[] = { config.core, config.uncore };
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        if (sessions[type] == NULL)
+            continue;
+        freq_gen_interface_t* interface = freq_gen_session_get_interface(sessions[type]);
+        freq_gen_session_close(sessions[type]);
+        interface->finalize();
+    }
+    return 0;
+}
@@ -0,0 +1,631 @@
+/*
+ * freqgen_broker.c
+ *
+ * A small privileged daemon that passes pre-opened msr_safe and scaling_setspeed file descriptors
+ * to unprivileged processes, see freqgen_broker.h. Every request is checked against the policy
+ * given on the command line: the user or group of the peer, its cgroup, the cpu and, for msr_safe,
+ * the register the process wants to write. In addition, the cpu must be in the affinity of the
+ * peer, so a job cannot change the cpus of other jobs. Raw /dev/cpu/(cpu)/msr files are never
+ * passed, the registers that can actually be accessed through msr_safe are enforced by the kernel
+ * according to its allowlist.
+ *
+ * Connections are non-blocking and served from a poll loop, so a slow client does not delay
+ * others. A client that does not send its request in time is disconnected.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <freqgen_broker.h>
+#include <freqgen_util.h>
+
+#define MAX_ENTRIES 64
+
+/* connections that are served at the same time, further ones wait in the listen backlog */
+#define MAX_CLIENTS 256
+
+/* how long a client may take to send its request */
+#define REQUEST_TIMEOUT_MS 1000
+
+#define IA32_PERF_CTL 0x199
+#define UNCORE_RATIO_LIMIT 0x620
+
+struct policy
+{
+    uid_t users[MAX_ENTRIES];
+    int nr_users;
+    gid_t groups[MAX_ENTRIES];
+    int nr_groups;
+    const char* cgroups[MAX_ENTRIES]; /**< allowed cgroup paths, including their children */
+    int nr_cgroups;
+    uint32_t registers[MAX_ENTRIES];
+    int nr_registers;
+    bool* cpus; /**< allowed cpus, NULL for all */
+};
+
+static struct policy policy;
+
+/* pre-opened files per cpu, -1 if they could not be opened */
+static int* msr_fds;
+static int* setspeed_fds;
+static int nr_cpus;
+
+/* package of every cpu, -1 if unknown */
+static int* packages;
+
+/* an accepted connection that has not sent its complete request yet */
+struct client
+{
+    int fd;
+    struct ucred peer;
+    uint64_t deadline_ns;
+    freq_gen_broker_request_t request;
+    size_t received;
+};
+
+static struct client clients[MAX_CLIENTS];
+static int nr_clients;
+
+static bool verbose;
+
+static volatile sig_atomic_t stop;
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "Options:\n"
+            "  -s <socket>     path of the socket (default " FREQ_GEN_BROKER_DEFAULT_SOCKET ")\n"
+            "  -m <mode>       permissions of the socket in octal (default 666)\n"
+            "  -u <users>      comma-separated users (names or uids) that are served\n"
+            "  -g <groups>     comma-separated groups (names or gids) whose members are served\n"
+            "  -C <cgroups>    comma-separated cgroups (e.g., /slurm/uid_1000), the requesting\n"
+            "                  process must be in one of them or their children\n"
+            "  -c <cpulist>    cpus whose files are passed (default all)\n"
+            "  -r <registers>  comma-separated msr registers that may be requested\n"
+            "                  (default 0x199,0x620)\n"
+            "  -v              log every request, not only denied ones\n"
+            "Without -u and -g, only root is served.\n",
+            name);
+}
+
+static void handle_signal(int signal)
+{
+    (void)signal;
+    stop = 1;
+}
+
+/* splits a comma-separated list in place, calling add for every entry */
+static int parse_list(char* string, int (*add)(const char*))
+{
+    for (char* entry = strtok(string, ","); entry != NULL; entry = strtok(NULL, ","))
+    {
+        int ret = add(entry);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+static int add_user(const char* name)
+{
+    if (policy.nr_users == MAX_ENTRIES)
+        return ENOSPC;
+    char* end;
+    unsigned long uid = strtoul(name, &end, 10);
+    if (*end != '\0')
+    {
+        struct passwd* pw = getpwnam(name);
+        if (pw == NULL)
+        {
+            fprintf(stderr, "Unknown user \"%s\"\n", name);
+            return EINVAL;
+        }
+        uid = pw->pw_uid;
+    }
+    policy.users[policy.nr_users++] = uid;
+    return 0;
+}
+
+static int add_group(const char* name)
+{
+    if (policy.nr_groups == MAX_ENTRIES)
+        return ENOSPC;
+    char* end;
+    unsigned long gid = strtoul(name, &end, 10);
+    if (*end != '\0')
+    {
+        struct group* gr = getgrnam(name);
+        if (gr == NULL)
+        {
+            fprintf(stderr, "Unknown group \"%s\"\n", name);
+            return EINVAL;
+        }
+        gid = gr->gr_gid;
+    }
+    policy.groups[policy.nr_groups++] = gid;
+    return 0;
+}
+
+static int add_cgroup(const char* path)
+{
+    if (policy.nr_cgroups == MAX_ENTRIES)
+        return ENOSPC;
+    policy.cgroups[policy.nr_cgroups++] = path;
+    return 0;
+}
+
+static int add_register(const char* string)
+{
+    if (policy.nr_registers == MAX_ENTRIES)
+        return ENOSPC;
+    char* end;
+    unsigned long msr_register = strtoul(string, &end, 0);
+    if (end == string || *end != '\0')
+    {
+        fprintf(stderr, "Invalid register \"%s\"\n", string);
+        return EINVAL;
+    }
+    policy.registers[policy.nr_registers++] = msr_register;
+    return 0;
+}
+
+static int parse_cpulist(const char* string)
+{
+    int* cpus;
+    int nr_allowed;
+    if (freq_gen_cpulist_parse_array(string, &cpus, &nr_allowed) != 0)
+    {
+        fprintf(stderr, "Invalid cpulist \"%s\"\n", string);
+        return EINVAL;
+    }
+    policy.cpus = calloc(nr_cpus, sizeof(bool));
+    if (policy.cpus == NULL)
+    {
+        free(cpus);
+        return ENOMEM;
+    }
+    for (int i = 0; i < nr_allowed; i++)
+        if (cpus[i] < nr_cpus)
+            policy.cpus[cpus[i]] = true;
+    free(cpus);
+    return 0;
+}
+
+static bool cpu_allowed(int cpu)
+{
+    return cpu >= 0 && cpu < nr_cpus && (policy.cpus == NULL || policy.cpus[cpu]);
+}
+
+static int read_package(int cpu)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    FILE* file = fopen(path, "r");
+    int package;
+    if (file == NULL)
+        return -1;
+    int ret = fscanf(file, "%d", &package);
+    fclose(file);
+    return ret == 1 ? package : -1;
+}
+
+/*
+ * checks the cpu against the affinity of the peer (Cpus_allowed_list in /proc/(pid)/status).
+ * UNCORE_RATIO_LIMIT is written on the first cpu of a package and applies to the whole package, so
+ * for it any cpu of the same package is sufficient.
+ */
+static bool peer_cpu_allowed(const struct ucred* peer, const freq_gen_broker_request_t* request)
+{
+    if (peer->uid == 0)
+        return true;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)peer->pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+    int* cpus = NULL;
+    int nr_allowed = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), file) != NULL)
+        if (strncmp(line, "Cpus_allowed_list:", strlen("Cpus_allowed_list:")) == 0)
+        {
+            const char* list = line + strlen("Cpus_allowed_list:");
+            list += strspn(list, " \t");
+            if (freq_gen_cpulist_parse_array(list, &cpus, &nr_allowed) != 0)
+                cpus = NULL;
+            break;
+        }
+    fclose(file);
+    if (cpus == NULL)
+        return false;
+
+    bool package_wide = request->file == FREQ_GEN_BROKER_MSR &&
+                        request->msr_register == UNCORE_RATIO_LIMIT &&
+                        packages[request->cpu] >= 0;
+    bool allowed = false;
+    for (int i = 0; i < nr_allowed && cpus[i] < nr_cpus && !allowed; i++)
+        allowed = cpus[i] == request->cpu ||
+                  (package_wide && packages[cpus[i]] == packages[request->cpu]);
+    free(cpus);
+    return allowed;
+}
+
+static bool register_allowed(uint32_t msr_register)
+{
+    for (int i = 0; i < policy.nr_registers; i++)
+        if (policy.registers[i] == msr_register)
+            return true;
+    return false;
+}
+
+static bool user_allowed(uid_t uid, gid_t gid)
+{
+    if (uid == 0)
+        return true;
+    for (int i = 0; i < policy.nr_users; i++)
+        if (policy.users[i] == uid)
+            return true;
+    if (policy.nr_groups == 0)
+        return false;
+
+    struct passwd* pw = getpwuid(uid);
+    gid_t groups[256];
+    int nr_groups = 256;
+    if (pw == NULL || getgrouplist(pw->pw_name, gid, groups, &nr_groups) < 0)
+    {
+        /* unknown user or too many groups, only check the primary group */
+        groups[0] = gid;
+        nr_groups = 1;
+    }
+    for (int i = 0; i < policy.nr_groups; i++)
+        for (int j = 0; j < nr_groups; j++)
+            if (policy.groups[i] == groups[j])
+                return true;
+    return false;
+}
+
+/* checks the lines "<id>:<controllers>:<path>" of /proc/(pid)/cgroup */
+static bool cgroup_allowed(pid_t pid)
+{
+    if (policy.nr_cgroups == 0)
+        return true;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", (int)pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+    bool allowed = false;
+    char line[4096];
+    while (!allowed && fgets(line, sizeof(line), file) != NULL)
+    {
+        char* cgroup = strchr(line, ':');
+        if (cgroup != NULL)
+            cgroup = strchr(cgroup + 1, ':');
+        if (cgroup == NULL)
+            continue;
+        cgroup++;
+        cgroup[strcspn(cgroup, "\n")] = '\0';
+        for (int i = 0; i < policy.nr_cgroups && !allowed; i++)
+        {
+            size_t length = strlen(policy.cgroups[i]);
+            allowed = strncmp(cgroup, policy.cgroups[i], length) == 0 &&
+                      (cgroup[length] == '\0' || cgroup[length] == '/' ||
+                       policy.cgroups[i][length - 1] == '/');
+        }
+    }
+    fclose(file);
+    return allowed;
+}
+
+/* warns about registers that msr_safe allows to write but the policy does not contain */
+static void check_allowlist(void)
+{
+    FILE* file = fopen("/dev/cpu/msr_allowlist", "r");
+    if (file == NULL)
+        file = fopen("/dev/cpu/msr_whitelist", "r");
+    if (file == NULL)
+        return;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        unsigned long long msr_register, write_mask;
+        if (line[0] == '#' || sscanf(line, "%llx %llx", &msr_register, &write_mask) != 2)
+            continue;
+        if (write_mask != 0 && !register_allowed(msr_register))
+            fprintf(stderr,
+                    "Warning: the msr_safe allowlist allows writing register 0x%llx, which is "
+                    "not in the policy. Clients can write it with the passed file descriptors.\n",
+                    msr_register);
+    }
+    fclose(file);
+}
+
+static void open_files(void)
+{
+    for (int cpu = 0; cpu < nr_cpus; cpu++)
+    {
+        msr_fds[cpu] = -1;
+        setspeed_fds[cpu] = -1;
+        if (!cpu_allowed(cpu))
+            continue;
+        char path[128];
+        snprintf(path, sizeof(path), "/dev/cpu/%d/msr_safe", cpu);
+        msr_fds[cpu] = open(path, O_RDWR | O_CLOEXEC);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_setspeed", cpu);
+        setspeed_fds[cpu] = open(path, O_RDWR | O_CLOEXEC);
+    }
+}
+
+static int send_response(int connection, int error, int fd)
+{
+    freq_gen_broker_response_t response = { .magic = FREQ_GEN_BROKER_MAGIC, .error = error };
+    struct iovec iov = { .iov_base = &response, .iov_len = sizeof(response) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+    if (error == 0)
+    {
+        memset(&control, 0, sizeof(control));
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return sendmsg(connection, &message, MSG_NOSIGNAL) == sizeof(response) ? 0 : errno;
+}
+
+/* checks a request and returns 0 or the error for the response, *fd is set if 0 is returned */
+static int check_request(const freq_gen_broker_request_t* request, const struct ucred* peer,
+                         int* fd)
+{
+    if (request->magic != FREQ_GEN_BROKER_MAGIC)
+        return EPROTO;
+    if (!user_allowed(peer->uid, peer->gid) || !cgroup_allowed(peer->pid))
+        return EACCES;
+    if (!cpu_allowed(request->cpu) || !peer_cpu_allowed(peer, request))
+        return EPERM;
+    switch (request->file)
+    {
+    case FREQ_GEN_BROKER_MSR:
+        if (!register_allowed(request->msr_register))
+            return EPERM;
+        *fd = msr_fds[request->cpu];
+        break;
+    case FREQ_GEN_BROKER_SCALING_SETSPEED:
+        *fd = setspeed_fds[request->cpu];
+        break;
+    default:
+        return EINVAL;
+    }
+    return *fd >= 0 ? 0 : ENODEV;
+}
+
+static void drop_client(int index)
+{
+    close(clients[index].fd);
+    clients[index] = clients[--nr_clients];
+}
+
+static void accept_clients(int sock)
+{
+    while (nr_clients < MAX_CLIENTS)
+    {
+        int connection = accept4(sock, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (connection < 0)
+        {
+            if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+                fprintf(stderr, "Could not accept a connection: %s\n", strerror(errno));
+            return;
+        }
+        struct client* client = &clients[nr_clients];
+        socklen_t length = sizeof(client->peer);
+        if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &client->peer, &length) != 0)
+        {
+            close(connection);
+            continue;
+        }
+        client->fd = connection;
+        client->deadline_ns = freq_gen_now_ns() + REQUEST_TIMEOUT_MS * 1000000ULL;
+        client->received = 0;
+        nr_clients++;
+    }
+}
+
+/* reads the available part of a request, answers complete requests, returns whether the client
+ * is done */
+static bool serve(struct client* client)
+{
+    ssize_t bytes = recv(client->fd, (char*)&client->request + client->received,
+                         sizeof(client->request) - client->received, MSG_DONTWAIT);
+    if (bytes < 0)
+        return errno != EAGAIN && errno != EINTR;
+    if (bytes == 0)
+        return true;
+    client->received += bytes;
+    if (client->received < sizeof(client->request))
+        return false;
+
+    const freq_gen_broker_request_t* request = &client->request;
+    int fd = -1;
+    int error = check_request(request, &client->peer, &fd);
+    if (error == 0)
+        error = send_response(client->fd, 0, fd) ? EIO : 0;
+    else
+        send_response(client->fd, error, -1);
+    if (error != 0 || verbose)
+        fprintf(stderr, "pid %d uid %d: file %u cpu %d register 0x%x: %s\n",
+                (int)client->peer.pid, (int)client->peer.uid, request->file, request->cpu,
+                request->msr_register, error ? strerror(error) : "granted");
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = FREQ_GEN_BROKER_DEFAULT_SOCKET;
+    const char* cpulist = NULL;
+    mode_t mode = 0666;
+    int ret = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:m:u:g:C:c:r:v")) != -1 && ret == 0)
+    {
+        switch (opt)
+        {
+        case 's':
+            path = optarg;
+            break;
+        case 'm':
+            mode = strtoul(optarg, NULL, 8);
+            break;
+        case 'u':
+            ret = parse_list(optarg, add_user);
+            break;
+        case 'g':
+            ret = parse_list(optarg, add_group);
+            break;
+        case 'C':
+            ret = parse_list(optarg, add_cgroup);
+            break;
+        case 'c':
+            cpulist = optarg;
+            break;
+        case 'r':
+            ret = parse_list(optarg, add_register);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            ret = EINVAL;
+        }
+    }
+    if (ret != 0 || optind != argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (policy.nr_registers == 0)
+    {
+        /* IA32_PERF_CTL and UNCORE_RATIO_LIMIT, as written by the msr backend */
+        policy.registers[policy.nr_registers++] = IA32_PERF_CTL;
+        policy.registers[policy.nr_registers++] = UNCORE_RATIO_LIMIT;
+    }
+
+    nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (nr_cpus <= 0)
+        nr_cpus = 1;
+    if (cpulist != NULL && parse_cpulist(cpulist) != 0)
+        return 1;
+    msr_fds = malloc(nr_cpus * sizeof(int));
+    setspeed_fds = malloc(nr_cpus * sizeof(int));
+    packages = malloc(nr_cpus * sizeof(int));
+    if (msr_fds == NULL || setspeed_fds == NULL || packages == NULL)
+    {
+        fprintf(stderr, "Could not allocate memory for %d cpus\n", nr_cpus);
+        return 1;
+    }
+    for (int cpu = 0; cpu < nr_cpus; cpu++)
+        packages[cpu] = read_package(cpu);
+    open_files();
+    check_allowlist();
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Socket path \"%s\" is too long\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    unlink(path);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        chmod(path, mode) != 0 || listen(sock, 64) != 0)
+    {
+        fprintf(stderr, "Could not listen on \"%s\": %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    /* no SA_RESTART, so that poll returns on signals */
+    struct sigaction action = { .sa_handler = handle_signal };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct pollfd fds[MAX_CLIENTS + 1];
+    while (!stop)
+    {
+        /* disconnect clients that did not send their request in time */
+        uint64_t now = freq_gen_now_ns();
+        int timeout_ms = -1;
+        for (int i = nr_clients - 1; i >= 0; i--)
+        {
+            if (clients[i].deadline_ns <= now)
+            {
+                if (verbose)
+                    fprintf(stderr, "pid %d uid %d: request timed out\n",
+                            (int)clients[i].peer.pid, (int)clients[i].peer.uid);
+                drop_client(i);
+                continue;
+            }
+            int remaining_ms = (clients[i].deadline_ns - now + 999999) / 1000000;
+            if (timeout_ms < 0 || remaining_ms < timeout_ms)
+                timeout_ms = remaining_ms;
+        }
+
+        /* stop accepting while all client slots are in use */
+        fds[0] = (struct pollfd){ .fd = sock, .events = nr_clients < MAX_CLIENTS ? POLLIN : 0 };
+        for (int i = 0; i < nr_clients; i++)
+            fds[i + 1] = (struct pollfd){ .fd = clients[i].fd, .events = POLLIN };
+        int nr_fds = nr_clients + 1;
+        if (poll(fds, nr_fds, timeout_ms) < 0)
+        {
+            if (errno != EINTR)
+                fprintf(stderr, "Could not poll: %s\n", strerror(errno));
+            continue;
+        }
+
+        /* from the back, so dropping a client only moves clients that have been handled */
+        for (int i = nr_fds - 2; i >= 0; i--)
+            if (fds[i + 1].revents != 0 && serve(&clients[i]))
+                drop_client(i);
+        if (fds[0].revents & POLLIN)
+            accept_clients(sock);
+    }
+
+    for (int i = nr_clients - 1; i >= 0; i--)
+        drop_client(i);
+    close(sock);
+    unlink(path);
+    for (int cpu = 0; cpu < nr_cpus; cpu++)
+    {
+        if (msr_fds[cpu] >= 0)
+            close(msr_fds[cpu]);
+        if (setspeed_fds[cpu] >= 0)
+            close(setspeed_fds[cpu]);
+    }
+    free(msr_fds);
+    free(setspeed_fds);
+    free(packages);
+    free(policy.cpus);
+    return 0;
+}
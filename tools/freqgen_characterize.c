@@ -0,0 +1,452 @@
+/*
+ * freqgen_characterize.c
+ *
+ * Measures how long frequency transitions take. For every pair (from, to) of the given
+ * frequencies, the device is set to from, then to, and the time until the new frequency is
+ * observed is recorded. Completion is detected by polling get_current_frequency (e.g.,
+ * IA32_PERF_STATUS) or, for cores, by a spin loop whose duration has been calibrated for every
+ * frequency. Percentiles are written to a latency table (see freqgen_latency.h).
+ *
+ * Polling is only as fine as a read of the current frequency. The msr uncore interface counts
+ * uncore clockticks for 10 ms per read if MSR_UNCORE_PERF_STATUS is not supported, so latencies
+ * are then quantized to 10 ms, which is reported at start. The tool can be tried without hardware
+ * access on the simulated interface (-c sim or -u sim).
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <freqgen.h>
+#include <freqgen_latency.h>
+#include <freqgen_session.h>
+#include <freqgen_snapshot.h>
+#include <freqgen_util.h>
+
+#define MAX_FREQUENCIES 64
+
+/* observed frequencies within this distance count as reached, half a 100 MHz ratio step */
+#define POLL_TOLERANCE_HZ 50000000LL
+
+/* a spin chunk should take about this long */
+#define SPIN_CHUNK_NS 5000.0
+
+/* how long to wait for the initial frequency before a transition */
+#define SETTLE_TIMEOUT_NS 50000000ULL
+
+enum method
+{
+    METHOD_POLL,
+    METHOD_SPIN
+};
+
+struct probe
+{
+    enum method method;
+    freq_gen_interface_t* interface;
+    freq_gen_single_device_t handle;
+    int nr_frequencies;
+    const long long int* frequencies;
+    /* spin only: iterations per chunk, expected chunk duration and tolerance per frequency */
+    uint64_t chunk;
+    double expected_ns[MAX_FREQUENCIES];
+    double tolerance[MAX_FREQUENCIES];
+};
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] -f <freq>,<freq>[,...] -o <file>\n"
+            "Options:\n"
+            "  -c <interface>  core interface (likwid, msr, sysfs, x86_adapt, sim)\n"
+            "  -u <interface>  uncore interface (likwid, msr, x86_adapt, sim)\n"
+            "  -t core|uncore  device type to characterize (default core)\n"
+            "  -d <cpulist>    devices to measure on, results are combined (default 0)\n"
+            "  -n <number>     repetitions per transition and device (default 20)\n"
+            "  -m poll|spin    detect completion by polling the current frequency or by a\n"
+            "                  calibrated spin loop (cores only), default poll if available\n"
+            "  -T <ms>         timeout per transition (default 100)\n"
+            "  -a              add to an existing table in <file> instead of replacing it\n"
+            "Frequencies can have a suffix GHz, MHz, kHz or Hz (default).\n",
+            name);
+}
+
+/* a dependency chain whose duration is proportional to the core clock */
+static void spin(uint64_t iterations)
+{
+    uint64_t x = 1;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        x = x * 3 + 1;
+        __asm__ volatile("" : "+r"(x));
+    }
+}
+
+static uint64_t time_chunk(uint64_t iterations)
+{
+    uint64_t start = freq_gen_now_ns();
+    spin(iterations);
+    return freq_gen_now_ns() - start;
+}
+
+/* returns whether the probe observes frequency index target */
+static bool observe(struct probe* probe, int target)
+{
+    if (probe->method == METHOD_POLL)
+    {
+        long long int current = probe->interface->get_current_frequency(probe->handle);
+        return current >= 0 &&
+               llabs(current - probe->frequencies[target]) <= POLL_TOLERANCE_HZ;
+    }
+    double duration = time_chunk(probe->chunk);
+    return fabs(duration - probe->expected_ns[target]) <=
+           probe->tolerance[target] * probe->expected_ns[target];
+}
+
+/* waits until frequency index target is observed, returns the time needed or UINT64_MAX */
+static uint64_t wait_for(struct probe* probe, int target, uint64_t start, uint64_t timeout_ns)
+{
+    do
+    {
+        if (observe(probe, target))
+            return freq_gen_now_ns() - start;
+    } while (freq_gen_now_ns() - start < timeout_ns);
+    return UINT64_MAX;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* measures the chunk duration at every frequency, the thread must run on the measured cpu */
+static int calibrate_spin(struct probe* probe, freq_gen_setting_t* settings)
+{
+    /* size chunks for the first frequency */
+    probe->interface->set_frequency(probe->handle, settings[0]);
+    usleep(100000);
+    uint64_t iterations = 1000000;
+    probe->chunk = iterations * SPIN_CHUNK_NS / time_chunk(iterations);
+    if (probe->chunk == 0)
+        probe->chunk = 1;
+
+    for (int i = 0; i < probe->nr_frequencies; i++)
+    {
+        double durations[21];
+        if (probe->interface->set_frequency(probe->handle, settings[i]))
+            return EIO;
+        usleep(100000);
+        for (int j = 0; j < 21; j++)
+            durations[j] = time_chunk(probe->chunk);
+        qsort(durations, 21, sizeof(double), compare_double);
+        probe->expected_ns[i] = durations[10];
+    }
+    /* accept up to 3%, but stay closer to the own than to any other frequency */
+    for (int i = 0; i < probe->nr_frequencies; i++)
+    {
+        probe->tolerance[i] = 0.03;
+        for (int j = 0; j < probe->nr_frequencies; j++)
+        {
+            double gap =
+                fabs(probe->expected_ns[j] - probe->expected_ns[i]) / probe->expected_ns[i];
+            if (j != i && gap * 0.4 < probe->tolerance[i])
+                probe->tolerance[i] = gap * 0.4;
+        }
+    }
+    return 0;
+}
+
+static int pin_to_cpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) ? errno : 0;
+}
+
+int main(int argc, char** argv)
+{
+    freq_gen_dev_type type = FREQ_GEN_DEVICE_CORE_FREQ;
+    const char* device_list = "0";
+    const char* frequency_list = NULL;
+    const char* output = NULL;
+    const char* method_name = NULL;
+    int repetitions = 20;
+    uint64_t timeout_ns = 100000000ULL;
+    bool append = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:u:t:d:n:m:T:f:o:a")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            setenv("LIBFREQGEN_CORE_INTERFACE", optarg, 1);
+            break;
+        case 'u':
+            setenv("LIBFREQGEN_UNCORE_INTERFACE", optarg, 1);
+            break;
+        case 't':
+            if (strcmp(optarg, "core") == 0)
+                type = FREQ_GEN_DEVICE_CORE_FREQ;
+            else if (strcmp(optarg, "uncore") == 0)
+                type = FREQ_GEN_DEVICE_UNCORE_FREQ;
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd':
+            device_list = optarg;
+            break;
+        case 'n':
+            repetitions = atoi(optarg);
+            break;
+        case 'm':
+            method_name = optarg;
+            break;
+        case 'T':
+            timeout_ns = strtoull(optarg, NULL, 10) * 1000000ULL;
+            break;
+        case 'f':
+            frequency_list = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'a':
+            append = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frequency_list == NULL || output == NULL || repetitions <= 0 || timeout_ns == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    long long int frequencies[MAX_FREQUENCIES];
+    int nr_frequencies = 0;
+    char* list = strdup(frequency_list);
+    char* saveptr;
+    for (char* token = strtok_r(list, ",", &saveptr); token != NULL;
+         token = strtok_r(NULL, ",", &saveptr))
+    {
+        if (nr_frequencies == MAX_FREQUENCIES ||
+            freq_gen_parse_frequency(token, &frequencies[nr_frequencies]))
+        {
+            fprintf(stderr, "Invalid or too many frequencies \"%s\"\n", frequency_list);
+            return 1;
+        }
+        nr_frequencies++;
+    }
+    free(list);
+    if (nr_frequencies < 2)
+    {
+        fprintf(stderr, "At least two frequencies are needed\n");
+        return 1;
+    }
+
+    int* devices;
+    int nr_devices;
+    if (freq_gen_cpulist_parse_array(device_list, &devices, &nr_devices) || nr_devices == 0)
+    {
+        fprintf(stderr, "Invalid device list \"%s\"\n", device_list);
+        return 1;
+    }
+
+    freq_gen_interface_t* interface = freq_gen_init(type);
+    if (interface == NULL)
+    {
+        fprintf(stderr, "Could not initialize interface:\n%s", freq_gen_error_string());
+        return 1;
+    }
+    enum method method = interface->get_current_frequency != NULL ? METHOD_POLL : METHOD_SPIN;
+    if (method_name != NULL)
+        method = strcmp(method_name, "spin") == 0 ? METHOD_SPIN : METHOD_POLL;
+    if (method == METHOD_POLL && interface->get_current_frequency == NULL)
+    {
+        fprintf(stderr, "Interface %s can not read the current frequency, use -m spin\n",
+                interface->name);
+        return 1;
+    }
+    if (method == METHOD_SPIN && type != FREQ_GEN_DEVICE_CORE_FREQ)
+    {
+        fprintf(stderr, "The spin probe only works for core frequencies\n");
+        return 1;
+    }
+
+    freq_gen_session_t* session = freq_gen_session_open(interface, devices, nr_devices);
+    if (session == NULL)
+    {
+        fprintf(stderr, "Could not open devices:\n%s", freq_gen_error_string());
+        return 1;
+    }
+    /* a read of the current frequency that blocks for a window limits the resolution */
+    for (int d = 0; method == METHOD_POLL && d < nr_devices; d++)
+    {
+        freq_gen_single_device_t handle = freq_gen_session_get_handle(session, d);
+        long long int window = freq_gen_current_frequency_window(interface, handle);
+        if (window > 0)
+            fprintf(stderr,
+                    "Device %d: the current frequency is measured over %.1f ms, latencies below "
+                    "that can not be resolved\n",
+                    devices[d], window / 1e6);
+    }
+
+    /* restore the settings at the end */
+    void* snapshot = NULL;
+    size_t snapshot_size;
+    if (freq_gen_snapshot(session, &snapshot, &snapshot_size))
+    {
+        fprintf(stderr, "Could not save the current settings:\n%s", freq_gen_error_string());
+        return 1;
+    }
+
+    freq_gen_setting_t settings[MAX_FREQUENCIES];
+    for (int i = 0; i < nr_frequencies; i++)
+    {
+        settings[i] = interface->prepare_set_frequency(frequencies[i], 0);
+        if (settings[i] == NULL)
+        {
+            fprintf(stderr, "Could not prepare frequency %lld:\n%s", frequencies[i],
+                    freq_gen_error_string());
+            return 1;
+        }
+    }
+
+    /* samples of all devices per transition */
+    uint32_t* samples = malloc((size_t)nr_frequencies * nr_frequencies * nr_devices *
+                               repetitions * sizeof(uint32_t));
+    int* nr_samples = calloc((size_t)nr_frequencies * nr_frequencies, sizeof(int));
+    if (samples == NULL || nr_samples == NULL)
+    {
+        fprintf(stderr, "Could not allocate memory for samples\n");
+        return 1;
+    }
+
+    int ret = 0;
+    int timeouts = 0;
+    for (int d = 0; d < nr_devices && ret == 0; d++)
+    {
+        struct probe probe = { .method = method,
+                               .interface = interface,
+                               .handle = freq_gen_session_get_handle(session, d),
+                               .nr_frequencies = nr_frequencies,
+                               .frequencies = frequencies };
+        if (method == METHOD_SPIN)
+        {
+            ret = pin_to_cpu(devices[d]);
+            if (ret == 0)
+                ret = calibrate_spin(&probe, settings);
+            if (ret)
+            {
+                fprintf(stderr, "Could not calibrate spin loop on cpu %d\n", devices[d]);
+                break;
+            }
+        }
+        for (int from = 0; from < nr_frequencies && ret == 0; from++)
+            for (int to = 0; to < nr_frequencies && ret == 0; to++)
+            {
+                if (from == to)
+                    continue;
+                int transition = from * nr_frequencies + to;
+                for (int r = 0; r < repetitions; r++)
+                {
+                    ret = interface->set_frequency(probe.handle, settings[from]);
+                    if (ret)
+                        break;
+                    wait_for(&probe, from, freq_gen_now_ns(), SETTLE_TIMEOUT_NS);
+                    uint64_t start = freq_gen_now_ns();
+                    ret = interface->set_frequency(probe.handle, settings[to]);
+                    if (ret)
+                        break;
+                    uint64_t latency = wait_for(&probe, to, start, timeout_ns);
+                    if (latency == UINT64_MAX)
+                    {
+                        timeouts++;
+                        continue;
+                    }
+                    samples[transition * nr_devices * repetitions + nr_samples[transition]++] =
+                        latency > UINT32_MAX - 1 ? UINT32_MAX - 1 : latency;
+                }
+                if (ret)
+                    fprintf(stderr, "Could not set frequency of device %d:\n%s", devices[d],
+                            freq_gen_error_string());
+            }
+    }
+
+    if (freq_gen_restore(session, snapshot, snapshot_size))
+        fprintf(stderr, "Could not restore the previous settings:\n%s", freq_gen_error_string());
+    free(snapshot);
+    for (int i = 0; i < nr_frequencies; i++)
+        interface->unprepare_set_frequency(settings[i]);
+
+    freq_gen_latency_table_t* table = append ? freq_gen_latency_load(output) : NULL;
+    if (table == NULL)
+        table = freq_gen_latency_create();
+    if (ret == 0 && table != NULL)
+        ret = freq_gen_latency_add_matrix(table, type, interface->name, nr_frequencies,
+                                          frequencies);
+    for (int from = 0; from < nr_frequencies && ret == 0; from++)
+        for (int to = 0; to < nr_frequencies && ret == 0; to++)
+        {
+            int transition = from * nr_frequencies + to;
+            if (nr_samples[transition] > 0)
+                ret = freq_gen_latency_set_samples(table, type, from, to,
+                                                   &samples[transition * nr_devices * repetitions],
+                                                   nr_samples[transition]);
+        }
+    if (ret == 0 && table != NULL)
+        ret = freq_gen_latency_save(table, output);
+    if (ret || table == NULL)
+        fprintf(stderr, "Could not write latency table:\n%s", freq_gen_error_string());
+    else
+    {
+        /* print the median in us, rows are from and columns are to */
+        printf("%10s", "from\\to");
+        for (int to = 0; to < nr_frequencies; to++)
+            printf(" %9.3f", frequencies[to] / 1e9);
+        printf("\n");
+        for (int from = 0; from < nr_frequencies; from++)
+        {
+            printf("%10.3f", frequencies[from] / 1e9);
+            for (int to = 0; to < nr_frequencies; to++)
+            {
+                long long int latency = freq_gen_latency_get(
+                    table, type, frequencies[from], frequencies[to], FREQ_GEN_LATENCY_P50);
+                if (latency < 0)
+                    printf(" %9s", "-");
+                else
+                    printf(" %9.1f", latency / 1e3);
+            }
+            printf("\n");
+        }
+        if (timeouts > 0)
+            fprintf(stderr, "%d transitions did not complete within the timeout\n", timeouts);
+    }
+
+    freq_gen_latency_free(table);
+    free(samples);
+    free(nr_samples);
+    free(devices);
+    freq_gen_session_close(session);
+    interface->finalize();
+    return ret || table == NULL ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * freqgen_model.c
+ *
+ * Builds tuning models from text files and prints them, see freqgen_model.h
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <freqgen_model.h>
+#include <freqgen_util.h>
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s build <input> <model>\n", name);
+    fprintf(stderr, "       %s dump <model>\n", name);
+    fprintf(stderr, "  build  reads lines \"<region> <core frequency> <uncore frequency>\"\n");
+    fprintf(stderr, "         region is a name or an id starting with 0x, frequencies are e.g.\n");
+    fprintf(stderr, "         2.4GHz, 1800MHz or - to keep the frequency, # starts a comment\n");
+    fprintf(stderr, "  dump   prints all regions of a model\n");
+}
+
+static int build(const char* input, const char* output)
+{
+    FILE* file = fopen(input, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Could not open \"%s\": %s\n", input, strerror(errno));
+        return 1;
+    }
+    freq_gen_model_builder_t* builder = freq_gen_model_builder_create();
+    if (builder == NULL)
+    {
+        fprintf(stderr, "%s\n", freq_gen_error_string());
+        fclose(file);
+        return 1;
+    }
+    char* line = NULL;
+    size_t size = 0;
+    int result = 0;
+    for (int nr = 1; getline(&line, &size, file) > 0; nr++)
+    {
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        char region[256], core[64], uncore[64];
+        int fields = sscanf(line, "%255s %63s %63s", region, core, uncore);
+        if (fields <= 0)
+            continue;
+        long long int core_frequency, uncore_frequency;
+        if (fields != 3 || freq_gen_parse_frequency(core, &core_frequency) ||
+            freq_gen_parse_frequency(uncore, &uncore_frequency))
+        {
+            fprintf(stderr, "%s:%d: expected <region> <core frequency> <uncore frequency>\n",
+                    input, nr);
+            result = 1;
+            break;
+        }
+        uint64_t id = 0;
+        const char* name = region;
+        if (strncmp(region, "0x", 2) == 0)
+        {
+            id = strtoull(region, NULL, 16);
+            name = NULL;
+        }
+        if (freq_gen_model_builder_add(builder, id, name, core_frequency, uncore_frequency))
+        {
+            fprintf(stderr, "%s:%d: %s\n", input, nr, freq_gen_error_string());
+            result = 1;
+            break;
+        }
+    }
+    free(line);
+    fclose(file);
+    if (result == 0 && freq_gen_model_builder_save(builder, output))
+    {
+        fprintf(stderr, "%s\n", freq_gen_error_string());
+        result = 1;
+    }
+    freq_gen_model_builder_free(builder);
+    return result;
+}
+
+static void print_frequency(long long int frequency)
+{
+    if (frequency == FREQ_GEN_MODEL_KEEP)
+        printf(" %12s", "-");
+    else
+        printf(" %12lld", frequency);
+}
+
+static int dump(const char* path)
+{
+    freq_gen_model_t* model = freq_gen_model_open(path);
+    if (model == NULL)
+    {
+        fprintf(stderr, "%s\n", freq_gen_error_string());
+        return 1;
+    }
+    printf("%-18s %12s %12s %s\n", "id", "core", "uncore", "name");
+    for (int i = 0; i < freq_gen_model_get_num_regions(model); i++)
+    {
+        uint64_t id;
+        const char* name;
+        long long int core, uncore;
+        freq_gen_model_get_region(model, i, &id, &name, &core, &uncore);
+        printf("0x%016" PRIx64, id);
+        print_frequency(core);
+        print_frequency(uncore);
+        printf(" %s\n", name ? name : "");
+    }
+    freq_gen_model_close(model);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && strcmp(argv[1], "build") == 0)
+        return build(argv[2], argv[3]);
+    if (argc == 3 && strcmp(argv[1], "dump") == 0)
+        return dump(argv[2]);
+    usage(argv[0]);
+    return 1;
+}
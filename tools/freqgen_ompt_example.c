@@ -0,0 +1,130 @@
+/*
+ * freqgen_ompt_example.c
+ *
+ * A minimal OpenMP program for the OpenMP tool (libfreqgen-ompt.so) that runs without hardware
+ * access. It configures the sim interface (freqgen_sim.h) with one core per cpu, writes a model
+ * for its two parallel regions unless LIBFREQGEN_OMPT_MODEL is set, and then runs a compute-bound
+ * region ("compute", high core and low uncore frequency) and a memory-bound region ("stream", low
+ * core and high uncore frequency) in turns. At the end, it prints the simulated transitions and
+ * energy:
+ *
+ *     OMP_TOOL_LIBRARIES=libfreqgen-ompt.so freqgen-ompt-example
+ *
+ * The tool is initialized with the OpenMP runtime at the first parallel region, i.e., after the
+ * simulator has been configured and the environment has been set. Regions are named after the
+ * enclosing function, so the program is linked with -rdynamic. It needs a runtime with OMPT
+ * support, e.g., the LLVM OpenMP runtime.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <freqgen_model.h>
+#include <freqgen_sim.h>
+
+/* elements of the arrays of the stream region */
+#define STREAM_SIZE (1 << 22)
+
+static double a[STREAM_SIZE], b[STREAM_SIZE], c[STREAM_SIZE];
+
+/* not static, so that the tool can find the names */
+double compute(int iterations)
+{
+    double sum = 0;
+#pragma omp parallel for reduction(+ : sum)
+    for (int i = 0; i < iterations; i++)
+    {
+        double x = i;
+        for (int j = 0; j < 100; j++)
+            x = x * 0.999 + 1.0;
+        sum += x;
+    }
+    return sum;
+}
+
+void stream(double scalar)
+{
+#pragma omp parallel for
+    for (int i = 0; i < STREAM_SIZE; i++)
+        a[i] = b[i] + scalar * c[i];
+}
+
+/* writes a model for both regions to a temporary file, returns its path or NULL */
+static char* write_model(void)
+{
+    static char path[] = "/tmp/freqgen-ompt-example-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("Could not create a model file");
+        return NULL;
+    }
+    close(fd);
+    freq_gen_model_builder_t* builder = freq_gen_model_builder_create();
+    int ret = builder == NULL;
+    if (ret == 0)
+        ret = freq_gen_model_builder_add(builder, 0, "compute", 3000000000LL, 1200000000LL);
+    if (ret == 0)
+        ret = freq_gen_model_builder_add(builder, 0, "stream", 1600000000LL, 2400000000LL);
+    if (ret == 0)
+        ret = freq_gen_model_builder_save(builder, path);
+    freq_gen_model_builder_free(builder);
+    if (ret)
+    {
+        fprintf(stderr, "Could not write model:\n%s", freq_gen_error_string());
+        unlink(path);
+        return NULL;
+    }
+    return path;
+}
+
+int main(int argc, char** argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+
+    freq_gen_sim_config_t config;
+    freq_gen_sim_default_config(&config);
+    /* every thread binds the model to the cpu it runs on */
+    config.cores_per_package = sysconf(_SC_NPROCESSORS_CONF);
+    if (freq_gen_sim_configure(&config))
+    {
+        fprintf(stderr, "Could not configure the simulator:\n%s", freq_gen_error_string());
+        return 1;
+    }
+    char* model_path = NULL;
+    if (getenv("LIBFREQGEN_OMPT_MODEL") == NULL)
+    {
+        model_path = write_model();
+        if (model_path == NULL)
+            return 1;
+        setenv("LIBFREQGEN_OMPT_MODEL", model_path, 1);
+    }
+    setenv("LIBFREQGEN_OMPT_REPORT", "-", 0);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        b[i] = i;
+        c[i] = 2 * i;
+    }
+    double sum = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        sum += compute(1 << 20);
+        stream(round);
+    }
+
+    if (model_path != NULL)
+        unlink(model_path);
+    printf("checksum %g\n", sum + a[STREAM_SIZE - 1]);
+    printf("simulated transitions: core %" PRIu64 " uncore %" PRIu64 "\n",
+           freq_gen_sim_get_transitions(FREQ_GEN_DEVICE_CORE_FREQ),
+           freq_gen_sim_get_transitions(FREQ_GEN_DEVICE_UNCORE_FREQ));
+    printf("simulated energy: core %.3f J uncore %.3f J\n",
+           freq_gen_sim_get_energy(FREQ_GEN_DEVICE_CORE_FREQ),
+           freq_gen_sim_get_energy(FREQ_GEN_DEVICE_UNCORE_FREQ));
+    return 0;
+}
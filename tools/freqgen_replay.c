@@ -0,0 +1,523 @@
+/*
+ * freqgen_replay.c
+ *
+ * Replays a trace written with LIBFREQGEN_RECORD (or LIBFREQGEN_TRACE) against a backend and
+ * reports the latency of each kind of call, recorded and replayed, and the total time spent
+ * switching frequencies. Calls of all threads are replayed sequentially in the order they were
+ * issued, as fast as possible or with the recorded timing. Traces written with LIBFREQGEN_TRACE
+ * only contain set calls, the settings for them are prepared from the recorded frequencies.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <freqgen.h>
+#include <freqgen_trace.h>
+#include <freqgen_util.h>
+
+#define NR_OPS (FREQ_GEN_TRACE_FINALIZE + 1)
+
+static const char* op_names[NR_OPS] = {
+    [FREQ_GEN_TRACE_SET_FREQUENCY] = "set_frequency",
+    [FREQ_GEN_TRACE_SET_MIN_FREQUENCY] = "set_min_frequency",
+    [FREQ_GEN_TRACE_INIT] = "init",
+    [FREQ_GEN_TRACE_INIT_DEVICE] = "init_device",
+    [FREQ_GEN_TRACE_CLOSE_DEVICE] = "close_device",
+    [FREQ_GEN_TRACE_PREPARE] = "prepare_set_frequency",
+    [FREQ_GEN_TRACE_UNPREPARE] = "unprepare_set_frequency",
+    [FREQ_GEN_TRACE_GET_FREQUENCY] = "get_frequency",
+    [FREQ_GEN_TRACE_GET_MIN_FREQUENCY] = "get_min_frequency",
+    [FREQ_GEN_TRACE_GET_CURRENT_FREQUENCY] = "get_current_frequency",
+    [FREQ_GEN_TRACE_FINALIZE] = "finalize",
+};
+
+static const char* type_names[FREQ_GEN_DEVICE_NUM] = { "core", "uncore" };
+
+/* latencies of one kind of call */
+struct op_stats
+{
+    uint64_t calls;
+    uint64_t errors;  /**< calls that failed during the replay */
+    uint64_t skipped; /**< calls that could not be replayed, e.g., for missing devices */
+    double recorded_ns;
+    double* replayed_ns; /**< one entry per replayed call */
+    size_t size;
+};
+
+/* a setting prepared from a frequency, for set calls without a recorded prepare */
+struct value_setting
+{
+    long long int frequency;
+    freq_gen_setting_t setting;
+};
+
+/* everything that is needed for one device type */
+struct device_type
+{
+    freq_gen_interface_t* interface;
+    bool init_failed;
+    int nr_devices;
+    freq_gen_single_device_t* handles; /**< -1 if not opened */
+    struct value_setting* value_settings;
+    int nr_value_settings;
+    char recorded_backend[64];
+    struct op_stats stats[NR_OPS];
+};
+
+static struct device_type device_types[FREQ_GEN_DEVICE_NUM];
+
+/* settings by recorded id */
+static freq_gen_setting_t* settings;
+static freq_gen_dev_type* setting_types;
+static uint32_t nr_settings;
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] <trace file>\n"
+            "Options:\n"
+            "  -c <interface>  core interface (likwid, msr, sim, sysfs, x86_adapt)\n"
+            "  -u <interface>  uncore interface (likwid, msr, sim, x86_adapt)\n"
+            "  -t              keep the recorded time between calls instead of replaying them\n"
+            "                  as fast as possible\n",
+            name);
+}
+
+static int compare_events(const void* a, const void* b)
+{
+    const freq_gen_trace_event_t* event_a = a;
+    const freq_gen_trace_event_t* event_b = b;
+    if (event_a->tsc_begin != event_b->tsc_begin)
+        return event_a->tsc_begin < event_b->tsc_begin ? -1 : 1;
+    /* the events of a thread are in order, keep it for calls within one tick */
+    return event_a->tsc_end < event_b->tsc_end ? -1 : event_a->tsc_end > event_b->tsc_end;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : da > db;
+}
+
+static int add_replayed(struct op_stats* stats, double ns)
+{
+    if (stats->calls == stats->size)
+    {
+        size_t size = stats->size ? stats->size * 2 : 64;
+        double* tmp = realloc(stats->replayed_ns, size * sizeof(double));
+        if (tmp == NULL)
+            return ENOMEM;
+        stats->replayed_ns = tmp;
+        stats->size = size;
+    }
+    stats->replayed_ns[stats->calls++] = ns;
+    return 0;
+}
+
+static struct device_type* get_device_type(freq_gen_dev_type type)
+{
+    struct device_type* device_type = &device_types[type];
+    if (device_type->interface == NULL && !device_type->init_failed)
+    {
+        device_type->interface = freq_gen_init(type);
+        if (device_type->interface == NULL)
+        {
+            fprintf(stderr, "Could not initialize %s interface: %s\n", type_names[type],
+                    freq_gen_error_string());
+            device_type->init_failed = true;
+            return NULL;
+        }
+        device_type->nr_devices = device_type->interface->get_num_devices();
+        if (device_type->nr_devices < 0)
+            device_type->nr_devices = 0;
+        device_type->handles = malloc(device_type->nr_devices * sizeof(freq_gen_single_device_t));
+        if (device_type->nr_devices > 0 && device_type->handles == NULL)
+        {
+            fprintf(stderr, "Could not allocate memory for %d devices\n",
+                    device_type->nr_devices);
+            device_type->init_failed = true;
+            device_type->interface->finalize();
+            device_type->interface = NULL;
+            return NULL;
+        }
+        for (int i = 0; i < device_type->nr_devices; i++)
+            device_type->handles[i] = -1;
+    }
+    return device_type->interface != NULL ? device_type : NULL;
+}
+
+/* returns the handle of a device, opening it if the trace did not record init_device */
+static freq_gen_single_device_t get_handle(struct device_type* device_type, int device)
+{
+    if (device < 0 || device >= device_type->nr_devices)
+        return -1;
+    if (device_type->handles[device] < 0)
+        device_type->handles[device] = device_type->interface->init_device(device);
+    return device_type->handles[device];
+}
+
+/* returns the setting for a set call, preparing one if the trace did not record the prepare */
+static freq_gen_setting_t get_setting(struct device_type* device_type, freq_gen_dev_type type,
+                                      const freq_gen_trace_event_t* event)
+{
+    if (event->setting != 0 && event->setting < nr_settings &&
+        settings[event->setting] != NULL && setting_types[event->setting] == type)
+        return settings[event->setting];
+    for (int i = 0; i < device_type->nr_value_settings; i++)
+        if (device_type->value_settings[i].frequency == event->value)
+            return device_type->value_settings[i].setting;
+    struct value_setting* tmp =
+        realloc(device_type->value_settings,
+                (device_type->nr_value_settings + 1) * sizeof(struct value_setting));
+    if (tmp == NULL)
+        return NULL;
+    device_type->value_settings = tmp;
+    freq_gen_setting_t setting = device_type->interface->prepare_set_frequency(event->value, 0);
+    if (setting != NULL)
+    {
+        tmp[device_type->nr_value_settings].frequency = event->value;
+        tmp[device_type->nr_value_settings].setting = setting;
+        device_type->nr_value_settings++;
+    }
+    return setting;
+}
+
+/*
+ * Replays a single call.
+ * @return the time the call took in ns, or -1 if it could not be replayed
+ */
+static double replay(const freq_gen_trace_event_t* event, bool* failed)
+{
+    uint64_t begin, end;
+    *failed = false;
+    /* corrupt or from a newer version of the library */
+    if (event->type >= FREQ_GEN_DEVICE_NUM)
+        return -1;
+    freq_gen_dev_type type = event->type;
+    if (event->op == FREQ_GEN_TRACE_INIT)
+    {
+        if (device_types[type].interface != NULL || device_types[type].init_failed)
+            return -1;
+        begin = freq_gen_now_ns();
+        *failed = get_device_type(type) == NULL;
+        end = freq_gen_now_ns();
+        return end - begin;
+    }
+    struct device_type* device_type = get_device_type(type);
+    if (device_type == NULL)
+        return -1;
+    freq_gen_interface_t* interface = device_type->interface;
+    freq_gen_single_device_t handle;
+    freq_gen_setting_t setting;
+    long long int frequency;
+
+    switch (event->op)
+    {
+    case FREQ_GEN_TRACE_INIT_DEVICE:
+        if (event->device < 0 || event->device >= device_type->nr_devices ||
+            device_type->handles[event->device] >= 0)
+            return -1;
+        begin = freq_gen_now_ns();
+        handle = interface->init_device(event->device);
+        end = freq_gen_now_ns();
+        device_type->handles[event->device] = handle;
+        *failed = handle < 0;
+        return end - begin;
+    case FREQ_GEN_TRACE_CLOSE_DEVICE:
+        if (event->device < 0 || event->device >= device_type->nr_devices ||
+            device_type->handles[event->device] < 0)
+            return -1;
+        begin = freq_gen_now_ns();
+        interface->close_device(event->device, device_type->handles[event->device]);
+        end = freq_gen_now_ns();
+        device_type->handles[event->device] = -1;
+        return end - begin;
+    case FREQ_GEN_TRACE_PREPARE:
+        if (event->setting == 0 || event->setting >= nr_settings || settings[event->setting])
+            return -1;
+        begin = freq_gen_now_ns();
+        setting = interface->prepare_set_frequency(event->value, event->device);
+        end = freq_gen_now_ns();
+        settings[event->setting] = setting;
+        setting_types[event->setting] = type;
+        *failed = setting == NULL;
+        return end - begin;
+    case FREQ_GEN_TRACE_UNPREPARE:
+        if (event->setting == 0 || event->setting >= nr_settings ||
+            settings[event->setting] == NULL || setting_types[event->setting] != type)
+            return -1;
+        begin = freq_gen_now_ns();
+        interface->unprepare_set_frequency(settings[event->setting]);
+        end = freq_gen_now_ns();
+        settings[event->setting] = NULL;
+        return end - begin;
+    case FREQ_GEN_TRACE_SET_FREQUENCY:
+    case FREQ_GEN_TRACE_SET_MIN_FREQUENCY:
+    {
+        int (*set)(freq_gen_single_device_t, freq_gen_setting_t) =
+            event->op == FREQ_GEN_TRACE_SET_FREQUENCY ? interface->set_frequency
+                                                      : interface->set_min_frequency;
+        handle = get_handle(device_type, event->device);
+        setting = get_setting(device_type, type, event);
+        if (set == NULL || handle < 0 || setting == NULL)
+            return -1;
+        begin = freq_gen_now_ns();
+        *failed = set(handle, setting) != 0;
+        end = freq_gen_now_ns();
+        return end - begin;
+    }
+    case FREQ_GEN_TRACE_GET_FREQUENCY:
+    case FREQ_GEN_TRACE_GET_MIN_FREQUENCY:
+    case FREQ_GEN_TRACE_GET_CURRENT_FREQUENCY:
+    {
+        long long int (*get)(freq_gen_single_device_t) =
+            event->op == FREQ_GEN_TRACE_GET_FREQUENCY
+                ? interface->get_frequency
+                : event->op == FREQ_GEN_TRACE_GET_MIN_FREQUENCY ? interface->get_min_frequency
+                                                                : interface->get_current_frequency;
+        handle = get_handle(device_type, event->device);
+        if (get == NULL || handle < 0)
+            return -1;
+        begin = freq_gen_now_ns();
+        frequency = get(handle);
+        end = freq_gen_now_ns();
+        *failed = frequency < 0;
+        return end - begin;
+    }
+    default:
+        return -1;
+    }
+}
+
+static double percentile(const struct op_stats* stats, double p)
+{
+    size_t index = (size_t)(p * stats->calls + 0.5);
+    if (index > 0)
+        index--;
+    if (index >= stats->calls)
+        index = stats->calls - 1;
+    return stats->replayed_ns[index];
+}
+
+static void report(double replay_ns, double recorded_span_ns, uint64_t nr_events)
+{
+    printf("%llu calls replayed in %.3f ms, recorded in %.3f ms\n\n",
+           (unsigned long long)nr_events, replay_ns / 1e6, recorded_span_ns / 1e6);
+    printf("%-6s %-23s %8s %6s %7s %12s %12s %12s %12s %12s\n", "type", "call", "calls",
+           "errors", "skipped", "recorded_ns", "mean_ns", "p50_ns", "p99_ns", "max_ns");
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        for (int op = 1; op < NR_OPS; op++)
+        {
+            struct op_stats* stats = &device_types[type].stats[op];
+            uint64_t recorded = stats->calls + stats->skipped;
+            if (recorded == 0)
+                continue;
+            double sum = 0;
+            for (uint64_t i = 0; i < stats->calls; i++)
+                sum += stats->replayed_ns[i];
+            qsort(stats->replayed_ns, stats->calls, sizeof(double), compare_doubles);
+            printf("%-6s %-23s %8llu %6llu %7llu %12.0f", type_names[type], op_names[op],
+                   (unsigned long long)stats->calls, (unsigned long long)stats->errors,
+                   (unsigned long long)stats->skipped, stats->recorded_ns / recorded);
+            if (stats->calls > 0)
+                printf(" %12.0f %12.0f %12.0f %12.0f\n", sum / stats->calls,
+                       percentile(stats, 0.5), percentile(stats, 0.99),
+                       stats->replayed_ns[stats->calls - 1]);
+            else
+                printf(" %12s %12s %12s %12s\n", "-", "-", "-", "-");
+        }
+    }
+    printf("\n");
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        struct device_type* device_type = &device_types[type];
+        double recorded = 0, replayed = 0;
+        bool any = false;
+        for (int op = FREQ_GEN_TRACE_SET_FREQUENCY; op <= FREQ_GEN_TRACE_SET_MIN_FREQUENCY; op++)
+        {
+            struct op_stats* stats = &device_type->stats[op];
+            any |= stats->calls + stats->skipped > 0;
+            recorded += stats->recorded_ns;
+            for (uint64_t i = 0; i < stats->calls; i++)
+                replayed += stats->replayed_ns[i];
+        }
+        if (!any)
+            continue;
+        printf("%s switch overhead: %.3f us recorded (%s), %.3f us replayed (%s)\n",
+               type_names[type], recorded / 1e3,
+               device_type->recorded_backend[0] ? device_type->recorded_backend : "unknown",
+               replayed / 1e3,
+               device_type->interface ? device_type->interface->name : "not initialized");
+    }
+}
+
+static void cleanup(void)
+{
+    for (uint32_t i = 0; i < nr_settings; i++)
+        if (settings[i] != NULL)
+            device_types[setting_types[i]].interface->unprepare_set_frequency(settings[i]);
+    free(settings);
+    free(setting_types);
+    for (int type = 0; type < FREQ_GEN_DEVICE_NUM; type++)
+    {
+        struct device_type* device_type = &device_types[type];
+        for (int i = 0; i < device_type->nr_value_settings; i++)
+            device_type->interface->unprepare_set_frequency(device_type->value_settings[i].setting);
+        free(device_type->value_settings);
+        for (int i = 0; i < device_type->nr_devices; i++)
+            if (device_type->handles[i] >= 0)
+                device_type->interface->close_device(i, device_type->handles[i]);
+        free(device_type->handles);
+        if (device_type->interface != NULL)
+            device_type->interface->finalize();
+        for (int op = 0; op < NR_OPS; op++)
+            free(device_type->stats[op].replayed_ns);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool timed = false;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc)
+            setenv("LIBFREQGEN_CORE_INTERFACE", argv[++arg], 1);
+        else if (strcmp(argv[arg], "-u") == 0 && arg + 1 < argc)
+            setenv("LIBFREQGEN_UNCORE_INTERFACE", argv[++arg], 1);
+        else if (strcmp(argv[arg], "-t") == 0)
+            timed = true;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (arg + 1 != argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    freq_gen_trace_reader_t* reader = freq_gen_trace_reader_open(argv[arg]);
+    if (reader == NULL)
+    {
+        fprintf(stderr, "%s\n", freq_gen_error_string());
+        return 1;
+    }
+    double tsc_hz = freq_gen_trace_reader_tsc_hz(reader);
+    freq_gen_trace_event_t* events = NULL;
+    freq_gen_trace_event_t event;
+    size_t nr_events = 0, size = 0;
+    int ret;
+    while ((ret = freq_gen_trace_reader_next(reader, &event)) == 1)
+    {
+        if (nr_events == size)
+        {
+            size = size ? size * 2 : 1024;
+            freq_gen_trace_event_t* tmp = realloc(events, size * sizeof(freq_gen_trace_event_t));
+            if (tmp == NULL)
+            {
+                ret = -ENOMEM;
+                break;
+            }
+            events = tmp;
+        }
+        events[nr_events++] = event;
+    }
+    if (ret < 0)
+    {
+        fprintf(stderr, "Could not read %s: %s\n", argv[arg], strerror(-ret));
+        freq_gen_trace_reader_close(reader);
+        free(events);
+        return 1;
+    }
+    if (freq_gen_trace_reader_dropped(reader) > 0)
+        fprintf(stderr, "Warning: %llu calls have not been recorded\n",
+                (unsigned long long)freq_gen_trace_reader_dropped(reader));
+    qsort(events, nr_events, sizeof(freq_gen_trace_event_t), compare_events);
+
+    nr_settings = 1;
+    for (size_t i = 0; i < nr_events; i++)
+    {
+        if (events[i].setting >= nr_settings)
+            nr_settings = events[i].setting + 1;
+        const char* backend = freq_gen_trace_reader_backend(reader, events[i].backend);
+        if (events[i].type < FREQ_GEN_DEVICE_NUM && backend != NULL)
+            snprintf(device_types[events[i].type].recorded_backend,
+                     sizeof(device_types[events[i].type].recorded_backend), "%s", backend);
+    }
+    settings = calloc(nr_settings, sizeof(freq_gen_setting_t));
+    setting_types = calloc(nr_settings, sizeof(freq_gen_dev_type));
+    if (settings == NULL || setting_types == NULL)
+    {
+        fprintf(stderr, "Could not allocate memory for %u settings\n", nr_settings);
+        freq_gen_trace_reader_close(reader);
+        free(events);
+        free(settings);
+        free(setting_types);
+        return 1;
+    }
+
+    size_t nr_invalid = 0;
+    uint64_t first_tsc = nr_events ? events[0].tsc_begin : 0;
+    uint64_t last_tsc = first_tsc;
+    uint64_t start = freq_gen_now_ns();
+    for (size_t i = 0; i < nr_events; i++)
+    {
+        const freq_gen_trace_event_t* event = &events[i];
+        /* neither a device type nor an operation of this version of the library */
+        if (event->type >= FREQ_GEN_DEVICE_NUM || event->op == 0 ||
+            event->op > FREQ_GEN_TRACE_FINALIZE)
+        {
+            nr_invalid++;
+            continue;
+        }
+        /* finalize is done once all calls have been replayed */
+        if (event->op == FREQ_GEN_TRACE_FINALIZE)
+            continue;
+        if (event->tsc_end > last_tsc)
+            last_tsc = event->tsc_end;
+        if (timed)
+        {
+            uint64_t target = start + (event->tsc_begin - first_tsc) / tsc_hz * 1e9;
+            struct timespec ts = { .tv_sec = target / 1000000000ULL,
+                                   .tv_nsec = target % 1000000000ULL };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+                ;
+        }
+        bool failed = false;
+        double ns = replay(event, &failed);
+        struct op_stats* stats = &device_types[event->type].stats[event->op];
+        stats->recorded_ns += (event->tsc_end - event->tsc_begin) / tsc_hz * 1e9;
+        if (ns < 0)
+            stats->skipped++;
+        else if (add_replayed(stats, ns) != 0)
+        {
+            fprintf(stderr, "Could not allocate memory for the results\n");
+            ret = ENOMEM;
+            break;
+        }
+        else if (failed)
+            stats->errors++;
+    }
+    uint64_t end = freq_gen_now_ns();
+    freq_gen_trace_reader_close(reader);
+    free(events);
+    if (nr_invalid > 0)
+        fprintf(stderr, "Warning: skipped %zu calls with an unknown device type or operation\n",
+                nr_invalid);
+
+    if (ret == 0)
+        report(end - start, (last_tsc - first_tsc) / tsc_hz * 1e9, nr_events);
+    cleanup();
+    return ret == 0 ? 0 : 1;
+}
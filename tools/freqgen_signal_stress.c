@@ -0,0 +1,316 @@
+/*
+ * freqgen_signal_stress.c
+ *
+ * Stress test of the async-signal-safe set path (see freqgen_signal.h). A SIGPROF timer applies
+ * two signal settings of a device in turns while threads spin and the main thread allocates and
+ * frees memory, so that handlers interrupt both user code and malloc. On exit, the counters of
+ * all threads are compared with the number of handled signals: every handler must have applied
+ * its setting successfully and preserved errno.
+ *
+ *  Created on: 19.10.2026
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <freqgen.h>
+#include <freqgen_session.h>
+#include <freqgen_signal.h>
+#include <freqgen_snapshot.h>
+#include <freqgen_util.h>
+
+/* errno seen by the applying code, must be unchanged afterwards */
+#define ERRNO_CANARY 12345
+
+/* allocations that are kept alive by the malloc loop */
+#define NR_BLOCKS 64
+
+static freq_gen_signal_setting_t* signal_settings[2];
+
+static atomic_int stop;
+static _Atomic uint64_t handled;
+static _Atomic uint64_t clobbered;
+
+/* sums of the counters of all threads */
+static _Atomic uint64_t applied;
+static _Atomic uint64_t failed;
+static atomic_int last_error;
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] -f <freq>,<freq>\n"
+            "Options:\n"
+            "  -c <interface>  core interface (msr, sysfs)\n"
+            "  -u <interface>  uncore interface (msr)\n"
+            "  -t core|uncore  device type (default core)\n"
+            "  -d <device>     device to switch (default 0)\n"
+            "  -m              apply the frequencies like set_min_frequency\n"
+            "  -r <rate>       SIGPROF rate in Hz of consumed cpu time (default 10000)\n"
+            "  -n <threads>    number of spinning threads (default 4)\n"
+            "  -s <seconds>    duration (default 5)\n"
+            "Frequencies can have a suffix GHz, MHz, kHz or Hz (default).\n",
+            name);
+}
+
+static void handle_sigprof(int signal)
+{
+    (void)signal;
+    int saved_errno = errno;
+    uint64_t number = atomic_fetch_add_explicit(&handled, 1, memory_order_relaxed);
+    errno = ERRNO_CANARY;
+    freq_gen_signal_apply(signal_settings[number & 1]);
+    if (errno != ERRNO_CANARY)
+        atomic_fetch_add_explicit(&clobbered, 1, memory_order_relaxed);
+    errno = saved_errno;
+}
+
+/* blocks SIGPROF, so the counters of the thread are final, and adds them to the sums */
+static void collect_stats(void)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    freq_gen_signal_stats_t stats;
+    freq_gen_signal_get_stats(&stats, 1);
+    atomic_fetch_add(&applied, stats.applied);
+    atomic_fetch_add(&failed, stats.failed);
+    if (stats.failed > 0)
+        atomic_store(&last_error, stats.last_error);
+}
+
+static void* spin_thread_main(void* arg)
+{
+    (void)arg;
+    uint64_t x = 1;
+    while (!atomic_load_explicit(&stop, memory_order_relaxed))
+    {
+        x = x * 3 + 1;
+        __asm__ volatile("" : "+r"(x));
+    }
+    collect_stats();
+    return NULL;
+}
+
+/* allocates blocks of varying size until end, returns the number of allocations */
+static uint64_t malloc_loop(uint64_t end_ns)
+{
+    void* blocks[NR_BLOCKS] = { NULL };
+    uint64_t allocations = 0;
+    uint32_t random = 1;
+    while (freq_gen_now_ns() < end_ns)
+    {
+        random = random * 1103515245U + 12345U;
+        int index = (random >> 8) % NR_BLOCKS;
+        size_t size = 16 + (random >> 16) % 65536;
+        free(blocks[index]);
+        blocks[index] = malloc(size);
+        if (blocks[index] != NULL)
+            memset(blocks[index], (int)allocations, size < 256 ? size : 256);
+        allocations++;
+    }
+    for (int i = 0; i < NR_BLOCKS; i++)
+        free(blocks[i]);
+    return allocations;
+}
+
+int main(int argc, char** argv)
+{
+    freq_gen_dev_type type = FREQ_GEN_DEVICE_CORE_FREQ;
+    const char* frequency_list = NULL;
+    int device = 0;
+    int min = 0;
+    long rate = 10000;
+    int nr_threads = 4;
+    int seconds = 5;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:u:t:d:f:mr:n:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            setenv("LIBFREQGEN_CORE_INTERFACE", optarg, 1);
+            break;
+        case 'u':
+            setenv("LIBFREQGEN_UNCORE_INTERFACE", optarg, 1);
+            break;
+        case 't':
+            if (strcmp(optarg, "core") == 0)
+                type = FREQ_GEN_DEVICE_CORE_FREQ;
+            else if (strcmp(optarg, "uncore") == 0)
+                type = FREQ_GEN_DEVICE_UNCORE_FREQ;
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd':
+            device = atoi(optarg);
+            break;
+        case 'f':
+            frequency_list = optarg;
+            break;
+        case 'm':
+            min = 1;
+            break;
+        case 'r':
+            rate = atol(optarg);
+            break;
+        case 'n':
+            nr_threads = atoi(optarg);
+            break;
+        case 's':
+            seconds = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frequency_list == NULL || rate <= 0 || rate > 1000000 || nr_threads < 0 || seconds <= 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    long long int frequencies[2];
+    const char* comma = strchr(frequency_list, ',');
+    char first[64];
+    if (comma == NULL || comma - frequency_list >= (long)sizeof(first))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    memcpy(first, frequency_list, comma - frequency_list);
+    first[comma - frequency_list] = '\0';
+    if (freq_gen_parse_frequency(first, &frequencies[0]) ||
+        freq_gen_parse_frequency(comma + 1, &frequencies[1]))
+    {
+        fprintf(stderr, "Invalid frequencies \"%s\"\n", frequency_list);
+        return 1;
+    }
+
+    freq_gen_interface_t* interface = freq_gen_init(type);
+    if (interface == NULL)
+    {
+        fprintf(stderr, "Could not initialize interface:\n%s", freq_gen_error_string());
+        return 1;
+    }
+    freq_gen_session_t* session = freq_gen_session_open(interface, &device, 1);
+    if (session == NULL)
+    {
+        fprintf(stderr, "Could not open device %d:\n%s", device, freq_gen_error_string());
+        return 1;
+    }
+    void* snapshot = NULL;
+    size_t snapshot_size;
+    if (freq_gen_snapshot(session, &snapshot, &snapshot_size))
+    {
+        fprintf(stderr, "Could not save the current settings:\n%s", freq_gen_error_string());
+        return 1;
+    }
+    freq_gen_single_device_t handle = freq_gen_session_get_handle(session, 0);
+    for (int i = 0; i < 2; i++)
+    {
+        freq_gen_setting_t setting = interface->prepare_set_frequency(frequencies[i], 0);
+        if (setting == NULL)
+        {
+            fprintf(stderr, "Could not prepare frequency %lld:\n%s", frequencies[i],
+                    freq_gen_error_string());
+            return 1;
+        }
+        signal_settings[i] = freq_gen_signal_setting_create(interface, handle, setting, min);
+        interface->unprepare_set_frequency(setting);
+        if (signal_settings[i] == NULL)
+        {
+            fprintf(stderr, "Could not create signal setting:\n%s", freq_gen_error_string());
+            return 1;
+        }
+    }
+
+    struct sigaction action = { .sa_handler = handle_sigprof, .sa_flags = SA_RESTART };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    pthread_t* threads = malloc(nr_threads * sizeof(pthread_t));
+    if (threads == NULL && nr_threads > 0)
+    {
+        fprintf(stderr, "Could not allocate memory for %d threads\n", nr_threads);
+        return 1;
+    }
+    int nr_started = 0;
+    for (; nr_started < nr_threads; nr_started++)
+        if (pthread_create(&threads[nr_started], NULL, spin_thread_main, NULL))
+        {
+            fprintf(stderr, "Could not start thread %d\n", nr_started);
+            break;
+        }
+
+    struct timeval interval = { .tv_sec = 1000000 / rate / 1000000,
+                                .tv_usec = 1000000 / rate % 1000000 };
+    struct itimerval timer = { .it_interval = interval, .it_value = interval };
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    uint64_t allocations = malloc_loop(freq_gen_now_ns() + seconds * 1000000000ULL);
+
+    struct itimerval disarm = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_PROF, &disarm, NULL);
+    atomic_store(&stop, 1);
+    for (int i = 0; i < nr_started; i++)
+        pthread_join(threads[i], NULL);
+    collect_stats();
+    free(threads);
+
+    if (freq_gen_restore(session, snapshot, snapshot_size))
+        fprintf(stderr, "Could not restore the previous settings:\n%s", freq_gen_error_string());
+    free(snapshot);
+    for (int i = 0; i < 2; i++)
+        freq_gen_signal_setting_free(signal_settings[i]);
+    freq_gen_session_close(session);
+    interface->finalize();
+
+    uint64_t nr_handled = atomic_load(&handled);
+    uint64_t nr_applied = atomic_load(&applied);
+    uint64_t nr_failed = atomic_load(&failed);
+    uint64_t nr_clobbered = atomic_load(&clobbered);
+    printf("signals %" PRIu64 " applied %" PRIu64 " failed %" PRIu64 " errno clobbered %" PRIu64
+           " allocations %" PRIu64 "\n",
+           nr_handled, nr_applied, nr_failed, nr_clobbered, allocations);
+
+    int ret = 0;
+    if (nr_handled == 0)
+    {
+        fprintf(stderr, "No signal was handled, increase the rate or duration\n");
+        ret = 1;
+    }
+    if (nr_applied + nr_failed != nr_handled)
+    {
+        fprintf(stderr, "The counters of the threads do not match the handled signals\n");
+        ret = 1;
+    }
+    if (nr_failed > 0)
+    {
+        fprintf(stderr, "Applying failed, last error: %s\n", strerror(atomic_load(&last_error)));
+        ret = 1;
+    }
+    if (nr_clobbered > 0)
+    {
+        fprintf(stderr, "errno was not preserved\n");
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,118 @@
+/*
+ * freqgen_status.c
+ *
+ * Prints the status page written by processes that run with LIBFREQGEN_STATUS=1
+ *
+ *  Created on: 19.10.2026
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <freqgen_status.h>
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-n <node>] [-a] [-w <interval in s>]\n", name);
+    fprintf(stderr, "  -n  read the status page of another node (default: this node)\n");
+    fprintf(stderr, "  -a  also print devices that have never been changed\n");
+    fprintf(stderr, "  -w  print the status page periodically\n");
+}
+
+static void print_entries(const char* type, const freq_gen_status_entry_t* entries, int nr,
+                          int all, double now)
+{
+    for (int i = 0; i < nr; i++)
+    {
+        if (!all && entries[i].timestamp == 0)
+            continue;
+        printf("%-6s %6d %12lld %12lld", type, i, (long long int)entries[i].frequency,
+               (long long int)entries[i].min_frequency);
+        if (entries[i].timestamp == 0)
+            printf(" %12s %8s\n", "-", "-");
+        else
+            printf(" %12.3f %8u\n", now - entries[i].timestamp / 1e9, entries[i].pid);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* node = NULL;
+    int all = 0;
+    double interval = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:aw:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            node = optarg;
+            break;
+        case 'a':
+            all = 1;
+            break;
+        case 'w':
+            interval = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    freq_gen_status_reader_t* reader = freq_gen_status_open(node);
+    if (reader == NULL)
+    {
+        fprintf(stderr, "Could not open the status page: %s\n", strerror(errno));
+        return 1;
+    }
+    int nr_cores = freq_gen_status_get_num_devices(reader, FREQ_GEN_DEVICE_CORE_FREQ);
+    int nr_uncores = freq_gen_status_get_num_devices(reader, FREQ_GEN_DEVICE_UNCORE_FREQ);
+    freq_gen_status_entry_t* cores = malloc(nr_cores * sizeof(freq_gen_status_entry_t));
+    freq_gen_status_entry_t* uncores = malloc(nr_uncores * sizeof(freq_gen_status_entry_t));
+    if (cores == NULL || uncores == NULL)
+    {
+        fprintf(stderr, "Could not allocate memory\n");
+        return 1;
+    }
+
+    int ret = 0;
+    do
+    {
+        ret = freq_gen_status_read(reader, cores, uncores);
+        if (ret)
+        {
+            fprintf(stderr, "Could not read the status page: %s\n", strerror(ret));
+            break;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        double seconds = now.tv_sec + now.tv_nsec / 1e9;
+        printf("%-6s %6s %12s %12s %12s %8s\n", "type", "device", "frequency", "min", "age [s]",
+               "pid");
+        print_entries("core", cores, nr_cores, all, seconds);
+        print_entries("uncore", uncores, nr_uncores, all, seconds);
+        if (interval > 0)
+        {
+            printf("\n");
+            fflush(stdout);
+            struct timespec sleep = { .tv_sec = (time_t)interval,
+                                      .tv_nsec = (long)((interval - (time_t)interval) * 1e9) };
+            nanosleep(&sleep, NULL);
+        }
+    } while (interval > 0);
+
+    free(cores);
+    free(uncores);
+    freq_gen_status_close(reader);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * freqgen_trace.c
+ *
+ * Converts trace files written with LIBFREQGEN_TRACE to CSV or Chrome trace JSON
+ *
+ *  Created on: 19.10.2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <freqgen_trace.h>
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s csv|chrome <trace file> [<output file>]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || argc > 4)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    FILE* out = stdout;
+    if (argc == 4)
+    {
+        out = fopen(argv[3], "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Could not open %s for writing\n", argv[3]);
+            return 1;
+        }
+    }
+    int ret;
+    if (strcmp(argv[1], "csv") == 0)
+        ret = freq_gen_trace_convert_csv(argv[2], out);
+    else if (strcmp(argv[1], "chrome") == 0)
+        ret = freq_gen_trace_convert_chrome(argv[2], out);
+    else
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (out != stdout)
+        fclose(out);
+    if (ret)
+    {
+        fprintf(stderr, "%s", freq_gen_error_string());
+        return 1;
+    }
+    return 0;
+}